@@ -14,7 +14,11 @@
 #include "hoxLog.h"
 #include "hoxUtil.h"
 
+#include <pthread.h>
 #include <sqlite3.h>
+#include <climits>
+#include <map>
+#include <vector>
 
 /* ------------------------------------------------------------------------- *
  * Constants
@@ -22,35 +26,196 @@
 
 #define DB_NAME  "../database/hoxserver.db"
 
+/* How long (in milliseconds) to wait for a lock held by another connection. */
+#define DB_BUSY_TIMEOUT  5000
+
+/* The tables created if missing:
+ *  - The last sequence number saved from each source (a server's outbox).
+ *  - The completed Games, looked up by either Player, the most recent first.
+ */
+#define DB_SCHEMA_SQL \
+    "CREATE TABLE IF NOT EXISTS outbox_marks" \
+    " (source TEXT PRIMARY KEY, seq INTEGER NOT NULL);" \
+    "CREATE TABLE IF NOT EXISTS games" \
+    " (gid INTEGER PRIMARY KEY AUTOINCREMENT, ended INTEGER NOT NULL," \
+    "  red TEXT NOT NULL, black TEXT NOT NULL, status TEXT NOT NULL," \
+    "  type INTEGER NOT NULL, red_score INTEGER, black_score INTEGER," \
+    "  moves INTEGER);" \
+    "CREATE INDEX IF NOT EXISTS games_by_red ON games (red, gid);" \
+    "CREATE INDEX IF NOT EXISTS games_by_black ON games (black, gid);"
+
+/* The suffix of the source of the Games (marked apart from the results). */
+#define GAMES_MARK_SUFFIX  "/games"
 
 /* ------------------------------------------------------------------------- *
  * Private API
  * ------------------------------------------------------------------------- */
 
-static int
-_callback_GET( void *pArg, 
-               int  argc, 
-               char **argv, 
-               char **azColName )
+/**
+ * The prepared statements of a connection.
+ */
+enum StatementId
 {
-    hoxDBAPI::Player_t* player = (hoxDBAPI::Player_t*) pArg;
-    //hoxLog(LOG_DEBUG, "%s: argc=[%d]. Player-Id = [%s].", __FUNCTION__, argc, player->id.c_str());
+    STMT_PLAYER_PUT,
+    STMT_PLAYER_GET,
+    STMT_PLAYER_SET,
+    STMT_PLAYERS_SCORES,
+    STMT_PROFILE_SET,
+    STMT_PASSWORD_SET,
+    STMT_MARK_GET,
+    STMT_MARK_SET,
+    STMT_GAME_PUT,
+    STMT_GAMES_GET,
+    STMT_BEGIN,
+    STMT_COMMIT,
+    STMT_ROLLBACK,
+
+    STMT_MAX
+};
+
+static const char* s_statementSQL[STMT_MAX] =
+{
+    /* STMT_PLAYER_PUT */
+    "INSERT INTO players (pid, score, hpassword, email) VALUES (?1, ?2, ?3, ?4)",
+
+    /* STMT_PLAYER_GET */
+    "SELECT score, wins, draws, losses, hpassword, email FROM players"
+    " WHERE pid = ?1 LIMIT 1",
+
+    /* STMT_PLAYER_SET: The game's result adds 1 to one of the counts. */
+    "UPDATE players SET score = ?2,"
+    " wins = wins + ?3, draws = draws + ?4, losses = losses + ?5"
+    " WHERE pid = ?1",
+
+    /* STMT_PLAYERS_SCORES */
+    "SELECT pid, score FROM players",
+
+    /* STMT_PROFILE_SET: The password is kept if NULL. */
+    "UPDATE players SET email = ?2, hpassword = COALESCE(?3, hpassword)"
+    " WHERE pid = ?1",
+
+    /* STMT_PASSWORD_SET */
+    "UPDATE players SET hpassword = ?2 WHERE pid = ?1",
+
+    /* STMT_MARK_GET: The last sequence number saved from a source. */
+    "SELECT seq FROM outbox_marks WHERE source = ?1",
+
+    /* STMT_MARK_SET */
+    "INSERT OR REPLACE INTO outbox_marks (source, seq) VALUES (?1, ?2)",
+
+    /* STMT_GAME_PUT */
+    "INSERT INTO games (ended, red, black, status, type, red_score, black_score, moves)"
+    " VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8)",
+
+    /* STMT_GAMES_GET: The Games as Red and those as Black, each read
+     * backwards from the cursor along its index, then merged.
+     * The opponent (?3) is optional.
+     */
+    "SELECT gid, ended, red, black, status, type, red_score, black_score, moves FROM"
+    " (SELECT * FROM (SELECT * FROM games WHERE red = ?1 AND gid < ?2"
+    "                 AND (?3 IS NULL OR black = ?3) ORDER BY gid DESC LIMIT ?4)"
+    "  UNION ALL"
+    "  SELECT * FROM (SELECT * FROM games WHERE black = ?1 AND gid < ?2"
+    "                 AND (?3 IS NULL OR red = ?3) ORDER BY gid DESC LIMIT ?4))"
+    " ORDER BY gid DESC LIMIT ?4",
+
+    /* STMT_BEGIN: Take the write lock now rather than at the first UPDATE. */
+    "BEGIN IMMEDIATE",
+
+    /* STMT_COMMIT */
+    "COMMIT",
+
+    /* STMT_ROLLBACK */
+    "ROLLBACK"
+};
+
+/**
+ * The long-lived connection of a worker thread, with its statements
+ * prepared once when it is opened.
+ */
+struct Connection
+{
+    sqlite3*      db;
+    sqlite3_stmt* stmts[STMT_MAX];
+};
+
+static pthread_key_t  s_connectionKey;
+static pthread_once_t s_connectionOnce = PTHREAD_ONCE_INIT;
+
+static void
+_free_connection( void* arg )
+{
+    Connection* conn = (Connection*) arg;
+
+    for ( int i = 0; i < STMT_MAX; ++i )
+    {
+        sqlite3_finalize( conn->stmts[i] );  // NULL is harmless.
+    }
+    sqlite3_close( conn->db );
+    delete conn;
+}
+
+static void
+_create_connection_key()
+{
+    /* The connection is freed when its thread exits. */
+    pthread_key_create( &s_connectionKey, _free_connection );
+}
+
+/**
+ * Get the calling thread's connection, opening it if needed.
+ *
+ * @return NULL if the connection cannot be opened.
+ */
+static Connection*
+_get_connection()
+{
+    pthread_once( &s_connectionOnce, _create_connection_key );
+
+    Connection* conn = (Connection*) pthread_getspecific( s_connectionKey );
+    if ( conn == NULL && hoxRC_OK == hoxDBAPI::open_connection() )
+    {
+        conn = (Connection*) pthread_getspecific( s_connectionKey );
+    }
+    return conn;
+}
+
+static void
+_bind_text( sqlite3_stmt*      stmt,
+            int                index,
+            const std::string& sValue )
+{
+    /* NOTE: The value is not copied. It must outlive the statement's step. */
+    sqlite3_bind_text( stmt, index, sValue.c_str(), (int) sValue.size(), SQLITE_STATIC );
+}
+
+static std::string
+_column_text( sqlite3_stmt* stmt,
+              int           column )
+{
+    const unsigned char* szText = sqlite3_column_text( stmt, column );
+    return ( szText ? (const char*) szText : "" );
+}
+
+/**
+ * Run a (bound) statement that returns no rows, then reset it.
+ */
+static hoxResult
+_execute( Connection*   conn,
+          sqlite3_stmt* stmt,
+          const char*   FNAME )
+{
+    const int rc = sqlite3_step( stmt );
+    sqlite3_reset( stmt );
+    sqlite3_clear_bindings( stmt );
 
-    std::string sColumn;
-    for ( int i = 0; i < argc; i++ )
+    if ( rc != SQLITE_DONE )
     {
-        sColumn = ( azColName[i] ? azColName[i] : "" );
-        //hoxLog(LOG_DEBUG, "... %s = %s", sColumn.c_str(), argv[i] ? argv[i] : "NULL");
-
-        if      ( sColumn == "score" )     player->score  = ::atoi( argv[i] );
-        else if ( sColumn == "wins" )      player->wins   = ::atoi( argv[i] );
-        else if ( sColumn == "draws" )     player->draws  = ::atoi( argv[i] );
-        else if ( sColumn == "losses" )    player->losses = ::atoi( argv[i] );
-        else if ( sColumn == "hpassword" ) player->hpw    = argv[i];
-        else if ( sColumn == "email" )     player->email  = argv[i];
+        hoxLog(LOG_ERROR, "%s: SQL error: [%s].", FNAME, sqlite3_errmsg( conn->db ));
+        return hoxRC_ERR;
     }
-    
-    return 0;
+
+    return hoxRC_OK;
 }
 
 /* ------------------------------------------------------------------------- *
@@ -58,90 +223,136 @@ _callback_GET( void *pArg,
  * ------------------------------------------------------------------------- */
 
 hoxResult
-hoxDBAPI::put_player_info( const Player_t&    playerInfo,
-                           const std::string& sEmail )
+hoxDBAPI::open_connection()
 {
-    const char* FNAME = "hoxDBAPI::put_player_info";
-    sqlite3*    db = NULL;
-    int         rc = 0;
+    const char* FNAME = "hoxDBAPI::open_connection";
     char*       szErrMsg = NULL;
-    std::string sSQL;
 
-    hoxLog(LOG_DEBUG, "%s: ENTER. pid = [%s].", FNAME, playerInfo.id.c_str());
+    pthread_once( &s_connectionOnce, _create_connection_key );
 
-    rc = sqlite3_open( DB_NAME, &db );
-    if( rc != SQLITE_OK )
+    if ( pthread_getspecific( s_connectionKey ) != NULL )
     {
-        hoxLog(LOG_ERROR, "%s: Can't open database: [%s].", FNAME, sqlite3_errmsg(db));
-        sqlite3_close( db );
-        return hoxRC_ERR;
+        return hoxRC_OK;  // Already opened.
     }
 
-    sSQL = std::string("INSERT INTO players (pid, score, hpassword, email) VALUES ")
-        + "('" + playerInfo.id + "'"
-        + " ,'" + hoxUtil::intToString( playerInfo.score ) + "'"
-        + " ,'" + playerInfo.hpw + "'"
-        + " ,'" + sEmail + "'"
-        + ")";
+    Connection* conn = new Connection;
+    conn->db = NULL;
+    for ( int i = 0; i < STMT_MAX; ++i ) conn->stmts[i] = NULL;
 
-    rc = sqlite3_exec( db, 
-                       sSQL.c_str(), 
-                       NULL,  /* callback  */
-                       NULL,  /* 1st argument to callback */
-                       &szErrMsg );
+    if ( SQLITE_OK != sqlite3_open( DB_NAME, &conn->db ) )
+    {
+        hoxLog(LOG_ERROR, "%s: Can't open database: [%s].", FNAME, sqlite3_errmsg(conn->db));
+        _free_connection( conn );
+        return hoxRC_ERR;
+    }
+
+    /* With WAL journaling, readers and the writer do not block each other
+     * and a commit needs no fsync of the database file.
+     */
+    sqlite3_busy_timeout( conn->db, DB_BUSY_TIMEOUT );
+    if ( SQLITE_OK != sqlite3_exec( conn->db,
+                                    "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;",
+                                    NULL, NULL, &szErrMsg ) )
+    {
+        hoxLog(LOG_WARN, "%s: Failed to set WAL mode: [%s].", FNAME, szErrMsg);
+        sqlite3_free( szErrMsg );
+        // NOTE: *** Still allow to continue.
+    }
 
-    if( rc != SQLITE_OK )
+    if ( SQLITE_OK != sqlite3_exec( conn->db, DB_SCHEMA_SQL, NULL, NULL, &szErrMsg ) )
     {
-        hoxLog(LOG_ERROR, "%s: SQL error: [%s].", FNAME, szErrMsg);
-        sqlite3_close( db );
+        hoxLog(LOG_ERROR, "%s: Failed to create the tables: [%s].", FNAME, szErrMsg);
+        sqlite3_free( szErrMsg );
+        _free_connection( conn );
         return hoxRC_ERR;
     }
 
-    sqlite3_close( db );
+    for ( int i = 0; i < STMT_MAX; ++i )
+    {
+        if ( SQLITE_OK != sqlite3_prepare_v2( conn->db, s_statementSQL[i], -1,
+                                              &conn->stmts[i], NULL ) )
+        {
+            hoxLog(LOG_ERROR, "%s: Failed to prepare [%s]: [%s].", FNAME,
+                s_statementSQL[i], sqlite3_errmsg(conn->db));
+            _free_connection( conn );
+            return hoxRC_ERR;
+        }
+    }
 
+    pthread_setspecific( s_connectionKey, conn );
+    hoxLog(LOG_DEBUG, "%s: Database [%s] opened.", FNAME, DB_NAME);
     return hoxRC_OK;
 }
 
+void
+hoxDBAPI::close_connection()
+{
+    pthread_once( &s_connectionOnce, _create_connection_key );
+
+    Connection* conn = (Connection*) pthread_getspecific( s_connectionKey );
+    if ( conn != NULL )
+    {
+        pthread_setspecific( s_connectionKey, NULL );
+        _free_connection( conn );
+    }
+}
+
+hoxResult
+hoxDBAPI::put_player_info( const Player_t&    playerInfo,
+                           const std::string& sEmail )
+{
+    const char* FNAME = "hoxDBAPI::put_player_info";
+
+    hoxLog(LOG_DEBUG, "%s: ENTER. pid = [%s].", FNAME, playerInfo.id.c_str());
+
+    Connection* conn = _get_connection();
+    if ( conn == NULL ) return hoxRC_ERR;
+
+    sqlite3_stmt* stmt = conn->stmts[STMT_PLAYER_PUT];
+    _bind_text( stmt, 1, playerInfo.id );
+    sqlite3_bind_int( stmt, 2, playerInfo.score );
+    _bind_text( stmt, 3, playerInfo.hpw );
+    _bind_text( stmt, 4, sEmail );
+
+    return _execute( conn, stmt, FNAME );
+}
+
 hoxResult
 hoxDBAPI::get_player_info( const std::string& pid,
                            Player_t&          playerInfo )
 {
     const char* FNAME = "hoxDBAPI::get_player_info";
-    sqlite3*    db = NULL;
-    int         rc = 0;
-    char*       szErrMsg = NULL;
-    std::string sSQL;
+    hoxResult   result = hoxRC_OK;
 
     hoxLog(LOG_DEBUG, "%s: ENTER. pid = [%s].", FNAME, pid.c_str());
 
     playerInfo.id = pid;
 
-    rc = sqlite3_open( DB_NAME, &db );
-    if( rc != SQLITE_OK )
-    {
-        hoxLog(LOG_ERROR, "%s: Can't open database: [%s].", FNAME, sqlite3_errmsg(db));
-        sqlite3_close( db );
-        return hoxRC_ERR;
-    }
+    Connection* conn = _get_connection();
+    if ( conn == NULL ) return hoxRC_ERR;
 
-    sSQL = "SELECT * FROM players WHERE pid = '" + pid + "'" + "LIMIT 1";
+    sqlite3_stmt* stmt = conn->stmts[STMT_PLAYER_GET];
+    _bind_text( stmt, 1, pid );
 
-    rc = sqlite3_exec( db, 
-                       sSQL.c_str(), 
-                       _callback_GET, 
-                       &playerInfo, /* 1st argument to callback */
-                       &szErrMsg );
-
-    if( rc != SQLITE_OK )
+    const int rc = sqlite3_step( stmt );
+    if ( rc == SQLITE_ROW )
     {
-        hoxLog(LOG_ERROR, "%s: SQL error: [%s].", FNAME, szErrMsg);
-        sqlite3_close( db );
-        return hoxRC_ERR;
+        playerInfo.score  = sqlite3_column_int( stmt, 0 );
+        playerInfo.wins   = sqlite3_column_int( stmt, 1 );
+        playerInfo.draws  = sqlite3_column_int( stmt, 2 );
+        playerInfo.losses = sqlite3_column_int( stmt, 3 );
+        playerInfo.hpw    = _column_text( stmt, 4 );
+        playerInfo.email  = _column_text( stmt, 5 );
+    }
+    else if ( rc != SQLITE_DONE )  // Not "no such Player"?
+    {
+        hoxLog(LOG_ERROR, "%s: SQL error: [%s].", FNAME, sqlite3_errmsg(conn->db));
+        result = hoxRC_ERR;
     }
 
-    sqlite3_close( db );
-
-    return hoxRC_OK;
+    sqlite3_reset( stmt );
+    sqlite3_clear_bindings( stmt );
+    return result;
 }
 
 hoxResult
@@ -149,127 +360,385 @@ hoxDBAPI::set_player_info( const Player_t&    playerInfo,
                            const std::string& sGameResult )
 {
     const char* FNAME = "hoxDBAPI::set_player_info";
-    sqlite3*    db = NULL;
-    int         rc = 0;
-    char*       szErrMsg = NULL;
-    std::string sSQL;
 
     hoxLog(LOG_DEBUG, "%s: ENTER. pid = [%s].", FNAME, playerInfo.id.c_str());
 
-    rc = sqlite3_open( DB_NAME, &db );
-    if( rc != SQLITE_OK )
+    Connection* conn = _get_connection();
+    if ( conn == NULL ) return hoxRC_ERR;
+
+    sqlite3_stmt* stmt = conn->stmts[STMT_PLAYER_SET];
+    _bind_text( stmt, 1, playerInfo.id );
+    sqlite3_bind_int( stmt, 2, playerInfo.score );
+    sqlite3_bind_int( stmt, 3, ( sGameResult == "W" ? 1 : 0 ) );
+    sqlite3_bind_int( stmt, 4, ( sGameResult == "D" ? 1 : 0 ) );
+    sqlite3_bind_int( stmt, 5, ( sGameResult == "L" ? 1 : 0 ) );
+
+    return _execute( conn, stmt, FNAME );
+}
+
+/**
+ * Get the last sequence number saved from a source (0 if none).
+ */
+static hoxResult
+_get_mark( Connection*        conn,
+           const std::string& sSource,
+           long long&         mark )
+{
+    const char* FNAME = "_get_mark";
+
+    mark = 0;
+
+    sqlite3_stmt* stmt = conn->stmts[STMT_MARK_GET];
+    _bind_text( stmt, 1, sSource );
+
+    const int rc = sqlite3_step( stmt );
+    if ( rc == SQLITE_ROW )
     {
-        hoxLog(LOG_ERROR, "%s: Can't open database: [%s].", FNAME, sqlite3_errmsg(db));
-        sqlite3_close( db );
+        mark = sqlite3_column_int64( stmt, 0 );
+    }
+
+    sqlite3_reset( stmt );
+    sqlite3_clear_bindings( stmt );
+
+    if ( rc != SQLITE_ROW && rc != SQLITE_DONE )
+    {
+        hoxLog(LOG_ERROR, "%s: SQL error: [%s].", FNAME, sqlite3_errmsg(conn->db));
         return hoxRC_ERR;
     }
+    return hoxRC_OK;
+}
 
-    sSQL = "UPDATE players SET score = '" 
-        + hoxUtil::intToString(playerInfo.score) + "'";
-    if      ( sGameResult == "W" ) sSQL += ", wins = wins+1";
-    else if ( sGameResult == "D" ) sSQL += ", draws = draws+1";
-    else if ( sGameResult == "L" ) sSQL += ", losses = losses+1";
-    sSQL += " WHERE pid = '" + playerInfo.id + "'";
+/**
+ * Set the last sequence number saved from a source.
+ */
+static hoxResult
+_set_mark( Connection*        conn,
+           const std::string& sSource,
+           long long          mark )
+{
+    sqlite3_stmt* stmt = conn->stmts[STMT_MARK_SET];
+    _bind_text( stmt, 1, sSource );
+    sqlite3_bind_int64( stmt, 2, mark );
 
-    rc = sqlite3_exec( db, 
-                       sSQL.c_str(), 
-                       NULL,
-                       NULL, /* 1st argument to callback */
-                       &szErrMsg );
+    return _execute( conn, stmt, "_set_mark" );
+}
 
-    if( rc != SQLITE_OK )
+/**
+ * Save the results (within the transaction begun by the caller).
+ */
+static hoxResult
+_set_players_info( Connection*                       conn,
+                   const hoxDBAPI::PlayerResultList& results,
+                   const std::string&                sSource,
+                   hoxDBAPI::PlayerList&             saved )
+{
+    const char* FNAME = "_set_players_info";
+
+    long long mark = 0;
+    if ( ! sSource.empty() && hoxRC_OK != _get_mark( conn, sSource, mark ) )
     {
-        hoxLog(LOG_ERROR, "%s: SQL error: [%s].", FNAME, szErrMsg);
-        sqlite3_close( db );
         return hoxRC_ERR;
     }
 
-    sqlite3_close( db );
+    /* Merge the results of each Player, skipping those saved already. */
+    typedef std::map<std::string, size_t> IndexMap;
+    IndexMap                        indexes;
+    std::vector<hoxDBAPI::Player_t> players;
+    long long                       lastSeq  = mark;
+    int                             nSkipped = 0;
+
+    for ( hoxDBAPI::PlayerResultList::const_iterator it = results.begin();
+                                                     it != results.end(); ++it )
+    {
+        if ( ! sSource.empty() && it->seq <= mark )
+        {
+            ++nSkipped;
+            continue;
+        }
+        if ( it->seq > lastSeq ) lastSeq = it->seq;
+
+        IndexMap::iterator found = indexes.find( it->info.id );
+        if ( found == indexes.end() )
+        {
+            indexes[it->info.id] = players.size();
+            players.push_back( it->info );
+            continue;
+        }
+
+        hoxDBAPI::Player_t& player = players[found->second];
+        player.score   = it->info.score;  // The latest.
+        player.wins   += it->info.wins;
+        player.draws  += it->info.draws;
+        player.losses += it->info.losses;
+    }
 
+    if ( nSkipped > 0 )
+    {
+        hoxLog(LOG_INFO, "%s: Skip [%d] results of [%s] saved already (up to [%lld]).",
+            FNAME, nSkipped, sSource.c_str(), mark);
+    }
+
+    sqlite3_stmt* stmt = conn->stmts[STMT_PLAYER_SET];
+    for ( std::vector<hoxDBAPI::Player_t>::const_iterator it = players.begin();
+                                                          it != players.end(); ++it )
+    {
+        _bind_text( stmt, 1, it->id );
+        sqlite3_bind_int( stmt, 2, it->score );
+        sqlite3_bind_int( stmt, 3, it->wins );
+        sqlite3_bind_int( stmt, 4, it->draws );
+        sqlite3_bind_int( stmt, 5, it->losses );
+
+        if ( hoxRC_OK != _execute( conn, stmt, FNAME ) )
+        {
+            return hoxRC_ERR;
+        }
+    }
+
+    if (   ! sSource.empty() && lastSeq > mark
+        && hoxRC_OK != _set_mark( conn, sSource, lastSeq ) )
+    {
+        return hoxRC_ERR;
+    }
+
+    saved.assign( players.begin(), players.end() );
     return hoxRC_OK;
 }
 
 hoxResult
-hoxDBAPI::set_profile_info( const std::string& pid,
-                            const std::string& sEmail,
-                            const std::string& sPassword )
+hoxDBAPI::set_players_info( const PlayerResultList& results,
+                            const std::string&      sSource,
+                            PlayerList&             saved )
 {
-    const char* FNAME = "hoxDBAPI::set_profile_info";
-    sqlite3*    db = NULL;
-    int         rc = 0;
-    char*       szErrMsg = NULL;
-    std::string sSQL;
+    const char* FNAME = "hoxDBAPI::set_players_info";
 
-    hoxLog(LOG_DEBUG, "%s: ENTER. pid = [%s].", FNAME, pid.c_str());
+    hoxLog(LOG_DEBUG, "%s: ENTER. # of results = [%d], source = [%s].",
+        FNAME, results.size(), sSource.c_str());
+
+    Connection* conn = _get_connection();
+    if ( conn == NULL ) return hoxRC_ERR;
 
-    rc = sqlite3_open( DB_NAME, &db );
-    if( rc != SQLITE_OK )
+    if ( hoxRC_OK != _execute( conn, conn->stmts[STMT_BEGIN], FNAME ) )
     {
-        hoxLog(LOG_ERROR, "%s: Can't open database: [%s].", FNAME, sqlite3_errmsg(db));
-        sqlite3_close( db );
         return hoxRC_ERR;
     }
 
-    sSQL = "UPDATE players SET email = '" + sEmail + "'";
-    if ( ! sPassword.empty() ) sSQL += ", hpassword = '" + sPassword + "'";
-    sSQL += " WHERE pid = '" + pid + "'";
+    /* The mark is read and moved within the same transaction as the
+     * results, so that a result is never saved twice.
+     */
+    if (   hoxRC_OK != _set_players_info( conn, results, sSource, saved )
+        || hoxRC_OK != _execute( conn, conn->stmts[STMT_COMMIT], FNAME ) )
+    {
+        (void) _execute( conn, conn->stmts[STMT_ROLLBACK], FNAME );
+        return hoxRC_ERR;
+    }
+
+    return hoxRC_OK;
+}
 
-    rc = sqlite3_exec( db, 
-                       sSQL.c_str(), 
-                       NULL,
-                       NULL, /* 1st argument to callback */
-                       &szErrMsg );
+/**
+ * Save the Games (within the transaction begun by the caller).
+ */
+static hoxResult
+_put_games( Connection*                     conn,
+            const hoxDBAPI::GameRecordList& games,
+            const std::string&              sSource )
+{
+    const char* FNAME = "_put_games";
 
-    if( rc != SQLITE_OK )
+    const std::string sMarkSource = sSource + GAMES_MARK_SUFFIX;
+    long long         mark = 0;
+    if ( ! sSource.empty() && hoxRC_OK != _get_mark( conn, sMarkSource, mark ) )
     {
-        hoxLog(LOG_ERROR, "%s: SQL error: [%s].", FNAME, szErrMsg);
-        sqlite3_close( db );
         return hoxRC_ERR;
     }
 
-    sqlite3_close( db );
+    long long     lastSeq  = mark;
+    int           nSkipped = 0;
+    sqlite3_stmt* stmt     = conn->stmts[STMT_GAME_PUT];
+
+    for ( hoxDBAPI::GameRecordList::const_iterator it = games.begin();
+                                                   it != games.end(); ++it )
+    {
+        if ( ! sSource.empty() && it->seq <= mark )
+        {
+            ++nSkipped;
+            continue;
+        }
+        if ( it->seq > lastSeq ) lastSeq = it->seq;
+
+        const hoxDBAPI::Game_t& game = it->info;
+        sqlite3_bind_int64( stmt, 1, game.ended );
+        _bind_text( stmt, 2, game.red );
+        _bind_text( stmt, 3, game.black );
+        _bind_text( stmt, 4, game.status );
+        sqlite3_bind_int( stmt, 5, game.type );
+        sqlite3_bind_int( stmt, 6, game.redScore );
+        sqlite3_bind_int( stmt, 7, game.blackScore );
+        sqlite3_bind_int( stmt, 8, game.moves );
+
+        if ( hoxRC_OK != _execute( conn, stmt, FNAME ) )
+        {
+            return hoxRC_ERR;
+        }
+    }
+
+    if ( nSkipped > 0 )
+    {
+        hoxLog(LOG_INFO, "%s: Skip [%d] Games of [%s] saved already (up to [%lld]).",
+            FNAME, nSkipped, sSource.c_str(), mark);
+    }
+
+    if (   ! sSource.empty() && lastSeq > mark
+        && hoxRC_OK != _set_mark( conn, sMarkSource, lastSeq ) )
+    {
+        return hoxRC_ERR;
+    }
 
     return hoxRC_OK;
 }
 
 hoxResult
-hoxDBAPI::set_player_password( const Player_t& playerInfo )
+hoxDBAPI::put_games( const GameRecordList& games,
+                     const std::string&    sSource )
 {
-    const char* FNAME = "hoxDBAPI::set_player_password";
-    sqlite3*    db = NULL;
-    int         rc = 0;
-    char*       szErrMsg = NULL;
-    std::string sSQL;
+    const char* FNAME = "hoxDBAPI::put_games";
 
-    hoxLog(LOG_DEBUG, "%s: ENTER. pid = [%s].", FNAME, playerInfo.id.c_str());
+    hoxLog(LOG_DEBUG, "%s: ENTER. # of games = [%d], source = [%s].",
+        FNAME, games.size(), sSource.c_str());
 
-    rc = sqlite3_open( DB_NAME, &db );
-    if( rc != SQLITE_OK )
+    Connection* conn = _get_connection();
+    if ( conn == NULL ) return hoxRC_ERR;
+
+    if ( hoxRC_OK != _execute( conn, conn->stmts[STMT_BEGIN], FNAME ) )
     {
-        hoxLog(LOG_ERROR, "%s: Can't open database: [%s].", FNAME, sqlite3_errmsg(db));
-        sqlite3_close( db );
         return hoxRC_ERR;
     }
 
-    sSQL = "UPDATE players SET hpassword = '" + playerInfo.hpw + "'"
-        + " WHERE pid = '" + playerInfo.id + "'";
+    if (   hoxRC_OK != _put_games( conn, games, sSource )
+        || hoxRC_OK != _execute( conn, conn->stmts[STMT_COMMIT], FNAME ) )
+    {
+        (void) _execute( conn, conn->stmts[STMT_ROLLBACK], FNAME );
+        return hoxRC_ERR;
+    }
 
-    rc = sqlite3_exec( db, 
-                       sSQL.c_str(), 
-                       NULL,
-                       NULL, /* 1st argument to callback */
-                       &szErrMsg );
+    return hoxRC_OK;
+}
 
-    if( rc != SQLITE_OK )
+hoxResult
+hoxDBAPI::get_games( const std::string& pid,
+                     const std::string& oid,
+                     long long          cursor,
+                     int                nLimit,
+                     GameList&          games )
+{
+    const char* FNAME = "hoxDBAPI::get_games";
+    hoxResult   result = hoxRC_OK;
+
+    hoxLog(LOG_DEBUG, "%s: ENTER. pid = [%s], oid = [%s], cursor = [%lld].",
+        FNAME, pid.c_str(), oid.c_str(), cursor);
+
+    Connection* conn = _get_connection();
+    if ( conn == NULL ) return hoxRC_ERR;
+
+    sqlite3_stmt* stmt = conn->stmts[STMT_GAMES_GET];
+    _bind_text( stmt, 1, pid );
+    sqlite3_bind_int64( stmt, 2, ( cursor > 0 ? cursor : LLONG_MAX ) );
+    if ( ! oid.empty() ) _bind_text( stmt, 3, oid );  // ... else NULL.
+    sqlite3_bind_int( stmt, 4, nLimit );
+
+    int rc;
+    while ( SQLITE_ROW == ( rc = sqlite3_step( stmt ) ) )
     {
-        hoxLog(LOG_ERROR, "%s: SQL error: [%s].", FNAME, szErrMsg);
-        sqlite3_close( db );
-        return hoxRC_ERR;
+        Game_t game;
+        game.id         = sqlite3_column_int64( stmt, 0 );
+        game.ended      = (long) sqlite3_column_int64( stmt, 1 );
+        game.red        = _column_text( stmt, 2 );
+        game.black      = _column_text( stmt, 3 );
+        game.status     = _column_text( stmt, 4 );
+        game.type       = sqlite3_column_int( stmt, 5 );
+        game.redScore   = sqlite3_column_int( stmt, 6 );
+        game.blackScore = sqlite3_column_int( stmt, 7 );
+        game.moves      = sqlite3_column_int( stmt, 8 );
+        games.push_back( game );
+    }
+
+    if ( rc != SQLITE_DONE )
+    {
+        hoxLog(LOG_ERROR, "%s: SQL error: [%s].", FNAME, sqlite3_errmsg(conn->db));
+        result = hoxRC_ERR;
     }
 
-    sqlite3_close( db );
+    sqlite3_reset( stmt );
+    sqlite3_clear_bindings( stmt );
+    return result;
+}
 
-    return hoxRC_OK;
+hoxResult
+hoxDBAPI::get_players_scores( PlayerList& players )
+{
+    const char* FNAME = "hoxDBAPI::get_players_scores";
+    hoxResult   result = hoxRC_OK;
+
+    Connection* conn = _get_connection();
+    if ( conn == NULL ) return hoxRC_ERR;
+
+    sqlite3_stmt* stmt = conn->stmts[STMT_PLAYERS_SCORES];
+    int           rc;
+
+    while ( SQLITE_ROW == ( rc = sqlite3_step( stmt ) ) )
+    {
+        Player_t playerInfo;
+        playerInfo.id    = _column_text( stmt, 0 );
+        playerInfo.score = sqlite3_column_int( stmt, 1 );
+        players.push_back( playerInfo );
+    }
+
+    if ( rc != SQLITE_DONE )
+    {
+        hoxLog(LOG_ERROR, "%s: SQL error: [%s].", FNAME, sqlite3_errmsg(conn->db));
+        result = hoxRC_ERR;
+    }
+
+    sqlite3_reset( stmt );
+    return result;
+}
+
+hoxResult
+hoxDBAPI::set_profile_info( const std::string& pid,
+                            const std::string& sEmail,
+                            const std::string& sPassword )
+{
+    const char* FNAME = "hoxDBAPI::set_profile_info";
+
+    hoxLog(LOG_DEBUG, "%s: ENTER. pid = [%s].", FNAME, pid.c_str());
+
+    Connection* conn = _get_connection();
+    if ( conn == NULL ) return hoxRC_ERR;
+
+    sqlite3_stmt* stmt = conn->stmts[STMT_PROFILE_SET];
+    _bind_text( stmt, 1, pid );
+    _bind_text( stmt, 2, sEmail );
+    if ( sPassword.empty() ) sqlite3_bind_null( stmt, 3 );
+    else                     _bind_text( stmt, 3, sPassword );
+
+    return _execute( conn, stmt, FNAME );
+}
+
+hoxResult
+hoxDBAPI::set_player_password( const Player_t& playerInfo )
+{
+    const char* FNAME = "hoxDBAPI::set_player_password";
+
+    hoxLog(LOG_DEBUG, "%s: ENTER. pid = [%s].", FNAME, playerInfo.id.c_str());
+
+    Connection* conn = _get_connection();
+    if ( conn == NULL ) return hoxRC_ERR;
+
+    sqlite3_stmt* stmt = conn->stmts[STMT_PASSWORD_SET];
+    _bind_text( stmt, 1, playerInfo.id );
+    _bind_text( stmt, 2, playerInfo.hpw );
+
+    return _execute( conn, stmt, FNAME );
 }
 
 /******************* END OF FILE *********************************************/
@@ -14,6 +14,7 @@
 #define __INCLUDED_HOX_DB_API_H_
 
 #include <string>
+#include <list>
 #include "hoxEnums.h"
 
 namespace hoxDBAPI
@@ -32,6 +33,64 @@ namespace hoxDBAPI
         int           losses;
         std::string   email;
     };
+    typedef std::list<Player_t> PlayerList;
+
+    /**
+     * The result of a game for a Player, numbered within its source
+     * (a server's outbox) so that one sent again can be told apart.
+     */
+    class PlayerResult_t
+    {
+    public:
+        PlayerResult_t() : seq( 0 ) {}
+
+        long long     seq;   // The sequence number (0 if none).
+        Player_t      info;  // With the counts to be ADDED.
+    };
+    typedef std::list<PlayerResult_t> PlayerResultList;
+
+    class Game_t
+    {
+    public:
+        Game_t() : id( 0 ), ended( 0 ), type( 0 )
+                 , redScore( 0 ), blackScore( 0 ), moves( 0 ) {}
+
+        long long     id;       // Game-Id (the order in which Games are saved).
+        long          ended;    // When the Game ended (seconds since the Epoch).
+        std::string   red;      // The Player-Ids.
+        std::string   black;
+        std::string   status;   // The result ("red_win", "black_win", "drawn",...)
+        int           type;     // The game-type (0 = rated, 1 = non-rated,...)
+        int           redScore; // The scores after the Game.
+        int           blackScore;
+        int           moves;    // The number of Moves.
+    };
+    typedef std::list<Game_t> GameList;
+
+    /**
+     * A completed Game, numbered within its source (a server's outbox).
+     */
+    class GameRecord_t
+    {
+    public:
+        GameRecord_t() : seq( 0 ) {}
+
+        long long     seq;   // The sequence number (0 if none).
+        Game_t        info;
+    };
+    typedef std::list<GameRecord_t> GameRecordList;
+
+    /**
+     * Open the database connection of the calling (worker) thread and
+     * prepare its statements. The other API opens it if needed, and it
+     * is closed when the thread exits.
+     */
+    hoxResult open_connection();
+
+    /**
+     * Close the database connection of the calling thread, if any.
+     */
+    void close_connection();
 
     /**
      * Put (create) the Info of a NEW Player.
@@ -63,6 +122,57 @@ namespace hoxDBAPI
     set_player_info( const Player_t&    playerInfo,
                      const std::string& sGameResult );
 
+    /**
+     * Set Info of many Players at once, in a single transaction.
+     *
+     * The results of a Player are merged (the last score, the counts
+     * summed) into a single update. If the source is given, the last
+     * sequence number saved from it is kept in the same transaction, and
+     * the results up to that number (sent again) are skipped.
+     *
+     * @param results The results to be saved, in their order.
+     * @param sSource [OPTIONAL] The source of the results.
+     * @param saved   [OUT] The Players saved, with their new scores.
+     */
+    hoxResult
+    set_players_info( const PlayerResultList& results,
+                      const std::string&      sSource,
+                      PlayerList&             saved );
+
+    /**
+     * Put (save) many completed Games at once, in a single transaction.
+     *
+     * If the source is given, the Games up to the last sequence number
+     * saved from it (sent again) are skipped, as with Players' results.
+     *
+     * @param games   The Games to be saved, in their order.
+     * @param sSource [OPTIONAL] The source of the Games.
+     */
+    hoxResult
+    put_games( const GameRecordList& games,
+               const std::string&    sSource );
+
+    /**
+     * Get the Games of a Player, the most recent first.
+     *
+     * @param pid     The Player-Id.
+     * @param oid     [OPTIONAL] The opponent's Id (the head-to-head Games).
+     * @param cursor  Get only the Games older than this Game-Id (0 for all).
+     * @param nLimit  The most Games to get.
+     */
+    hoxResult
+    get_games( const std::string& pid,
+               const std::string& oid,
+               long long          cursor,
+               int                nLimit,
+               GameList&          games );
+
+    /**
+     * Get the scores of all the Players (only their Ids and scores are set).
+     */
+    hoxResult
+    get_players_scores( PlayerList& players );
+
     /**
      * Set Info of a Profile.
      *
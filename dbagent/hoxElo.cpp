@@ -0,0 +1,145 @@
+//
+// C++ Implementation: hoxElo
+//
+// Description: The (Elo) Rating System.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include "hoxElo.h"
+
+// =========================================================================
+//                  >>>> Elo Rating System <<<
+//
+//  References:
+//  ----------
+//     http://en.wikipedia.org/wiki/Elo_rating_system
+//     http://www.chesselo.com
+//     http://gobase.org/studying/articles/elo
+//
+//  Table of Winning Probability:
+//  ---------------------------------------------------------
+//   Rating Difference | Stronger Player | Weaker Player
+//    0                    0.50              0.50
+//    25                   0.53	             0.47
+//    50                   0.57	             0.43
+//    100                  0.64	             0.36
+//    150                  0.70              0.30
+//    200                  0.76              0.24
+//    250                  0.81              0.19
+//    300                  0.85              0.15
+//    350 (FIDE)           0.89              0.11
+//  ----------------------------------------------------------
+//
+// Calculating K-factor:
+// ---------------------
+// Use FIDE rules to determine the K-factor:
+//
+//  (1) K-factor = 25 for players new to the rating list, until they have
+//                    completed events with a total of at least 30 games;
+//  (2) K-factor = 15 for players with a rating under 2400;
+//  (3) K-factor = 10 once the player has reached 2400 and been registered
+//                    for at least 30 games. Thereafter it remains permanently
+//                    at 10, even if the player' s rating is under 2400 at
+//                    a later stage.
+//
+//
+//  Calculating New Rating:
+//  -----------------------
+//     New Rating = Old Rating + K-factor * (Result - Expected Result)
+//
+// =========================================================================
+
+namespace
+{
+    struct WinningProbability_t
+    {
+        int    ratingDiff;
+        float  strongerPlayer;
+        float  weakerPlayer;
+    };
+
+    const WinningProbability_t s_winningProbabilities[] =
+    {
+       // Diff | Stronger | Weaker
+        { 0,      0.50,   0.50 },
+        { 25,     0.53,   0.47 },
+        { 50,     0.57,   0.43 },
+        { 100,    0.64,   0.36 },
+        { 150,    0.70,   0.30 },
+        { 200,    0.76,   0.24 },
+        { 250,    0.81,   0.19 },
+        { 300,    0.85,   0.15 },
+        { 350,    0.89,   0.11 }
+    };
+
+} // END of private namespace
+
+int
+hoxElo::calculate_KFactor( const int  nPlayedGames,
+                           const int  nOldRating,
+                           const bool bReachedTop /* = false */ )
+{
+    if      ( nPlayedGames < 30 ) return 25;
+    else if ( bReachedTop )       return 10;
+    else if ( nOldRating < 2400 ) return 15;
+    // NOTE: The server does not know whether a Player has reached 2400
+    //       before, and thus ignores the phase:
+    //    "... Thereafter it remains permanently at 10,"
+    //    "even if the player's rating is under 2400 at a later stage"
+    //       The tools replaying the games may apply it (see hoxEloReplay).
+    return 10;
+}
+
+int
+hoxElo::calculate_NewRatingChange( const int   nRatingDiff,
+                                   const int   nOldRating,
+                                   const int   nPlayedGames,
+                                   const float fGameResult,
+                                   const bool  bReachedTop /* = false */ )
+{
+    const int nAbsoluteRatingDiff = ( nRatingDiff > 0 ? nRatingDiff
+                                                      :(-1 * nRatingDiff) );
+
+    const int nMaxSize = sizeof(s_winningProbabilities) / sizeof (WinningProbability_t);
+    float fExpectedResult = 0.50;
+    for ( int i = nMaxSize-1; i >= 0; --i )
+    {
+        if ( nAbsoluteRatingDiff >= s_winningProbabilities[i].ratingDiff )
+        {
+            fExpectedResult = (   nRatingDiff > 0
+                                ? s_winningProbabilities[i].strongerPlayer
+                                : s_winningProbabilities[i].weakerPlayer );
+            break;
+        }
+    }
+
+    const int nKFactor = calculate_KFactor( nPlayedGames, nOldRating, bReachedTop );
+
+    return (int) (nKFactor * (fGameResult - fExpectedResult));
+}
+
+int
+hoxElo::calculate_RedChange( const Rating_t& red,
+                             const Rating_t& black,
+                             const float     fRedResult )
+{
+    // NOTE: Focus more on the "experienced" player.
+    const bool bUseRED = red.playedGames > black.playedGames;
+
+    const Rating_t& player   = ( bUseRED ? red : black );
+    const Rating_t& opponent = ( bUseRED ? black : red );
+
+    const int nRatingChange =
+        calculate_NewRatingChange( player.rating - opponent.rating,
+                                   player.rating,
+                                   player.playedGames,
+                                   ( bUseRED ? fRedResult : 1.0f - fRedResult ),
+                                   player.reachedTop );
+
+    return ( bUseRED ? nRatingChange : -nRatingChange );
+}
+
+/******************* END OF FILE *********************************************/
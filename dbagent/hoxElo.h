@@ -0,0 +1,79 @@
+//
+// C++ Interface: hoxElo
+//
+// Description: The (Elo) Rating System.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#ifndef __INCLUDED_HOX_ELO_H__
+#define __INCLUDED_HOX_ELO_H__
+
+/**
+ * The rules to rate the Players after each (rated) game, shared by the
+ * server and the tools replaying the past games, so that both come to
+ * the same ratings.
+ */
+namespace hoxElo
+{
+    /**
+     * A Player's standing before a game.
+     */
+    class Rating_t
+    {
+    public:
+        Rating_t( int r = 0, int n = 0, bool b = false )
+            : rating( r ), playedGames( n ), reachedTop( b ) {}
+
+        int    rating;
+        int    playedGames;
+        bool   reachedTop;   // Has reached 2400 (after 30 games) before?
+                             // (Known only to the tools replaying the games)
+    };
+
+    /**
+     * Calculate the K-Factor.
+     *
+     * @param nPlayedGames The number of games that has been played.
+     * @param nOldRating The Old Rating.
+     * @param bReachedTop Whether the K-Factor has dropped to 10 for good.
+     */
+    int calculate_KFactor( const int  nPlayedGames,
+                           const int  nOldRating,
+                           const bool bReachedTop = false );
+
+    /**
+     * Calculate the new (Elo) Rating Change.
+     *
+     * @param nRatingDiff The Rating Difference:
+     *                    (positive for Stronger, negative for Weaker)
+     * @param fGameResult The game's score (win=1, draw=0.5, loss=0).
+     */
+    int calculate_NewRatingChange( const int   nRatingDiff,
+                                   const int   nOldRating,
+                                   const int   nPlayedGames,
+                                   const float fGameResult,
+                                   const bool  bReachedTop = false );
+
+    /**
+     * Calculate the change of RED's rating after a game.
+     * BLACK's rating changes by the opposite amount.
+     *
+     * @param fRedResult RED's score (win=1, draw=0.5, loss=0).
+     */
+    int calculate_RedChange( const Rating_t& red,
+                             const Rating_t& black,
+                             const float     fRedResult );
+
+    /**
+     * Whether the K-Factor of a Player drops to 10 for good.
+     */
+    inline bool has_reached_top( const Rating_t& player )
+        { return player.reachedTop
+              || ( player.playedGames >= 30 && player.rating >= 2400 ); }
+
+} /* namespace hoxElo */
+
+#endif /* __INCLUDED_HOX_ELO_H__ */
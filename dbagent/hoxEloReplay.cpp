@@ -0,0 +1,644 @@
+//
+// C++ Implementation: hoxEloReplay
+//
+// Description: The command-line tool to recompute the Players' ratings
+//              by replaying all the (rated) games.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include <sys/time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sqlite3.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "hoxElo.h"
+
+/******************************************************************
+ * Constants
+ */
+
+#define DB_NAME            "../database/hoxserver.db"
+#define NEW_PLAYER_SCORE   1500  /* The initial score of new Players. */
+#define GAME_TYPE_RATED    0     /* hoxGAME_TYPE_RATED (of the server) */
+#define MAX_THREADS        64
+
+/******************************************************************
+ * The games and the Players, indexed by numbers
+ */
+
+namespace
+{
+    struct Game_t
+    {
+        long    ended;       // The time the game ended.
+        int     red;         // The Players' indexes.
+        int     black;
+        float   redResult;   // RED's score (win=1, draw=0.5, loss=0).
+    };
+    typedef std::vector<Game_t> GameVector;
+
+    bool _earlier( const Game_t& a, const Game_t& b )
+        { return a.ended < b.ended; }
+
+    std::vector<std::string>       s_pids;        // The Players' Ids.
+    std::vector<int>               s_oldScores;   // ... as saved.
+    std::vector<int>               s_oldGames;    // ... W+D+L, as saved.
+    std::vector<hoxElo::Rating_t>  s_ratings;     // ... as replayed.
+    std::vector<int>               s_slots;       // The indexes, hashed by Ids.
+    GameVector                     s_games;       // The oldest first.
+
+    /* The options. */
+    int                            s_initialScore = NEW_PLAYER_SCORE;
+    bool                           s_bFideRule    = false;
+
+    /**
+     * A group of Players who have played (directly or not) each other,
+     * but no one outside. Its games are replayed apart from the others.
+     */
+    struct Component_t
+    {
+        int     first;       // The first of its games (in s_order).
+        int     count;       // The number of its games.
+    };
+    typedef std::vector<Component_t> ComponentVector;
+
+    std::vector<int>               s_order;       // The games, by component.
+    std::vector<int>               s_roots;       // The Players' components
+                                                  //   (a Player of each).
+    ComponentVector                s_components;  // The largest first.
+    int                            s_nextComponent = 0;
+    pthread_mutex_t                s_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    bool _larger( const Component_t& a, const Component_t& b )
+        { return a.count > b.count; }
+
+    double _now()
+    {
+        struct timeval tv;
+        ::gettimeofday( &tv, NULL );
+        return tv.tv_sec + tv.tv_usec / 1e6;
+    }
+
+    /**
+     * The root of a Player's set (union-find, with path halving).
+     */
+    int _find( std::vector<int>& parents, int i )
+    {
+        while ( parents[i] != i )
+        {
+            parents[i] = parents[parents[i]];
+            i = parents[i];
+        }
+        return i;
+    }
+
+    /**
+     * The hash (FNV-1a) of a Player-Id.
+     */
+    unsigned _hash( const char* szId )
+    {
+        unsigned h = 2166136261U;
+        for ( ; *szId; ++szId )
+        {
+            h = ( h ^ (unsigned char) *szId ) * 16777619U;
+        }
+        return h;
+    }
+
+    /**
+     * Index the Players by their Ids (open addressing, half empty).
+     * Looking up millions of Ids this way is several times faster than
+     * with a std::map.
+     */
+    void _indexPlayers()
+    {
+        size_t nSlots = 16;
+        while ( nSlots < 2 * s_pids.size() ) nSlots *= 2;
+        s_slots.assign( nSlots, -1 );
+
+        for ( int i = 0; i < (int) s_pids.size(); ++i )
+        {
+            size_t slot = _hash( s_pids[i].c_str() ) & ( nSlots - 1 );
+            while ( s_slots[slot] >= 0 ) slot = ( slot + 1 ) & ( nSlots - 1 );
+            s_slots[slot] = i;
+        }
+    }
+
+    /**
+     * @return The index of a Player, or -1 if unknown.
+     */
+    int _findPlayer( const char* szId )
+    {
+        const size_t nMask = s_slots.size() - 1;
+        for ( size_t slot = _hash( szId ) & nMask; s_slots[slot] >= 0;
+                     slot = ( slot + 1 ) & nMask )
+        {
+            if ( s_pids[s_slots[slot]] == szId ) return s_slots[slot];
+        }
+        return -1;
+    }
+
+    bool _getResult( const char* szStatus, float& fRedResult )
+    {
+        if      ( strcmp( szStatus, "red_win" ) == 0 )   fRedResult = 1.0;
+        else if ( strcmp( szStatus, "black_win" ) == 0 ) fRedResult = 0.0;
+        else if ( strcmp( szStatus, "drawn" ) == 0 )     fRedResult = 0.5;
+        else return false;
+        return true;
+    }
+
+    /**
+     * Add a game, unless one of its Players is unknown (a guest's).
+     */
+    bool _addGame( long ended, const char* szRed,
+                   const char* szBlack, float fRedResult )
+    {
+        const int red   = _findPlayer( szRed );
+        const int black = _findPlayer( szBlack );
+        if ( red < 0 || black < 0 )
+        {
+            return false;
+        }
+
+        Game_t game;
+        game.ended     = ended;
+        game.red       = red;
+        game.black     = black;
+        game.redResult = fRedResult;
+        s_games.push_back( game );
+        return true;
+    }
+
+} // END of private namespace
+
+/******************************************************************
+ * Helper API
+ */
+
+static void usage( const char *progname )
+{
+    fprintf( stderr, "Usage: %s [<options>]\n\n"
+             "Possible options:\n\n"
+             "\t-d <database>           The Database (default: %s).\n"
+             "\t-i <game_log>           Read the games from a log printed by 'hoxarchive'\n"
+             "\t                        ('-' for stdin) instead of the 'games' table.\n"
+             "\t-s <score>              The initial score (default: %d).\n"
+             "\t-f                      Keep the K-Factor at 10 once a Player has reached\n"
+             "\t                        2400 (the FIDE rule, not applied by the server).\n"
+             "\t-t <threads>            The number of threads (default: the CPUs).\n"
+             "\t-w                      Write the new ratings to the Database.\n"
+             "\t-h                      Print this message.\n\n"
+             "The rated games are replayed in the order they ended, each Player\n"
+             "starting from the initial score. The Players whose ratings change\n"
+             "are printed on one line each, the largest change first, as:\n"
+             "\tpid;old;new;diff\n"
+             "The 'games' table (or the archive) holds only the games saved since it\n"
+             "was created: a Player with more games (wins, draws and losses) saved than\n"
+             "replayed has an incomplete history. Such a Player is left out (neither\n"
+             "printed nor written), together with every Player of the same group\n"
+             "(who have played each other, directly or not), whose ratings depend on it.\n"
+             "Without -w, nothing is written. With -w, the ratings are saved in one\n"
+             "transaction: restart the DB Agent and the servers afterwards, since they\n"
+             "keep the scores in memory.\n",
+             progname, DB_NAME, NEW_PLAYER_SCORE );
+    exit( 1 );
+}
+
+static int load_players( sqlite3* db )
+{
+    sqlite3_stmt* stmt = NULL;
+    if ( SQLITE_OK != sqlite3_prepare_v2( db, "SELECT pid, score, wins + draws + losses"
+                                              " FROM players",
+                                          -1, &stmt, NULL ) )
+    {
+        fprintf( stderr, "ERROR: can't read the Players [%s]\n", sqlite3_errmsg( db ) );
+        return -1;
+    }
+
+    int rc;
+    while ( SQLITE_ROW == ( rc = sqlite3_step( stmt ) ) )
+    {
+        s_pids.push_back( (const char*) sqlite3_column_text( stmt, 0 ) );
+        s_oldScores.push_back( sqlite3_column_int( stmt, 1 ) );
+        s_oldGames.push_back( sqlite3_column_int( stmt, 2 ) );
+    }
+    sqlite3_finalize( stmt );
+
+    if ( rc != SQLITE_DONE )
+    {
+        fprintf( stderr, "ERROR: can't read the Players [%s]\n", sqlite3_errmsg( db ) );
+        return -1;
+    }
+
+    _indexPlayers();
+    return 0;
+}
+
+static int load_games_from_db( sqlite3* db, long& nSkipped )
+{
+    sqlite3_stmt* stmt = NULL;
+    if ( SQLITE_OK != sqlite3_prepare_v2( db,
+                            "SELECT ended, red, black, status, type FROM games"
+                            " ORDER BY gid", -1, &stmt, NULL ) )
+    {
+        fprintf( stderr, "ERROR: can't read the games [%s]\n", sqlite3_errmsg( db ) );
+        return -1;
+    }
+
+    int rc;
+    while ( SQLITE_ROW == ( rc = sqlite3_step( stmt ) ) )
+    {
+        float fRedResult = 0.0;
+        if (   sqlite3_column_int( stmt, 4 ) != GAME_TYPE_RATED
+            || ! _getResult( (const char*) sqlite3_column_text( stmt, 3 ), fRedResult )
+            || ! _addGame( (long) sqlite3_column_int64( stmt, 0 ),
+                           (const char*) sqlite3_column_text( stmt, 1 ),
+                           (const char*) sqlite3_column_text( stmt, 2 ),
+                           fRedResult ) )
+        {
+            ++nSkipped;
+        }
+    }
+    sqlite3_finalize( stmt );
+
+    if ( rc != SQLITE_DONE )
+    {
+        fprintf( stderr, "ERROR: can't read the games [%s]\n", sqlite3_errmsg( db ) );
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Read the lines printed by 'hoxarchive':
+ *    segment:offset;timestamp;type;status;itimes;redtime;blacktime;
+ *    red;redScore;black;blackScore;moves
+ */
+static int load_games_from_log( const char* szLog, long& nSkipped )
+{
+    FILE* fp = ( strcmp( szLog, "-" ) == 0 ? stdin : fopen( szLog, "r" ) );
+    if ( fp == NULL )
+    {
+        fprintf( stderr, "ERROR: can't open the game log [%s]\n", szLog );
+        return -1;
+    }
+
+    std::string sLine;
+    char        buf[4096];
+    while ( fgets( buf, sizeof(buf), fp ) )
+    {
+        sLine.append( buf );
+        if ( sLine.empty() || sLine[sLine.size() - 1] != '\n' )
+        {
+            if ( ! feof( fp ) ) continue;  // The moves of a long game.
+        }
+
+        const char* fields[10];
+        int         nFields = 0;
+        for ( std::string::size_type nStart = 0;
+              nFields < 10 && nStart < sLine.size(); ++nFields )
+        {
+            std::string::size_type nEnd = sLine.find( ';', nStart );
+            if ( nEnd == std::string::npos ) break;
+            sLine[nEnd] = '\0';
+            fields[nFields] = sLine.c_str() + nStart;
+            nStart = nEnd + 1;
+        }
+
+        float fRedResult = 0.0;
+        if (   nFields < 10
+            || ::atoi( fields[2] ) != GAME_TYPE_RATED
+            || ! _getResult( fields[3], fRedResult )
+            || ! _addGame( ::atol( fields[1] ), fields[7], fields[9], fRedResult ) )
+        {
+            ++nSkipped;
+        }
+        sLine.clear();
+    }
+
+    if ( fp != stdin ) fclose( fp );
+    return 0;
+}
+
+/**
+ * Split the games by the groups of Players who have played each other,
+ * keeping the order of the games within each group.
+ */
+static void split_components()
+{
+    const int nPlayers = s_pids.size();
+
+    std::vector<int> parents( nPlayers );
+    for ( int i = 0; i < nPlayers; ++i ) parents[i] = i;
+
+    for ( GameVector::const_iterator it = s_games.begin();
+                                     it != s_games.end(); ++it )
+    {
+        const int red   = _find( parents, it->red );
+        const int black = _find( parents, it->black );
+        if ( red != black ) parents[red] = black;
+    }
+
+    s_roots.resize( nPlayers );
+    for ( int i = 0; i < nPlayers; ++i ) s_roots[i] = _find( parents, i );
+
+    /* Count the games of each group, then place them (a counting sort). */
+    std::vector<int> groups( nPlayers, -1 );   // The groups by their roots.
+    std::vector<int> counts;
+    std::vector<int> gameGroups( s_games.size() );
+
+    for ( size_t g = 0; g < s_games.size(); ++g )
+    {
+        int& group = groups[_find( parents, s_games[g].red )];
+        if ( group < 0 )
+        {
+            group = counts.size();
+            counts.push_back( 0 );
+        }
+        gameGroups[g] = group;
+        ++counts[group];
+    }
+
+    std::vector<int> next( counts.size() );
+    s_components.resize( counts.size() );
+    for ( size_t c = 0, nFirst = 0; c < counts.size(); ++c )
+    {
+        s_components[c].first = next[c] = nFirst;
+        s_components[c].count = counts[c];
+        nFirst += counts[c];
+    }
+
+    s_order.resize( s_games.size() );
+    for ( size_t g = 0; g < s_games.size(); ++g )
+    {
+        s_order[next[gameGroups[g]]++] = g;
+    }
+
+    /* The largest first, so that the threads end at about the same time. */
+    std::sort( s_components.begin(), s_components.end(), _larger );
+}
+
+/**
+ * Replay the games of a group. No other thread touches its Players.
+ */
+static void replay_component( const Component_t& component )
+{
+    for ( int i = component.first; i < component.first + component.count; ++i )
+    {
+        const Game_t&     game  = s_games[s_order[i]];
+        hoxElo::Rating_t& red   = s_ratings[game.red];
+        hoxElo::Rating_t& black = s_ratings[game.black];
+
+        const int nRedChange =
+            hoxElo::calculate_RedChange( red, black, game.redResult );
+
+        red.rating   += nRedChange;
+        black.rating -= nRedChange;
+        ++red.playedGames;
+        ++black.playedGames;
+
+        if ( s_bFideRule )
+        {
+            red.reachedTop   = hoxElo::has_reached_top( red );
+            black.reachedTop = hoxElo::has_reached_top( black );
+        }
+    }
+}
+
+static void* replay_thread( void* /* arg */ )
+{
+    for (;;)
+    {
+        pthread_mutex_lock( &s_mutex );
+        const int c = s_nextComponent++;
+        pthread_mutex_unlock( &s_mutex );
+
+        if ( c >= (int) s_components.size() ) break;
+        replay_component( s_components[c] );
+    }
+    return NULL;
+}
+
+static int replay_all( int nThreads )
+{
+    s_ratings.assign( s_pids.size(), hoxElo::Rating_t( s_initialScore, 0 ) );
+
+    nThreads = std::max( 1, std::min( nThreads, (int) s_components.size() ) );
+
+    std::vector<pthread_t> threads( nThreads );
+    int nStarted = 0;
+    for ( ; nStarted < nThreads; ++nStarted )
+    {
+        if ( 0 != pthread_create( &threads[nStarted], NULL, replay_thread, NULL ) )
+        {
+            fprintf( stderr, "WARN: can't start more than [%d] threads\n", nStarted );
+            break;
+        }
+    }
+
+    if ( nStarted == 0 ) replay_thread( NULL );
+
+    for ( int i = 0; i < nStarted; ++i )
+    {
+        pthread_join( threads[i], NULL );
+    }
+    return std::max( nStarted, 1 );
+}
+
+static int save_ratings( sqlite3* db, const std::vector<int>& changed )
+{
+    sqlite3_stmt* stmt = NULL;
+    if (   SQLITE_OK != sqlite3_exec( db, "BEGIN IMMEDIATE", NULL, NULL, NULL )
+        || SQLITE_OK != sqlite3_prepare_v2( db, "UPDATE players SET score = ? WHERE pid = ?",
+                                            -1, &stmt, NULL ) )
+    {
+        fprintf( stderr, "ERROR: can't update the Players [%s]\n", sqlite3_errmsg( db ) );
+        sqlite3_exec( db, "ROLLBACK", NULL, NULL, NULL );
+        return -1;
+    }
+
+    for ( std::vector<int>::const_iterator it = changed.begin();
+                                           it != changed.end(); ++it )
+    {
+        sqlite3_bind_int( stmt, 1, s_ratings[*it].rating );
+        sqlite3_bind_text( stmt, 2, s_pids[*it].c_str(), -1, SQLITE_STATIC );
+        if ( SQLITE_DONE != sqlite3_step( stmt ) )
+        {
+            fprintf( stderr, "ERROR: can't update the Player [%s] [%s]\n",
+                     s_pids[*it].c_str(), sqlite3_errmsg( db ) );
+            sqlite3_finalize( stmt );
+            sqlite3_exec( db, "ROLLBACK", NULL, NULL, NULL );
+            return -1;
+        }
+        sqlite3_reset( stmt );
+    }
+    sqlite3_finalize( stmt );
+
+    if ( SQLITE_OK != sqlite3_exec( db, "COMMIT", NULL, NULL, NULL ) )
+    {
+        fprintf( stderr, "ERROR: can't commit [%s]\n", sqlite3_errmsg( db ) );
+        sqlite3_exec( db, "ROLLBACK", NULL, NULL, NULL );
+        return -1;
+    }
+    return 0;
+}
+
+namespace
+{
+    /* The Players by the sizes of their changes, the largest first. */
+    struct LargerChange
+    {
+        bool operator()( int a, int b ) const
+        {
+            const int nA = ::abs( s_ratings[a].rating - s_oldScores[a] );
+            const int nB = ::abs( s_ratings[b].rating - s_oldScores[b] );
+            return ( nA > nB || ( nA == nB && s_pids[a] < s_pids[b] ) );
+        }
+    };
+}
+
+/******************************************************************
+ * The main program
+ */
+
+int main( int argc, char *argv[] )
+{
+    const char* szDatabase = DB_NAME;
+    const char* szLog      = NULL;
+    int         nThreads   = ::sysconf( _SC_NPROCESSORS_ONLN );
+    bool        bWrite     = false;
+    int         ch;
+
+    while ( ( ch = getopt( argc, argv, "d:i:s:ft:wh" ) ) != EOF )
+    {
+        switch ( ch )
+        {
+            case 'd': szDatabase     = optarg;                 break;
+            case 'i': szLog          = optarg;                 break;
+            case 's': s_initialScore = ::atoi( optarg );       break;
+            case 'f': s_bFideRule    = true;                   break;
+            case 't': nThreads       = ::atoi( optarg );       break;
+            case 'w': bWrite         = true;                   break;
+            case 'h':
+            case '?':
+            default:  usage( argv[0] );
+        }
+    }
+
+    if ( optind != argc || nThreads < 1 || nThreads > MAX_THREADS )
+    {
+        usage( argv[0] );
+    }
+
+    sqlite3* db = NULL;
+    if ( SQLITE_OK != sqlite3_open_v2( szDatabase, &db,
+                            ( bWrite ? SQLITE_OPEN_READWRITE : SQLITE_OPEN_READONLY ),
+                            NULL ) )
+    {
+        fprintf( stderr, "ERROR: can't open the Database [%s]\n", szDatabase );
+        return 1;
+    }
+    sqlite3_busy_timeout( db, 5000 );
+
+    /* Load the Players and the games. */
+
+    const double fStart = _now();
+    long nSkipped = 0;
+
+    if (   0 != load_players( db )
+        || 0 != ( szLog ? load_games_from_log( szLog, nSkipped )
+                        : load_games_from_db( db, nSkipped ) ) )
+    {
+        sqlite3_close( db );
+        return 1;
+    }
+
+    /* The Database returns them in the order they were saved, which is
+     * almost the order they ended (the servers save them apart).
+     */
+    std::stable_sort( s_games.begin(), s_games.end(), _earlier );
+    const double fLoaded = _now();
+
+    /* Replay them. */
+
+    split_components();
+    nThreads = replay_all( nThreads );
+    const double fReplayed = _now();
+
+    /* Report the changes, except for the groups with a Player whose
+     * older games are missing: that Player is replayed from the initial
+     * score, not from the real rating, which skews the ratings of every
+     * (direct or not) opponent as well.
+     */
+
+    std::vector<bool> incomplete( s_pids.size(), false );  // By component.
+    for ( int i = 0; i < (int) s_pids.size(); ++i )
+    {
+        if ( s_oldGames[i] > s_ratings[i].playedGames )
+        {
+            incomplete[s_roots[i]] = true;
+        }
+    }
+
+    std::vector<int> changed;
+    long nTotalChange = 0;
+    int  nLeftOut     = 0;
+    for ( int i = 0; i < (int) s_pids.size(); ++i )
+    {
+        if ( incomplete[s_roots[i]] )
+        {
+            ++nLeftOut;
+        }
+        else if ( s_ratings[i].rating != s_oldScores[i] )
+        {
+            changed.push_back( i );
+            nTotalChange += ::abs( s_ratings[i].rating - s_oldScores[i] );
+        }
+    }
+    std::sort( changed.begin(), changed.end(), LargerChange() );
+
+    for ( std::vector<int>::const_iterator it = changed.begin();
+                                           it != changed.end(); ++it )
+    {
+        printf( "%s;%d;%d;%+d\n", s_pids[*it].c_str(), s_oldScores[*it],
+                s_ratings[*it].rating, s_ratings[*it].rating - s_oldScores[*it] );
+    }
+    fflush( stdout );
+
+    int nResult = 0;
+    if ( bWrite && ! changed.empty() )
+    {
+        nResult = save_ratings( db, changed );
+    }
+    sqlite3_close( db );
+
+    fprintf( stderr, "Games:      %ld replayed, %ld skipped (unrated, unfinished or of guests)\n"
+                     "Groups:     %d (the largest with %d games), %d thread(s)\n"
+                     "Players:    %d, of whom %d changed (mean change %.1f, largest %d),\n"
+                     "            %d left out (in a group with an incomplete history)\n"
+                     "Time:       %.2fs to load, %.2fs to replay\n"
+                     "Database:   %s\n",
+             (long) s_games.size(), nSkipped,
+             (int) s_components.size(),
+             ( s_components.empty() ? 0 : s_components[0].count ), nThreads,
+             (int) s_pids.size(), (int) changed.size(),
+             ( changed.empty() ? 0.0 : (double) nTotalChange / changed.size() ),
+             ( changed.empty() ? 0 : ::abs( s_ratings[changed[0]].rating
+                                           - s_oldScores[changed[0]] ) ),
+             nLeftOut,
+             fLoaded - fStart, fReplayed - fLoaded,
+             ( ! bWrite ? "not written (no -w)"
+                        : nResult == 0 ? "written" : "NOT written (error)" ) );
+
+    return ( nResult == 0 ? 0 : 1 );
+}
+
+/******************* END OF FILE *********************************************/
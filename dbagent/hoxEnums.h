@@ -60,12 +60,30 @@ enum hoxRequestType
     hoxREQUEST_DB_PLAYER_SET,
         /* Set Database Player's info */
 
+    hoxREQUEST_DB_PLAYER_SET_BATCH,
+        /* Set Database many Players' info (the results of many games) */
+
+    hoxREQUEST_DB_GAME_PUT_BATCH,
+        /* Put (save) into Database many completed Games */
+
+    hoxREQUEST_DB_GAMES_GET,
+        /* Get Database a Player's Games (a page of his history) */
+
     hoxREQUEST_DB_PROFILE_SET,
         /* Set Database Profile's info */
 
     hoxREQUEST_DB_PASSWORD_SET,
         /* Set Database Player's NEW password */
 
+    hoxREQUEST_DB_PLAYER_INVALIDATE,
+        /* Notice to the clients: a Player's info has changed */
+
+    hoxREQUEST_DB_LEADERS_GET,
+        /* Get the Players with the highest scores */
+
+    hoxREQUEST_DB_RANK_GET,
+        /* Get a Player's rank (and his neighbors) */
+
     hoxREQUEST_HTTP_GET,
         /* HTTP GET request */
 
@@ -0,0 +1,324 @@
+//
+// C++ Implementation: hoxLeaderboard
+//
+// Description: The Players ranked by their scores, kept in memory.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include <pthread.h>
+#include <map>
+#include <algorithm>
+#include "hoxLeaderboard.h"
+#include "hoxDBAPI.h"
+#include "hoxLog.h"
+
+/******************************************************************
+ * The ranking tree
+ */
+
+namespace
+{
+    /**
+     * A node of a treap (a binary search tree kept balanced by random
+     * priorities), with the size of its subtree so that the n-th
+     * Player and the rank of a Player are found by a single descent.
+     */
+    struct Node
+    {
+        std::string   pid;
+        int           score;
+        unsigned      priority;
+        int           size;      // The number of nodes in this subtree.
+        Node*         left;
+        Node*         right;
+    };
+
+    typedef std::map<std::string, Node*> NodeMap;
+
+    Node*             s_root = NULL;
+    NodeMap           s_nodes;      // The nodes by their Player-Ids.
+    unsigned          s_seed = 2463534242U;
+
+    /* Many readers (the read workers), one writer (the write worker). */
+    pthread_rwlock_t  s_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+    unsigned
+    _random()
+    {
+        /* xorshift32: called under the write lock only. */
+        s_seed ^= s_seed << 13;
+        s_seed ^= s_seed >> 17;
+        s_seed ^= s_seed << 5;
+        return s_seed;
+    }
+
+    inline int
+    _size( const Node* node )
+    {
+        return ( node ? node->size : 0 );
+    }
+
+    inline void
+    _update( Node* node )
+    {
+        node->size = 1 + _size( node->left ) + _size( node->right );
+    }
+
+    /**
+     * Is a Player (score, pid) ranked before a node?
+     */
+    inline bool
+    _before( int score, const std::string& pid, const Node* node )
+    {
+        return (   score > node->score
+                || ( score == node->score && pid < node->pid ) );
+    }
+
+    /**
+     * Split a tree into the nodes ranked before (score, pid) and the rest.
+     */
+    void
+    _split( Node* node, int score, const std::string& pid,
+            Node*& left, Node*& right )
+    {
+        if ( node == NULL )
+        {
+            left = right = NULL;
+        }
+        else if ( _before( score, pid, node ) )
+        {
+            _split( node->left, score, pid, left, node->left );
+            right = node;
+            _update( node );
+        }
+        else
+        {
+            _split( node->right, score, pid, node->right, right );
+            left = node;
+            _update( node );
+        }
+    }
+
+    /**
+     * Merge two trees, all the nodes of the left one ranked first.
+     */
+    Node*
+    _merge( Node* left, Node* right )
+    {
+        if ( left == NULL ) return right;
+        if ( right == NULL ) return left;
+
+        if ( left->priority > right->priority )
+        {
+            left->right = _merge( left->right, right );
+            _update( left );
+            return left;
+        }
+        right->left = _merge( left, right->left );
+        _update( right );
+        return right;
+    }
+
+    void
+    _insert( Node* node )
+    {
+        Node* left  = NULL;
+        Node* right = NULL;
+        _split( s_root, node->score, node->pid, left, right );
+        s_root = _merge( _merge( left, node ), right );
+    }
+
+    /**
+     * Unlink a node (which must be in the tree).
+     */
+    Node*
+    _erase( Node* root, const Node* node )
+    {
+        if ( root == node )
+        {
+            return _merge( root->left, root->right );
+        }
+
+        if ( _before( node->score, node->pid, root ) )
+            root->left = _erase( root->left, node );
+        else
+            root->right = _erase( root->right, node );
+        _update( root );
+        return root;
+    }
+
+    /**
+     * The number of Players ranked before a node (which must be in the tree).
+     */
+    int
+    _count_before( const Node* node )
+    {
+        int         nCount = 0;
+        const Node* current = s_root;
+
+        while ( current != node )
+        {
+            if ( _before( node->score, node->pid, current ) )
+            {
+                current = current->left;
+            }
+            else
+            {
+                nCount += _size( current->left ) + 1;
+                current = current->right;
+            }
+        }
+        return nCount + _size( node->left );
+    }
+
+    /**
+     * The node with a given number of Players ranked before it.
+     */
+    const Node*
+    _select( int nIndex )
+    {
+        const Node* current = s_root;
+
+        while ( current != NULL )
+        {
+            const int nLeft = _size( current->left );
+            if ( nIndex < nLeft )
+            {
+                current = current->left;
+            }
+            else if ( nIndex == nLeft )
+            {
+                break;
+            }
+            else
+            {
+                nIndex -= nLeft + 1;
+                current = current->right;
+            }
+        }
+        return current;
+    }
+
+    /**
+     * Get the Players of a range of ranks, under the read lock.
+     */
+    void
+    _get_range( int nFrom, int nCount, hoxLeaderboard::EntryList& entries )
+    {
+        const int nEnd = std::min( nFrom + nCount, _size( s_root ) );
+
+        for ( int i = std::max( nFrom, 0 ); i < nEnd; ++i )
+        {
+            const Node* node = _select( i );
+            hoxLeaderboard::Entry_t entry;
+            entry.rank  = i + 1;
+            entry.pid   = node->pid;
+            entry.score = node->score;
+            entries.push_back( entry );
+        }
+    }
+
+} // END of private namespace
+
+/******************************************************************
+ * The API
+ */
+
+hoxResult
+hoxLeaderboard::load()
+{
+    const char* FNAME = "hoxLeaderboard::load";
+
+    hoxDBAPI::PlayerList players;
+    if ( hoxRC_OK != hoxDBAPI::get_players_scores( players ) )
+    {
+        hoxLog(LOG_ERROR, "%s: Failed to get the scores.", FNAME);
+        return hoxRC_ERR;
+    }
+
+    for ( hoxDBAPI::PlayerList::const_iterator it = players.begin();
+                                               it != players.end(); ++it )
+    {
+        set_score( it->id, it->score );
+    }
+
+    hoxLog(LOG_INFO, "%s: Loaded [%d] Players.", FNAME, size());
+    return hoxRC_OK;
+}
+
+void
+hoxLeaderboard::set_score( const std::string& pid,
+                           int                score )
+{
+    pthread_rwlock_wrlock( &s_lock );
+
+    Node*& node = s_nodes[pid];
+    if ( node == NULL )
+    {
+        node = new Node;
+        node->pid      = pid;
+        node->priority = _random();
+    }
+    else if ( node->score == score )
+    {
+        pthread_rwlock_unlock( &s_lock );
+        return;  // Not moved.
+    }
+    else
+    {
+        s_root = _erase( s_root, node );
+    }
+
+    node->score = score;
+    node->size  = 1;
+    node->left  = node->right = NULL;
+    _insert( node );
+
+    pthread_rwlock_unlock( &s_lock );
+}
+
+int
+hoxLeaderboard::size()
+{
+    pthread_rwlock_rdlock( &s_lock );
+    const int nSize = _size( s_root );
+    pthread_rwlock_unlock( &s_lock );
+    return nSize;
+}
+
+void
+hoxLeaderboard::get_top( int        nFrom,
+                         int        nCount,
+                         EntryList& entries )
+{
+    pthread_rwlock_rdlock( &s_lock );
+    _get_range( nFrom, nCount, entries );
+    pthread_rwlock_unlock( &s_lock );
+}
+
+hoxResult
+hoxLeaderboard::get_around( const std::string& pid,
+                            int                nAround,
+                            EntryList&         entries )
+{
+    pthread_rwlock_rdlock( &s_lock );
+
+    NodeMap::const_iterator found = s_nodes.find( pid );
+    if ( found == s_nodes.end() )
+    {
+        pthread_rwlock_unlock( &s_lock );
+        return hoxRC_NOT_FOUND;
+    }
+
+    const int nIndex = _count_before( found->second );
+    const int nFrom  = std::max( nIndex - nAround, 0 );
+    _get_range( nFrom, nIndex + nAround + 1 - nFrom, entries );
+
+    pthread_rwlock_unlock( &s_lock );
+    return hoxRC_OK;
+}
+
+/******************* END OF FILE *********************************************/
@@ -0,0 +1,79 @@
+//
+// C++ Interface: hoxLeaderboard
+//
+// Description: The Players ranked by their scores, kept in memory.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#ifndef __INCLUDED_HOX_LEADERBOARD_H__
+#define __INCLUDED_HOX_LEADERBOARD_H__
+
+#include <string>
+#include <list>
+#include "hoxEnums.h"
+
+/**
+ * The leaderboard is loaded from the Database at startup and updated as
+ * the scores are saved, so that the ranks are looked up without sorting
+ * the Players table.
+ *
+ * The Players are ordered by their scores (the highest first), then by
+ * their Ids. Each lookup takes O(log n).
+ */
+namespace hoxLeaderboard
+{
+    class Entry_t
+    {
+    public:
+        Entry_t() : rank( 0 ), score( 0 ) {}
+
+        int           rank;   // 1 for the highest score.
+        std::string   pid;    // Player-Id
+        int           score;
+    };
+    typedef std::list<Entry_t> EntryList;
+
+    /**
+     * Load the scores of all the Players from the Database.
+     */
+    hoxResult load();
+
+    /**
+     * Set the score of a Player (added if new).
+     */
+    void set_score( const std::string& pid,
+                    int                score );
+
+    /**
+     * The number of Players ranked.
+     */
+    int size();
+
+    /**
+     * Get the Players at the top.
+     *
+     * @param nFrom   The number of Players to skip (0 for the first).
+     * @param nCount  The number of Players to get.
+     */
+    void get_top( int        nFrom,
+                  int        nCount,
+                  EntryList& entries );
+
+    /**
+     * Get the rank of a Player, with his neighbors.
+     *
+     * @param nAround The number of neighbors to get on each side
+     *                (0 for the Player alone).
+     *
+     * @return hoxRC_NOT_FOUND if the Player is not ranked.
+     */
+    hoxResult get_around( const std::string& pid,
+                          int                nAround,
+                          EntryList&         entries );
+
+} /* namespace hoxLeaderboard */
+
+#endif /* __INCLUDED_HOX_LEADERBOARD_H__ */
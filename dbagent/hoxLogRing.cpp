@@ -0,0 +1,339 @@
+//
+// C++ Implementation: hoxLogRing
+//
+// Description: The shared-memory ring carrying the log messages of the
+//              (local) servers to the DB-Agent.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <cstring>
+#include <algorithm>
+#include "hoxLogRing.h"
+#include "hoxLog.h"
+
+/******************************************************************
+ * Constants
+ */
+
+#define LOG_RING_MAGIC    0x474C5848   /* "HXLG" */
+#define LOG_RING_VERSION  1
+
+/******************************************************************
+ * The shared layout
+ */
+
+namespace
+{
+    /**
+     * The header at the start of the shared memory, followed by the data.
+     *
+     * The positions only grow; each is taken modulo the data's size.
+     * Each message is stored as its size (4 bytes) followed by its bytes,
+     * possibly wrapping around the end of the data.
+     */
+    struct RingHeader
+    {
+        uint32_t         magic;
+        uint32_t         version;
+        uint64_t         size;       // The size of the data.
+        pthread_mutex_t  mutex;      // Shared by the processes (robust).
+        pthread_cond_t   cond;       // Signaled when a message is written.
+        uint64_t         writePos;
+        uint64_t         readPos;
+    };
+
+    RingHeader*  s_header = NULL;
+    char*        s_data   = NULL;
+    size_t       s_nMapSize = 0;
+
+    /**
+     * Lock the ring, recovering it if its last owner has died with it.
+     */
+    void
+    _lock()
+    {
+        if ( EOWNERDEAD == pthread_mutex_lock( &s_header->mutex ) )
+        {
+            pthread_mutex_consistent( &s_header->mutex );
+        }
+    }
+
+    void
+    _unlock()
+    {
+        pthread_mutex_unlock( &s_header->mutex );
+    }
+
+    /**
+     * Copy bytes to / from the data, wrapping around its end.
+     */
+    void
+    _copy_in( uint64_t pos, const char* src, size_t nBytes )
+    {
+        const size_t nOffset = pos % s_header->size;
+        const size_t nFirst  = std::min( nBytes, (size_t) s_header->size - nOffset );
+        memcpy( s_data + nOffset, src, nFirst );
+        memcpy( s_data, src + nFirst, nBytes - nFirst );
+    }
+
+    void
+    _copy_out( uint64_t pos, char* dst, size_t nBytes )
+    {
+        const size_t nOffset = pos % s_header->size;
+        const size_t nFirst  = std::min( nBytes, (size_t) s_header->size - nOffset );
+        memcpy( dst, s_data + nOffset, nFirst );
+        memcpy( dst + nFirst, s_data, nBytes - nFirst );
+    }
+
+    /**
+     * Map an open shared-memory object.
+     */
+    hoxResult
+    _map( int fd, size_t nMapSize )
+    {
+        void* p = mmap( NULL, nMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        if ( p == MAP_FAILED )
+        {
+            return hoxRC_ERR;
+        }
+
+        s_header   = (RingHeader*) p;
+        s_data     = (char*) p + sizeof(RingHeader);
+        s_nMapSize = nMapSize;
+        return hoxRC_OK;
+    }
+
+    /**
+     * Initialize a new ring.
+     */
+    void
+    _init_header( size_t nSize )
+    {
+        pthread_mutexattr_t mattr;
+        pthread_mutexattr_init( &mattr );
+        pthread_mutexattr_setpshared( &mattr, PTHREAD_PROCESS_SHARED );
+        pthread_mutexattr_setrobust( &mattr, PTHREAD_MUTEX_ROBUST );
+        pthread_mutex_init( &s_header->mutex, &mattr );
+        pthread_mutexattr_destroy( &mattr );
+
+        pthread_condattr_t cattr;
+        pthread_condattr_init( &cattr );
+        pthread_condattr_setpshared( &cattr, PTHREAD_PROCESS_SHARED );
+        pthread_cond_init( &s_header->cond, &cattr );
+        pthread_condattr_destroy( &cattr );
+
+        s_header->size     = nSize;
+        s_header->writePos = 0;
+        s_header->readPos  = 0;
+        s_header->version  = LOG_RING_VERSION;
+        s_header->magic    = LOG_RING_MAGIC;  // Valid from now on.
+    }
+
+} // END of private namespace
+
+/******************************************************************
+ * The API
+ */
+
+hoxResult
+hoxLogRing::create( const char* szName,
+                    size_t      nSize )
+{
+    const char* FNAME = "hoxLogRing::create";
+
+    const size_t nMapSize = sizeof(RingHeader) + nSize;
+
+    const int fd = shm_open( szName, O_CREAT | O_RDWR, 0600 );
+    if ( fd < 0 )
+    {
+        hoxLog(LOG_SYS_ERROR, "%s: Failed to open [%s]", FNAME, szName);
+        return hoxRC_ERR;
+    }
+
+    struct stat st;
+    const bool bExists = ( fstat( fd, &st ) == 0 && (size_t) st.st_size == nMapSize );
+
+    if (   ( ! bExists && ftruncate( fd, nMapSize ) < 0 )
+        || hoxRC_OK != _map( fd, nMapSize ) )
+    {
+        hoxLog(LOG_SYS_ERROR, "%s: Failed to map [%s]", FNAME, szName);
+        ::close( fd );
+        return hoxRC_ERR;
+    }
+    ::close( fd );
+
+    /* Keep the ring of the previous run, if any: the servers still
+     * have it open, and there may be some messages not yet read.
+     */
+    if (   bExists
+        && s_header->magic   == LOG_RING_MAGIC
+        && s_header->version == LOG_RING_VERSION
+        && s_header->size    == nSize )
+    {
+        hoxLog(LOG_INFO, "%s: Re-use [%s] with [%lu] bytes not yet read.", FNAME, szName,
+            (unsigned long) ( s_header->writePos - s_header->readPos ));
+        return hoxRC_OK;
+    }
+
+    memset( s_header, 0, sizeof(RingHeader) );
+    _init_header( nSize );
+
+    hoxLog(LOG_INFO, "%s: Created [%s] of [%lu] bytes.", FNAME, szName, (unsigned long) nSize);
+    return hoxRC_OK;
+}
+
+hoxResult
+hoxLogRing::open( const char* szName )
+{
+    const char* FNAME = "hoxLogRing::open";
+
+    hoxLogRing::close();  // ... the one open before (if any).
+
+    const int fd = shm_open( szName, O_RDWR, 0 );
+    if ( fd < 0 )
+    {
+        hoxLog(LOG_SYS_WARN, "%s: Failed to open [%s]", FNAME, szName);
+        return hoxRC_ERR;
+    }
+
+    struct stat st;
+    if (   fstat( fd, &st ) < 0
+        || (size_t) st.st_size <= sizeof(RingHeader)
+        || hoxRC_OK != _map( fd, st.st_size ) )
+    {
+        hoxLog(LOG_SYS_WARN, "%s: Failed to map [%s]", FNAME, szName);
+        ::close( fd );
+        return hoxRC_ERR;
+    }
+    ::close( fd );
+
+    if (   s_header->magic   != LOG_RING_MAGIC
+        || s_header->version != LOG_RING_VERSION
+        || sizeof(RingHeader) + s_header->size != s_nMapSize )
+    {
+        hoxLog(LOG_WARN, "%s: [%s] is not a valid ring.", FNAME, szName);
+        hoxLogRing::close();
+        return hoxRC_ERR;
+    }
+
+    hoxLog(LOG_INFO, "%s: Opened [%s] of [%lu] bytes.", FNAME, szName,
+        (unsigned long) s_header->size);
+    return hoxRC_OK;
+}
+
+void
+hoxLogRing::close()
+{
+    if ( s_header != NULL )
+    {
+        munmap( s_header, s_nMapSize );
+        s_header   = NULL;
+        s_data     = NULL;
+        s_nMapSize = 0;
+    }
+}
+
+bool
+hoxLogRing::is_open()
+{
+    return ( s_header != NULL );
+}
+
+hoxResult
+hoxLogRing::write( const std::string& sMsg )
+{
+    // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+    // !! Do not log here since this function is doing   !!
+    // !! the "logging".                                 !!
+    // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+
+    if ( s_header == NULL ) return hoxRC_ERR;
+
+    const uint32_t nMsgSize = sMsg.size();
+    const uint64_t nNeeded  = sizeof(nMsgSize) + nMsgSize;
+
+    _lock();
+
+    if ( s_header->size - ( s_header->writePos - s_header->readPos ) < nNeeded )
+    {
+        _unlock();
+        return hoxRC_ERR;  // Full.
+    }
+
+    _copy_in( s_header->writePos, (const char*) &nMsgSize, sizeof(nMsgSize) );
+    _copy_in( s_header->writePos + sizeof(nMsgSize), sMsg.data(), nMsgSize );
+    s_header->writePos += nNeeded;
+
+    pthread_cond_signal( &s_header->cond );
+    _unlock();
+
+    return hoxRC_OK;
+}
+
+hoxResult
+hoxLogRing::read( std::string& sMsgs,
+                  int          nTimeout )
+{
+    if ( s_header == NULL ) return hoxRC_ERR;
+
+    struct timespec deadline;
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_sec += nTimeout;
+
+    _lock();
+
+    while ( s_header->writePos == s_header->readPos )
+    {
+        const int rc = pthread_cond_timedwait( &s_header->cond, &s_header->mutex, &deadline );
+        if ( rc == EOWNERDEAD )
+        {
+            pthread_mutex_consistent( &s_header->mutex );
+        }
+        else if ( rc == ETIMEDOUT )
+        {
+            _unlock();
+            return hoxRC_TIMEOUT;
+        }
+    }
+
+    const uint64_t nReadPos  = s_header->readPos;
+    const uint64_t nWritePos = s_header->writePos;
+
+    _unlock();
+
+    /* Only this (single) reader moves the read position, so the messages
+     * up to the write position seen can be copied without the lock.
+     */
+    uint64_t pos = nReadPos;
+    while ( pos < nWritePos )
+    {
+        uint32_t nMsgSize = 0;
+        _copy_out( pos, (char*) &nMsgSize, sizeof(nMsgSize) );
+        pos += sizeof(nMsgSize);
+
+        const size_t nOldSize = sMsgs.size();
+        sMsgs.resize( nOldSize + nMsgSize );
+        _copy_out( pos, &sMsgs[nOldSize], nMsgSize );
+        pos += nMsgSize;
+    }
+
+    _lock();
+    s_header->readPos = nWritePos;
+    _unlock();
+
+    return hoxRC_OK;
+}
+
+/******************* END OF FILE *********************************************/
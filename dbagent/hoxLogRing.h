@@ -0,0 +1,72 @@
+//
+// C++ Interface: hoxLogRing
+//
+// Description: The shared-memory ring carrying the log messages of the
+//              (local) servers to the DB-Agent.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#ifndef __INCLUDED_HOX_LOG_RING_H__
+#define __INCLUDED_HOX_LOG_RING_H__
+
+#include <string>
+#include "hoxEnums.h"
+
+/**
+ * The ring is a POSIX shared-memory object, created by the DB-Agent
+ * (the only reader) and opened by the servers (the writers) running on
+ * the same host. The messages go one way, with no response.
+ *
+ * A writer never waits for room: if the ring is full, the message is
+ * left for the caller to send another way.
+ */
+namespace hoxLogRing
+{
+    /**
+     * Create (or re-use) the ring, to be read by this process.
+     *
+     * @param szName The name of the shared-memory object (e.g. "/hoxlog").
+     * @param nSize  The size of the ring's data, in bytes.
+     */
+    hoxResult create( const char* szName,
+                      size_t      nSize );
+
+    /**
+     * Open the ring created by the DB-Agent, to be written by this process.
+     */
+    hoxResult open( const char* szName );
+
+    /**
+     * Close the ring (if open).
+     */
+    void close();
+
+    /**
+     * Is the ring open?
+     */
+    bool is_open();
+
+    /**
+     * Write a message to the ring.
+     *
+     * @return hoxRC_ERR if the ring is not open or has no room for it.
+     */
+    hoxResult write( const std::string& sMsg );
+
+    /**
+     * Read all the messages in the ring, waiting for some if none.
+     *
+     * @param sMsgs   The messages read, appended one after another.
+     * @param nTimeout The time to wait (in seconds).
+     *
+     * @return hoxRC_TIMEOUT if there is none after the time-out.
+     */
+    hoxResult read( std::string& sMsgs,
+                    int          nTimeout );
+
+} /* namespace hoxLogRing */
+
+#endif /* __INCLUDED_HOX_LOG_RING_H__ */
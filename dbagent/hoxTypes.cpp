@@ -102,6 +102,8 @@ hoxResponse::hoxResponse( const hoxResponse& other )
         : _type( other._type )
         , _code( other._code )
 {
+    _tid     = other._tid;
+    _rid     = other._rid;
     _content = other._content;
 }
 
@@ -122,6 +124,11 @@ hoxResponse::toString() const
         outStream << "&tid=" << _tid;
     }
 
+    if ( ! _rid.empty() )
+    {
+        outStream << "&rid=" << _rid;
+    }
+
     // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
     // NOTE: Make sure that the output is terminated by only
     //       (and only) TWO end-of-line characters. 
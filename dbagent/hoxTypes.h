@@ -49,6 +49,8 @@ public:
     const hoxParameters& getParameters() const { return _parameters; }
     const std::string getParam(const std::string& key) const
         { return const_cast<hoxRequest*>(this)->_parameters[key]; }
+    void setParam(const std::string& key, const std::string& value)
+        { _parameters[key] = value; }
 
     const std::string toString() const;
 
@@ -72,6 +74,7 @@ public:
 
     void setCode(hoxResult code) { _code = code; }
     void setTid(const std::string& tid) { _tid = tid; } 
+    void setRid(const std::string& rid) { _rid = rid; }
     void setContent(const std::string& content) { _content = content; }
 
     const std::string toString() const;
@@ -87,6 +90,7 @@ private:
     const hoxRequestType  _type;
     hoxResult             _code;
     std::string           _tid;   // Table-Id (if applicable).
+    std::string           _rid;   // Request-Id (if applicable).
     std::string           _content;
 };
 
@@ -35,8 +35,14 @@ hoxUtil::requestTypeToString( const hoxRequestType requestType )
         case hoxREQUEST_DB_PLAYER_PUT:    return "DB_PLAYER_PUT";
         case hoxREQUEST_DB_PLAYER_GET:    return "DB_PLAYER_GET";
         case hoxREQUEST_DB_PLAYER_SET:    return "DB_PLAYER_SET";
+        case hoxREQUEST_DB_PLAYER_SET_BATCH: return "DB_PLAYER_SET_BATCH";
+        case hoxREQUEST_DB_GAME_PUT_BATCH: return "DB_GAME_PUT_BATCH";
+        case hoxREQUEST_DB_GAMES_GET:     return "DB_GAMES_GET";
         case hoxREQUEST_DB_PROFILE_SET:   return "DB_PROFILE_SET";
         case hoxREQUEST_DB_PASSWORD_SET:  return "DB_PASSWORD_SET";
+        case hoxREQUEST_DB_PLAYER_INVALIDATE: return "DB_PLAYER_INVALIDATE";
+        case hoxREQUEST_DB_LEADERS_GET:   return "DB_LEADERS_GET";
+        case hoxREQUEST_DB_RANK_GET:      return "DB_RANK_GET";
         case hoxREQUEST_HTTP_GET:         return "HTTP_GET";
         case hoxREQUEST_LOG:              return "LOG";
 
@@ -56,8 +62,14 @@ hoxUtil::stringToRequestType( const std::string& input )
     if ( input == "DB_PLAYER_PUT" )    return hoxREQUEST_DB_PLAYER_PUT;
     if ( input == "DB_PLAYER_GET" )    return hoxREQUEST_DB_PLAYER_GET;
     if ( input == "DB_PLAYER_SET" )    return hoxREQUEST_DB_PLAYER_SET;
+    if ( input == "DB_PLAYER_SET_BATCH" ) return hoxREQUEST_DB_PLAYER_SET_BATCH;
+    if ( input == "DB_GAME_PUT_BATCH" ) return hoxREQUEST_DB_GAME_PUT_BATCH;
+    if ( input == "DB_GAMES_GET" )     return hoxREQUEST_DB_GAMES_GET;
     if ( input == "DB_PROFILE_SET" )   return hoxREQUEST_DB_PROFILE_SET;
     if ( input == "DB_PASSWORD_SET" )  return hoxREQUEST_DB_PASSWORD_SET;
+    if ( input == "DB_PLAYER_INVALIDATE" ) return hoxREQUEST_DB_PLAYER_INVALIDATE;
+    if ( input == "DB_LEADERS_GET" )   return hoxREQUEST_DB_LEADERS_GET;
+    if ( input == "DB_RANK_GET" )      return hoxREQUEST_DB_RANK_GET;
     if ( input == "HTTP_GET" )         return hoxREQUEST_HTTP_GET;
     if ( input == "LOG" )              return hoxREQUEST_LOG;
 
@@ -24,6 +24,15 @@
 #include <iostream>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <list>
+#include <map>
+#include <algorithm>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
 
 #include "hoxLog.h"
 #include "hoxTypes.h"
@@ -31,6 +40,8 @@
 #include "hoxDBAPI.h"
 #include "hoxExcept.h"
 #include "hoxUtil.h"
+#include "hoxLogRing.h"
+#include "hoxLeaderboard.h"
 
 /******************************************************************
  * Server configuration parameters
@@ -40,6 +51,35 @@
 #define DBAGENT_DEFAULT_IP   "0.0.0.0"
 #define DBAGENT_DEFAULT_PORT 7000
 
+/* The number of worker threads reading the database
+ * (one per core, but at least this many).
+ */
+#define DBAGENT_MIN_READ_WORKERS   2
+
+/* The number of worker threads writing to the database.
+ * SQLite has one writer at a time: more would only wait for its lock.
+ */
+#define DBAGENT_WRITE_WORKERS      1
+
+/* The most Players returned by a leaderboard's request */
+#define DBAGENT_MAX_LEADERS        100
+
+/* The most Games returned by a history's request (a page) */
+#define DBAGENT_MAX_GAMES          500
+
+/* Reactor's settings */
+#define DBAGENT_MAX_EVENTS         64     /* Events handled per epoll_wait */
+#define DBAGENT_READ_CHUNK_SIZE    16384  /* Bytes read at once from a client */
+
+/* The prefix of a local (Unix-domain) listening address,
+ * e.g. "unix:/tmp/dbagent.sock".
+ */
+#define DBAGENT_UNIX_PREFIX        "unix:"
+
+/* The shared-memory ring of the servers' logs */
+#define DBAGENT_LOG_RING_SIZE      ( 4 * 1024 * 1024 )
+#define DBAGENT_LOG_RING_WAIT      1      /* Seconds to wait for a message */
+
 /* Log files */
 #define PID_FILE    "pid"
 #define ERRORS_FILE "errors.log"
@@ -51,6 +91,8 @@
 static char*       s_logdir      = NULL;
 static const char* s_serverIP    = DBAGENT_DEFAULT_IP;
 static int         s_nListenPort = DBAGENT_DEFAULT_PORT;
+static const char* s_unixPath    = NULL;  // The local socket's path (if any).
+static const char* s_logRingName = NULL;  // The log ring's name (if any).
 
 int s_errfd    = STDERR_FILENO;
 int s_serverfd = STDERR_FILENO;
@@ -59,13 +101,57 @@ int s_serverfd = STDERR_FILENO;
  * Data structure
  */
 
-class SocketInfo
+/**
+ * A client connection.
+ *
+ * Its requests are read and parsed by the reactor (epoll) thread and
+ * answered by the workers. A request with an Id ("rid") is answered as
+ * soon as it is done, possibly out of order, with the same Id. Those
+ * without an Id are answered one at a time, in order.
+ */
+class ClientConnection
 {
 public:
-    int             nSocket;
-    struct in_addr  iaFrom;
+    ClientConnection( int fd, const std::string& from )
+            : nSocket( fd ), sFrom( from )
+            , bWantWrite( false ), bClosed( false ), bOrderedBusy( false )
+    {
+        pthread_mutex_init( &lock, NULL );
+    }
+    ~ClientConnection()
+    {
+        /* Closed only now, so that no worker writes to a reused fd. */
+        close( nSocket );
+        pthread_mutex_destroy( &lock );
+    }
+
+    const int                   nSocket;
+    const std::string           sFrom;      // The client's address.
+    std::string                 inBuffer;   // Data read but not yet parsed.
+                                            // (by the reactor thread only)
+
+    pthread_mutex_t             lock;       // Protects the members below.
+    std::string                 outBuffer;  // Data not yet written.
+    bool                        bWantWrite; // Waiting for the socket to be writable?
+    bool                        bClosed;
+    std::list<hoxRequest_SPtr>  orderedRequests;  // Those without Id, waiting.
+    bool                        bOrderedBusy;     // Is one of them being answered?
+
+    std::string                 sClientId;  // Set (by HELLO) to be notified
+                                            // of the changes of Players' info.
 };
-typedef std::auto_ptr<SocketInfo>  SocketInfo_APtr;
+typedef boost::shared_ptr<ClientConnection>   ClientConnection_SPtr;
+typedef std::map<int, ClientConnection_SPtr>  ClientConnectionMap;
+
+/**
+ * The connections open, by socket.
+ * Changed by the reactor thread only, while holding the lock (which
+ * others must hold to look at them).
+ */
+static ClientConnectionMap  s_connections;
+static pthread_mutex_t      s_connectionsLock = PTHREAD_MUTEX_INITIALIZER;
+
+static int s_epollfd = -1;   // The reactor's epoll instance.
 
 /**
  * Open error log file.
@@ -92,40 +178,49 @@ open_log_file( const std::string& sLogDir )
 }
 
 /**
- * Read an incoming request from a given socket.
+ * Write as much of the pending output of a connection as the socket
+ * takes now, and watch for it to become writable if some is left.
+ *
+ * @note The connection's lock must be held.
  */
 hoxResult
-read_request( int                   nfd,
-              const struct in_addr* from,
-              hoxRequest_SPtr&      pRequest )
+flush_output( ClientConnection* conn )
 {
     const char* FNAME = __FUNCTION__;
-    hoxResult   result;
-    std::string requestStr;
-
-    result = hoxSocketAPI::read_line( nfd,
-                                      requestStr );
-    if ( result != hoxRC_OK )
-    {
-        hoxLog(LOG_SYS_WARN, "%s: Failed to read request from %s",
-            FNAME, inet_ntoa( *from ));
-        return result;
-    }
 
-    /* Check for socket-close condition. */
-    if ( requestStr.empty() )
+    while ( ! conn->outBuffer.empty() )
     {
-        //hoxLog(LOG_INFO, "%s: Returned 'NULL' request due to socket-close event.", FNAME);
-        return hoxRC_CLOSED;
+        const ssize_t nWritten = send( conn->nSocket,
+                                       conn->outBuffer.data(),
+                                       conn->outBuffer.size(),
+                                       MSG_NOSIGNAL );
+        if ( nWritten > 0 )
+        {
+            conn->outBuffer.erase( 0, nWritten );
+        }
+        else if ( nWritten < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        else if ( nWritten < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+        {
+            break;  // The socket is full. Wait till it is writable.
+        }
+        else
+        {
+            hoxLog(LOG_SYS_WARN, "%s: Failed to write to socket", FNAME );
+            return hoxRC_ERR;
+        }
     }
 
-    /* Parse the request. */
-    pRequest.reset( new hoxRequest( requestStr ) );
-
-    if ( ! pRequest->isValid() )
+    const bool bWantWrite = ! conn->outBuffer.empty();
+    if ( bWantWrite != conn->bWantWrite )
     {
-        hoxLog(LOG_INFO, "%s: Request [%s] is invalid.", FNAME, requestStr.c_str() );
-        return hoxRC_NOT_VALID;
+        struct epoll_event ev;
+        ev.events  = EPOLLIN | ( bWantWrite ? (uint32_t) EPOLLOUT : (uint32_t) 0 );
+        ev.data.fd = conn->nSocket;
+        epoll_ctl( s_epollfd, EPOLL_CTL_MOD, conn->nSocket, &ev );
+        conn->bWantWrite = bWantWrite;
     }
 
     return hoxRC_OK;
@@ -135,24 +230,47 @@ read_request( int                   nfd,
  * Write an outgoing response back to the client.
  */
 hoxResult
-write_response( int                     nfd,
+write_response( ClientConnection*       conn,
                 const hoxResponse_SPtr& pResponse )
 {
-    const char* FNAME = __FUNCTION__;
-    const std::string resp         = pResponse->toString();
-    ssize_t           nToBeWritten = resp.size();
+    hoxResult result = hoxRC_ERR;
 
-    //hoxLog(LOG_DEBUG, "%s: Sending out (%d)...", FNAME, nToBeWritten);
-
-    ssize_t nWritten = write( nfd,
-                              resp.c_str(), nToBeWritten);
-    if ( nWritten != nToBeWritten )
+    pthread_mutex_lock( &conn->lock );
+    if ( ! conn->bClosed )
     {
-        hoxLog(LOG_SYS_WARN, "Failed to write to socket", FNAME );
-        return hoxRC_ERR;
+        conn->outBuffer.append( pResponse->toString() );
+        result = ::flush_output( conn );
     }
+    pthread_mutex_unlock( &conn->lock );
 
-    return hoxRC_OK;
+    return result;
+}
+
+/**
+ * Tell the other clients that a Player's info has changed,
+ * so that they drop it from their caches.
+ */
+void
+notify_player_changed( const ClientConnection* origin,
+                       const std::string&      sPlayerId )
+{
+    hoxResponse_SPtr pNotice( new hoxResponse( hoxREQUEST_DB_PLAYER_INVALIDATE ) );
+    pNotice->setContent( sPlayerId + "\n\n" );
+
+    pthread_mutex_lock( &s_connectionsLock );
+    for ( ClientConnectionMap::iterator it = s_connections.begin();
+                                        it != s_connections.end(); ++it )
+    {
+        ClientConnection* conn = it->second.get();
+        if (   conn->sClientId.empty()                   // Not subscribed?
+            || conn->sClientId == origin->sClientId )    // Same client?
+        {
+            continue;
+        }
+
+        (void) write_response( conn, pNotice );
+    }
+    pthread_mutex_unlock( &s_connectionsLock );
 }
 
 /**
@@ -197,6 +315,8 @@ handle_DB_PLAYER_PUT( const hoxRequest_SPtr&  pRequest,
     hoxLog(LOG_DEBUG, "%s: Put new player-info OK. id = [%s], password = [***], score = [%d].", 
             FNAME, playerInfo.id.c_str(), playerInfo.score);
 
+    hoxLeaderboard::set_score( playerInfo.id, playerInfo.score );
+
     /* Return:
      *         Player-Info
      */
@@ -286,6 +406,165 @@ handle_DB_PLAYER_SET( const hoxRequest_SPtr&  pRequest,
     hoxLog(LOG_DEBUG, "%s: Set new player-info OK. id = [%s], score = [%d].", 
             FNAME, playerInfo.id.c_str(), playerInfo.score);
 
+    hoxLeaderboard::set_score( playerInfo.id, playerInfo.score );
+
+    /* Return:
+     *       Nothing
+     */
+
+    std::ostringstream  outStream;
+
+    outStream << "\n\n";
+
+    pResponse.reset( new hoxResponse( pRequest->getType() ) );
+    pResponse->setContent( outStream.str() );
+
+    return hoxRC_OK;
+}
+
+/**
+ * Parse the data of request DB_PLAYER_SET_BATCH: one line per result,
+ * "pid;score;wins;draws;losses", with the counts to be added.
+ * If the request has a source ("src"), each line starts with the
+ * result's sequence number: "seq;pid;score;wins;draws;losses".
+ */
+void
+parse_player_batch( const hoxRequest_SPtr&       pRequest,
+                    hoxDBAPI::PlayerResultList&  results )
+{
+    const bool          bWithSeq = ! pRequest->getParam("src").empty();
+    std::istringstream  inStream( pRequest->getParam("data") );
+    std::string         sLine;
+
+    while ( std::getline( inStream, sLine ) )
+    {
+        std::istringstream        lineStream( sLine );
+        hoxDBAPI::PlayerResult_t  result;
+        hoxDBAPI::Player_t&       playerInfo = result.info;
+        std::string               sField;
+
+        if ( bWithSeq )
+        {
+            std::getline( lineStream, sField, ';' ); result.seq = ::atoll( sField.c_str() );
+        }
+        if ( ! std::getline( lineStream, playerInfo.id, ';' ) || playerInfo.id.empty() )
+        {
+            continue;
+        }
+        std::getline( lineStream, sField, ';' ); playerInfo.score  = ::atoi( sField.c_str() );
+        std::getline( lineStream, sField, ';' ); playerInfo.wins   = ::atoi( sField.c_str() );
+        std::getline( lineStream, sField, ';' ); playerInfo.draws  = ::atoi( sField.c_str() );
+        std::getline( lineStream, sField, ';' ); playerInfo.losses = ::atoi( sField.c_str() );
+
+        results.push_back( result );
+    }
+}
+
+/**
+ * Handle request DB_PLAYER_SET_BATCH.
+ */
+hoxResult
+handle_DB_PLAYER_SET_BATCH( const hoxRequest_SPtr&  pRequest,
+                            hoxResponse_SPtr&       pResponse )
+{
+    const char* FNAME = __FUNCTION__;
+    hoxResult                  result;
+    hoxDBAPI::PlayerResultList results;
+    hoxDBAPI::PlayerList       saved;
+
+    ::parse_player_batch( pRequest, results );
+
+    result = hoxDBAPI::set_players_info( results, pRequest->getParam("src"), saved );
+    if ( result != hoxRC_OK ) 
+    {
+        throw hoxError(hoxRC_ERR, "Failed to set players-info");
+    } 
+
+    hoxLog(LOG_DEBUG, "%s: Set [%d] players-info OK.", FNAME, saved.size());
+
+    for ( hoxDBAPI::PlayerList::const_iterator it = saved.begin();
+                                               it != saved.end(); ++it )
+    {
+        hoxLeaderboard::set_score( it->id, it->score );
+    }
+
+    /* Return:
+     *       Nothing
+     */
+
+    std::ostringstream  outStream;
+
+    outStream << "\n\n";
+
+    pResponse.reset( new hoxResponse( pRequest->getType() ) );
+    pResponse->setContent( outStream.str() );
+
+    return hoxRC_OK;
+}
+
+/**
+ * Parse the data of request DB_GAME_PUT_BATCH: one line per Game,
+ * "ended;red;black;status;type;redScore;blackScore;moves".
+ * If the request has a source ("src"), each line starts with the
+ * Game's sequence number.
+ */
+void
+parse_game_batch( const hoxRequest_SPtr&     pRequest,
+                  hoxDBAPI::GameRecordList&  games )
+{
+    const bool          bWithSeq = ! pRequest->getParam("src").empty();
+    std::istringstream  inStream( pRequest->getParam("data") );
+    std::string         sLine;
+
+    while ( std::getline( inStream, sLine ) )
+    {
+        std::istringstream      lineStream( sLine );
+        hoxDBAPI::GameRecord_t  record;
+        hoxDBAPI::Game_t&       game = record.info;
+        std::string             sField;
+
+        if ( bWithSeq )
+        {
+            std::getline( lineStream, sField, ';' ); record.seq = ::atoll( sField.c_str() );
+        }
+        std::getline( lineStream, sField, ';' );     game.ended = ::atol( sField.c_str() );
+        std::getline( lineStream, game.red, ';' );
+        std::getline( lineStream, game.black, ';' );
+        if ( game.red.empty() || game.black.empty() )
+        {
+            continue;
+        }
+        std::getline( lineStream, game.status, ';' );
+        std::getline( lineStream, sField, ';' ); game.type       = ::atoi( sField.c_str() );
+        std::getline( lineStream, sField, ';' ); game.redScore   = ::atoi( sField.c_str() );
+        std::getline( lineStream, sField, ';' ); game.blackScore = ::atoi( sField.c_str() );
+        std::getline( lineStream, sField, ';' ); game.moves      = ::atoi( sField.c_str() );
+
+        games.push_back( record );
+    }
+}
+
+/**
+ * Handle request DB_GAME_PUT_BATCH.
+ */
+hoxResult
+handle_DB_GAME_PUT_BATCH( const hoxRequest_SPtr&  pRequest,
+                          hoxResponse_SPtr&       pResponse )
+{
+    const char* FNAME = __FUNCTION__;
+    hoxResult                result;
+    hoxDBAPI::GameRecordList games;
+
+    ::parse_game_batch( pRequest, games );
+
+    result = hoxDBAPI::put_games( games, pRequest->getParam("src") );
+    if ( result != hoxRC_OK ) 
+    {
+        throw hoxError(hoxRC_ERR, "Failed to put games");
+    } 
+
+    hoxLog(LOG_DEBUG, "%s: Put [%d] games OK.", FNAME, games.size());
+
     /* Return:
      *       Nothing
      */
@@ -300,6 +579,85 @@ handle_DB_PLAYER_SET( const hoxRequest_SPtr&  pRequest,
     return hoxRC_OK;
 }
 
+/**
+ * Get a numeric parameter of a request, bounded to [nMin, nMax].
+ * A missing parameter takes the default value.
+ *
+ * @throw hoxError(hoxRC_NOT_VALID) if the parameter is not a number.
+ */
+int
+get_bounded_param( const hoxRequest_SPtr&  pRequest,
+                   const std::string&      sName,
+                   const int               nDefault,
+                   const int               nMin,
+                   const int               nMax )
+{
+    const std::string sValue = pRequest->getParam( sName );
+    if ( sValue.empty() ) return nDefault;
+
+    char* pEnd = NULL;
+    const long nValue = ::strtol( sValue.c_str(), &pEnd, 10 );
+    if ( *pEnd != '\0' )
+    {
+        throw hoxError(hoxRC_NOT_VALID, "Invalid parameter '" + sName + "'");
+    }
+    return (int) std::min( std::max( nValue, (long) nMin ), (long) nMax );
+}
+
+/**
+ * Handle request DB_GAMES_GET.
+ */
+hoxResult
+handle_DB_GAMES_GET( const hoxRequest_SPtr&  pRequest,
+                     hoxResponse_SPtr&       pResponse )
+{
+    const char* FNAME = __FUNCTION__;
+    hoxResult          result;
+    const std::string  pid    = pRequest->getParam("pid");
+    const std::string  oid    = pRequest->getParam("oid");
+    const long long    cursor = ::atoll( pRequest->getParam("cursor").c_str() );
+    const int          nLimit = ::get_bounded_param( pRequest, "limit", DBAGENT_MAX_GAMES,
+                                                     1, DBAGENT_MAX_GAMES );
+    hoxDBAPI::GameList games;
+
+    result = hoxDBAPI::get_games( pid, oid, cursor, nLimit, games );
+    if ( result != hoxRC_OK ) 
+    {
+        throw hoxError(hoxRC_ERR, "Failed to get games");
+    } 
+
+    hoxLog(LOG_DEBUG, "%s: Got [%d] games of [%s] before [%lld].", FNAME,
+        games.size(), pid.c_str(), cursor);
+
+    /* Return:
+     *       One line per Game, the most recent first:
+     *       "gid;ended;red;black;status;type;redScore;blackScore;moves".
+     *       The last Game-Id is the cursor of the next page.
+     */
+
+    std::ostringstream  outStream;
+
+    for ( hoxDBAPI::GameList::const_iterator it = games.begin();
+                                             it != games.end(); ++it )
+    {
+        outStream << it->id << ";"
+                  << it->ended << ";"
+                  << it->red << ";"
+                  << it->black << ";"
+                  << it->status << ";"
+                  << it->type << ";"
+                  << it->redScore << ";"
+                  << it->blackScore << ";"
+                  << it->moves << "\n";
+    }
+    outStream << ( games.empty() ? "\n\n" : "\n" );
+
+    pResponse.reset( new hoxResponse( pRequest->getType() ) );
+    pResponse->setContent( outStream.str() );
+
+    return hoxRC_OK;
+}
+
 /**
  * Handle request DB_PROFILE_SET.
  */
@@ -372,6 +730,89 @@ handle_DB_PASSWORD_SET( const hoxRequest_SPtr&  pRequest,
     return hoxRC_OK;
 }
 
+/**
+ * Write the entries of the leaderboard, one line per Player:
+ * "rank;pid;score", ending the response.
+ */
+void
+write_leaderboard_entries( const hoxLeaderboard::EntryList& entries,
+                           std::ostringstream&              outStream )
+{
+    for ( hoxLeaderboard::EntryList::const_iterator it = entries.begin();
+                                                    it != entries.end(); ++it )
+    {
+        outStream << it->rank << ";"
+                  << it->pid << ";"
+                  << it->score << "\n";
+    }
+    outStream << ( entries.empty() ? "\n\n" : "\n" );
+}
+
+/**
+ * Handle request DB_LEADERS_GET.
+ */
+hoxResult
+handle_DB_LEADERS_GET( const hoxRequest_SPtr&  pRequest,
+                       hoxResponse_SPtr&       pResponse )
+{
+    const char* FNAME = __FUNCTION__;
+    const int nFrom  = ::get_bounded_param( pRequest, "from", 0, 0, INT_MAX );
+    const int nCount = ::get_bounded_param( pRequest, "count", DBAGENT_MAX_LEADERS,
+                                            1, DBAGENT_MAX_LEADERS );
+    hoxLeaderboard::EntryList entries;
+
+    hoxLeaderboard::get_top( nFrom, nCount, entries );
+
+    hoxLog(LOG_DEBUG, "%s: Got [%d] leaders from [%d].", FNAME, entries.size(), nFrom);
+
+    /* Return:
+     *       The Players ranked from "from" (0 for the first).
+     */
+
+    std::ostringstream  outStream;
+
+    ::write_leaderboard_entries( entries, outStream );
+
+    pResponse.reset( new hoxResponse( pRequest->getType() ) );
+    pResponse->setContent( outStream.str() );
+
+    return hoxRC_OK;
+}
+
+/**
+ * Handle request DB_RANK_GET.
+ */
+hoxResult
+handle_DB_RANK_GET( const hoxRequest_SPtr&  pRequest,
+                    hoxResponse_SPtr&       pResponse )
+{
+    const char* FNAME = __FUNCTION__;
+    const std::string pid     = pRequest->getParam("pid");
+    const int         nAround = ::get_bounded_param( pRequest, "around", 0,
+                                                     0, DBAGENT_MAX_LEADERS / 2 );
+    hoxLeaderboard::EntryList entries;
+
+    if ( hoxRC_OK != hoxLeaderboard::get_around( pid, nAround, entries ) )
+    {
+        throw hoxError(hoxRC_NOT_FOUND, "Player not found");
+    }
+
+    hoxLog(LOG_DEBUG, "%s: Got [%d] Players around [%s].", FNAME, entries.size(), pid.c_str());
+
+    /* Return:
+     *       The Player, with up to "around" neighbors on each side.
+     */
+
+    std::ostringstream  outStream;
+
+    ::write_leaderboard_entries( entries, outStream );
+
+    pResponse.reset( new hoxResponse( pRequest->getType() ) );
+    pResponse->setContent( outStream.str() );
+
+    return hoxRC_OK;
+}
+
 /**
  * Handle request HTTP_GET.
  */
@@ -412,22 +853,13 @@ handle_HTTP_GET( const hoxRequest_SPtr&  pRequest,
  * Handle request LOG.
  */
 hoxResult
-handle_LOG( int                     nfd,
-            const hoxRequest_SPtr&  pRequest,
+handle_LOG( const hoxRequest_SPtr&  pRequest,
             hoxResponse_SPtr&       pResponse )
 {
-    const char* FNAME = __FUNCTION__;
-
     const int nSize = ::atoi( pRequest->getParam("size").c_str() );
     //hoxLog(LOG_DEBUG, "%s: Expect to log a message of size [%d] to file.", FNAME, nSize);
 
-    std::string sMsg;
-    if ( hoxRC_OK != hoxSocketAPI::read_nbytes( nfd, nSize,
-                                                sMsg ) )
-    {
-        hoxLog(LOG_SYS_WARN, "%s: Failed to read [%d] bytes", FNAME, nSize);
-        // Still allow to continue
-    }
+    const std::string sMsg = pRequest->getParam("data");
 
     write( s_serverfd, sMsg.data(), sMsg.size() );
 
@@ -450,8 +882,7 @@ handle_LOG( int                     nfd,
  * Handle a request.
  */
 hoxResult
-handle_request( int                     nfd,
-                const hoxRequest_SPtr&  pRequest,
+handle_request( const hoxRequest_SPtr&  pRequest,
                 hoxResponse_SPtr&       pResponse )
 {
     const char* FNAME = __FUNCTION__;
@@ -475,17 +906,32 @@ handle_request( int                     nfd,
             case hoxREQUEST_DB_PLAYER_SET:
                 return handle_DB_PLAYER_SET( pRequest, pResponse );
 
+            case hoxREQUEST_DB_PLAYER_SET_BATCH:
+                return handle_DB_PLAYER_SET_BATCH( pRequest, pResponse );
+
+            case hoxREQUEST_DB_GAME_PUT_BATCH:
+                return handle_DB_GAME_PUT_BATCH( pRequest, pResponse );
+
+            case hoxREQUEST_DB_GAMES_GET:
+                return handle_DB_GAMES_GET( pRequest, pResponse );
+
             case hoxREQUEST_DB_PROFILE_SET:
                 return handle_DB_PROFILE_SET( pRequest, pResponse );
 
             case hoxREQUEST_DB_PASSWORD_SET:
                 return handle_DB_PASSWORD_SET( pRequest, pResponse );
 
+            case hoxREQUEST_DB_LEADERS_GET:
+                return handle_DB_LEADERS_GET( pRequest, pResponse );
+
+            case hoxREQUEST_DB_RANK_GET:
+                return handle_DB_RANK_GET( pRequest, pResponse );
+
             case hoxREQUEST_HTTP_GET:
                 return handle_HTTP_GET( pRequest, pResponse );
 
             case hoxREQUEST_LOG:
-                return handle_LOG( nfd, pRequest, pResponse );
+                return handle_LOG( pRequest, pResponse );
 
             default:
                 throw hoxError(hoxRC_NOT_SUPPORTED, "Unsupported Request");
@@ -503,79 +949,590 @@ handle_request( int                     nfd,
 }
 
 /**
- * A thread that handles a client connection.
+ * Handle a request and write its response (with the request's Id, if any).
  */
-void*
-handle_client_thread( void* arg )
+hoxResult
+answer_request( ClientConnection*       conn,
+                const hoxRequest_SPtr&  pRequest )
 {
     const char* FNAME = __FUNCTION__;
-    const SocketInfo_APtr pSocketInfo( (SocketInfo* ) arg );
-    hoxResult result;
-
-    hoxLog(LOG_INFO, "%s: ENTER. Client from = [%s].", FNAME, 
-        inet_ntoa( pSocketInfo->iaFrom ));
+    hoxResponse_SPtr pResponse;
+    hoxResult        result;
 
-    const int fd = pSocketInfo->nSocket;
-
-    /* Set the socket's timeout on reading INPUT. */ 
-    const int timeout = (365 * 24 * 3600 );  // forever =  1 year
-    if ( hoxRC_OK != hoxSocketAPI::set_read_timeout( fd, timeout ) )
+    result = ::handle_request( pRequest,
+                               pResponse );
+    if ( result != hoxRC_OK )
     {
-        hoxLog(LOG_SYS_WARN, "%s: Fail to set socket's read timeout.", FNAME);
-        // NOTE: *** Still allow to continue.
+        hoxLog(LOG_INFO, "%s: Failed to handle request.", FNAME);
+        // TODO: Still allow to continue...
     }
 
-    for (;;)
-    {
-        hoxRequest_SPtr  pRequest;
-        hoxResponse_SPtr pResponse;
+    /* Write a response, if any. */
 
-        /* Read the incoming request. */
+    const hoxResult handleResult = result;
 
-        result = ::read_request( fd,
-                                 &(pSocketInfo->iaFrom),
-                                 pRequest );
+    if ( pResponse.get() != NULL )
+    {
+        pResponse->setRid( pRequest->getParam("rid") );
+        result = write_response( conn, 
+                                 pResponse );
         if ( result != hoxRC_OK )
         {
-            if ( result != hoxRC_CLOSED ) // Not 'connection closed'?
-            {
-                hoxLog(LOG_INFO, "%s: Cannot read request.", FNAME);
-            }
-            break;
+            hoxLog(LOG_WARN, "%s: Failed to write response", FNAME);
+            return hoxRC_ERR;
         }
+    }
 
-        //hoxLog(LOG_DEBUG, "%s: Received [%s]", FNAME, pRequest->toString().c_str() );
-
-        /* Handle the request. */
+    /* Let the other clients know of a Player's info changed. */
 
-        result = ::handle_request( fd,
-                                   pRequest,
-                                   pResponse );
-        if ( result != hoxRC_OK )
+    if ( handleResult == hoxRC_OK )
+    {
+        switch ( pRequest->getType() )
         {
-            hoxLog(LOG_INFO, "%s: Failed to handle request.", FNAME);
-            // TODO: Still allow to continue...
-        }
-
-        /* Write a response, if any. */
+            case hoxREQUEST_DB_PLAYER_SET:
+            case hoxREQUEST_DB_PROFILE_SET:
+            case hoxREQUEST_DB_PASSWORD_SET:
+                ::notify_player_changed( conn, pRequest->getParam("pid") );
+                break;
 
-        if ( pResponse.get() != NULL )
-        {
-            result = write_response( fd, 
-                                     pResponse );
-            if ( result != hoxRC_OK )
+            case hoxREQUEST_DB_PLAYER_SET_BATCH:
             {
-                hoxLog(LOG_WARN, "%s: Failed to write response", FNAME);
+                hoxDBAPI::PlayerResultList results;
+                ::parse_player_batch( pRequest, results );
+                for ( hoxDBAPI::PlayerResultList::const_iterator it = results.begin();
+                                                                 it != results.end(); ++it )
+                {
+                    ::notify_player_changed( conn, it->info.id );
+                }
                 break;
             }
-        }
-
-    } /* for(...) */
-    
-    /* Close connection. */
-    close( fd );
 
-    hoxLog(LOG_INFO, "%s: END.", FNAME);
+            default:
+                break;
+        }
+    }
+
+    return hoxRC_OK;
+}
+
+/**
+ * A request to be answered by a worker.
+ */
+class Job
+{
+public:
+    ClientConnection_SPtr  conn;
+    hoxRequest_SPtr        pRequest;
+    bool                   bOrdered;  // Is it one of those without Id?
+};
+
+void run_job( const Job& job );
+
+/**
+ * A fixed pool of worker threads, each with its own database connection,
+ * answering the requests queued to them.
+ */
+class WorkerPool
+{
+public:
+    WorkerPool( const char* szName ) : _szName( szName )
+    {
+        pthread_mutex_init( &_lock, NULL );
+        pthread_cond_init( &_cond, NULL );
+    }
+
+    /**
+     * Start a number of worker threads.
+     *
+     * @return The number of threads started.
+     */
+    int start( int nThreads )
+    {
+        int nStarted = 0;
+        for ( int i = 0; i < nThreads; ++i )
+        {
+            pthread_t thread;
+            if ( 0 != pthread_create( &thread,
+                                      NULL,   /* Use Default Attributes */
+                                      _run,
+                                      (void*) this ) )
+            {
+                hoxLog(LOG_SYS_ERROR, "%s: Failed to create %s worker Thread", __FUNCTION__, _szName);
+                break;
+            }
+            pthread_detach( thread );
+            ++nStarted;
+        }
+        return nStarted;
+    }
+
+    void submit( const Job& job )
+    {
+        pthread_mutex_lock( &_lock );
+        _jobs.push_back( job );
+        pthread_cond_signal( &_cond );
+        pthread_mutex_unlock( &_lock );
+    }
+
+private:
+    static void* _run( void* arg )
+    {
+        WorkerPool* pool = (WorkerPool*) arg;
+
+        /* Open this worker's database connection. */
+        (void) hoxDBAPI::open_connection();  // NOTE: Retried on the first request.
+
+        for (;;)
+        {
+            pthread_mutex_lock( &pool->_lock );
+            while ( pool->_jobs.empty() )
+            {
+                pthread_cond_wait( &pool->_cond, &pool->_lock );
+            }
+            const Job job = pool->_jobs.front();
+            pool->_jobs.pop_front();
+            pthread_mutex_unlock( &pool->_lock );
+
+            ::run_job( job );
+        }
+
+        return NULL;
+    }
+
+private:
+    const char*      _szName;
+    pthread_mutex_t  _lock;
+    pthread_cond_t   _cond;   // Signaled when a job is queued.
+    std::list<Job>   _jobs;
+};
+
+/**
+ * The workers reading the database are apart from those writing to it,
+ * so that reads never wait behind writes.
+ */
+static WorkerPool s_readPool( "read" );
+static WorkerPool s_writePool( "write" );
+
+/**
+ * Queue a request to the workers reading or writing the database.
+ */
+void
+submit_request( const ClientConnection_SPtr& conn,
+                const hoxRequest_SPtr&       pRequest,
+                bool                         bOrdered )
+{
+    Job job;
+    job.conn     = conn;
+    job.pRequest = pRequest;
+    job.bOrdered = bOrdered;
+
+    switch ( pRequest->getType() )
+    {
+        case hoxREQUEST_DB_PLAYER_PUT:
+        case hoxREQUEST_DB_PLAYER_SET:
+        case hoxREQUEST_DB_PLAYER_SET_BATCH:
+        case hoxREQUEST_DB_GAME_PUT_BATCH:
+        case hoxREQUEST_DB_PROFILE_SET:
+        case hoxREQUEST_DB_PASSWORD_SET:
+            s_writePool.submit( job );
+            break;
+
+        default:
+            s_readPool.submit( job );
+            break;
+    }
+}
+
+/**
+ * Answer a queued request, then submit the next one without Id, if any.
+ */
+void
+run_job( const Job& job )
+{
+    (void) ::answer_request( job.conn.get(), job.pRequest );
+
+    if ( ! job.bOrdered )
+    {
+        return;
+    }
+
+    ClientConnection* conn = job.conn.get();
+    hoxRequest_SPtr   pNext;
+
+    pthread_mutex_lock( &conn->lock );
+    if ( ! conn->orderedRequests.empty() && ! conn->bClosed )
+    {
+        pNext = conn->orderedRequests.front();
+        conn->orderedRequests.pop_front();
+    }
+    else
+    {
+        conn->bOrderedBusy = false;
+    }
+    pthread_mutex_unlock( &conn->lock );
+
+    if ( pNext )
+    {
+        ::submit_request( job.conn, pNext, true /* ordered */ );
+    }
+}
+
+/**
+ * Dispatch a request just parsed.
+ */
+void
+dispatch_request( const ClientConnection_SPtr& conn,
+                  const hoxRequest_SPtr&       pRequest )
+{
+    //hoxLog(LOG_DEBUG, "%s: Received [%s]", __FUNCTION__, pRequest->toString().c_str() );
+
+    if (   pRequest->getType() == hoxREQUEST_HELLO
+        && ! pRequest->getParam("cid").empty() )
+    {
+        pthread_mutex_lock( &s_connectionsLock );
+        conn->sClientId = pRequest->getParam("cid");
+        pthread_mutex_unlock( &s_connectionsLock );
+    }
+
+    /* HELLO and LOG need no database: answer them here, in order. */
+
+    if (   pRequest->getType() == hoxREQUEST_HELLO
+        || pRequest->getType() == hoxREQUEST_LOG )
+    {
+        (void) ::answer_request( conn.get(), pRequest );
+        return;
+    }
+
+    /* Queue a request without an Id behind the others, if any. */
+
+    if ( pRequest->getParam("rid").empty() )
+    {
+        pthread_mutex_lock( &conn->lock );
+        const bool bBusy = conn->bOrderedBusy;
+        if ( bBusy )
+        {
+            conn->orderedRequests.push_back( pRequest );
+        }
+        conn->bOrderedBusy = true;
+        pthread_mutex_unlock( &conn->lock );
+
+        if ( ! bBusy )
+        {
+            ::submit_request( conn, pRequest, true /* ordered */ );
+        }
+        return;
+    }
+
+    ::submit_request( conn, pRequest, false /* not ordered */ );
+}
+
+/**
+ * Parse the complete requests read from a connection, and dispatch them.
+ *
+ * A request is a line, followed by "size" bytes of data for LOG,
+ * DB_PLAYER_SET_BATCH and DB_GAME_PUT_BATCH (kept in its "data" parameter).
+ */
+hoxResult
+parse_requests( const ClientConnection_SPtr& conn )
+{
+    const char* FNAME = __FUNCTION__;
+    std::string&           inBuffer = conn->inBuffer;
+    std::string::size_type nStart = 0;
+    hoxResult              result = hoxRC_OK;
+
+    for (;;)
+    {
+        const std::string::size_type nEnd = inBuffer.find( '\n', nStart );
+        if ( nEnd == std::string::npos )
+        {
+            if ( inBuffer.size() - nStart >= hoxNETWORK_MAX_MSG_SIZE )  // Impose some limit.
+            {
+                hoxLog(LOG_WARN, "%s: Maximum message's size [%d] reached. "
+                    "Likely to be an error.", FNAME, hoxNETWORK_MAX_MSG_SIZE );
+                result = hoxRC_ERR;
+            }
+            break;
+        }
+
+        if ( nEnd == nStart )  // Skip an empty line.
+        {
+            nStart = nEnd + 1;
+            continue;
+        }
+
+        hoxRequest_SPtr pRequest( new hoxRequest( inBuffer.substr( nStart, nEnd - nStart ) ) );
+        if ( ! pRequest->isValid() )
+        {
+            hoxLog(LOG_INFO, "%s: Request [%s] is invalid.", FNAME,
+                inBuffer.substr( nStart, nEnd - nStart ).c_str() );
+            result = hoxRC_NOT_VALID;
+            break;
+        }
+
+        std::string::size_type nNext = nEnd + 1;
+
+        /* The data following the request. */
+        if (   pRequest->getType() == hoxREQUEST_LOG
+            || pRequest->getType() == hoxREQUEST_DB_PLAYER_SET_BATCH
+            || pRequest->getType() == hoxREQUEST_DB_GAME_PUT_BATCH )
+        {
+            const size_t nSize = ::atoi( pRequest->getParam("size").c_str() );
+            if ( inBuffer.size() - nNext < nSize )
+            {
+                break;  // Wait for the rest.
+            }
+            pRequest->setParam("data", inBuffer.substr( nNext, nSize ));
+            nNext += nSize;
+        }
+
+        nStart = nNext;
+        ::dispatch_request( conn, pRequest );
+    }
+
+    inBuffer.erase( 0, nStart );
+    return result;
+}
+
+/**
+ * Read what is available from a connection, then parse it.
+ *
+ * @return hoxRC_CLOSED if the client has closed the connection.
+ */
+hoxResult
+read_requests( const ClientConnection_SPtr& conn )
+{
+    char buf[DBAGENT_READ_CHUNK_SIZE];
+
+    for (;;)
+    {
+        const ssize_t nRead = read( conn->nSocket, buf, sizeof(buf) );
+        if ( nRead > 0 )
+        {
+            conn->inBuffer.append( buf, nRead );
+            continue;
+        }
+
+        if ( nRead < 0 && errno == EINTR )
+        {
+            continue;
+        }
+
+        /* Parse what has been read, even if the connection is closed. */
+        const hoxResult result = ::parse_requests( conn );
+        if ( result != hoxRC_OK )
+        {
+            return result;
+        }
+
+        if ( nRead < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+        {
+            return hoxRC_OK;  // All read for now.
+        }
+
+        if ( nRead < 0 )
+        {
+            hoxLog(LOG_SYS_WARN, "%s: Failed to read from %s", __FUNCTION__,
+                conn->sFrom.c_str());
+            return hoxRC_ERR;
+        }
+
+        return hoxRC_CLOSED;
+    }
+}
+
+/**
+ * Close a connection. Its socket is closed when the workers answering
+ * its last requests are done with it.
+ */
+void
+close_client_connection( const ClientConnection_SPtr& conn )
+{
+    hoxLog(LOG_INFO, "%s: Client from = [%s].", __FUNCTION__,
+        conn->sFrom.c_str());
+
+    pthread_mutex_lock( &conn->lock );
+    conn->bClosed = true;
+    conn->orderedRequests.clear();
+    pthread_mutex_unlock( &conn->lock );
+
+    epoll_ctl( s_epollfd, EPOLL_CTL_DEL, conn->nSocket, NULL );
+    shutdown( conn->nSocket, SHUT_RDWR );
+
+    pthread_mutex_lock( &s_connectionsLock );
+    s_connections.erase( conn->nSocket );
+    pthread_mutex_unlock( &s_connectionsLock );
+}
+
+/**
+ * Accept all the pending connections on the listening socket.
+ */
+void
+accept_connections( int listenSock )
+{
+    const char* FNAME = __FUNCTION__;
+    struct sockaddr_storage clientAddress;  // IPv4 or Unix-domain.
+    socklen_t               clientAddressLength;
+
+    for (;;)
+    {
+        clientAddressLength = sizeof(clientAddress);
+        const int cliSock = accept4( listenSock,
+                                     (struct sockaddr *) &clientAddress,
+                                     &clientAddressLength,
+                                     SOCK_NONBLOCK | SOCK_CLOEXEC );
+        if ( cliSock < 0 )
+        {
+            if ( errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
+            {
+                hoxLog(LOG_SYS_ERROR, "%s: cannot accept connection", FNAME);
+            }
+            return;
+        }
+
+        std::string sFrom = "local";  // From a Unix-domain socket.
+
+        if ( clientAddress.ss_family == AF_INET )
+        {
+            const struct sockaddr_in* pAddr = (struct sockaddr_in *) &clientAddress;
+
+            /* (1) Show the IP address of the client.
+             *     inet_ntoa() converts an IP address from binary form to the
+             *     standard "numbers and dots" notation.
+             *
+             * (2) Show the client's port number.
+             *     ntohs() converts a short int from network byte order (which is
+             *     Most Significant Byte first) to host byte order (which on x86,
+             *     for example, is Least Significant Byte first).
+             */
+            sFrom = inet_ntoa(pAddr->sin_addr);
+            hoxLog(LOG_INFO, "%s: connected to [%s:%d]", FNAME, 
+                sFrom.c_str(),
+                ntohs(pAddr->sin_port));
+
+            /* Send each (small) response at once, even if some are pipelined. */
+            int nNoDelay = 1;
+            setsockopt( cliSock, IPPROTO_TCP, TCP_NODELAY, &nNoDelay, sizeof(nNoDelay) );
+        }
+        else
+        {
+            hoxLog(LOG_INFO, "%s: connected to [%s]", FNAME, sFrom.c_str());
+        }
+
+        ClientConnection_SPtr conn( new ClientConnection( cliSock, sFrom ) );
+
+        pthread_mutex_lock( &s_connectionsLock );
+        s_connections[cliSock] = conn;
+        pthread_mutex_unlock( &s_connectionsLock );
+
+        struct epoll_event ev;
+        ev.events  = EPOLLIN;
+        ev.data.fd = cliSock;
+        if ( 0 != epoll_ctl( s_epollfd, EPOLL_CTL_ADD, cliSock, &ev ) )
+        {
+            hoxLog(LOG_SYS_ERROR, "%s: Failed to watch the new connection", FNAME);
+            ::close_client_connection( conn );
+        }
+    }
+}
+
+/**
+ * The reactor: wait for the sockets to be ready, then accept the new
+ * connections, read the requests and write the pending responses.
+ */
+void
+run_reactor( int listenSock )
+{
+    const char* FNAME = __FUNCTION__;
+    struct epoll_event events[DBAGENT_MAX_EVENTS];
+
+    for (;;)
+    {
+        const int nEvents = epoll_wait( s_epollfd, events, DBAGENT_MAX_EVENTS, -1 );
+        if ( nEvents < 0 )
+        {
+            if ( errno == EINTR ) continue;
+            hoxLog(LOG_SYS_ERROR, "%s: epoll_wait failed", FNAME);
+            exit(1);
+        }
+
+        for ( int i = 0; i < nEvents; ++i )
+        {
+            const int fd = events[i].data.fd;
+            if ( fd == listenSock )
+            {
+                ::accept_connections( listenSock );
+                continue;
+            }
+
+            ClientConnectionMap::iterator found = s_connections.find( fd );
+            if ( found == s_connections.end() )
+            {
+                continue;  // Closed earlier in this round.
+            }
+            const ClientConnection_SPtr conn = found->second;
+
+            bool bClose = ( events[i].events & ( EPOLLERR | EPOLLHUP ) ) != 0;
+
+            if ( ! bClose && ( events[i].events & EPOLLOUT ) )
+            {
+                pthread_mutex_lock( &conn->lock );
+                bClose = ( hoxRC_OK != ::flush_output( conn.get() ) );
+                pthread_mutex_unlock( &conn->lock );
+            }
+
+            if ( ! bClose && ( events[i].events & EPOLLIN ) )
+            {
+                const hoxResult result = ::read_requests( conn );
+                if ( result != hoxRC_OK && result != hoxRC_CLOSED )
+                {
+                    hoxLog(LOG_INFO, "%s: Cannot read request.", FNAME);
+                }
+                bClose = ( result != hoxRC_OK );
+            }
+
+            if ( bClose )
+            {
+                ::close_client_connection( conn );
+            }
+        }
+    }
+}
+
+/**
+ * The thread writing the logs that the (local) servers put in the
+ * shared-memory ring.
+ */
+void*
+handle_log_ring_thread( void* /*arg*/ )
+{
+    const char* FNAME = __FUNCTION__;
+    std::string sMsgs;
+
+    for (;;)
+    {
+        sMsgs.clear();
+        if ( hoxRC_OK != hoxLogRing::read( sMsgs, DBAGENT_LOG_RING_WAIT ) )
+        {
+            continue;
+        }
+
+        /* Write them all, unless the file fails (then they are lost). */
+        size_t nWritten = 0;
+        while ( nWritten < sMsgs.size() )
+        {
+            const ssize_t n = write( s_serverfd, sMsgs.data() + nWritten,
+                                     sMsgs.size() - nWritten );
+            if ( n < 0 )
+            {
+                if ( errno == EINTR ) continue;
+                hoxLog(LOG_SYS_WARN, "%s: Failed to write [%d] bytes of logs", FNAME,
+                    (int) ( sMsgs.size() - nWritten ));
+                break;
+            }
+            nWritten += n;
+        }
+    }
+
     return NULL;
 }
 
@@ -585,9 +1542,12 @@ static void usage( const char *progname )
 {
     fprintf( stderr, "Usage: %s -l <log_directory> [<options>]\n\n"
              "Possible options:\n\n"
-             "\t-b <listening_ip>       The listening IP address.\n"
+             "\t-b <listening_ip>       The listening IP address,\n"
+             "\t                        or unix:<path> for a local socket.\n"
              "\t-p <listening_port>     The listening port.\n"
              "\t-l <loggin_directory>   The logging directory.\n"
+             "\t-r <log_ring_name>      Read the local servers' logs from this\n"
+             "\t                        shared-memory ring (e.g. /hoxlog).\n"
              "\t-h                      Print this message.\n",
              progname );
     exit( 1 );
@@ -601,7 +1561,7 @@ static void parse_arguments( int argc, char *argv[] )
     int opt;
     char* c = NULL;
 
-    while (( opt = getopt( argc, argv, "b:p:l:h" ) ) != EOF )
+    while (( opt = getopt( argc, argv, "b:p:l:r:h" ) ) != EOF )
     {
         switch ( opt )
         {
@@ -609,6 +1569,12 @@ static void parse_arguments( int argc, char *argv[] )
                 if (( c = strdup( optarg ) ) == NULL )
                     err_sys_quit( s_errfd, "ERROR: strdup" );
                 s_serverIP = c;
+                if ( 0 == strncmp( c, DBAGENT_UNIX_PREFIX, strlen(DBAGENT_UNIX_PREFIX) ) )
+                {
+                    s_unixPath = c + strlen(DBAGENT_UNIX_PREFIX);
+                    if ( strlen( s_unixPath ) >= sizeof(((struct sockaddr_un *) 0)->sun_path) )
+                        err_quit( s_errfd, "ERROR: socket path too long: %s", s_unixPath );
+                }
                 break;
             case 'p':
                 s_nListenPort = atoi( optarg );
@@ -618,6 +1584,9 @@ static void parse_arguments( int argc, char *argv[] )
             case 'l':
                 s_logdir = optarg;
                 break;
+            case 'r':
+                s_logRingName = optarg;
+                break;
             case 'h':
             case '?':
                 usage( argv[0] );
@@ -691,6 +1660,10 @@ static void wdog_sighandler( int signo )
             hoxLog(LOG_INFO, "watchdog: caught SIGTERM, terminating" );
             const std::string sFilename = std::string(s_logdir) + PID_FILE;
             unlink( sFilename.c_str() );
+            if ( s_unixPath != NULL )
+            {
+                unlink( s_unixPath );
+            }
             exit( 0 );
         }
         default:
@@ -710,12 +1683,7 @@ main( int argc, char *argv[] )
 {
     const char* FNAME = __FUNCTION__;
     int       listenSock;   // Server listening socket.
-    int       cliSock;      // Client remote socket.
-    socklen_t clientAddressLength;
-    struct sockaddr_in clientAddress;
     struct sockaddr_in serverAddress;
-    SocketInfo* pSocketInfo = NULL;
-    pthread_t   serviceThread;
 
     /* Parse command-line options */
     parse_arguments( argc, argv );
@@ -733,80 +1701,107 @@ main( int argc, char *argv[] )
     Signal( SIGTERM, wdog_sighandler );  /* terminate */
 
     /* Create socket for listening for client connection requests.  */
-    listenSock = socket(AF_INET, SOCK_STREAM, 0);
+    listenSock = socket(s_unixPath ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
     if (listenSock < 0) 
     {
         hoxLog(LOG_SYS_ERROR, "%s: cannot create listen socket", FNAME);
         exit(1);
     }
-  
-    /* Bind listen socket to listen port. */
-    serverAddress.sin_family = AF_INET;
-    serverAddress.sin_addr.s_addr = inet_addr(s_serverIP);
-    serverAddress.sin_port = htons(s_nListenPort);
 
-    if ( bind( listenSock,
-               (struct sockaddr *) &serverAddress,
-               sizeof(serverAddress) ) < 0 ) 
+    if ( s_unixPath != NULL )
     {
-        hoxLog(LOG_SYS_ERROR, "%s: cannot bind socket", FNAME);
-        exit(1);
+        /* Bind listen socket to the local path, left over by a previous
+         * run if any.
+         */
+        struct sockaddr_un unixAddress;
+        memset( &unixAddress, 0, sizeof(unixAddress) );
+        unixAddress.sun_family = AF_UNIX;
+        strcpy( unixAddress.sun_path, s_unixPath );
+
+        unlink( s_unixPath );
+        if ( bind( listenSock,
+                   (struct sockaddr *) &unixAddress,
+                   sizeof(unixAddress) ) < 0 ) 
+        {
+            hoxLog(LOG_SYS_ERROR, "%s: cannot bind socket to [%s]", FNAME, s_unixPath);
+            exit(1);
+        }
     }
-
-    /* Wait for connections from clients.
-     * This is a non-blocking call; i.e., it registers this program with
-     * the system as expecting connections on this socket, and then
-     * this thread of execution continues on.
-     */
-    listen(listenSock, 5);
-  
-    for (;;)
+    else
     {
-        hoxLog(LOG_INFO, "%s: Waiting for connections on [%s:%d]...", 
-            FNAME, s_serverIP, s_nListenPort);
-
-        /* Accept a connection with a client that is requesting one.
+        /* Allow a restarted agent to bind again at once, so that the
+         * servers can reconnect to it.
          */
-        clientAddressLength = sizeof(clientAddress);
-        cliSock = accept( listenSock,
-                          (struct sockaddr *) &clientAddress,
-                          &clientAddressLength);
-        if ( cliSock < 0 ) 
+        int nReuse = 1;
+        setsockopt( listenSock, SOL_SOCKET, SO_REUSEADDR, &nReuse, sizeof(nReuse) );
+      
+        /* Bind listen socket to listen port. */
+        serverAddress.sin_family = AF_INET;
+        serverAddress.sin_addr.s_addr = inet_addr(s_serverIP);
+        serverAddress.sin_port = htons(s_nListenPort);
+
+        if ( bind( listenSock,
+                   (struct sockaddr *) &serverAddress,
+                   sizeof(serverAddress) ) < 0 ) 
         {
-            hoxLog(LOG_SYS_ERROR, "%s: cannot accept connection", FNAME);
+            hoxLog(LOG_SYS_ERROR, "%s: cannot bind socket", FNAME);
             exit(1);
         }
-    
-        /* (1) Show the IP address of the client.
-         *     inet_ntoa() converts an IP address from binary form to the
-         *     standard "numbers and dots" notation.
-         *
-         * (2) Show the client's port number.
-         *     ntohs() converts a short int from network byte order (which is
-         *     Most Significant Byte first) to host byte order (which on x86,
-         *     for example, is Least Significant Byte first).
-         */
-        hoxLog(LOG_DEBUG, "%s: connected to [%s:%d]", FNAME, 
-            inet_ntoa(clientAddress.sin_addr),
-            ntohs(clientAddress.sin_port));
-
-        /* Create a separate thread to handle this client. */
-
-        pSocketInfo = new SocketInfo;
-        pSocketInfo->nSocket = cliSock;
-        pSocketInfo->iaFrom = clientAddress.sin_addr;
+    }
 
-        if ( 0 != pthread_create( &serviceThread,
-                                  NULL,   /* Use Default Attributes */
-                                  handle_client_thread, 
-                                  (void*) pSocketInfo ) )
+    /* Read the local servers' logs from the shared-memory ring (optional). */
+    if ( s_logRingName != NULL )
+    {
+        pthread_t logThread;
+        if (   hoxRC_OK != hoxLogRing::create( s_logRingName, DBAGENT_LOG_RING_SIZE )
+            || 0 != pthread_create( &logThread, NULL, handle_log_ring_thread, NULL ) )
         {
-            hoxLog(LOG_SYS_ERROR, "%s: Failed to create service Thread", FNAME);
-            delete pSocketInfo;
-            continue;  // NOTE: *** Still continue...
+            hoxLog(LOG_ERROR, "%s: cannot serve the log ring [%s]", FNAME, s_logRingName);
+            exit(1);
         }
+        pthread_detach( logThread );
+    }
+
+    /* Wait for connections from clients. */
+    listen(listenSock, SOMAXCONN);
+
+    /* Rank the Players, before any score is saved. */
+    if ( hoxRC_OK != hoxLeaderboard::load() )
+    {
+        hoxLog(LOG_ERROR, "%s: cannot load the leaderboard", FNAME);
+        exit(1);
+    }
+    hoxDBAPI::close_connection();  // Only the workers use the database.
+
+    /* Start the workers. */
+    const long nCores = sysconf( _SC_NPROCESSORS_ONLN );
+    const int  nReadWorkers = std::max( (int) nCores, DBAGENT_MIN_READ_WORKERS );
+    if (   s_readPool.start( nReadWorkers ) == 0
+        || s_writePool.start( DBAGENT_WRITE_WORKERS ) == 0 )
+    {
+        hoxLog(LOG_ERROR, "%s: cannot start the workers", FNAME);
+        exit(1);
+    }
+
+    /* Serve the connections from the reactor. */
+    s_epollfd = epoll_create1( EPOLL_CLOEXEC );
+    if ( s_epollfd < 0 )
+    {
+        hoxLog(LOG_SYS_ERROR, "%s: cannot create epoll instance", FNAME);
+        exit(1);
+    }
+
+    fcntl( listenSock, F_SETFL, fcntl( listenSock, F_GETFL ) | O_NONBLOCK );
+
+    struct epoll_event ev;
+    ev.events  = EPOLLIN;
+    ev.data.fd = listenSock;
+    epoll_ctl( s_epollfd, EPOLL_CTL_ADD, listenSock, &ev );
+
+    hoxLog(LOG_INFO, "%s: Waiting for connections on [%s:%d] with [%d + %d] workers...", 
+        FNAME, s_serverIP, s_nListenPort, nReadWorkers, DBAGENT_WRITE_WORKERS);
 
-    } /* for(...) */
+    ::run_reactor( listenSock );
 
     /* Close log files. */
     close( s_errfd );
@@ -0,0 +1,187 @@
+//
+// C++ Implementation: hoxArchiveDump
+//
+// Description: The command-line tool to dump the Game archive.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include "hoxGameArchive.h"
+
+/******************************************************************
+ * Helper API
+ */
+
+static void usage( const char *progname )
+{
+    fprintf( stderr, "Usage: %s [<options>] <archive_directory | segment_file>...\n\n"
+             "Possible options:\n\n"
+             "\t-p <player_id>          Dump only the games of a player (using the indexes).\n"
+             "\t-h                      Print this message.\n\n"
+             "Each game is printed on one line as:\n"
+             "\tsegment:offset;timestamp;type;status;itimes;redtime;blacktime;"
+             "red;redScore;black;blackScore;moves\n"
+             "where the times are in milliseconds.\n",
+             progname );
+    exit( 1 );
+}
+
+static const char* status_to_string( const hoxGameStatus status )
+{
+    switch ( status )
+    {
+        case hoxGAME_STATUS_OPEN:        return "open";
+        case hoxGAME_STATUS_READY:       return "ready";
+        case hoxGAME_STATUS_IN_PROGRESS: return "in_progress";
+        case hoxGAME_STATUS_RED_WIN:     return "red_win";
+        case hoxGAME_STATUS_BLACK_WIN:   return "black_win";
+        case hoxGAME_STATUS_DRAWN:       return "drawn";
+        default:                         return "UNKNOWN";
+    }
+}
+
+static void print_game( const std::string&   sSegment,
+                        const long           nOffset,
+                        const hoxGameRecord& record )
+{
+    printf( "%s:%ld;%ld;%d;%s;%d/%d/%d;%d/%d/%d;%d/%d/%d;%s;%d;%s;%d;",
+            sSegment.c_str(), nOffset,
+            (long) record.timestamp, record.gameType,
+            status_to_string( record.status ),
+            record.initialTime.nGame, record.initialTime.nMove, record.initialTime.nFree,
+            record.redTime.nGame, record.redTime.nMove, record.redTime.nFree,
+            record.blackTime.nGame, record.blackTime.nMove, record.blackTime.nFree,
+            record.redId.c_str(), record.redScore,
+            record.blackId.c_str(), record.blackScore );
+
+    for ( hoxStringList::const_iterator it = record.moves.begin();
+                                        it != record.moves.end(); ++it )
+    {
+        printf( "%s%s", ( it == record.moves.begin() ? "" : "," ), it->c_str() );
+    }
+    printf( "\n" );
+}
+
+static int dump_segment( const std::string& sSegment )
+{
+    hoxGameArchiveReader reader;
+    hoxGameRecord        record;
+    long                 nOffset = 0;
+    hoxResult            result;
+
+    if ( hoxRC_OK != reader.open( sSegment ) )
+    {
+        fprintf( stderr, "ERROR: can't open segment [%s]\n", sSegment.c_str() );
+        return 1;
+    }
+
+    int nErrors = 0;
+    while ( hoxRC_CLOSED != ( result = reader.next( record, &nOffset ) ) )
+    {
+        if ( result == hoxRC_OK )
+        {
+            print_game( sSegment, nOffset, record );
+            continue;
+        }
+        fprintf( stderr, "WARN: segment [%s] is corrupted at offset [%ld]\n",
+                 sSegment.c_str(), nOffset );
+        ++nErrors;
+    }
+    return ( nErrors == 0 ? 0 : 1 );
+}
+
+static bool is_directory( const std::string& sPath )
+{
+    struct stat st;
+    return ( ::stat( sPath.c_str(), &st ) == 0 && S_ISDIR( st.st_mode ) );
+}
+
+/******************************************************************/
+
+/**
+ * Main function.
+ */
+int
+main( int argc, char *argv[] )
+{
+    extern char *optarg;
+    extern int   optind;
+    const char*  szPlayerId = NULL;
+    int          opt;
+    int          nErrors = 0;
+
+    while (( opt = getopt( argc, argv, "p:h" ) ) != EOF )
+    {
+        switch ( opt )
+        {
+            case 'p':
+                szPlayerId = optarg;
+                break;
+            case 'h':
+            case '?':
+                usage( argv[0] );
+        }
+    }
+
+    if ( optind >= argc )
+    {
+        usage( argv[0] );
+    }
+
+    for ( int i = optind; i < argc; ++i )
+    {
+        std::string sPath = argv[i];
+        const bool bDirectory = is_directory( sPath );
+        if ( bDirectory && sPath[sPath.size() - 1] != '/' ) sPath += '/';
+
+        if ( szPlayerId != NULL )
+        {
+            if ( ! bDirectory )
+            {
+                fprintf( stderr, "ERROR: -p requires an archive directory [%s]\n", argv[i] );
+                ++nErrors;
+                continue;
+            }
+
+            hoxGameLocationList locations;
+            hoxGameRecord       record;
+            hoxGameArchive::findGames( sPath, szPlayerId, locations );
+            for ( hoxGameLocationList::const_iterator it = locations.begin();
+                                                      it != locations.end(); ++it )
+            {
+                if ( hoxRC_OK != hoxGameArchive::readGame( *it, record ) )
+                {
+                    fprintf( stderr, "WARN: can't read game at [%s:%ld]\n",
+                             it->segment.c_str(), it->offset );
+                    ++nErrors;
+                    continue;
+                }
+                print_game( it->segment, it->offset, record );
+            }
+        }
+        else if ( bDirectory )
+        {
+            std::vector<std::string> segments;
+            hoxGameArchive::getSegments( sPath, segments );
+            for ( std::vector<std::string>::const_iterator it = segments.begin();
+                                                           it != segments.end(); ++it )
+            {
+                nErrors += dump_segment( *it );
+            }
+        }
+        else
+        {
+            nErrors += dump_segment( sPath );
+        }
+    }
+
+    return ( nErrors == 0 ? 0 : 1 );
+}
+
+/******************* END OF FILE *********************************************/
@@ -0,0 +1,356 @@
+//
+// C++ Implementation: hoxCheckpoint
+//
+// Description: The crash-safe checkpoint of in-progress Tables.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include "hoxCheckpoint.h"
+#include "hoxLog.h"
+
+/******************************************************************
+ * Constants
+ */
+
+#define CHECKPOINT_MAGIC       0x4B435848   /* "HXCK" */
+#define CHECKPOINT_VERSION     3
+#define CHECKPOINT_MAX_TABLES  1024
+        /* The Tables checkpointed at the same time (whatever their Ids). */
+#define CHECKPOINT_COPY_SIZE   4096
+#define CHECKPOINT_SLOT_SIZE   ( 2 * CHECKPOINT_COPY_SIZE )
+#define CHECKPOINT_HEADER_SIZE 4096
+#define CHECKPOINT_FILE_SIZE   \
+    ( CHECKPOINT_HEADER_SIZE + CHECKPOINT_MAX_TABLES * CHECKPOINT_SLOT_SIZE )
+
+/******************************************************************
+ * The on-disk layout
+ */
+
+namespace
+{
+    /* The header of the state file. */
+    struct FileHeader
+    {
+        unsigned int  magic;
+        unsigned int  version;
+        unsigned int  maxTables;
+        unsigned int  slotSize;
+    };
+
+    const size_t TABLE_ID_SIZE = 32;
+
+    /* One of the two copies in a slot, followed by the Game record. */
+    struct SlotCopy
+    {
+        unsigned int  magic;
+        unsigned int  seq;          // Higher is newer.
+        unsigned int  length;       // Bytes following this header.
+        unsigned int  checksum;     // Of the bytes following this header.
+
+        int           gameGroup;
+        int           isPrevMoveCheck;
+        int           effectiveMoves;
+        int           redGames[3];
+        int           blackGames[3];
+        char          drawPlayerId[256];
+        char          tableId[TABLE_ID_SIZE];
+    };
+
+    const size_t HEADER_SIZE = 4 * sizeof(unsigned int);
+
+    bool _isValidCopy( const SlotCopy* pCopy )
+    {
+        if ( pCopy->magic != CHECKPOINT_MAGIC ) return false;
+        if ( pCopy->length < sizeof(SlotCopy) - HEADER_SIZE ) return false;
+        if ( pCopy->length > CHECKPOINT_COPY_SIZE - HEADER_SIZE ) return false;
+        const char* pData = (const char*) pCopy + HEADER_SIZE;
+        return ( hoxGameArchive::checksum( pData, pCopy->length ) == pCopy->checksum );
+    }
+
+    /**
+     * Return the newest valid copy of a slot (NULL if none).
+     */
+    const SlotCopy* _getLatestCopy( const char* pSlot )
+    {
+        const SlotCopy* pFirst  = (const SlotCopy*) pSlot;
+        const SlotCopy* pSecond = (const SlotCopy*) ( pSlot + CHECKPOINT_COPY_SIZE );
+        const bool bFirst  = _isValidCopy( pFirst );
+        const bool bSecond = _isValidCopy( pSecond );
+
+        if ( bFirst && bSecond ) return ( pFirst->seq > pSecond->seq ? pFirst : pSecond );
+        if ( bFirst )            return pFirst;
+        if ( bSecond )           return pSecond;
+        return NULL;
+    }
+
+} // namespace
+
+// =========================================================================
+//
+//                        hoxCheckpoint
+//
+// =========================================================================
+
+/* Define the static singleton instance. */
+hoxCheckpoint* hoxCheckpoint::s_instance = NULL;
+
+/*static*/
+hoxCheckpoint*
+hoxCheckpoint::getInstance()
+{
+    if ( hoxCheckpoint::s_instance == NULL )
+    {
+        hoxCheckpoint::s_instance = new hoxCheckpoint();
+    }
+    return hoxCheckpoint::s_instance;
+}
+
+hoxResult
+hoxCheckpoint::open( const std::string& sPath )
+{
+    const char* FNAME = "hoxCheckpoint::open";
+
+    close();
+
+    const int fd = ::open( sPath.c_str(), O_CREAT | O_RDWR, 0644 );
+    if ( fd < 0 )
+    {
+        hoxLog(LOG_SYS_WARN, "%s: Failed to open [%s].", FNAME, sPath.c_str());
+        return hoxRC_ERR;
+    }
+
+    /* Start afresh if the file was not created by this version. */
+    FileHeader header;
+    memset( &header, 0, sizeof(header) );
+    struct stat st;
+    const bool bValid = (    ::fstat( fd, &st ) == 0
+                          && st.st_size == CHECKPOINT_FILE_SIZE
+                          && ::pread( fd, &header, sizeof(header), 0 ) == sizeof(header)
+                          && header.magic     == CHECKPOINT_MAGIC
+                          && header.version   == CHECKPOINT_VERSION
+                          && header.maxTables == CHECKPOINT_MAX_TABLES
+                          && header.slotSize  == CHECKPOINT_SLOT_SIZE );
+    if ( ! bValid )
+    {
+        hoxLog(LOG_INFO, "%s: Initialize the state file [%s].", FNAME, sPath.c_str());
+        header.magic     = CHECKPOINT_MAGIC;
+        header.version   = CHECKPOINT_VERSION;
+        header.maxTables = CHECKPOINT_MAX_TABLES;
+        header.slotSize  = CHECKPOINT_SLOT_SIZE;
+        if (   ::ftruncate( fd, 0 ) != 0
+            || ::ftruncate( fd, CHECKPOINT_FILE_SIZE ) != 0  /* Sparse */
+            || ::pwrite( fd, &header, sizeof(header), 0 ) != sizeof(header) )
+        {
+            hoxLog(LOG_SYS_WARN, "%s: Failed to initialize [%s].", FNAME, sPath.c_str());
+            ::close( fd );
+            return hoxRC_ERR;
+        }
+    }
+
+    void* pBase = ::mmap( NULL, CHECKPOINT_FILE_SIZE, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd, 0 );
+    ::close( fd );  // The mapping remains valid.
+    if ( pBase == MAP_FAILED )
+    {
+        hoxLog(LOG_SYS_WARN, "%s: Failed to map [%s].", FNAME, sPath.c_str());
+        return hoxRC_ERR;
+    }
+
+    _pBase = (char*) pBase;
+    _nSize = CHECKPOINT_FILE_SIZE;
+
+    /* Find the slots taken. The last ones are given out first. */
+    for ( int i = CHECKPOINT_MAX_TABLES - 1; i >= 0; --i )
+    {
+        const SlotCopy* pCopy = _getLatestCopy( _getSlot( i ) );
+        if ( pCopy == NULL )
+        {
+            _freeSlots.push_back( i );
+            continue;
+        }
+
+        const std::string tableId( pCopy->tableId,
+                                   strnlen( pCopy->tableId, sizeof(pCopy->tableId) ) );
+        if ( ! _slots.insert( std::make_pair( tableId, i ) ).second )
+        {
+            hoxLog(LOG_WARN, "%s: Drop a second state of Table [%s].", FNAME, tableId.c_str());
+            ((SlotCopy*) _getSlot( i ))->magic = 0;
+            ((SlotCopy*) ( _getSlot( i ) + CHECKPOINT_COPY_SIZE ))->magic = 0;
+            _freeSlots.push_back( i );
+        }
+    }
+
+    return hoxRC_OK;
+}
+
+void
+hoxCheckpoint::close()
+{
+    if ( ! isOpen() ) return;
+
+    ::msync( _pBase, _nSize, MS_SYNC );
+    ::munmap( _pBase, _nSize );
+    _pBase = NULL;
+    _nSize = 0;
+    _slots.clear();
+    _freeSlots.clear();
+}
+
+hoxResult
+hoxCheckpoint::save( const hoxTableState& state )
+{
+    const char* FNAME = "hoxCheckpoint::save";
+
+    if ( ! isOpen() ) return hoxRC_NOT_SUPPORTED;
+
+    std::string sRecord;
+    hoxGameArchive::encodeRecord( state.game, sRecord );
+    if ( sizeof(SlotCopy) + sRecord.size() > CHECKPOINT_COPY_SIZE )
+    {
+        hoxLog(LOG_DEBUG, "%s: Table [%s] is too large (%d moves) to checkpoint.",
+            FNAME, state.tableId.c_str(), (int) state.game.moves.size());
+        clear( state.tableId );  // Its previous state would be stale.
+        return hoxRC_NOT_SUPPORTED;
+    }
+
+    if ( state.tableId.size() >= TABLE_ID_SIZE )
+    {
+        hoxLog(LOG_DEBUG, "%s: Table-Id [%s] is too long to checkpoint.",
+            FNAME, state.tableId.c_str());
+        clear( state.tableId );  // Its previous state would be stale.
+        return hoxRC_NOT_SUPPORTED;
+    }
+
+    const int nSlot = _findSlot( state.tableId, true /* take a free one */ );
+    if ( nSlot < 0 )
+    {
+        hoxLog(LOG_DEBUG, "%s: No free slot for Table [%s] (all [%d] are taken).",
+            FNAME, state.tableId.c_str(), CHECKPOINT_MAX_TABLES);
+        clear( state.tableId );  // Its previous state would be stale.
+        return hoxRC_NOT_SUPPORTED;
+    }
+    char* pSlot = _getSlot( nSlot );
+
+    /* Overwrite the older copy so that the newer one survives a crash
+     * in the middle of this function.
+     */
+    const SlotCopy* pLatest = _getLatestCopy( pSlot );
+    SlotCopy* pCopy = (SlotCopy*) pSlot;
+    if ( pLatest == pCopy ) pCopy = (SlotCopy*) ( pSlot + CHECKPOINT_COPY_SIZE );
+
+    pCopy->magic           = 0;  // Invalidate the copy while writing.
+    pCopy->seq             = ( pLatest ? pLatest->seq + 1 : 1 );
+    pCopy->gameGroup       = state.gameGroup;
+    pCopy->isPrevMoveCheck = state.isPrevMoveCheck;
+    pCopy->effectiveMoves  = state.effectiveMoves;
+    for ( int i = 0; i < 3; ++i )
+    {
+        pCopy->redGames[i]   = state.redGames[i];
+        pCopy->blackGames[i] = state.blackGames[i];
+    }
+    memset( pCopy->drawPlayerId, 0, sizeof(pCopy->drawPlayerId) );
+    strncpy( pCopy->drawPlayerId, state.drawPlayerId.c_str(),
+             sizeof(pCopy->drawPlayerId) - 1 );
+    memset( pCopy->tableId, 0, sizeof(pCopy->tableId) );
+    strncpy( pCopy->tableId, state.tableId.c_str(), sizeof(pCopy->tableId) - 1 );
+    memcpy( (char*) pCopy + sizeof(SlotCopy), sRecord.data(), sRecord.size() );
+
+    pCopy->length   = sizeof(SlotCopy) - HEADER_SIZE + sRecord.size();
+    pCopy->checksum = hoxGameArchive::checksum( (const char*) pCopy + HEADER_SIZE,
+                                                pCopy->length );
+    pCopy->magic    = CHECKPOINT_MAGIC;
+
+    /* Schedule the write-back. The data is already in the page cache,
+     * which survives a crash of this process.
+     */
+    ::msync( pCopy, CHECKPOINT_COPY_SIZE, MS_ASYNC );
+    return hoxRC_OK;
+}
+
+void
+hoxCheckpoint::clear( const std::string& tableId )
+{
+    const int nSlot = _findSlot( tableId, false );
+    if ( nSlot < 0 ) return;
+
+    char* pSlot = _getSlot( nSlot );
+    ((SlotCopy*) pSlot)->magic = 0;
+    ((SlotCopy*) ( pSlot + CHECKPOINT_COPY_SIZE ))->magic = 0;
+    ::msync( pSlot, CHECKPOINT_SLOT_SIZE, MS_ASYNC );
+
+    _slots.erase( tableId );
+    _freeSlots.push_back( nSlot );
+}
+
+void
+hoxCheckpoint::load( hoxTableStateList& states ) const
+{
+    const char* FNAME = "hoxCheckpoint::load";
+
+    states.clear();
+    if ( ! isOpen() ) return;
+
+    for ( SlotMap::const_iterator it = _slots.begin(); it != _slots.end(); ++it )
+    {
+        const SlotCopy* pCopy = _getLatestCopy( _getSlot( it->second ) );
+        if ( pCopy == NULL ) continue;
+
+        hoxTableState state;
+        size_t        nLength = 0;
+        const char*   pRecord = (const char*) pCopy + sizeof(SlotCopy);
+        const size_t  nSize   = pCopy->length - ( sizeof(SlotCopy) - HEADER_SIZE );
+        if ( hoxRC_OK != hoxGameArchive::decodeRecord( pRecord, nSize,
+                                                       state.game, nLength ) )
+        {
+            hoxLog(LOG_WARN, "%s: Skip the invalid state of Table [%s].", FNAME, it->first.c_str());
+            continue;
+        }
+
+        state.tableId         = it->first;
+        state.gameGroup       = (hoxGameGroup) pCopy->gameGroup;
+        state.isPrevMoveCheck = ( pCopy->isPrevMoveCheck != 0 );
+        state.effectiveMoves  = pCopy->effectiveMoves;
+        for ( int j = 0; j < 3; ++j )
+        {
+            state.redGames[j]   = pCopy->redGames[j];
+            state.blackGames[j] = pCopy->blackGames[j];
+        }
+        state.drawPlayerId.assign( pCopy->drawPlayerId,
+                                   strnlen( pCopy->drawPlayerId, sizeof(pCopy->drawPlayerId) ) );
+        states.push_back( state );
+    }
+}
+
+char*
+hoxCheckpoint::_getSlot( const int nSlot ) const
+{
+    return _pBase + CHECKPOINT_HEADER_SIZE + nSlot * CHECKPOINT_SLOT_SIZE;
+}
+
+int
+hoxCheckpoint::_findSlot( const std::string& tableId,
+                          const bool         bTake )
+{
+    if ( ! isOpen() ) return -1;
+
+    SlotMap::const_iterator found = _slots.find( tableId );
+    if ( found != _slots.end() ) return found->second;
+
+    if ( ! bTake || _freeSlots.empty() ) return -1;
+
+    const int nSlot = _freeSlots.back();
+    _freeSlots.pop_back();
+    _slots[tableId] = nSlot;
+    return nSlot;
+}
+
+/******************* END OF FILE *********************************************/
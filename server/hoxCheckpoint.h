@@ -0,0 +1,114 @@
+//
+// C++ Interface: hoxCheckpoint
+//
+// Description: The crash-safe checkpoint of in-progress Tables.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#ifndef __INCLUDED_HOX_CHECKPOINT_H__
+#define __INCLUDED_HOX_CHECKPOINT_H__
+
+#include <string>
+#include <list>
+#include <map>
+#include <vector>
+#include "hoxTypes.h"
+#include "hoxGameArchive.h"
+
+/**
+ * The saved state of an in-progress Table.
+ */
+class hoxTableState
+{
+public:
+    std::string     tableId;
+    hoxGameGroup    gameGroup;
+    hoxGameRecord   game;         // Players, clocks, Moves,...
+    int             redGames[3];  // RED's Wins / Draws / Losses.
+    int             blackGames[3];
+    std::string     drawPlayerId; // The pending Draw offer, if any.
+    bool            isPrevMoveCheck;
+    int             effectiveMoves;
+
+    hoxTableState() : gameGroup( hoxGAME_GROUP_PUBLIC )
+                    , isPrevMoveCheck( false ), effectiveMoves( 0 )
+    {
+        redGames[0] = redGames[1] = redGames[2] = 0;
+        blackGames[0] = blackGames[1] = blackGames[2] = 0;
+    }
+};
+typedef std::list<hoxTableState> hoxTableStateList;
+
+/**
+ * The checkpoint of in-progress Tables of this process (VP).
+ * This class is implemented as a singleton.
+ *
+ * The state file is memory-mapped and divided into fixed-size slots.
+ * A Table takes any free slot, which records its Id, and gives it back
+ * when cleared. Each slot holds two copies which are written
+ * alternately, so that a crash in the middle of a save always leaves
+ * the previous copy intact.
+ */
+class hoxCheckpoint
+{
+private:
+    static hoxCheckpoint* s_instance;  // The singleton instance.
+
+public:
+    static hoxCheckpoint* getInstance();
+
+public:
+    ~hoxCheckpoint() { close(); }
+
+    /**
+     * Open (and map) the state file, creating it if needed.
+     */
+    hoxResult open( const std::string& sPath );
+    void close();
+    bool isOpen() const { return _pBase != NULL; }
+
+    /**
+     * Save the state of a Table.
+     *
+     * @return hoxRC_NOT_SUPPORTED if the Table is too large, or if all
+     *         slots are taken. Its previously saved state (if any) is
+     *         then cleared, so that a stale Game is not restored.
+     */
+    hoxResult save( const hoxTableState& state );
+
+    /**
+     * Remove the state of a Table (e.g., when its Game has ended).
+     */
+    void clear( const std::string& tableId );
+
+    /**
+     * Load the states of all Tables saved in the file.
+     */
+    void load( hoxTableStateList& states ) const;
+
+private:
+    hoxCheckpoint() : _pBase( NULL ), _nSize( 0 ) {}
+
+    char* _getSlot( const int nSlot ) const;
+
+    /**
+     * Find the slot of a Table, or take a free one if asked to.
+     *
+     * @return The slot's index, or -1 if none.
+     */
+    int _findSlot( const std::string& tableId,
+                   const bool         bTake );
+
+    typedef std::map<std::string, int> SlotMap;
+
+private:
+    char*             _pBase;      // The mapped file.
+    size_t            _nSize;      // The size of the mapped file.
+    SlotMap           _slots;      // The slots taken, by Table-Ids.
+    std::vector<int>  _freeSlots;
+};
+
+#endif /* __INCLUDED_HOX_CHECKPOINT_H__ */
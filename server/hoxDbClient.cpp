@@ -16,21 +16,46 @@
 #include "hoxPlayer.h"
 #include "hoxUtil.h"
 #include "hoxSocketAPI.h"
+#include "hoxLogRing.h"
+#include "hoxOutbox.h"
+#include "hoxGameArchive.h"
+#include "hoxEventLog.h"
 
 #include <st.h>
 #include <string>
+#include <sstream>
 #include <cstring>
+#include <climits>
+#include <map>
+#include <list>
+#include <vector>
+#include <algorithm>
 #include <errno.h>
+#include <unistd.h>
 #include <netdb.h>
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <boost/tokenizer.hpp>
 
 /* Constants. */
 #define WWW_HOST      "www.playxiangqi.com"
 #define WWW_PORT      80
 
+#define hoxDB_READ_CHUNK_SIZE  4096   /* Bytes read at once from DB Agent */
+#define hoxDB_MAX_RESPONSE_SIZE  ( 128 * 1024 )
+        /* The largest response: a page of (up to 500) Games fits in it. */
+#define hoxDB_HEALTH_CHECK_INTERVAL  10   /* Seconds between health checks */
+#define hoxDB_CALL_TIMEOUT       5        /* Default seconds for a call to be answered */
+#define hoxDB_CONNECT_TIMEOUT    3        /* Seconds for a connection to be made */
+#define hoxDB_BREAKER_THRESHOLD  3        /* Failures in a row before failing fast */
+#define hoxDB_BACKOFF_MIN        1        /* Seconds before the first retry ... */
+#define hoxDB_BACKOFF_MAX        30       /* ... doubled each time up to this */
+#define hoxDB_PLAYER_CACHE_SIZE  10000    /* Players' info kept in memory */
+#define hoxDB_PLAYER_CACHE_TTL   600      /* Seconds a cached info is trusted */
+#define hoxDB_WRITE_BATCH_MAX    256      /* Records saved in one transaction */
+
 /* -----------------------------------------------------------------------
  *
  *     Helper Data Types
@@ -61,293 +86,1164 @@ namespace
     bool         s_bInitialized = false;
                     /* Has the module been initialized? */
 
-    st_netfd_t   s_nfd          = NULL;  
-                    /* Client socket descriptor. */
+    std::string  s_sHost;
+    int          s_nPort        = 0;
+                    /* The DB-Agent's address (to reconnect to). */
+
+    st_utime_t   s_callTimeout  = hoxDB_CALL_TIMEOUT * 1000000LL;
+                    /* The time for a call to be answered (in microseconds). */
+
+    st_thread_t  s_healthThread = NULL;
+                   /* The thread checking (and reconnecting) the connections. */
+
+    bool         s_bShutdownHealthThread = false;
+                  /* Is 'shutdown' in effect for DB-Health thread? */
 
     st_thread_t  s_writeThread  = NULL;
                    /* The "write" helper thread. */
 
     bool         s_bShutdownWriteThread = false;
                   /* Is 'shutdown' in effect for DB-Write thread? */
-    
-    st_mutex_t   s_mutex = NULL;
-                  /* Provide exclusve access to DB/Disk resources */
 
-    hoxRequestSList s_requestList;
+    hoxOutbox       s_outbox;            // The writes not yet saved.
     st_cond_t       s_writeCond = NULL;  // Write condition-variable.
 
     /* --------------- HELPER Data structure --------------------- */
 
+    /**
+     * A call waiting for its response.
+     *
+     * Each request carries an Id ("rid") which the DB-Agent returns with
+     * the response, so that many calls can be in flight at once and be
+     * answered in any order.
+     */
+    class PendingCall
+    {
+    public:
+        PendingCall() : cond( st_cond_new() ), bDone( false )
+                      , result( hoxRC_ERR ), type( hoxREQUEST_UNKNOWN ) {}
+        ~PendingCall() { st_cond_destroy( cond ); }
+
+        st_cond_t       cond;         // Signaled when the response arrives.
+        bool            bDone;
+        hoxResult       result;
+        hoxRequestType  type;         // The response's type.
+        hoxParameters   parameters;   // The response's parameters.
+        std::string     sAttachment;  // The data following the response.
+    };
+    typedef std::map<int, PendingCall*> PendingCallMap;
+
+    /**
+     * A connection (of the pool) to the DB-Agent.
+     *
+     * The DB-Agent reads all its connections from a single (epoll)
+     * reactor, and hands the requests to its pools of workers (reading
+     * and writing the database), which answer them out of order by Id.
+     * The calls on one connection are thus served in parallel already.
+     * Spreading them over the pool rather keeps a call from queueing
+     * behind a large request or response on the same socket, and lets
+     * the others carry on while a connection is down.
+     */
+    class DbConnection
+    {
+    public:
+        DbConnection( int index ) : nIndex( index ), nfd( NULL )
+                                  , readThread( NULL ), bUp( false )
+                                  , mutex( st_mutex_new() )
+                                  , nRetryDelay( hoxDB_BACKOFF_MIN ), nextRetry( 0 )
+                                  , nextCheck( 0 ) {}
+        ~DbConnection() { st_mutex_destroy( mutex ); }
+
+        const int       nIndex;        // The position in the pool.
+        st_netfd_t      nfd;           // Client socket descriptor.
+        st_thread_t     readThread;    // Routes responses to the callers.
+        bool            bUp;           // Can the connection take calls?
+        st_mutex_t      mutex;         // Exclusive access to the write side.
+        PendingCallMap  pendingCalls;  // The calls in flight.
+        std::string     readBuffer;    // Data read but not yet consumed.
+
+        int             nRetryDelay;   // Seconds to wait after a failed reconnect.
+        time_t          nextRetry;     // When to try to reconnect (if down).
+        time_t          nextCheck;     // When to check its health (if up).
+    };
+    typedef std::vector<DbConnection*> DbConnectionList;
+
+    /**
+     * A circuit breaker in front of the DB-Agent.
+     *
+     * After a number of calls failing in a row, the calls fail fast
+     * (without waiting) for a while. Then one call is let through to
+     * probe the DB-Agent: if it fails too, the wait doubles.
+     */
+    class CircuitBreaker
+    {
+    public:
+        CircuitBreaker() : _nFailures( 0 ), _nDelay( hoxDB_BACKOFF_MIN )
+                         , _retryTime( 0 ) {}
+
+        /**
+         * Can a call be made now?
+         */
+        bool allow()
+        {
+            if ( _nFailures < hoxDB_BREAKER_THRESHOLD ) return true;
+
+            const time_t now = st_time();
+            if ( now < _retryTime ) return false;
+
+            _retryTime = now + _nDelay;  // Only this probe until then.
+            return true;
+        }
+
+        void success()
+        {
+            if ( _nFailures >= hoxDB_BREAKER_THRESHOLD )
+            {
+                hoxLog(LOG_INFO, "%s: DB-Agent answers again. Calls resumed.", __FUNCTION__);
+            }
+            _nFailures = 0;
+            _nDelay    = hoxDB_BACKOFF_MIN;
+        }
+
+        void failure()
+        {
+            if ( ++_nFailures < hoxDB_BREAKER_THRESHOLD ) return;
+
+            hoxLog(LOG_WARN, "%s: DB-Agent failed [%d] calls in a row. "
+                "Failing fast for [%d] seconds.", __FUNCTION__, _nFailures, _nDelay);
+            _retryTime = st_time() + _nDelay;
+            _nDelay    = std::min( _nDelay * 2, hoxDB_BACKOFF_MAX );
+        }
+
+    private:
+        int     _nFailures;  // Calls failed in a row.
+        int     _nDelay;     // Seconds to fail fast before the next probe.
+        time_t  _retryTime;  // When to let the next probe through.
+    };
+
+    /**
+     * An LRU cache of Players' info, so that the Players logging in again
+     * and again are not fetched from the Database each time.
+     *
+     * The changes made by this process are written through to the cache.
+     * Those made by other processes are announced by the DB-Agent
+     * (DB_PLAYER_INVALIDATE), and an entry also expires after a while
+     * in case an announcement is missed.
+     */
+    class PlayerCache
+    {
+    public:
+        PlayerCache() : _nCapacity( hoxDB_PLAYER_CACHE_SIZE ) {}
+
+        bool get( const std::string& sPlayerId,
+                  Player_t&          playerInfo )
+        {
+            EntryMap::iterator found = _index.find( sPlayerId );
+            if ( found == _index.end() )
+            {
+                return false;
+            }
+
+            EntryList::iterator entry = found->second;
+            if ( entry->expiry < st_time() )
+            {
+                _erase( found );
+                return false;
+            }
+
+            _entries.splice( _entries.begin(), _entries, entry );  // Most recent.
+            playerInfo = entry->info;
+            return true;
+        }
+
+        void put( const Player_t& playerInfo )
+        {
+            EntryMap::iterator found = _index.find( playerInfo.id );
+            if ( found != _index.end() )
+            {
+                _erase( found );
+            }
+
+            Entry entry;
+            entry.info   = playerInfo;
+            entry.expiry = st_time() + hoxDB_PLAYER_CACHE_TTL;
+            _entries.push_front( entry );
+            _index[playerInfo.id] = _entries.begin();
+
+            if ( _index.size() > _nCapacity )  // Evict the least recent.
+            {
+                _erase( _index.find( _entries.back().info.id ) );
+            }
+        }
+
+        /**
+         * Write a change through to a Player already cached.
+         */
+        void update( const Player_t& playerInfo )
+        {
+            if ( _index.find( playerInfo.id ) != _index.end() )
+            {
+                put( playerInfo );
+            }
+        }
+
+        void invalidate( const std::string& sPlayerId )
+        {
+            EntryMap::iterator found = _index.find( sPlayerId );
+            if ( found != _index.end() )
+            {
+                _erase( found );
+            }
+        }
+
+        void clear() { _entries.clear(); _index.clear(); }
+
+    private:
+        class Entry
+        {
+        public:
+            Player_t  info;
+            time_t    expiry;  // When to fetch it again.
+        };
+        typedef std::list<Entry>  EntryList;  // The most recent first.
+        typedef std::map<std::string, EntryList::iterator> EntryMap;
+
+        void _erase( EntryMap::iterator found )
+        {
+            _entries.erase( found->second );
+            _index.erase( found );
+        }
+
+        const size_t  _nCapacity;
+        EntryList     _entries;
+        EntryMap      _index;
+    };
+
+    PlayerCache       s_playerCache;
+    CircuitBreaker    s_breaker;
+    std::string       s_sClientId;
+                  /* Identifies this process to the DB-Agent, which does not
+                   * announce back the changes made by it.
+                   */
+
+    int               s_nLastRequestId = 0;
+    DbConnectionList  s_connections;
+    size_t            s_nNextConnection = 0;  // Where to start looking from.
+
     class Lock /* To provide exclusive access */
     {
     public:
-        Lock() /*: _mutex( st_mutex_new() ) */
+        Lock( st_mutex_t mutex ) : _mutex( mutex )
             {
-                st_mutex_lock( s_mutex );
+                st_mutex_lock( _mutex );
             }
 
         ~Lock()
             {
-                st_mutex_unlock( s_mutex );
-                //st_mutex_destroy( _mutex );
-                //_mutex = NULL;
+                st_mutex_unlock( _mutex );
+            }
+
+    private:
+        st_mutex_t   _mutex;
+    };
+
+
+    /* --------------- API  -------------------------------------- */
+
+    /**
+     * The prefix of the address of a local (Unix-domain) socket,
+     * e.g. "unix:/tmp/dbagent.sock".
+     */
+    const char*  UNIX_ADDRESS_PREFIX = "unix:";
+
+    /**
+     * Open a outgoing client socket.
+     *
+     * @param szHost The host, or "unix:<path>" for a local socket
+     *               (in which case the port is not used).
+     * @param timeout The time for the connection to be made.
+     *
+     * @return NULL if error.
+     */
+    st_netfd_t
+    _open_client_socket( const char*      szHost,
+                         const int        nPort,
+                         const st_utime_t timeout = hoxDB_CONNECT_TIMEOUT * 1000000LL )
+    {
+        const char* FNAME = __FUNCTION__;
+
+        struct hostent*     he = NULL;
+        int                 sock = -1;
+        st_netfd_t          nfd = NULL;
+        struct sockaddr_in  rmt_addr;    /* Remote address */
+        struct sockaddr_un  unix_addr;   /* ... or local address */
+        struct sockaddr*    addr = NULL;
+        socklen_t           addrLength = 0;
+
+        hoxLog(LOG_DEBUG, "%s: ENTER. Server-addess = [%s:%d].", FNAME, szHost, nPort);
+
+        const size_t nPrefixLength = strlen( UNIX_ADDRESS_PREFIX );
+        const bool   bUnix = ( 0 == strncmp( szHost, UNIX_ADDRESS_PREFIX, nPrefixLength ) );
+
+        if ( bUnix )
+        {
+            const char* szPath = szHost + nPrefixLength;
+            if ( strlen( szPath ) >= sizeof(unix_addr.sun_path) )
+            {
+                hoxLog(LOG_ERROR, "%s: Socket path [%s] is too long", FNAME, szPath);
+                return NULL;
+            }
+
+            memset( &unix_addr, 0, sizeof(unix_addr) );
+            unix_addr.sun_family = AF_UNIX;
+            strcpy( unix_addr.sun_path, szPath );
+            addr       = (struct sockaddr *) &unix_addr;
+            addrLength = sizeof(unix_addr);
+        }
+        else
+        {
+             /* Get the host info. */
+            if ( NULL == ( he = gethostbyname( szHost )) )
+            {
+                hoxLog(LOG_SYS_ERROR, "%s: Failed to get host-info", FNAME);
+                return NULL;
+            }
+
+            /* Initialize the remote server address. */
+            rmt_addr.sin_family = AF_INET;    // host byte order 
+            rmt_addr.sin_port = htons( nPort );  // short, network byte order 
+            rmt_addr.sin_addr = *((struct in_addr *)he->h_addr);
+            memset(rmt_addr.sin_zero, '\0', sizeof rmt_addr.sin_zero);
+            addr       = (struct sockaddr *) &rmt_addr;
+            addrLength = sizeof(rmt_addr);
+        }
+
+        /* Create a socket. */
+        sock = socket( bUnix ? PF_UNIX : PF_INET, SOCK_STREAM, 0 );
+        if (sock < 0) 
+        {
+            hoxLog(LOG_SYS_ERROR, "%s: Failed to create socket", FNAME);
+            return NULL;
+        }
+
+        nfd = st_netfd_open_socket( sock );
+        if ( nfd == NULL )
+        {
+            hoxLog(LOG_SYS_ERROR, "%s: Failed to open socket", FNAME);
+            close(sock);
+            return NULL;
+        }
+
+        if ( st_connect( nfd, 
+                         addr,
+                         addrLength,
+                         timeout ) < 0 ) 
+        {
+            hoxLog(LOG_SYS_ERROR, "%s: Failed to connect to the server", FNAME);
+            st_netfd_close( nfd );
+            return NULL;
+        }
+
+        return nfd;
+    }
+
+    /**
+     * Read more data from a connection into its "read" buffer.
+     */
+    hoxResult
+    _fill_read_buffer( DbConnection* conn )
+    {
+        const char* FNAME = __FUNCTION__;
+        char        buf[hoxDB_READ_CHUNK_SIZE];
+
+        const ssize_t nRead = st_read( conn->nfd, buf, sizeof(buf), ST_UTIME_NO_TIMEOUT );
+        if ( nRead <= 0 )
+        {
+            hoxLog(LOG_SYS_WARN, "%s: Fail to read from the network", FNAME);
+            return hoxRC_ERR;
+        }
+
+        conn->readBuffer.append( buf, nRead );
+        return hoxRC_OK;
+    }
+
+    /**
+     * Read from a connection a "line" terminated by TWO '\n' characters.
+     * The data is read in chunks, with what follows the "line" kept in
+     * the buffer for the next responses (which may be pipelined).
+     */
+    hoxResult
+    _read_line( DbConnection* conn,
+                std::string&  sResult )
+    {
+        const char* FNAME = __FUNCTION__;
+        std::string&           readBuffer = conn->readBuffer;
+        std::string::size_type nSearchFrom = 0;
+
+        for (;;)
+        {
+            const std::string::size_type nEnd = readBuffer.find( "\n\n", nSearchFrom );
+            if ( nEnd != std::string::npos )
+            {
+                sResult.assign( readBuffer, 0, nEnd );
+                readBuffer.erase( 0, nEnd + 2 );
+                return hoxRC_OK;  // Done.
+            }
+
+            // Impose some limit.
+            if ( readBuffer.size() >= hoxDB_MAX_RESPONSE_SIZE )
+            {
+                hoxLog(LOG_ERROR, "%s: Maximum message's size [%d] reached. Likely to be an error.", 
+                    FNAME, hoxDB_MAX_RESPONSE_SIZE);
+                hoxLog(LOG_ERROR, "%s: Partial read message (64 bytes) = [%s ...].", 
+                    FNAME, readBuffer.substr(0, 64).c_str());
+                break;
+            }
+
+            nSearchFrom = readBuffer.empty() ? 0 : readBuffer.size() - 1;
+            if ( hoxRC_OK != _fill_read_buffer( conn ) )
+            {
+                hoxLog(LOG_WARN, "%s: Result message accumulated so far = [%s].", FNAME, readBuffer.c_str());
+                break;
+            }
+        }
+
+        return hoxRC_ERR;
+    }
+
+    /**
+     * Read exactly a given number of bytes (following a "line").
+     */
+    hoxResult
+    _read_nbytes( DbConnection* conn,
+                  const size_t  nBytes,
+                  std::string&  sResult )
+    {
+        while ( conn->readBuffer.size() < nBytes )
+        {
+            if ( hoxRC_OK != _fill_read_buffer( conn ) )
+            {
+                return hoxRC_ERR;
+            }
+        }
+
+        sResult.assign( conn->readBuffer, 0, nBytes );
+        conn->readBuffer.erase( 0, nBytes );
+        return hoxRC_OK;
+    }
+
+    /**
+     * Mark a connection as broken: its "read" thread then fails the calls
+     * still waiting, and the "health" thread reconnects it.
+     */
+    void
+    _break_connection( DbConnection* conn )
+    {
+        if ( conn->bUp )
+        {
+            conn->bUp = false;
+            ::shutdown( st_netfd_fileno( conn->nfd ), SHUT_RDWR );
+        }
+    }
+
+    /**
+     * Write a request (and its additional data, if any) to a connection.
+     *
+     * @param deadline When to give up (in st_utime).
+     */
+    hoxResult
+    _write_request( DbConnection*      conn,
+                    const hoxRequest&  request,
+                    const std::string& sData,
+                    const st_utime_t   deadline )
+    {
+        const char* FNAME = __FUNCTION__;
+
+        /* Serialize the request (ie., make sure it has the "right" 
+         * outgoing format).
+         */
+        std::string sRequest = request.toString() + "\n";
+        if ( !sData.empty() ) sRequest.append( sData );
+
+        const int nToSend = sRequest.size();
+        ssize_t   nSent = 0;
+
+        Lock lock( conn->mutex );  // Obtain exclusive access.
+
+        const st_utime_t now = st_utime();
+        if ( now >= deadline || ! conn->bUp )
+        {
+            return hoxRC_TIMEOUT;  // Nothing sent.
+        }
+
+        //hoxLog(LOG_DEBUG, "%s: Sending request [%s]...", FNAME, sRequest.c_str());
+        nSent = st_write( conn->nfd, 
+                          sRequest.data(), 
+                          nToSend, 
+                          deadline - now );
+        if ( nSent < nToSend )
+        {
+            /* Part of the request may have been sent. */
+            hoxLog(LOG_SYS_WARN, "%s: Failed to write to socket", FNAME);
+            _break_connection( conn );
+            return ( errno == ETIME ? hoxRC_TIMEOUT : hoxRC_ERR );
+        }
+
+        return hoxRC_OK;
+    }
+
+    /**
+     * Send a request over a given connection and wait for its response.
+     *
+     * @param parameters [OUT] The response's parameters ("code", "content").
+     * @param pAttachment [OUT] The data following the response, if needed.
+     * @param sData The additional data following the request, if any.
+     *
+     * @return hoxRC_TIMEOUT if the response has not arrived in time.
+     *         A late response is then dropped.
+     */
+    hoxResult
+    _call_on( DbConnection*      conn,
+              hoxRequest&        request,
+              hoxParameters&     parameters,
+              std::string*       pAttachment = NULL,
+              const std::string& sData = "" )
+    {
+        const char* FNAME = __FUNCTION__;
+
+        if ( ! conn->bUp )
+        {
+            hoxLog(LOG_WARN, "%s: The DB-Agent connection [%d] is closed.", FNAME, conn->nIndex);
+            return hoxRC_ERR;
+        }
+
+        s_nLastRequestId = ( s_nLastRequestId == INT_MAX ? 1 : s_nLastRequestId + 1 );
+        const int nId = s_nLastRequestId;
+        request.setParam("rid", hoxUtil::intToString( nId ));
+
+        const st_utime_t deadline = st_utime() + s_callTimeout;
+
+        PendingCall call;
+        conn->pendingCalls[nId] = &call;
+
+        const hoxResult writeResult = _write_request( conn, request, sData, deadline );
+        if ( hoxRC_OK != writeResult )
+        {
+            conn->pendingCalls.erase( nId );
+            return writeResult;
+        }
+
+        while ( ! call.bDone )
+        {
+            const st_utime_t now = st_utime();
+            if (   now >= deadline
+                || ( st_cond_timedwait( call.cond, deadline - now ) < 0 && errno == EINTR ) )
+            {
+                if ( call.bDone ) break;  // ... just in time.
+
+                hoxLog(LOG_WARN, "%s: Request [%s] timed out on connection [%d].", FNAME,
+                    hoxUtil::requestTypeToString( request.getType() ).c_str(), conn->nIndex);
+                conn->pendingCalls.erase( nId );
+                return hoxRC_TIMEOUT;
+            }
+        }
+
+        if ( call.result != hoxRC_OK )
+        {
+            return call.result;
+        }
+
+        if ( call.type != request.getType() )
+        {
+            hoxLog(LOG_ERROR, "%s: Wrong returned Message-Type [%s].", FNAME,
+                hoxUtil::requestTypeToString(call.type).c_str());
+            return hoxRC_ERR;
+        }
+
+        parameters = call.parameters;
+        if ( pAttachment != NULL ) *pAttachment = call.sAttachment;
+
+        return hoxRC_OK;
+    }
+
+    /**
+     * Handle read Thread: route each response to its waiting call.
+     */
+    void*
+    _handle_db_read( void* arg )
+    {
+        const char* FNAME = __FUNCTION__;
+        DbConnection* conn = (DbConnection*) arg;
+        std::string   sResponse;
+
+        for (;;)
+        {
+            if ( hoxRC_OK != _read_line( conn, sResponse ) )
+            {
+                hoxLog(LOG_SYS_WARN, "%s: Failed to read from socket", FNAME);
+                break;
+            }
+
+            hoxRequestType  type = hoxREQUEST_UNKNOWN;
+            hoxParameters   parameters;
+
+            hoxUtil::parse_network_message( sResponse,
+                                            type,
+                                            parameters );
+
+            /* A file's content follows the response of HTTP_GET. */
+            std::string sAttachment;
+            if ( type == hoxREQUEST_HTTP_GET && parameters["code"] == "0" )
+            {
+                const size_t nSize = ::atoi( parameters["content"].c_str() );
+                if ( hoxRC_OK != _read_nbytes( conn, nSize, sAttachment ) )
+                {
+                    hoxLog(LOG_SYS_WARN, "%s: Failed to read [%d] bytes", FNAME, (int) nSize);
+                    break;
+                }
+            }
+
+            /* A Player's info changed by another process. */
+            if ( type == hoxREQUEST_DB_PLAYER_INVALIDATE )
+            {
+                s_playerCache.invalidate( parameters["content"] );
+                continue;
+            }
+
+            const int nId = ::atoi( parameters["rid"].c_str() );
+            PendingCallMap::iterator found = conn->pendingCalls.find( nId );
+            if ( found == conn->pendingCalls.end() )
+            {
+                hoxLog(LOG_INFO, "%s: No call waits for response [%s] (timed out?).", FNAME,
+                    sResponse.c_str());
+                continue;  // *** Still allow to continue
+            }
+
+            PendingCall* call = found->second;
+            conn->pendingCalls.erase( found );
+
+            call->result      = hoxRC_OK;
+            call->type        = type;
+            call->parameters  = parameters;
+            call->sAttachment = sAttachment;
+            call->bDone       = true;
+            st_cond_signal( call->cond );
+        }
+
+        /* Fail all the calls still waiting. */
+
+        conn->bUp = false;
+        for ( PendingCallMap::iterator it = conn->pendingCalls.begin();
+                                       it != conn->pendingCalls.end(); ++it )
+        {
+            it->second->bDone = true;  // ... with the result hoxRC_ERR.
+            st_cond_signal( it->second->cond );
+        }
+        conn->pendingCalls.clear();
+
+        hoxLog(LOG_INFO, "%s: Closing DB READ connection [%d].", FNAME, conn->nIndex);
+        return NULL;
+    }
+
+    /**
+     * Close a connection (once its "read" thread has failed the calls
+     * still waiting).
+     */
+    void
+    _disconnect( DbConnection* conn )
+    {
+        if ( conn->nfd == NULL )
+        {
+            return;
+        }
+
+        conn->bUp = false;
+        ::shutdown( st_netfd_fileno( conn->nfd ), SHUT_RDWR );
+        if ( conn->readThread != NULL )
+        {
+            st_thread_join( conn->readThread, NULL );
+            conn->readThread = NULL;
+        }
+        st_netfd_close( conn->nfd );
+        conn->nfd = NULL;
+        conn->readBuffer.clear();
+    }
+
+    /**
+     * (Re)open a connection and make sure, with a HELLO request,
+     * that the DB Agent answers on it.
+     */
+    hoxResult
+    _connect( DbConnection* conn )
+    {
+        const char* FNAME = __FUNCTION__;
+
+        _disconnect( conn );
+
+        conn->nfd = _open_client_socket( s_sHost.c_str(), s_nPort );
+        if ( conn->nfd == NULL )
+        {
+            hoxLog(LOG_ERROR, "%s: Failed to open connection [%d].", FNAME, conn->nIndex);
+            return hoxRC_ERR;
+        }
+
+        conn->readThread = st_thread_create( _handle_db_read,
+                                             ( void * ) conn,
+                                             1 /* joinable */,
+                                             0 /* stack-size */ );
+        if ( conn->readThread == NULL )
+        {
+            hoxLog(LOG_ERROR, "%s: Failed to create read DB thread.", FNAME);
+            st_netfd_close( conn->nfd );
+            conn->nfd = NULL;
+            return hoxRC_ERR;
+        }
+        conn->bUp = true;
+
+        /* Subscribe to the changes of Players' info made by others. */
+        hoxRequest    request( hoxREQUEST_HELLO );
+        request.setParam("cid", s_sClientId);
+        hoxParameters parameters;
+
+        if ( hoxRC_OK != _call_on( conn, request, parameters ) )
+        {
+            hoxLog(LOG_ERROR, "%s: Failed to send HELLO request.", FNAME);
+            _disconnect( conn );
+            return hoxRC_ERR;
+        }
+
+        return hoxRC_OK;
+    }
+
+    /**
+     * Pick the connection to make a call on: the healthy one with
+     * the fewest calls in flight.
+     *
+     * @return NULL if all the connections are down.
+     */
+    DbConnection*
+    _get_least_busy_connection()
+    {
+        DbConnection* best = NULL;
+        const size_t  nSize = s_connections.size();
+
+        /* Rotate the starting point so that ties are spread evenly. */
+        for ( size_t i = 0; i < nSize; ++i )
+        {
+            DbConnection* conn = s_connections[(s_nNextConnection + i) % nSize];
+            if (   conn->bUp
+                && (   best == NULL
+                    || conn->pendingCalls.size() < best->pendingCalls.size() ) )
+            {
+                best = conn;
+                if ( best->pendingCalls.empty() ) break;  // Cannot do better.
+            }
+        }
+
+        if ( best != NULL )
+        {
+            s_nNextConnection = ( best->nIndex + 1 ) % nSize;
+        }
+        return best;
+    }
+
+    /**
+     * Send a request to the DB-Agent and wait for its response.
+     *
+     * @return hoxRC_CLOSED if the request could not be sent: either all the
+     *         connections are down or the DB-Agent has failed too many calls
+     *         lately (see CircuitBreaker).
+     *
+     * @see _call_on
+     */
+    hoxResult
+    _call( hoxRequest&        request,
+           hoxParameters&     parameters,
+           std::string*       pAttachment = NULL,
+           const std::string& sData = "" )
+    {
+        if ( ! s_breaker.allow() )
+        {
+            return hoxRC_CLOSED;  // Fail fast.
+        }
+
+        DbConnection* conn = _get_least_busy_connection();
+        if ( conn == NULL )
+        {
+            hoxLog(LOG_WARN, "%s: All DB-Agent connections are down.", __FUNCTION__);
+            return hoxRC_CLOSED;
+        }
+
+        hoxEventLog*    pEventLog = hoxEventLog::getInstance();
+        const long long startTime = ( pEventLog->isOpen() ? hoxEventLog::now() : 0 );
+
+        const hoxResult result = _call_on( conn, request, parameters, pAttachment, sData );
+        if ( result == hoxRC_OK ) s_breaker.success();
+        else                      s_breaker.failure();
+
+        if ( pEventLog->isOpen() )
+        {
+            pEventLog->log( hoxEVENT_DB_CALL, request.getParam("pid"), "", "",
+                            hoxUtil::requestTypeToString( request.getType() ),
+                            hoxEventLog::now() - startTime, result );
+        }
+
+        return result;
+    }
+
+    /**
+     * The result to return to the callers when a call has failed.
+     *
+     * @return hoxRC_TIMEOUT if the DB-Agent has not answered in time
+     *         (or is known to be down), hoxRC_ERR otherwise.
+     */
+    hoxResult
+    _call_failed( const hoxResult result )
+    {
+        return (   result == hoxRC_TIMEOUT
+                || result == hoxRC_CLOSED ) ? hoxRC_TIMEOUT : hoxRC_ERR;
+    }
+
+    /**
+     * Handle health Thread: every now and then, send a HELLO request
+     * on each idle connection, and reconnect those that are down
+     * with an increasing delay (while the DB-Agent is still down).
+     */
+    void*
+    _handle_db_health( void * /*arg*/ )
+    {
+        const char* FNAME = __FUNCTION__;
+
+        while ( ! s_bShutdownHealthThread )
+        {
+            st_sleep( hoxDB_BACKOFF_MIN );
+
+            for ( size_t i = 0;
+                  i < s_connections.size() && ! s_bShutdownHealthThread; ++i )
+            {
+                DbConnection* conn = s_connections[i];
+                const time_t  now  = st_time();
+
+                if ( conn->bUp )
+                {
+                    if ( now < conn->nextCheck ) continue;
+                    conn->nextCheck = now + hoxDB_HEALTH_CHECK_INTERVAL;
+
+                    if ( ! conn->pendingCalls.empty() ) continue;  // Busy.
+
+                    hoxRequest    request( hoxREQUEST_HELLO );
+                    hoxParameters parameters;
+                    if ( hoxRC_OK == _call_on( conn, request, parameters ) ) continue;
+
+                    hoxLog(LOG_WARN, "%s: Connection [%d] failed its health check.", FNAME, conn->nIndex);
+                    _break_connection( conn );
+                    conn->nextRetry = now;  // Reconnect at once.
+                }
+
+                if ( now < conn->nextRetry ) continue;
+
+                if ( hoxRC_OK == _connect( conn ) )
+                {
+                    hoxLog(LOG_INFO, "%s: Connection [%d] reconnected.", FNAME, conn->nIndex);
+                    conn->nRetryDelay = hoxDB_BACKOFF_MIN;
+                    conn->nextCheck   = st_time() + hoxDB_HEALTH_CHECK_INTERVAL;
+                    s_playerCache.clear();  // Announcements may have been missed.
+                    s_breaker.success();
+                }
+                else
+                {
+                    hoxLog(LOG_INFO, "%s: Retry connection [%d] in [%d] seconds.", FNAME,
+                        conn->nIndex, conn->nRetryDelay);
+                    conn->nextRetry   = st_time() + conn->nRetryDelay;
+                    conn->nRetryDelay = std::min( conn->nRetryDelay * 2, hoxDB_BACKOFF_MAX );
+                }
+            }
+        }
+
+        hoxLog(LOG_INFO, "%s: Closing DB HEALTH thread.", FNAME);
+        return NULL;
+    }
+
+    /**
+     * Parse a string for playe-info.
+     *
+     */
+    hoxResult
+    _parse_str_player_info( const std::string& input,
+                            Player_t&          playerInfo )
+    {
+        typedef boost::tokenizer<boost::char_separator<char> > Tokenizer;
+        typedef boost::char_separator<char> Separator;
+
+        Separator sep(";");
+        Tokenizer tok(input, sep);
+        int       i = 0;
+
+        for ( Tokenizer::iterator it = tok.begin(); it != tok.end(); ++it )
+        {
+            switch (i++)
+            {
+                case 0: playerInfo.id = (*it); break;
+                case 1: playerInfo.score = ::atoi( it->c_str() ); break;
+                case 2: playerInfo.wins = ::atoi( it->c_str() ); break;
+                case 3: playerInfo.draws = ::atoi( it->c_str() ); break;
+                case 4: playerInfo.losses = ::atoi( it->c_str() ); break;
+                case 5: playerInfo.hpw = (*it); break;
+                default: /* Ignore the rest. */ break;
             }
+        }
 
-    private:
-        //st_mutex_t   _mutex;
-    };
-
-
-    /* --------------- API  -------------------------------------- */
+        return hoxRC_OK;
+    }
 
     /**
-     * Open a outgoing client socket.
-     *
-     * @return NULL if error.
+     * Get the info. (to be cached) of a Player.
      */
-    st_netfd_t
-    _open_client_socket( const char* szHost,
-                         const int   nPort )
+    Player_t
+    _get_player_info( const hoxPlayer_SPtr& player )
     {
-        const char* FNAME = __FUNCTION__;
-
-        struct hostent*    he = NULL;
-        int                sock = -1;
-        st_netfd_t         nfd = NULL;
-        struct sockaddr_in rmt_addr;    /* Remote address */
-
-        hoxLog(LOG_DEBUG, "%s: ENTER. Server-addess = [%s:%d].", FNAME, szHost, nPort);
+        Player_t  playerInfo;
 
-         /* Get the host info. */
-        if ( NULL == ( he = gethostbyname( szHost )) )
-        {
-            hoxLog(LOG_SYS_ERROR, "%s: Failed to get host-info", FNAME);
-            return NULL;
-        }
+        playerInfo.id     = player->getId();
+        playerInfo.hpw    = player->getHPassword();
+        playerInfo.score  = player->getScore();
+        playerInfo.wins   = player->getWins();
+        playerInfo.draws  = player->getDraws();
+        playerInfo.losses = player->getLosses();
 
-        /* Create a socket. */
-        sock = socket( PF_INET, SOCK_STREAM, 0 );
-        if (sock < 0) 
-        {
-            hoxLog(LOG_SYS_ERROR, "%s: Failed to create socket", FNAME);
-            return NULL;
-        }
+        return playerInfo;
+    }
 
-        nfd = st_netfd_open_socket( sock );
-        if ( nfd == NULL )
+    /**
+     * Split a record's data into a given number of fields.
+     * The last field takes the rest of the data.
+     */
+    void
+    _split_fields( const std::string&        sData,
+                   const size_t              nFields,
+                   std::vector<std::string>& fields )
+    {
+        std::string::size_type nStart = 0;
+        fields.clear();
+        while ( fields.size() + 1 < nFields )
         {
-            hoxLog(LOG_SYS_ERROR, "%s: Failed to open socket", FNAME);
-            close(sock);
-            return NULL;
+            const std::string::size_type nEnd = sData.find( ';', nStart );
+            if ( nEnd == std::string::npos ) break;
+            fields.push_back( sData.substr( nStart, nEnd - nStart ) );
+            nStart = nEnd + 1;
         }
+        fields.push_back( sData.substr( nStart ) );
+        fields.resize( nFields );
+    }
 
-        /* Initialize the remote server address. */
-        rmt_addr.sin_family = AF_INET;    // host byte order 
-        rmt_addr.sin_port = htons( nPort );  // short, network byte order 
-        rmt_addr.sin_addr = *((struct in_addr *)he->h_addr);
-        memset(rmt_addr.sin_zero, '\0', sizeof rmt_addr.sin_zero);
-
-        if ( st_connect( nfd, 
-                        (struct sockaddr *)&rmt_addr,
-                         sizeof(rmt_addr),
-                         ST_UTIME_NO_TIMEOUT ) < 0 ) 
+    /**
+     * Get the lines of a response's content, each ending with a new-line
+     * (the last one's is taken as the end of the response).
+     */
+    void
+    _get_lines( const std::string& sContent,
+                std::string&       sLines )
+    {
+        sLines = sContent;
+        if ( ! sLines.empty() && sLines[sLines.size() - 1] != '\n' )
         {
-            hoxLog(LOG_SYS_ERROR, "%s: Failed to connect to the server", FNAME);
-            st_netfd_close( nfd );
-            return NULL;
+            sLines += '\n';
         }
-
-        return nfd;
     }
 
     /**
-     * Read from a socket a "line" terminated by TWO '\n' characters.
+     * Send a batch of records (results or Games), which the DB-Agent saves
+     * in a single transaction.
      *
-     * @TODO  We should merge this version with the 1-new-line-char one.
+     * @return hoxRC_NOT_VALID if the DB-Agent has answered with an error,
+     *         or the failure of the call if it has not answered.
      */
     hoxResult
-    _read_line( const st_netfd_t  nfd,
-                std::string&      sResult )
+    _send_batch( const hoxRequestType type,
+                 const std::string&   sData,
+                 const int            nRecords )
     {
         const char* FNAME = __FUNCTION__;
-        std::string commandStr;
+        hoxParameters parameters;
 
-	    /* Read a line until "\n\n" */
+        hoxLog(LOG_DEBUG, "%s: Send a batch of [%d] records ([%s]).", FNAME,
+            nRecords, hoxUtil::requestTypeToString( type ).c_str());
 
-	    bool     bSawOne = false;  // Has seen one '\n'?
-        char     c;
-        ssize_t  nRead = 0;
+        hoxRequest request( type );
+        request.setParam("size", hoxUtil::intToString( sData.size() ));
+        request.setParam("src", s_outbox.getSource());
 
-        for (;;)
+        const hoxResult result = _call( request, parameters, NULL, sData );
+        if ( result != hoxRC_OK ) return result;
+
+        if ( parameters["code"] != "0" )
         {
-            nRead = st_read( nfd, &c, sizeof(c), ST_UTIME_NO_TIMEOUT );
-            if ( nRead == 1 )
-            {
-			    if ( !bSawOne && c == '\n' )
-			    {
-				    bSawOne = true;
-			    }
-			    else if ( bSawOne && c == '\n' )
-			    {
-				    sResult = commandStr;
-				    return hoxRC_OK;  // Done.
-			    }
-                else
-                {
-                    bSawOne = false;
-                    commandStr += c;
-
-                    // Impose some limit.
-                    if ( commandStr.size() >= hoxNETWORK_MAX_MSG_SIZE )
-                    {
-                        hoxLog(LOG_ERROR, "%s: Maximum message's size [%d] reached. Likely to be an error.", 
-                            FNAME, hoxNETWORK_MAX_MSG_SIZE);
-                        hoxLog(LOG_ERROR, "%s: Partial read message (64 bytes) = [%s ...].", 
-                            FNAME, commandStr.substr(0, 64).c_str());
-                        break;
-                    }
-                }
-            }
-            else
-            {
-                hoxLog(LOG_SYS_WARN, "%s: Fail to read 1 byte from the network", FNAME);
-                hoxLog(LOG_WARN, "%s: Result message accumulated so far = [%s].", FNAME, commandStr.c_str());
-                break;
-            }
+            hoxLog(LOG_WARN, "%s: Failed to save a batch of [%d] records. Error-code [%s].",
+                FNAME, nRecords, parameters["code"].c_str());
+            return hoxRC_NOT_VALID;
         }
+        return hoxRC_OK;
+    }
 
-        return hoxRC_ERR;
+    /**
+     * Append the line of an outbox record to the data of its batch.
+     * The results: "<seq>;<pid>;<score>;<wins>;<draws>;<losses>".
+     * The Games: "<seq>;<data>".
+     */
+    void
+    _append_record_line( const hoxOutboxRecord& record,
+                         std::string&           sData )
+    {
+        char szSeq[32];
+        snprintf( szSeq, sizeof(szSeq), "%lld;", record.seq );
+        sData.append( szSeq );
+
+        if ( record.type == hoxOutboxRecord::TYPE_GAME )
+        {
+            sData.append( record.data ).append( "\n" );
+            return;
+        }
+
+        std::vector<std::string> fields;
+        _split_fields( record.data, 3, fields );  // pid;score;result
+
+        sData.append( fields[0] ).append( ";" )
+             .append( fields[1] ).append( ";" )
+             .append( fields[2] == "W" ? "1;0;0\n"
+                    : fields[2] == "D" ? "0;1;0\n"
+                    : fields[2] == "L" ? "0;0;1\n" : "0;0;0\n" );
     }
 
     /**
-     * Send a request over a specified socket.
+     * Send the records of a kind as one batch.
+     *
+     * If the DB-Agent refuses the batch, its records are sent again one
+     * by one to find those at fault, which are then dropped (and logged)
+     * so that they do not hold back the others forever. If all of them
+     * are refused, the Database itself is failing: none is dropped, and
+     * they are all sent again later.
      *
+     * @return hoxRC_OK if the records are saved or dropped.
      */
     hoxResult
-    _send_request_over_socket( const st_netfd_t   nfd, 
-                               const hoxRequest   request,
-                               std::string&       sResponse,
-                               const std::string& sData = "")
+    _send_records( const hoxRequestType                       type,
+                   const std::vector<const hoxOutboxRecord*>& records )
     {
         const char* FNAME = __FUNCTION__;
-        //hoxLog(LOG_DEBUG, "%s: ENTER.", FNAME);
 
-        /* Serialize the request (ie., make sure it has the "right" 
-         * outgoing format).
-         */
-        std::string sRequest = request.toString() + "\n";
-        if ( !sData.empty() ) sRequest.append( sData );
-
-        const int nToSend = sRequest.size();
-        ssize_t   nSent = 0;
+        if ( records.empty() ) return hoxRC_OK;
 
-        //hoxLog(LOG_DEBUG, "%s: Sending request [%s]...", FNAME, sRequest.c_str());
-        nSent = st_write( nfd, 
-                          sRequest.data(), 
-                          nToSend, 
-                          ST_UTIME_NO_TIMEOUT );
-        if ( nSent < nToSend )
+        std::string sData;
+        for ( size_t i = 0; i < records.size(); ++i )
         {
-            hoxLog(LOG_SYS_WARN, "%s: Failed to write to socket", FNAME);
-            return hoxRC_ERR;
+            _append_record_line( *records[i], sData );
         }
 
-        //hoxLog(LOG_DEBUG, "%s: Reading response...", FNAME);
-        if ( hoxRC_OK != _read_line( nfd, sResponse ) )
+        hoxResult result = _send_batch( type, sData, (int) records.size() );
+        if ( result != hoxRC_NOT_VALID ) return result;
+        if ( records.size() == 1 ) return hoxRC_ERR;
+
+        std::vector<const hoxOutboxRecord*> refused;
+        for ( size_t i = 0; i < records.size(); ++i )
         {
-            hoxLog(LOG_SYS_WARN, "%s: Failed to read from socket", FNAME);
-            return hoxRC_ERR;
+            sData.clear();
+            _append_record_line( *records[i], sData );
+            result = _send_batch( type, sData, 1 );
+            if      ( result == hoxRC_NOT_VALID ) refused.push_back( records[i] );
+            else if ( result != hoxRC_OK )        return result;  // Not answered.
         }
 
-        //hoxLog(LOG_DEBUG, "%s: Received: [%s].", FNAME, sResponse.c_str());
+        if ( refused.size() == records.size() ) return hoxRC_ERR;
 
+        for ( size_t i = 0; i < refused.size(); ++i )
+        {
+            hoxLog(LOG_ERROR, "%s: Dropped the record [%lld] refused by the DB-Agent: [%c;%s].",
+                FNAME, refused[i]->seq, refused[i]->type, refused[i]->data.c_str());
+        }
         return hoxRC_OK;
     }
 
     /**
-     * Parse a string for playe-info.
+     * Send the oldest records of the outbox: the results and Games,
+     * each kind as one batch.
+     *
+     * The records carry their sequence numbers and the outbox's source, so
+     * that the DB-Agent skips those it has saved already when a batch is
+     * sent again (each kind is marked apart).
      *
+     * @param lastSeq [OUT] The sequence number of the last record sent.
+     *
+     * @return hoxRC_OK if all the records up to lastSeq are saved (or
+     *         dropped, being refused by the DB-Agent).
      */
     hoxResult
-    _parse_str_player_info( const std::string& input,
-                            Player_t&          playerInfo )
+    _send_outbox_records( long long& lastSeq )
     {
-        typedef boost::tokenizer<boost::char_separator<char> > Tokenizer;
-        typedef boost::char_separator<char> Separator;
+        const char* FNAME = __FUNCTION__;
+        const hoxOutboxRecordList& records = s_outbox.getRecords();
+        hoxOutboxRecordList::const_iterator it = records.begin();
 
-        Separator sep(";");
-        Tokenizer tok(input, sep);
-        int       i = 0;
+        std::vector<const hoxOutboxRecord*> results;
+        std::vector<const hoxOutboxRecord*> games;
+        hoxResult                           result = hoxRC_UNKNOWN;
 
-        for ( Tokenizer::iterator it = tok.begin(); it != tok.end(); ++it )
+        for ( ; it != records.end() && results.size() + games.size() < hoxDB_WRITE_BATCH_MAX; ++it )
         {
-            switch (i++)
+            if ( it->type == hoxOutboxRecord::TYPE_GAME )
             {
-                case 0: playerInfo.id = (*it); break;
-                case 1: playerInfo.score = ::atoi( it->c_str() ); break;
-                case 2: playerInfo.wins = ::atoi( it->c_str() ); break;
-                case 3: playerInfo.draws = ::atoi( it->c_str() ); break;
-                case 4: playerInfo.losses = ::atoi( it->c_str() ); break;
-                case 5: playerInfo.hpw = (*it); break;
-                default: /* Ignore the rest. */ break;
+                games.push_back( &(*it) );
+            }
+            else if ( it->type != hoxOutboxRecord::TYPE_RESULT )
+            {
+                hoxLog(LOG_WARN, "%s: Dropped a record [%lld] of unknown type [%c].",
+                    FNAME, it->seq, it->type);
             }
+            else
+            {
+                results.push_back( &(*it) );
+            }
+            lastSeq = it->seq;
         }
 
+        result = _send_records( hoxREQUEST_DB_PLAYER_SET_BATCH, results );
+        if ( result != hoxRC_OK ) return result;
+
+        result = _send_records( hoxREQUEST_DB_GAME_PUT_BATCH, games );
+        if ( result != hoxRC_OK ) return result;
+
         return hoxRC_OK;
     }
 
     /**
-     * Handle write Thread.
+     * Handle write Thread: drain the outbox to the DB-Agent.
+     *
+     * The records are synced to the outbox's file (if any) before being
+     * sent, one sync for all those appended meanwhile. Those not known to
+     * be saved are sent again later, while the DB-Agent is unavailable.
      */
     void*
     _handle_db_write( void * /*arg*/ )
     {
         const char* FNAME = __FUNCTION__;
-        hoxResult result = hoxRC_UNKNOWN;
 
         while ( ! s_bShutdownWriteThread )
         {
-            if ( s_requestList.empty() )
+            if ( s_outbox.empty() )
             {
                 st_cond_wait( s_writeCond );
                 continue;    // NOTE: Double-check one more time.
             }
 
-            hoxRequest_SPtr pRequest( s_requestList.front() );
-            s_requestList.pop_front();
-
-            hoxLog(LOG_DEBUG, "%s: Got a new request [%s].", FNAME, pRequest->toString().c_str());
-
-            std::string      sResponse;
-            {
-                Lock lock;  // Obtain exclusive access.
-                result = _send_request_over_socket( s_nfd, *(pRequest.get()),
-                                                    sResponse );
-            }
-
-            /* Parse the response for player-info. */
-
-            hoxRequestType   type = hoxREQUEST_UNKNOWN;
-            hoxParameters    parameters;
+            (void) s_outbox.flush();
 
-            hoxUtil::parse_network_message( sResponse,
-                                            type,
-                                            parameters );
-            if ( type != pRequest->getType() )
+            long long lastSeq = 0;
+            if ( hoxRC_OK != _send_outbox_records( lastSeq ) )
             {
-                hoxLog(LOG_ERROR, "%s: Wrong returned Message-Type [%s].", FNAME,
-                    hoxUtil::requestTypeToString(type).c_str());
-                continue;  // *** Still allow to continue
+                st_sleep( hoxDB_BACKOFF_MIN );  // ... and send them again.
+                continue;
             }
 
-            const std::string sCode    = parameters["code"];
-            //const std::string sContent = parameters["content"];
-
-            if ( sCode != "0" )
-            {
-                hoxLog(LOG_ERROR, "%s: Received an Error-code [%s].", FNAME, sCode.c_str());
-                continue;  // *** Still allow to continue
-            }
+            s_outbox.ack( lastSeq );
 
             st_sleep( ST_UTIME_NO_WAIT ); // yield so that others can run.
         }
@@ -370,12 +1266,14 @@ namespace
 
 hoxResult
 hoxDbClient::initialize( const char* szHost,
-                         int         nPort )
+                         int         nPort,
+                         int         nPoolSize /* = 1 */,
+                         int         nCallTimeout /* = 0 */ )
 {
     const char* FNAME = "hoxDbClient::initialize";
-    hoxResult result = hoxRC_UNKNOWN;
 
-    hoxLog(LOG_INFO, "%s: ENTER. [%s:%d]", FNAME, szHost, nPort);
+    hoxLog(LOG_INFO, "%s: ENTER. [%s:%d] x %d, timeout = %d", FNAME, szHost, nPort,
+        nPoolSize, nCallTimeout);
 
     if ( s_bInitialized )
     {
@@ -383,23 +1281,40 @@ hoxDbClient::initialize( const char* szHost,
         return hoxRC_OK;
     }
 
-    s_mutex = st_mutex_new();  // ... to provide exclusive assess
+    s_sHost = szHost;
+    s_nPort = nPort;
+    s_callTimeout = ( nCallTimeout > 0 ? nCallTimeout : hoxDB_CALL_TIMEOUT ) * 1000000LL;
+    s_sClientId = hoxUtil::intToString( getpid() ) + "."
+                + hoxUtil::intToString( hoxUtil::generateRandomNumber( INT_MAX - 1 ) );
 
-    /* Open a "shared" client socket. */
-    s_nfd = _open_client_socket( szHost, nPort );
-    if ( s_nfd == NULL )
+    /* Open the pool of connections, each answering a "HELLO" request
+     * to make sure that the DB Agent is OK.
+     * Those that fail are retried later by the "health" thread.
+     */
+    int nConnected = 0;
+    for ( int i = 0; i < std::max(nPoolSize, 1); ++i )
     {
-        hoxLog(LOG_ERROR, "%s: Failed to open a client socket.", FNAME);
-        return hoxRC_OK;
+        DbConnection* conn = new DbConnection( i );
+        s_connections.push_back( conn );
+        if ( hoxRC_OK == _connect( conn ) ) ++nConnected;
+    }
+
+    if ( nConnected == 0 )
+    {
+        /* Start anyway: the writes wait in the outbox meanwhile. */
+        hoxLog(LOG_WARN, "%s: Failed to open any connection to DB Agent. Retry later.", FNAME);
     }
 
     s_bInitialized = true;
 
-    /* Send an "HELLO" request to make sure that the DB Agent is OK. */
-    result = send_HELLO();
-    if ( result != hoxRC_OK )
+    s_bShutdownHealthThread = false;
+    s_healthThread = st_thread_create( _handle_db_health,
+                                       ( void * ) NULL,
+                                       1 /* joinable */,
+                                       0 /* stack-size */ );
+    if ( s_healthThread == NULL )
     {
-        hoxLog(LOG_ERROR, "%s: Failed to send HELLO request.", FNAME);
+        hoxLog(LOG_ERROR, "%s: Failed to create health DB thread.", FNAME);
         return hoxRC_ERR;
     }
 
@@ -419,10 +1334,16 @@ hoxDbClient::initialize( const char* szHost,
         return hoxRC_ERR;
     }
 
-    hoxLog(LOG_DEBUG, "%s: END. (OK)", FNAME);
+    hoxLog(LOG_DEBUG, "%s: END. (OK) %d connection(s) up.", FNAME, nConnected);
     return hoxRC_OK;
 }
 
+hoxResult
+hoxDbClient::open_outbox( const std::string& sPath )
+{
+    return s_outbox.open( sPath );
+}
+
 hoxResult
 hoxDbClient::deinitialize()
 {
@@ -436,9 +1357,34 @@ hoxDbClient::deinitialize()
         return hoxRC_ERR;
     }
 
-    /* Close the "shared" client socket. */
-    st_netfd_close( s_nfd );
-    s_nfd = NULL;
+    /* Stop the "health" thread so that it reconnects nothing more. */
+    s_bShutdownHealthThread = true;
+    if ( s_healthThread != NULL )
+    {
+        st_thread_interrupt( s_healthThread );
+    }
+
+    /* Close the connections (failing the calls still waiting). */
+    for ( size_t i = 0; i < s_connections.size(); ++i )
+    {
+        _disconnect( s_connections[i] );
+    }
+
+    if ( s_healthThread != NULL )
+    {
+        st_thread_join( s_healthThread, NULL );
+        s_healthThread = NULL;
+    }
+
+    for ( size_t i = 0; i < s_connections.size(); ++i )
+    {
+        delete s_connections[i];
+    }
+    s_connections.clear();
+    s_playerCache.clear();
+
+    /* Keep the writes not yet saved (if the outbox has a file). */
+    (void) s_outbox.flush();
 
     s_bInitialized = false;
 
@@ -454,13 +1400,10 @@ hoxDbClient::send_HELLO()
 
     hoxLog(LOG_DEBUG, "%s: ENTER.", FNAME);
 
-    Lock lock;  // Obtain exclusive access.
+    hoxRequest    request( hoxREQUEST_HELLO );
+    hoxParameters parameters;
 
-    const hoxRequest request( hoxREQUEST_HELLO );
-    std::string      sResponse;
-
-    result = _send_request_over_socket( s_nfd, request,
-                                        sResponse );
+    result = _call( request, parameters );
     return result;
 }
 
@@ -474,32 +1417,22 @@ hoxDbClient::put_player_info( hoxPlayer_SPtr     player,
 
     hoxLog(LOG_DEBUG, "%s: ENTER. pid = [%s].", FNAME, sPlayerId.c_str());
 
-    Lock lock;  // Obtain exclusive access.
-
+    /* NOTE: Unlike the game results, a new Player is not kept in the outbox:
+     *       another VP may take the same ID meanwhile, and the Player must
+     *       learn it before being told that the account is created.
+     */
     hoxRequest request( hoxREQUEST_DB_PLAYER_PUT );
     request.setParam("pid", sPlayerId);
     request.setParam("password", player->getHPassword());
     request.setParam("score", hoxUtil::intToString(player->getScore()));
     request.setParam("email", sEmail);
 
-    std::string      sResponse;
-
-    result = _send_request_over_socket( s_nfd, request,
-                                        sResponse );
-
-    /* Parse the response for player-info. */
-
-    hoxRequestType   type = hoxREQUEST_UNKNOWN;
     hoxParameters    parameters;
 
-    hoxUtil::parse_network_message( sResponse,
-                                    type,
-                                    parameters );
-    if ( type != request.getType() )
+    result = _call( request, parameters );
+    if ( result != hoxRC_OK )
     {
-        hoxLog(LOG_ERROR, "%s: Wrong returned Message-Type [%s].", FNAME,
-            hoxUtil::requestTypeToString(type).c_str());
-        return hoxRC_ERR;
+        return _call_failed( result );
     }
 
     const std::string sCode    = parameters["code"];
@@ -510,6 +1443,7 @@ hoxDbClient::put_player_info( hoxPlayer_SPtr     player,
         return hoxRC_ERR;
     }
 
+    s_playerCache.put( _get_player_info( player ) );
     return hoxRC_OK;
 }
 
@@ -518,29 +1452,28 @@ hoxDbClient::get_player_info( hoxPlayer_SPtr player )
 {
     hoxResult         result = hoxRC_UNKNOWN;
     const std::string sPlayerId = player->getId();
+    Player_t          playerInfo;
 
-    Lock lock;  // Obtain exclusive access.
+    /* Look up the cache first. */
+    if ( s_playerCache.get( sPlayerId, playerInfo ) )
+    {
+        player->setScore( playerInfo.score );
+        player->setWins( playerInfo.wins );
+        player->setDraws( playerInfo.draws );
+        player->setLosses( playerInfo.losses );
+        player->setHPassword( playerInfo.hpw );
+        return hoxRC_OK;
+    }
 
     hoxRequest request( hoxREQUEST_DB_PLAYER_GET );
     request.setParam("pid", sPlayerId);
 
-    std::string sResponse;
-    result = _send_request_over_socket( s_nfd, request,
-                                        sResponse );
-
-    /* Parse the response for player-info. */
-
-    hoxRequestType   type = hoxREQUEST_UNKNOWN;
     hoxParameters    parameters;
 
-    hoxUtil::parse_network_message( sResponse,
-                                    type,
-                                    parameters );
-    if ( type != request.getType() )
+    result = _call( request, parameters );
+    if ( result != hoxRC_OK )
     {
-        hoxLog(LOG_ERROR, "%s: Wrong returned Message-Type [%s].", __FUNCTION__,
-            hoxUtil::requestTypeToString(type).c_str());
-        return hoxRC_ERR;
+        return _call_failed( result );
     }
 
     const std::string sCode    = parameters["code"];
@@ -558,8 +1491,6 @@ hoxDbClient::get_player_info( hoxPlayer_SPtr player )
         return hoxRC_ERR;
     }
 
-    Player_t  playerInfo;
-
     result = _parse_str_player_info( sContent, playerInfo );
     hoxCHECK_MSG(result == hoxRC_OK, hoxRC_ERR, "Failed to parse Content");
     hoxCHECK_MSG(playerInfo.id == sPlayerId, hoxRC_ERR, "Player Ids not matched");
@@ -570,6 +1501,7 @@ hoxDbClient::get_player_info( hoxPlayer_SPtr player )
     player->setLosses( playerInfo.losses );
     player->setHPassword( playerInfo.hpw );
 
+    s_playerCache.put( playerInfo );
     return hoxRC_OK;
 }
 
@@ -579,15 +1511,136 @@ hoxDbClient::set_player_info( const hoxPlayer_SPtr player,
 {
     const std::string sPlayerId = player->getId();
 
-    hoxRequest_SPtr pRequest( new hoxRequest( hoxREQUEST_DB_PLAYER_SET ) );
-    pRequest->setParam("pid", sPlayerId);
-    pRequest->setParam("score", hoxUtil::intToString(player->getScore()));
-    pRequest->setParam("result", sGameResult);
+    s_playerCache.update( _get_player_info( player ) );  // Write through.
+
+    /* Sent (in a batch) by the "write" thread. */
+    s_outbox.append( hoxOutboxRecord::TYPE_RESULT,
+                     sPlayerId + ";" + hoxUtil::intToString(player->getScore())
+                               + ";" + sGameResult );
+    st_cond_signal( s_writeCond );
+}
 
-    s_requestList.push_back( pRequest );
+void
+hoxDbClient::put_game_info( const hoxGameRecord& record )
+{
+    std::ostringstream outStream;
+
+    outStream << record.timestamp << ";"
+              << record.redId << ";"
+              << record.blackId << ";"
+              << hoxUtil::gameStatusToString( record.status ) << ";"
+              << record.gameType << ";"
+              << record.redScore << ";"
+              << record.blackScore << ";"
+              << record.moves.size();
+
+    /* Sent (in a batch) by the "write" thread. */
+    s_outbox.append( hoxOutboxRecord::TYPE_GAME, outStream.str() );
     st_cond_signal( s_writeCond );
 }
 
+hoxResult
+hoxDbClient::get_games( const std::string& sPlayerId,
+                        const std::string& sOpponentId,
+                        long long          cursor,
+                        int                nLimit,
+                        std::string&       sEntries )
+{
+    const char* FNAME = "hoxDbClient::get_games";
+    hoxResult   result = hoxRC_UNKNOWN;
+    char        szCursor[32];
+
+    snprintf( szCursor, sizeof(szCursor), "%lld", cursor );
+
+    hoxRequest request( hoxREQUEST_DB_GAMES_GET );
+    request.setParam("pid", sPlayerId);
+    if ( ! sOpponentId.empty() ) request.setParam("oid", sOpponentId);
+    request.setParam("cursor", szCursor);
+    request.setParam("limit", hoxUtil::intToString( nLimit ));
+
+    hoxParameters    parameters;
+
+    result = _call( request, parameters );
+    if ( result != hoxRC_OK )
+    {
+        return _call_failed( result );
+    }
+
+    const std::string sCode = parameters["code"];
+    if ( sCode != "0" )
+    {
+        hoxLog(LOG_ERROR, "%s: Received an Error-code [%s].", FNAME, sCode.c_str());
+        return hoxRC_ERR;
+    }
+
+    _get_lines( parameters["content"], sEntries );
+    return hoxRC_OK;
+}
+
+hoxResult
+hoxDbClient::get_leaders( int          nFrom,
+                          int          nCount,
+                          std::string& sEntries )
+{
+    const char* FNAME = "hoxDbClient::get_leaders";
+    hoxResult   result = hoxRC_UNKNOWN;
+
+    hoxRequest request( hoxREQUEST_DB_LEADERS_GET );
+    request.setParam("from", hoxUtil::intToString( nFrom ));
+    request.setParam("count", hoxUtil::intToString( nCount ));
+
+    hoxParameters    parameters;
+
+    result = _call( request, parameters );
+    if ( result != hoxRC_OK )
+    {
+        return _call_failed( result );
+    }
+
+    const std::string sCode = parameters["code"];
+    if ( sCode != "0" )
+    {
+        hoxLog(LOG_ERROR, "%s: Received an Error-code [%s].", FNAME, sCode.c_str());
+        return hoxRC_ERR;
+    }
+
+    _get_lines( parameters["content"], sEntries );
+    return hoxRC_OK;
+}
+
+hoxResult
+hoxDbClient::get_rank( const std::string& sPlayerId,
+                       int                nAround,
+                       std::string&       sEntries )
+{
+    const char* FNAME = "hoxDbClient::get_rank";
+    hoxResult   result = hoxRC_UNKNOWN;
+
+    hoxRequest request( hoxREQUEST_DB_RANK_GET );
+    request.setParam("pid", sPlayerId);
+    request.setParam("around", hoxUtil::intToString( nAround ));
+
+    hoxParameters    parameters;
+
+    result = _call( request, parameters );
+    if ( result != hoxRC_OK )
+    {
+        return _call_failed( result );
+    }
+
+    /* NOTE: The only error is a Player not ranked. */
+    const std::string sCode = parameters["code"];
+    if ( sCode != "0" )
+    {
+        hoxLog(LOG_DEBUG, "%s: Player [%s] not ranked. Error-code [%s].", FNAME,
+            sPlayerId.c_str(), sCode.c_str());
+        return hoxRC_NOT_FOUND;
+    }
+
+    _get_lines( parameters["content"], sEntries );
+    return hoxRC_OK;
+}
+
 hoxResult
 hoxDbClient::set_player_password( const hoxPlayer_SPtr player )
 {
@@ -597,30 +1650,16 @@ hoxDbClient::set_player_password( const hoxPlayer_SPtr player )
 
     hoxLog(LOG_DEBUG, "%s: ENTER. pid = [%s].", FNAME, sPlayerId.c_str());
 
-    Lock lock;  // Obtain exclusive access.
-
     hoxRequest request( hoxREQUEST_DB_PASSWORD_SET );
     request.setParam("pid", sPlayerId);
     request.setParam("password", player->getHPassword());
 
-    std::string      sResponse;
-
-    result = _send_request_over_socket( s_nfd, request,
-                                        sResponse );
-
-    /* Parse the response for player-info. */
-
-    hoxRequestType   type = hoxREQUEST_UNKNOWN;
     hoxParameters    parameters;
 
-    hoxUtil::parse_network_message( sResponse,
-                                    type,
-                                    parameters );
-    if ( type != request.getType() )
+    result = _call( request, parameters );
+    if ( result != hoxRC_OK )
     {
-        hoxLog(LOG_ERROR, "%s: Wrong returned Message-Type [%s].", FNAME,
-            hoxUtil::requestTypeToString(type).c_str());
-        return hoxRC_ERR;
+        return _call_failed( result );
     }
 
     const std::string sCode    = parameters["code"];
@@ -632,6 +1671,7 @@ hoxDbClient::set_player_password( const hoxPlayer_SPtr player )
         return hoxRC_ERR;
     }
 
+    s_playerCache.update( _get_player_info( player ) );  // Write through.
     return hoxRC_OK;
 }
 
@@ -672,11 +1712,11 @@ hoxDbClient::WWW_authenticate( const std::string& sPlayerId,
     const int nToSend = sRequest.size();
     ssize_t   nSent = 0;
 
-    hoxLog(LOG_DEBUG, "%s: Sending (%d bytes): [\n%s]...", FNAME, sRequest.size(), sRequest.c_str());
+    hoxLog(LOG_DEBUG, "%s: Sending (%d bytes): [\n%s]...", FNAME, (int) sRequest.size(), sRequest.c_str());
     nSent = st_write( nfd, 
                       sRequest.c_str(), 
                       nToSend, 
-                      ST_UTIME_NO_TIMEOUT );
+                      s_callTimeout );
     if ( nSent < nToSend )
     {
         hoxLog(LOG_SYS_WARN, "%s: Failed to write to socket", FNAME);
@@ -695,7 +1735,7 @@ hoxDbClient::WWW_authenticate( const std::string& sPlayerId,
     for (;;)
     {
         memset( szBuffer, 0, MAX_TO_READ );  // zero-out.
-        nRead = st_read( nfd, szBuffer, MAX_TO_READ, ST_UTIME_NO_TIMEOUT );
+        nRead = st_read( nfd, szBuffer, MAX_TO_READ, s_callTimeout );
         if ( nRead > 0 )
         {
             sResponse.append( szBuffer, nRead ); 
@@ -706,7 +1746,7 @@ hoxDbClient::WWW_authenticate( const std::string& sPlayerId,
         }
     }
 
-    hoxLog(LOG_DEBUG, "%s: Received (%d bytes): [\n%s].", FNAME, sResponse.size(), sResponse.c_str());
+    hoxLog(LOG_DEBUG, "%s: Received (%d bytes): [\n%s].", FNAME, (int) sResponse.size(), sResponse.c_str());
 
     /* Check for return-code. */
 
@@ -732,29 +1772,17 @@ hoxDbClient::get_http_file( const std::string& sPath,
     hoxResult result = hoxRC_UNKNOWN;
 
     hoxLog(LOG_DEBUG, "%s: ENTER. path = [%s].", FNAME, sPath.c_str());
-    Lock lock;  // Obtain exclusive access.
 
     hoxRequest request( hoxREQUEST_HTTP_GET );
     request.setParam("path", sPath);
 
-    std::string      sResponse;
-
-    result = _send_request_over_socket( s_nfd, request,
-                                        sResponse );
-
-    /* Parse the response for player-info. */
-
-    hoxRequestType   type = hoxREQUEST_UNKNOWN;
     hoxParameters    parameters;
 
-    hoxUtil::parse_network_message( sResponse,
-                                    type,
-                                    parameters );
-    if ( type != request.getType() )
+    /* The file's content follows the response. */
+    result = _call( request, parameters, &sFileContent );
+    if ( result != hoxRC_OK )
     {
-        hoxLog(LOG_ERROR, "%s: Wrong returned Message-Type [%s].", FNAME,
-            hoxUtil::requestTypeToString(type).c_str());
-        return hoxRC_ERR;
+        return _call_failed( result );
     }
 
     const std::string sCode    = parameters["code"];
@@ -766,11 +1794,7 @@ hoxDbClient::get_http_file( const std::string& sPath,
         return hoxRC_ERR;
     }
 
-    const size_t nSize = ::atoi( sContent.c_str() );
-    hoxLog(LOG_DEBUG, "%s: Path = [%s], Size = [%d].", FNAME, sPath.c_str(), nSize);
-
-    result = hoxSocketAPI::read_nbytes( s_nfd, nSize, sFileContent );
-    hoxCHECK_MSG(result == hoxRC_OK, hoxRC_ERR, "Failed to read N bytes");
+    hoxLog(LOG_DEBUG, "%s: Path = [%s], Size = [%s].", FNAME, sPath.c_str(), sContent.c_str());
 
     return hoxRC_OK;
 }
@@ -785,16 +1809,20 @@ hoxDbClient::log_msg( const std::string& sMsg )
     // !! is doing the "logging".                        !!
     // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
-    Lock lock;  // Obtain exclusive access.
+    /* Through the shared-memory ring (if open), unless it is full. */
+    if ( hoxRC_OK == hoxLogRing::write( sMsg ) )
+    {
+        return hoxRC_OK;
+    }
 
     hoxRequest request( hoxREQUEST_LOG );
     request.setParam("size", hoxUtil::intToString(sMsg.size()));
 
-    std::string      sResponse;
+    hoxParameters    parameters;
 
-    result = _send_request_over_socket( s_nfd, request,
-                                        sResponse,
-                                        sMsg /* Additional data */ );
+    result = _call( request, parameters,
+                    NULL,
+                    sMsg /* Additional data */ );
     return result;
 }
 
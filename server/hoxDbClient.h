@@ -16,14 +16,36 @@
 #include <string>
 #include "hoxTypes.h"
 
+class hoxGameRecord;
+
 namespace hoxDbClient
 {
     /**
      * Initialize this client.
      *
+     * @param nPoolSize The number of connections to the DB-Agent.
+     *                  Each call goes to the least busy one.
+     * @param nCallTimeout The seconds for a call to be answered
+     *                     (0 for the default).
+     *
+     * @note A call failing because the DB-Agent does not answer in time,
+     *       or is down, returns hoxRC_TIMEOUT.
+     * @note It succeeds even if the DB-Agent is down: the connections
+     *       are retried later.
      */
     hoxResult initialize( const char* szHost, 
-                          int         nPort );
+                          int         nPort,
+                          int         nPoolSize = 1,
+                          int         nCallTimeout = 0 );
+
+    /**
+     * Open the (durable) outbox of the writes to the Database.
+     * The writes not yet saved (from the last run) are sent again.
+     *
+     * @note To be called before initialize(). Without it, the writes
+     *       wait in memory only.
+     */
+    hoxResult open_outbox( const std::string& sPath );
 
     /**
      * De-initialize this client.
@@ -40,6 +62,8 @@ namespace hoxDbClient
     /**
      * Put (create) a new Player's Info.
      *
+     * @return hoxRC_TIMEOUT if the DB-Agent does not answer in time,
+     *         hoxRC_ERR if the Player is refused (e.g., the ID is taken).
      */
     hoxResult put_player_info( hoxPlayer_SPtr     player,
                                const std::string& sEmail );
@@ -47,16 +71,60 @@ namespace hoxDbClient
     /**
      * Get the info. of a Player.
      *
+     * @return hoxRC_NOT_FOUND if the Player does not exist,
+     *         hoxRC_TIMEOUT if the DB-Agent does not answer in time.
      */
     hoxResult get_player_info( hoxPlayer_SPtr player );
 
     /**
-     * Set the info. of a Player.
+     * Set the info. of a Player (with the result of a game).
+     * It is saved to the outbox and sent to the DB-Agent later.
      *
      */
     void set_player_info( const hoxPlayer_SPtr player,
                           const std::string&   sGameResult );
 
+    /**
+     * Put (save) a completed Game, for the Players' history.
+     * It is saved to the outbox and sent to the DB-Agent later.
+     */
+    void put_game_info( const hoxGameRecord& record );
+
+    /**
+     * Get the Games of a Player, the most recent first.
+     *
+     * @param sOpponentId [OPTIONAL] Only the Games against this Player.
+     * @param cursor      Only the Games older than this Game-Id (0 for all).
+     * @param sEntries    [OUT] One line per Game:
+     *           "gid;ended;red;black;status;type;redScore;blackScore;moves".
+     */
+    hoxResult get_games( const std::string& sPlayerId,
+                         const std::string& sOpponentId,
+                         long long          cursor,
+                         int                nLimit,
+                         std::string&       sEntries );
+
+    /**
+     * Get the Players with the highest scores.
+     *
+     * @param nFrom    The number of Players to skip (0 for the first).
+     * @param sEntries [OUT] One line per Player: "rank;pid;score".
+     */
+    hoxResult get_leaders( int          nFrom,
+                           int          nCount,
+                           std::string& sEntries );
+
+    /**
+     * Get the rank of a Player, with up to nAround neighbors on each side.
+     *
+     * @param sEntries [OUT] One line per Player: "rank;pid;score".
+     *
+     * @return hoxRC_NOT_FOUND if the Player is not ranked.
+     */
+    hoxResult get_rank( const std::string& sPlayerId,
+                        int                nAround,
+                        std::string&       sEntries );
+
     /**
      * Set the new Password of a Player.
      *
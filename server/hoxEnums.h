@@ -21,14 +21,22 @@
  * Various constants defined the server's behaviors.
  */
 
-#define hoxPERPETUAL_CHECKS_MAX   6
-        /* The number of consecutive checks allowed. */
+#define hoxREPETITION_MAX         3
+        /* The number of times a position may occur before the Game is
+         * judged by the repetition rules (perpetual check / chase).
+         */
 
 #define hoxEFFECTIVE_MOVES_MAX    200
         /* The number of 'effective' (i.e., non-check) Moves allowed before
          * the Game is declared to be a Draw.
          */
 
+#define hoxLIST_LIMIT_MAX         100
+        /* The maximum number of Tables returned by a paged LIST request. */
+
+#define hoxSCORE_BAND_SIZE        100
+        /* The width of a rating band in the (max) player-score index. */
+
 /******************************************************************/
 /******************************************************************/
 
@@ -109,6 +117,12 @@ enum hoxRequestType
     hoxREQUEST_PLAYER_INFO,
         /* Info request for a given Player */
 
+    hoxREQUEST_LEADERBOARD,
+        /* The Players ranked by score (the top, or around a given Player) */
+
+    hoxREQUEST_HISTORY,
+        /* The completed Games of a Player (a page, the most recent first) */
+
     hoxREQUEST_PLAYER_STATUS,
         /* Event generated from a Player when his Status is changed. */
 
@@ -127,9 +141,27 @@ enum hoxRequestType
     hoxREQUEST_DB_PLAYER_SET,
         /* Set Database Player's info */
 
+    hoxREQUEST_DB_PLAYER_SET_BATCH,
+        /* Set Database many Players' info (the results of many games) */
+
+    hoxREQUEST_DB_GAME_PUT_BATCH,
+        /* Put (save) into Database many completed Games */
+
+    hoxREQUEST_DB_GAMES_GET,
+        /* Get Database a Player's Games (a page of his history) */
+
     hoxREQUEST_DB_PASSWORD_SET,
         /* Set Database Player's NEW password */
 
+    hoxREQUEST_DB_PLAYER_INVALIDATE,
+        /* Notice from DBAgent: a Player's info was changed by another server */
+
+    hoxREQUEST_DB_LEADERS_GET,
+        /* Get from DBAgent the Players with the highest scores */
+
+    hoxREQUEST_DB_RANK_GET,
+        /* Get from DBAgent a Player's rank (and his neighbors) */
+
           /* HTTP requests */
     hoxREQUEST_HTTP_GET,
     hoxREQUEST_HTTP_POST,
@@ -236,6 +268,19 @@ enum hoxGameStatus
     hoxGAME_STATUS_DRAWN        // Game Over: Drawn.
 };
 
+/**
+ * Time-control buckets (based on the initial Game-time) of a Table.
+ */
+enum hoxTimeBucket
+{
+    hoxTIME_BUCKET_UNKNOWN = -1,
+
+    hoxTIME_BUCKET_BLITZ = 0,   // Up to 5 minutes.
+    hoxTIME_BUCKET_RAPID,       // Up to 15 minutes.
+    hoxTIME_BUCKET_STANDARD,    // Up to 30 minutes.
+    hoxTIME_BUCKET_LONG         // More than 30 minutes.
+};
+
 /**
  * Network constants.
  */
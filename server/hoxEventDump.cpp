@@ -0,0 +1,232 @@
+//
+// C++ Implementation: hoxEventDump
+//
+// Description: The command-line tool to decode the event logs.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include <unistd.h>
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include "hoxEventLog.h"
+
+/******************************************************************
+ * Helper API
+ */
+
+static void usage( const char *progname )
+{
+    fprintf( stderr, "Usage: %s [<options>] <event_log>...\n\n"
+             "Possible options:\n\n"
+             "\t-c                      Print as CSV (with a header line).\n"
+             "\t-t <type>               Print only the events of a type (such as REQUEST).\n"
+             "\t-p <player_id>          Print only the events of a player.\n"
+             "\t-s                      Print the durations' summary of each request\n"
+             "\t                        (and DB call) instead of the events.\n"
+             "\t-h                      Print this message.\n\n"
+             "Each event is printed on one line as:\n"
+             "\ttime type pid=... pid2=... tid=... duration=... code=... text\n"
+             "where the durations are in microseconds.\n",
+             progname );
+    exit( 1 );
+}
+
+static hoxEventType string_to_type( const char* szType )
+{
+    for ( int type = hoxEVENT_UNKNOWN + 1; type <= hoxEVENT_MAX; ++type )
+    {
+        if ( strcasecmp( szType, hoxEventLog::typeToString( (hoxEventType) type ) ) == 0 )
+        {
+            return (hoxEventType) type;
+        }
+    }
+    return hoxEVENT_UNKNOWN;
+}
+
+static const std::string time_to_string( const long long time )
+{
+    const time_t seconds = (time_t) ( time / 1000000 );
+    struct tm    tmTime;
+    ::localtime_r( &seconds, &tmTime );
+
+    char szTime[64];
+    const size_t n = strftime( szTime, sizeof(szTime), "%Y-%m-%d %H:%M:%S", &tmTime );
+    snprintf( szTime + n, sizeof(szTime) - n, ".%06d", (int) ( time % 1000000 ) );
+    return szTime;
+}
+
+/**
+ * Quote a CSV field if needed (doubling its quotes).
+ */
+static const std::string csv_field( const std::string& sField )
+{
+    if ( sField.find_first_of( ",\"\n" ) == std::string::npos ) return sField;
+
+    std::string sQuoted = "\"";
+    for ( size_t i = 0; i < sField.size(); ++i )
+    {
+        if ( sField[i] == '"' ) sQuoted += '"';
+        sQuoted += sField[i];
+    }
+    return sQuoted + "\"";
+}
+
+static void print_event( const hoxEventRecord& record,
+                         const bool            bCSV )
+{
+    if ( bCSV )
+    {
+        printf( "%lld,%s,%s,%s,%s,%u,%d,%s\n",
+                record.time, hoxEventLog::typeToString( record.type ),
+                csv_field( record.pid ).c_str(), csv_field( record.pid2 ).c_str(),
+                csv_field( record.tid ).c_str(), record.duration, record.code,
+                csv_field( record.text ).c_str() );
+    }
+    else
+    {
+        printf( "%s %s pid=%s pid2=%s tid=%s duration=%u code=%d %s\n",
+                time_to_string( record.time ).c_str(),
+                hoxEventLog::typeToString( record.type ),
+                record.pid.c_str(), record.pid2.c_str(), record.tid.c_str(),
+                record.duration, record.code, record.text.c_str() );
+    }
+}
+
+/**
+ * The durations of the requests (and DB calls), by name.
+ */
+typedef std::map<std::string, std::vector<unsigned int> > DurationMap;
+
+static void print_summary( DurationMap& durations )
+{
+    printf( "%-24s %10s %10s %10s %10s %10s\n",
+            "name", "count", "avg", "p50", "p99", "max" );
+
+    for ( DurationMap::iterator it = durations.begin(); it != durations.end(); ++it )
+    {
+        std::vector<unsigned int>& values = it->second;
+        std::sort( values.begin(), values.end() );
+
+        double fTotal = 0;
+        for ( size_t i = 0; i < values.size(); ++i ) fTotal += values[i];
+
+        const size_t n = values.size();
+        printf( "%-24s %10lu %10.0f %10u %10u %10u\n",
+                it->first.c_str(), (unsigned long) n, fTotal / n,
+                values[( n - 1 ) / 2], values[( n - 1 ) * 99 / 100], values[n - 1] );
+    }
+}
+
+/******************************************************************/
+
+/**
+ * Main function.
+ */
+int
+main( int argc, char *argv[] )
+{
+    extern char *optarg;
+    extern int   optind;
+    bool         bCSV       = false;
+    bool         bSummary   = false;
+    hoxEventType type       = hoxEVENT_UNKNOWN;  // Any type.
+    const char*  szPlayerId = NULL;
+    int          opt;
+    int          nErrors = 0;
+
+    while (( opt = getopt( argc, argv, "ct:p:sh" ) ) != EOF )
+    {
+        switch ( opt )
+        {
+            case 'c':
+                bCSV = true;
+                break;
+            case 't':
+                type = string_to_type( optarg );
+                if ( type == hoxEVENT_UNKNOWN )
+                {
+                    fprintf( stderr, "ERROR: unknown type [%s]\n", optarg );
+                    usage( argv[0] );
+                }
+                break;
+            case 'p':
+                szPlayerId = optarg;
+                break;
+            case 's':
+                bSummary = true;
+                break;
+            case 'h':
+            case '?':
+                usage( argv[0] );
+        }
+    }
+
+    if ( optind >= argc )
+    {
+        usage( argv[0] );
+    }
+
+    if ( bCSV && ! bSummary )
+    {
+        printf( "time,type,pid,pid2,tid,duration,code,text\n" );
+    }
+
+    DurationMap durations;
+
+    for ( int i = optind; i < argc; ++i )
+    {
+        hoxEventLogReader reader;
+        hoxEventRecord    record;
+        long              nOffset = 0;
+        hoxResult         result;
+
+        if ( hoxRC_OK != reader.open( argv[i] ) )
+        {
+            fprintf( stderr, "ERROR: can't open event log [%s]\n", argv[i] );
+            ++nErrors;
+            continue;
+        }
+
+        while ( hoxRC_OK == ( result = reader.next( record, &nOffset ) ) )
+        {
+            if ( type != hoxEVENT_UNKNOWN && record.type != type ) continue;
+            if ( szPlayerId != NULL && record.pid != szPlayerId ) continue;
+
+            if ( ! bSummary )
+            {
+                print_event( record, bCSV );
+            }
+            else if (    record.type == hoxEVENT_REQUEST
+                      || record.type == hoxEVENT_DB_CALL )
+            {
+                const std::string sName = std::string( hoxEventLog::typeToString( record.type ) )
+                                        + ":" + record.text;
+                durations[sName].push_back( record.duration );
+            }
+        }
+
+        if ( result == hoxRC_NOT_VALID )
+        {
+            fprintf( stderr, "WARN: event log [%s] is corrupted at offset [%ld]\n",
+                     argv[i], nOffset );
+            ++nErrors;
+        }
+    }
+
+    if ( bSummary )
+    {
+        print_summary( durations );
+    }
+
+    return ( nErrors == 0 ? 0 : 1 );
+}
+
+/******************* END OF FILE *********************************************/
@@ -0,0 +1,454 @@
+//
+// C++ Implementation: hoxEventLog
+//
+// Description: The append-only (binary) log of the server's events.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <algorithm>
+#include "hoxEventLog.h"
+
+/******************************************************************
+ * Constants
+ */
+
+#define EVENT_LOG_MAGIC        "HXEV"
+#define EVENT_LOG_VERSION      1
+#define EVENT_LOG_HEADER_SIZE  6        /* magic + version */
+#define EVENT_FLUSH_SIZE       ( 64 * 1024 )
+        /* The amount of pending data that triggers a flush. */
+#define EVENT_READ_SIZE        ( 64 * 1024 )
+#define EVENT_FIXED_SIZE       19       /* length ... code */
+#define EVENT_MIN_SIZE         ( EVENT_FIXED_SIZE + 4 )
+
+/******************************************************************
+ * Encoding helpers
+ */
+
+namespace
+{
+    void _put8( std::string& s, unsigned int v )
+    {
+        s += (char) ( v & 0xFF );
+    }
+
+    void _put16( std::string& s, unsigned int v )
+    {
+        _put8( s, v );
+        _put8( s, v >> 8 );
+    }
+
+    void _put32( std::string& s, unsigned int v )
+    {
+        _put16( s, v & 0xFFFF );
+        _put16( s, v >> 16 );
+    }
+
+    void _put64( std::string& s, unsigned long long v )
+    {
+        _put32( s, (unsigned int) ( v & 0xFFFFFFFF ) );
+        _put32( s, (unsigned int) ( v >> 32 ) );
+    }
+
+    void _set16( std::string& s, size_t pos, unsigned int v )
+    {
+        s[pos]     = (char) ( v & 0xFF );
+        s[pos + 1] = (char) ( ( v >> 8 ) & 0xFF );
+    }
+
+    unsigned int _get8( const char* p )
+    {
+        return (unsigned char) p[0];
+    }
+
+    unsigned int _get16( const char* p )
+    {
+        return _get8( p ) | ( _get8( p + 1 ) << 8 );
+    }
+
+    unsigned int _get32( const char* p )
+    {
+        return _get16( p ) | ( _get16( p + 2 ) << 16 );
+    }
+
+    unsigned long long _get64( const char* p )
+    {
+        return _get32( p ) | ( (unsigned long long) _get32( p + 4 ) << 32 );
+    }
+
+    void _putString( std::string& s, const std::string& v )
+    {
+        const size_t n = std::min( v.size(), (size_t) 0xFF );
+        _put8( s, n );
+        s.append( v, 0, n );
+    }
+
+    /**
+     * Read a string, checking that it does not go past the end.
+     */
+    bool _getString( const char*& p, const char* end, std::string& v )
+    {
+        if ( p >= end ) return false;
+        const size_t n = _get8( p++ );
+        if ( p + n > end ) return false;
+        v.assign( p, n );
+        p += n;
+        return true;
+    }
+
+    /**
+     * Append a record to the data. Its fields are given separately
+     * so that the server logs an event without building a record.
+     */
+    void _encode( std::string&        sData,
+                  const hoxEventType  type,
+                  const long long     time,
+                  const long long     duration,
+                  const int           code,
+                  const std::string&  pid,
+                  const std::string&  pid2,
+                  const std::string&  tid,
+                  const std::string&  text )
+    {
+        const size_t nStart = sData.size();
+        _put16( sData, 0 );  // The length (set below).
+        _put8( sData, (unsigned int) type );
+        _put64( sData, (unsigned long long) time );
+        _put32( sData, (unsigned int) std::max( 0LL, std::min( duration, 0xFFFFFFFFLL ) ) );
+        _put32( sData, (unsigned int) code );
+        _putString( sData, pid );
+        _putString( sData, pid2 );
+        _putString( sData, tid );
+        _putString( sData, text );
+        _set16( sData, nStart, sData.size() - nStart );
+    }
+
+    const std::string _header()
+    {
+        std::string sHeader = EVENT_LOG_MAGIC;
+        _put16( sHeader, EVENT_LOG_VERSION );
+        return sHeader;
+    }
+
+    /**
+     * Write the whole data to a file. Written bytes are removed from
+     * the data, so that a failed write can be resumed later.
+     */
+    hoxResult _writeAll( int fd, std::string& sData )
+    {
+        size_t nWritten = 0;
+        while ( nWritten < sData.size() )
+        {
+            const ssize_t n = ::write( fd, sData.data() + nWritten,
+                                       sData.size() - nWritten );
+            if ( n < 0 )
+            {
+                if ( errno == EINTR ) continue;
+                sData.erase( 0, nWritten );
+                return hoxRC_ERR;
+            }
+            nWritten += n;
+        }
+        sData.clear();
+        return hoxRC_OK;
+    }
+
+} // namespace
+
+// =========================================================================
+//
+//                        hoxEventLog
+//
+// =========================================================================
+
+/* Define the static singleton instance. */
+hoxEventLog* hoxEventLog::s_instance = NULL;
+
+/*static*/
+hoxEventLog*
+hoxEventLog::getInstance()
+{
+    if ( hoxEventLog::s_instance == NULL )
+    {
+        hoxEventLog::s_instance = new hoxEventLog();
+    }
+    return hoxEventLog::s_instance;
+}
+
+hoxResult
+hoxEventLog::open( const std::string& sPath )
+{
+    if ( isOpen() && sPath == _path )
+    {
+        return hoxRC_OK;  // Already opened.
+    }
+
+    close();
+
+    /* Drop a partial record (or header) left behind by a crash. */
+    {
+        hoxEventLogReader reader;
+        hoxEventRecord    record;
+        long              nOffset = 0;
+        hoxResult         result = reader.open( sPath );
+        if ( result == hoxRC_OK )
+        {
+            while ( hoxRC_OK == ( result = reader.next( record, &nOffset ) ) ) {}
+            if ( result == hoxRC_NOT_VALID )
+            {
+                ::truncate( sPath.c_str(), nOffset );
+            }
+        }
+        else if ( result == hoxRC_NOT_VALID )
+        {
+            return hoxRC_NOT_VALID;  // Not an event log: leave it alone.
+        }
+    }
+
+    _path = sPath;
+    return _openFile();
+}
+
+hoxResult
+hoxEventLog::_openFile()
+{
+    _fd = ::open( _path.c_str(), O_CREAT | O_WRONLY | O_APPEND, 0644 );
+    if ( _fd < 0 ) return hoxRC_ERR;
+
+    struct stat st;
+    if ( ::fstat( _fd, &st ) == 0 && st.st_size < EVENT_LOG_HEADER_SIZE )
+    {
+        ::ftruncate( _fd, 0 );
+        std::string sHeader = _header();
+        if ( hoxRC_OK != _writeAll( _fd, sHeader ) )
+        {
+            close();
+            return hoxRC_ERR;
+        }
+    }
+
+    return hoxRC_OK;
+}
+
+void
+hoxEventLog::close()
+{
+    if ( ! isOpen() ) return;
+
+    flush();
+    ::close( _fd );
+    _fd = -1;
+    _buffer.clear();
+}
+
+hoxResult
+hoxEventLog::reopen()
+{
+    if ( ! isOpen() ) return hoxRC_OK;
+
+    /* NOTE: Unlike open(), the file is not checked, as it has been
+     *       written by this process only.
+     */
+    close();
+    return _openFile();
+}
+
+void
+hoxEventLog::log( const hoxEventType  type,
+                  const std::string&  pid,
+                  const std::string&  pid2,
+                  const std::string&  tid,
+                  const std::string&  text,
+                  const long long     duration /* = 0 */,
+                  const int           code /* = 0 */ )
+{
+    if ( ! isOpen() ) return;
+
+    _encode( _buffer, type, now(), duration, code, pid, pid2, tid, text );
+
+    if ( _buffer.size() >= EVENT_FLUSH_SIZE )
+    {
+        flush();
+    }
+}
+
+hoxResult
+hoxEventLog::flush()
+{
+    if ( ! isOpen() || _buffer.empty() ) return hoxRC_OK;
+
+    return _writeAll( _fd, _buffer );
+}
+
+/*static*/
+long long
+hoxEventLog::now()
+{
+    struct timeval tv;
+    ::gettimeofday( &tv, NULL );
+    return (long long) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/*static*/
+const char*
+hoxEventLog::typeToString( const hoxEventType type )
+{
+    switch ( type )
+    {
+        case hoxEVENT_SESSION_START: return "SESSION_START";
+        case hoxEVENT_SESSION_END:   return "SESSION_END";
+        case hoxEVENT_REQUEST:       return "REQUEST";
+        case hoxEVENT_MOVE:          return "MOVE";
+        case hoxEVENT_GAME_END:      return "GAME_END";
+        case hoxEVENT_DB_CALL:       return "DB_CALL";
+        default:                     return "UNKNOWN";
+    }
+}
+
+/*static*/
+void
+hoxEventLog::encodeRecord( const hoxEventRecord& record,
+                           std::string&          sData )
+{
+    _encode( sData, record.type, record.time, record.duration, record.code,
+             record.pid, record.pid2, record.tid, record.text );
+}
+
+/*static*/
+hoxResult
+hoxEventLog::decodeRecord( const char*     pData,
+                           const size_t    nSize,
+                           hoxEventRecord& record,
+                           size_t&         nLength )
+{
+    if ( nSize < 2 ) return hoxRC_NOT_VALID;
+
+    nLength = _get16( pData );
+    if ( nLength < EVENT_MIN_SIZE || nLength > nSize ) return hoxRC_NOT_VALID;
+
+    const unsigned int type = _get8( pData + 2 );
+    if ( type == hoxEVENT_UNKNOWN || type > hoxEVENT_MAX ) return hoxRC_NOT_VALID;
+
+    const char* p   = pData + 3;
+    const char* end = pData + nLength;
+
+    record.type     = (hoxEventType) type;
+    record.time     = (long long) _get64( p );  p += 8;
+    record.duration = _get32( p );              p += 4;
+    record.code     = (int) _get32( p );        p += 4;
+
+    if (    ! _getString( p, end, record.pid )
+         || ! _getString( p, end, record.pid2 )
+         || ! _getString( p, end, record.tid )
+         || ! _getString( p, end, record.text )
+         || p != end )
+    {
+        return hoxRC_NOT_VALID;
+    }
+
+    return hoxRC_OK;
+}
+
+// =========================================================================
+//
+//                        hoxEventLogReader
+//
+// =========================================================================
+
+hoxResult
+hoxEventLogReader::open( const std::string& sPath )
+{
+    close();
+
+    _fd = ::open( sPath.c_str(), O_RDONLY );
+    if ( _fd < 0 ) return hoxRC_NOT_FOUND;
+
+    /* A header cut short (by a crash) is read as an empty log. */
+    char header[EVENT_LOG_HEADER_SIZE];
+    const ssize_t n = ::read( _fd, header, sizeof(header) );
+    const std::string sHeader = _header();
+    if (    n < 0
+         || ::memcmp( header, sHeader.data(), std::min( (size_t) n, sizeof(header) ) ) != 0 )
+    {
+        close();
+        return hoxRC_NOT_VALID;
+    }
+
+    _offset = n;
+    return hoxRC_OK;
+}
+
+void
+hoxEventLogReader::close()
+{
+    if ( _fd >= 0 ) ::close( _fd );
+    _fd     = -1;
+    _offset = 0;
+    _start  = 0;
+    _buffer.clear();
+}
+
+hoxResult
+hoxEventLogReader::next( hoxEventRecord& record,
+                         long*           pOffset /* = NULL */ )
+{
+    if ( _fd < 0 ) return hoxRC_CLOSED;
+
+    size_t nNeeded = 2;
+    bool   bEOF    = false;
+
+    for (;;)
+    {
+        const size_t nAvail = _buffer.size() - _start;
+        if ( nAvail >= 2 )
+        {
+            const char* p = _buffer.data() + _start;
+            nNeeded = _get16( p );
+            if ( nNeeded < EVENT_MIN_SIZE ) break;  // Corrupted.
+            if ( nAvail >= nNeeded )
+            {
+                size_t nLength = 0;
+                if ( pOffset ) *pOffset = _offset + (long) _start;
+                if ( hoxRC_OK != hoxEventLog::decodeRecord( p, nAvail, record, nLength ) )
+                {
+                    return hoxRC_NOT_VALID;
+                }
+                _start += nLength;
+                return hoxRC_OK;
+            }
+        }
+
+        if ( bEOF )
+        {
+            if ( pOffset ) *pOffset = _offset + (long) _start;
+            return ( nAvail == 0 ? hoxRC_CLOSED : hoxRC_NOT_VALID );
+        }
+
+        /* Compact the buffer and read some more. */
+        _buffer.erase( 0, _start );
+        _offset += (long) _start;
+        _start = 0;
+
+        const size_t nOld  = _buffer.size();
+        const size_t nRead = std::max( (size_t) EVENT_READ_SIZE, nNeeded - nOld );
+        _buffer.resize( nOld + nRead );
+        const ssize_t n = ::read( _fd, &_buffer[nOld], nRead );
+        _buffer.resize( nOld + ( n > 0 ? n : 0 ) );
+        if ( n <= 0 ) bEOF = true;
+    }
+
+    if ( pOffset ) *pOffset = _offset + (long) _start;
+    return hoxRC_NOT_VALID;
+}
+
+/******************* END OF FILE *********************************************/
@@ -0,0 +1,192 @@
+//
+// C++ Interface: hoxEventLog
+//
+// Description: The append-only (binary) log of the server's events.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#ifndef __INCLUDED_HOX_EVENT_LOG_H__
+#define __INCLUDED_HOX_EVENT_LOG_H__
+
+#include <string>
+#include "hoxEnums.h"
+
+/**
+ * The types of events.
+ */
+enum hoxEventType
+{
+    hoxEVENT_UNKNOWN = 0,
+
+    hoxEVENT_SESSION_START,   // pid, pid2 = session, code = client type
+    hoxEVENT_SESSION_END,     // pid, pid2 = session, text = reason:
+                              //   "closed" (by its thread) or "purged"
+                              //   (by the manager, after a shutdown)
+    hoxEVENT_REQUEST,         // pid, pid2 = session, tid, text = request,
+                              //   duration, code = result
+    hoxEVENT_MOVE,            // pid, tid, text = move,
+                              //   duration = think time, code = game status
+    hoxEVENT_GAME_END,        // pid = red, pid2 = black, tid, text = reason,
+                              //   code = game status
+    hoxEVENT_DB_CALL,         // pid, text = request, duration, code = result
+
+    hoxEVENT_MAX = hoxEVENT_DB_CALL
+};
+
+/**
+ * An event, as stored in the log.
+ *
+ * All types share the same schema. On disk, a record is laid out
+ * (little-endian) as:
+ *
+ *    length(2) type(1) time(8) duration(4) code(4)
+ *    pid(1+n) pid2(1+n) tid(1+n) text(1+n)
+ *
+ * after the file's header "HXEV" version(2).
+ * The fields that do not apply to a type are empty (or zero).
+ */
+class hoxEventRecord
+{
+public:
+    hoxEventType   type;
+    long long      time;       // When (in microseconds since the Epoch).
+    unsigned int   duration;   // How long (in microseconds).
+    int            code;       // A result (hoxResult, hoxGameStatus).
+    std::string    pid;        // The Player.
+    std::string    pid2;       // The other Player (or the session).
+    std::string    tid;        // The Table.
+    std::string    text;
+
+    hoxEventRecord() : type( hoxEVENT_UNKNOWN ), time( 0 )
+                     , duration( 0 ), code( 0 ) {}
+};
+
+/**
+ * The event log of this process (VP).
+ * This class is implemented as a singleton.
+ *
+ * The records are appended to a memory buffer, which is written out
+ * by flush() (every few seconds, or when it grows large). A partial
+ * record left behind by a crash is dropped when the file is opened.
+ */
+class hoxEventLog
+{
+private:
+    static hoxEventLog* s_instance;  // The singleton instance.
+
+public:
+    static hoxEventLog* getInstance();
+
+public:
+    ~hoxEventLog() { close(); }
+
+    /**
+     * Open (or create) the log's file.
+     */
+    hoxResult open( const std::string& sPath );
+    void close();
+    bool isOpen() const { return _fd >= 0; }
+
+    /**
+     * Reopen the file (to be called after it was moved away for rotation).
+     */
+    hoxResult reopen();
+
+    /**
+     * Append an event, timed now, to the (buffered) log.
+     */
+    void log( const hoxEventType  type,
+              const std::string&  pid,
+              const std::string&  pid2,
+              const std::string&  tid,
+              const std::string&  text,
+              const long long     duration = 0,
+              const int           code = 0 );
+
+    /**
+     * Write out all buffered records.
+     */
+    hoxResult flush();
+
+    /* ---------- */
+    /* Static API */
+    /* ---------- */
+public:
+    /**
+     * The current time (in microseconds since the Epoch).
+     */
+    static long long now();
+
+    /**
+     * The name of a type (such as "REQUEST").
+     */
+    static const char* typeToString( const hoxEventType type );
+
+    /**
+     * Encode an event into its binary record (appended to the data).
+     */
+    static void encodeRecord( const hoxEventRecord& record,
+                              std::string&          sData );
+
+    /**
+     * Decode a binary record.
+     *
+     * @param pData The data starting at the record.
+     * @param nSize The number of bytes available.
+     * @param record [OUT] The decoded event.
+     * @param nLength [OUT] The length of the record.
+     */
+    static hoxResult decodeRecord( const char*     pData,
+                                   const size_t    nSize,
+                                   hoxEventRecord& record,
+                                   size_t&         nLength );
+
+private:
+    hoxEventLog() : _fd( -1 ) {}
+
+    hoxResult _openFile();
+
+private:
+    std::string   _path;
+    int           _fd;
+    std::string   _buffer;        // The pending records.
+};
+
+/**
+ * The streaming reader of an event log.
+ */
+class hoxEventLogReader
+{
+public:
+    hoxEventLogReader() : _fd( -1 ), _offset( 0 ), _start( 0 ) {}
+    ~hoxEventLogReader() { close(); }
+
+    /**
+     * @return hoxRC_NOT_VALID if the file is not an event log.
+     */
+    hoxResult open( const std::string& sPath );
+    void close();
+
+    /**
+     * Read the next event.
+     *
+     * @param record [OUT] The event read.
+     * @param pOffset [OUT] The offset of the event (optional).
+     *
+     * @return hoxRC_OK if an event is read, hoxRC_CLOSED at the end of the
+     *         file, or hoxRC_NOT_VALID if the file is corrupted.
+     */
+    hoxResult next( hoxEventRecord& record,
+                    long*           pOffset = NULL );
+
+private:
+    int           _fd;
+    long          _offset;        // The file offset of the buffer.
+    std::string   _buffer;        // The data read but not yet consumed.
+    size_t        _start;         // The first unconsumed byte of the buffer.
+};
+
+#endif /* __INCLUDED_HOX_EVENT_LOG_H__ */
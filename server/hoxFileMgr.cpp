@@ -109,7 +109,7 @@ void
 hoxFileMgr::clearCache()
 {
     const char* FNAME = "hoxFileMgr::clearCache";
-    hoxLog(LOG_INFO, "%s: ENTER. Cache-size = [%d]", FNAME, _files.size());
+    hoxLog(LOG_INFO, "%s: ENTER. Cache-size = [%d]", FNAME, (int) _files.size());
     _files.clear();
 }
 
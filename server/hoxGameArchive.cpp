@@ -0,0 +1,643 @@
+//
+// C++ Implementation: hoxGameArchive
+//
+// Description: The append-only archive of completed Games.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include "hoxGameArchive.h"
+
+/******************************************************************
+ * Constants
+ */
+
+#define ARCHIVE_MAGIC        0x5848   /* "HX" */
+#define ARCHIVE_FLUSH_SIZE   ( 64 * 1024 )
+        /* The amount of pending data that triggers a flush. */
+#define ARCHIVE_READ_SIZE    ( 64 * 1024 )
+#define ARCHIVE_HEADER_SIZE  6        /* magic + length */
+#define ARCHIVE_MAX_RECORD_SIZE  ( 1024 * 1024 )
+        /* No valid record (of a few thousand moves at most) gets near it. */
+
+/******************************************************************
+ * Encoding helpers
+ */
+
+namespace
+{
+    void _put8( std::string& s, unsigned int v )
+    {
+        s += (char) ( v & 0xFF );
+    }
+
+    void _put16( std::string& s, unsigned int v )
+    {
+        _put8( s, v );
+        _put8( s, v >> 8 );
+    }
+
+    void _put32( std::string& s, unsigned int v )
+    {
+        _put16( s, v & 0xFFFF );
+        _put16( s, v >> 16 );
+    }
+
+    void _set32( std::string& s, size_t pos, unsigned int v )
+    {
+        for ( int i = 0; i < 4; ++i, v >>= 8 ) s[pos + i] = (char) ( v & 0xFF );
+    }
+
+    unsigned int _get8( const char* p )
+    {
+        return (unsigned char) p[0];
+    }
+
+    unsigned int _get16( const char* p )
+    {
+        return _get8( p ) | ( _get8( p + 1 ) << 8 );
+    }
+
+    unsigned int _get32( const char* p )
+    {
+        return _get16( p ) | ( _get16( p + 2 ) << 16 );
+    }
+
+    void _putTime( std::string& s, const hoxTimeInfo& t )
+    {
+        _put32( s, t.nGame );
+        _put32( s, t.nMove );
+        _put32( s, t.nFree );
+    }
+
+    void _getTime( const char* p, hoxTimeInfo& t )
+    {
+        t.nGame = (int) _get32( p );
+        t.nMove = (int) _get32( p + 4 );
+        t.nFree = (int) _get32( p + 8 );
+    }
+
+    void _putString( std::string& s, const std::string& v )
+    {
+        const size_t n = std::min( v.size(), (size_t) 0xFF );
+        _put8( s, n );
+        s.append( v, 0, n );
+    }
+
+    /**
+     * Encode a Move ("xyXY") into 16 bits. Return 0xFFFF if invalid.
+     */
+    unsigned int _encodeMove( const std::string& sMove )
+    {
+        if ( sMove.size() != 4 ) return 0xFFFF;
+        const int x1 = sMove[0] - '0', y1 = sMove[1] - '0';
+        const int x2 = sMove[2] - '0', y2 = sMove[3] - '0';
+        if (   x1 < 0 || x1 > 8 || y1 < 0 || y1 > 9
+            || x2 < 0 || x2 > 8 || y2 < 0 || y2 > 9 )
+        {
+            return 0xFFFF;
+        }
+        return ( ( y1 * 9 + x1 ) << 7 ) | ( y2 * 9 + x2 );
+    }
+
+    /**
+     * Decode a Move. Return an empty (invalid) Move for 0xFFFF, or for
+     * any other value that is not on the board.
+     */
+    const std::string _decodeMove( unsigned int v )
+    {
+        const int from = ( v >> 7 ) & 0x7F;
+        const int to   = v & 0x7F;
+        if ( v == 0xFFFF || from >= 90 || to >= 90 ) return "";
+
+        char szMove[5];
+        szMove[0] = '0' + from % 9;
+        szMove[1] = '0' + from / 9;
+        szMove[2] = '0' + to % 9;
+        szMove[3] = '0' + to / 9;
+        szMove[4] = '\0';
+        return szMove;
+    }
+
+    /**
+     * Write the whole data to a file. Written bytes are removed from
+     * the data, so that a failed write can be resumed later.
+     */
+    hoxResult _writeAll( int fd, std::string& sData )
+    {
+        size_t nWritten = 0;
+        while ( nWritten < sData.size() )
+        {
+            const ssize_t n = ::write( fd, sData.data() + nWritten,
+                                       sData.size() - nWritten );
+            if ( n < 0 )
+            {
+                if ( errno == EINTR ) continue;
+                sData.erase( 0, nWritten );
+                return hoxRC_ERR;
+            }
+            nWritten += n;
+        }
+        sData.clear();
+        return hoxRC_OK;
+    }
+
+    const std::string _segmentName( int nVpIndex, int nSeq, const char* szExt )
+    {
+        char szName[64];
+        snprintf( szName, sizeof(szName), "games.%d.%06d.%s", nVpIndex, nSeq, szExt );
+        return szName;
+    }
+
+} // namespace
+
+// =========================================================================
+//
+//                        hoxGameArchive
+//
+// =========================================================================
+
+/* Define the static singleton instance. */
+hoxGameArchive* hoxGameArchive::s_instance = NULL;
+
+/*static*/
+hoxGameArchive*
+hoxGameArchive::getInstance()
+{
+    if ( hoxGameArchive::s_instance == NULL )
+    {
+        hoxGameArchive::s_instance = new hoxGameArchive();
+    }
+    return hoxGameArchive::s_instance;
+}
+
+hoxResult
+hoxGameArchive::open( const std::string& sLocation,
+                      const int          nVpIndex,
+                      const long         nSegmentSize )
+{
+    if (    isOpen()
+         && sLocation == _location && nVpIndex == _vpIndex )
+    {
+        _segmentSize = nSegmentSize;
+        return hoxRC_OK;  // Already opened.
+    }
+
+    close();
+
+    _location    = sLocation;
+    _vpIndex     = nVpIndex;
+    _segmentSize = nSegmentSize;
+
+    /* Continue with the last segment of this VP, if any. */
+    _seq = 0;
+    char szPrefix[32];
+    snprintf( szPrefix, sizeof(szPrefix), "games.%d.", nVpIndex );
+    const std::string sPrefix = szPrefix;
+    std::vector<std::string> segments;
+    getSegments( _location, segments );
+    for ( std::vector<std::string>::const_iterator it = segments.begin();
+                                                   it != segments.end(); ++it )
+    {
+        const std::string sName = it->substr( _location.size() );
+        if ( sName.compare( 0, sPrefix.size(), sPrefix ) == 0 )
+        {
+            _seq = std::max( _seq, ::atoi( sName.c_str() + sPrefix.size() ) );
+        }
+    }
+
+    return _openSegment();
+}
+
+void
+hoxGameArchive::close()
+{
+    if ( ! isOpen() ) return;
+
+    flush();
+    ::close( _fd );
+    ::close( _idxFd );
+    _fd = _idxFd = -1;
+    _fileSize = 0;
+    _buffer.clear();
+    _idxBuffer.clear();
+}
+
+hoxResult
+hoxGameArchive::appendGame( const hoxGameRecord& record )
+{
+    if ( ! isOpen() ) return hoxRC_NOT_ALLOWED;
+
+    std::string sData;
+    encodeRecord( record, sData );
+
+    /* Start a new segment if this record does not fit. */
+    const long nPending = _fileSize + (long) _buffer.size();
+    if ( nPending > 0 && nPending + (long) sData.size() > _segmentSize )
+    {
+        if ( hoxRC_OK != _rotateSegment() ) return hoxRC_ERR;
+    }
+
+    const long nOffset = _fileSize + (long) _buffer.size();
+    _buffer += sData;
+
+    char szOffset[32];
+    snprintf( szOffset, sizeof(szOffset), "\t%ld\n", nOffset );
+    _idxBuffer += record.redId + szOffset;
+    _idxBuffer += record.blackId + szOffset;
+
+    if ( _buffer.size() >= ARCHIVE_FLUSH_SIZE )
+    {
+        return flush();
+    }
+    return hoxRC_OK;
+}
+
+hoxResult
+hoxGameArchive::flush()
+{
+    if ( ! isOpen() ) return hoxRC_OK;
+
+    /* NOTE: The index is written only after the records so that
+     *       it never refers to data that is not on disk.
+     */
+    if ( ! _buffer.empty() )
+    {
+        const size_t nPending = _buffer.size();
+        const hoxResult result = _writeAll( _fd, _buffer );
+        _fileSize += (long) ( nPending - _buffer.size() );
+        if ( result != hoxRC_OK ) return result;
+    }
+
+    return _writeAll( _idxFd, _idxBuffer );
+}
+
+hoxResult
+hoxGameArchive::_openSegment()
+{
+    const std::string sData  = _location + _segmentName( _vpIndex, _seq, "dat" );
+    const std::string sIndex = _location + _segmentName( _vpIndex, _seq, "idx" );
+
+    /* Drop a partial record left behind by a crash: the invalid data
+     * at the end, if any. That followed by valid records is kept (and
+     * skipped by the readers).
+     */
+    long nValidSize = 0;
+    {
+        hoxGameArchiveReader reader;
+        hoxGameRecord        record;
+        long                 nOffset    = 0;
+        long                 nBadOffset = -1;  // Where the invalid tail starts.
+        if ( hoxRC_OK == reader.open( sData ) )
+        {
+            hoxResult result;
+            while ( hoxRC_CLOSED != ( result = reader.next( record, &nOffset ) ) )
+            {
+                nBadOffset = ( result == hoxRC_OK ? -1 : nOffset );
+            }
+            if ( nBadOffset >= 0 )
+            {
+                nValidSize = nBadOffset;
+                ::truncate( sData.c_str(), nValidSize );
+            }
+        }
+    }
+
+    _fd = ::open( sData.c_str(), O_CREAT | O_WRONLY | O_APPEND, 0644 );
+    if ( _fd < 0 ) return hoxRC_ERR;
+
+    _idxFd = ::open( sIndex.c_str(), O_CREAT | O_WRONLY | O_APPEND, 0644 );
+    if ( _idxFd < 0 )
+    {
+        ::close( _fd );
+        _fd = -1;
+        return hoxRC_ERR;
+    }
+
+    struct stat st;
+    _fileSize = ( ::fstat( _fd, &st ) == 0 ? st.st_size : nValidSize );
+    return hoxRC_OK;
+}
+
+hoxResult
+hoxGameArchive::_rotateSegment()
+{
+    if ( hoxRC_OK != flush() ) return hoxRC_ERR;
+
+    ::close( _fd );
+    ::close( _idxFd );
+    _fd = _idxFd = -1;
+
+    ++_seq;
+    return _openSegment();
+}
+
+/*static*/
+unsigned int
+hoxGameArchive::checksum( const char* pData,
+                          size_t      nSize )
+{
+    /* The FNV-1a hash. */
+    unsigned int h = 2166136261U;
+    for ( size_t i = 0; i < nSize; ++i )
+    {
+        h ^= (unsigned char) pData[i];
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/*static*/
+void
+hoxGameArchive::encodeRecord( const hoxGameRecord& record,
+                              std::string&         sData )
+{
+    sData.clear();
+    _put16( sData, ARCHIVE_MAGIC );
+    _put32( sData, 0 );  // The length (set below).
+    _put32( sData, (unsigned int) record.timestamp );
+    _put8( sData, (unsigned int) record.gameType );
+    _put8( sData, (unsigned int) record.status );
+    _putTime( sData, record.initialTime );
+    _putTime( sData, record.redTime );
+    _putTime( sData, record.blackTime );
+    _putString( sData, record.redId );
+    _put16( sData, record.redScore );
+    _putString( sData, record.blackId );
+    _put16( sData, record.blackScore );
+
+    _put16( sData, record.moves.size() );
+    for ( hoxStringList::const_iterator it = record.moves.begin();
+                                        it != record.moves.end(); ++it )
+    {
+        _put16( sData, _encodeMove( *it ) );
+    }
+
+    _set32( sData, 2, sData.size() + 4 );
+    _put32( sData, checksum( sData.data(), sData.size() ) );
+}
+
+/*static*/
+hoxResult
+hoxGameArchive::decodeRecord( const char*    pData,
+                              const size_t   nSize,
+                              hoxGameRecord& record,
+                              size_t&        nLength )
+{
+    if ( nSize < ARCHIVE_HEADER_SIZE ) return hoxRC_NOT_VALID;
+    if ( _get16( pData ) != ARCHIVE_MAGIC ) return hoxRC_NOT_VALID;
+
+    nLength = _get32( pData + 2 );
+    const size_t nFixed = ARCHIVE_HEADER_SIZE + 4 + 2 + 3 * 12;
+    if ( nLength < nFixed + 2 + 2 + 4 + 2 + 4 || nLength > nSize )
+    {
+        return hoxRC_NOT_VALID;
+    }
+    if ( checksum( pData, nLength - 4 ) != _get32( pData + nLength - 4 ) )
+    {
+        return hoxRC_NOT_VALID;
+    }
+
+    const char* p   = pData + ARCHIVE_HEADER_SIZE;
+    const char* end = pData + nLength - 4;
+
+    record.timestamp = (time_t) _get32( p );  p += 4;
+    record.gameType  = (hoxGameType) (signed char) _get8( p );    p += 1;
+    record.status    = (hoxGameStatus) (signed char) _get8( p );  p += 1;
+    _getTime( p, record.initialTime );  p += 12;
+    _getTime( p, record.redTime );      p += 12;
+    _getTime( p, record.blackTime );    p += 12;
+
+    size_t n = _get8( p++ );
+    if ( p + n + 2 + 1 > end ) return hoxRC_NOT_VALID;
+    record.redId.assign( p, n );  p += n;
+    record.redScore = (short) _get16( p );  p += 2;
+
+    n = _get8( p++ );
+    if ( p + n + 2 + 2 > end ) return hoxRC_NOT_VALID;
+    record.blackId.assign( p, n );  p += n;
+    record.blackScore = (short) _get16( p );  p += 2;
+
+    const size_t nMoves = _get16( p );  p += 2;
+    if ( p + 2 * nMoves != end ) return hoxRC_NOT_VALID;
+    record.moves.clear();
+    for ( size_t i = 0; i < nMoves; ++i, p += 2 )
+    {
+        record.moves.push_back( _decodeMove( _get16( p ) ) );
+    }
+
+    return hoxRC_OK;
+}
+
+/*static*/
+void
+hoxGameArchive::getSegments( const std::string&        sLocation,
+                             std::vector<std::string>& segments )
+{
+    segments.clear();
+
+    DIR* dir = ::opendir( sLocation.empty() ? "." : sLocation.c_str() );
+    if ( dir == NULL ) return;
+
+    struct dirent* entry = NULL;
+    while ( ( entry = ::readdir( dir ) ) != NULL )
+    {
+        const std::string sName = entry->d_name;
+        if (    sName.compare( 0, 6, "games." ) == 0
+             && sName.size() > 4
+             && sName.compare( sName.size() - 4, 4, ".dat" ) == 0 )
+        {
+            segments.push_back( sLocation + sName );
+        }
+    }
+    ::closedir( dir );
+
+    std::sort( segments.begin(), segments.end() );
+}
+
+/*static*/
+hoxResult
+hoxGameArchive::findGames( const std::string&   sLocation,
+                           const std::string&   playerId,
+                           hoxGameLocationList& locations )
+{
+    locations.clear();
+
+    std::vector<std::string> segments;
+    getSegments( sLocation, segments );
+
+    for ( std::vector<std::string>::const_iterator it = segments.begin();
+                                                   it != segments.end(); ++it )
+    {
+        const std::string sIndex = it->substr( 0, it->size() - 3 ) + "idx";
+        FILE* fp = ::fopen( sIndex.c_str(), "r" );
+        if ( fp == NULL ) continue;
+
+        char szLine[512];
+        while ( ::fgets( szLine, sizeof(szLine), fp ) != NULL )
+        {
+            char* pTab = ::strchr( szLine, '\t' );
+            if ( pTab == NULL ) continue;
+            *pTab = '\0';
+            if ( playerId == szLine )
+            {
+                locations.push_back( hoxGameLocation( *it, ::atol( pTab + 1 ) ) );
+            }
+        }
+        ::fclose( fp );
+    }
+
+    return hoxRC_OK;
+}
+
+/*static*/
+hoxResult
+hoxGameArchive::readGame( const hoxGameLocation& location,
+                          hoxGameRecord&         record )
+{
+    const int fd = ::open( location.segment.c_str(), O_RDONLY );
+    if ( fd < 0 ) return hoxRC_NOT_FOUND;
+
+    hoxResult   result = hoxRC_NOT_VALID;
+    char        header[ARCHIVE_HEADER_SIZE];
+    struct stat st;
+
+    if (    ::fstat( fd, &st ) == 0
+         && ::pread( fd, header, sizeof(header), location.offset ) == (ssize_t) sizeof(header)
+         && _get16( header ) == ARCHIVE_MAGIC )
+    {
+        /* Check the length (from the file) before allocating it. */
+        const size_t nRecord = _get32( header + 2 );
+        if (    nRecord < sizeof(header)
+             || nRecord > ARCHIVE_MAX_RECORD_SIZE
+             || (off_t) nRecord > st.st_size - (off_t) location.offset )
+        {
+            ::close( fd );
+            return hoxRC_ERR;
+        }
+
+        std::string sData( nRecord, '\0' );
+        size_t      nLength = 0;
+        if ( ::pread( fd, &sData[0], sData.size(), location.offset ) == (ssize_t) sData.size() )
+        {
+            result = decodeRecord( sData.data(), sData.size(), record, nLength );
+        }
+    }
+
+    ::close( fd );
+    return result;
+}
+
+// =========================================================================
+//
+//                        hoxGameArchiveReader
+//
+// =========================================================================
+
+hoxResult
+hoxGameArchiveReader::open( const std::string& sSegment )
+{
+    close();
+
+    _fd = ::open( sSegment.c_str(), O_RDONLY );
+    if ( _fd < 0 ) return hoxRC_NOT_FOUND;
+
+    _offset = 0;
+    return hoxRC_OK;
+}
+
+void
+hoxGameArchiveReader::close()
+{
+    if ( _fd >= 0 ) ::close( _fd );
+    _fd     = -1;
+    _offset = 0;
+    _start  = 0;
+    _buffer.clear();
+    _bSkipping = false;
+}
+
+hoxResult
+hoxGameArchiveReader::next( hoxGameRecord& record,
+                            long*          pOffset /* = NULL */ )
+{
+    if ( _fd < 0 ) return hoxRC_CLOSED;
+
+    size_t nNeeded = ARCHIVE_HEADER_SIZE;
+    bool   bEOF    = false;
+
+    for (;;)
+    {
+        const size_t nAvail = _buffer.size() - _start;
+        bool         bValid = true;  // May a record start here?
+
+        if ( nAvail >= ARCHIVE_HEADER_SIZE )
+        {
+            const char* p = _buffer.data() + _start;
+            nNeeded = _get32( p + 2 );
+            bValid  = (    _get16( p ) == ARCHIVE_MAGIC
+                        && nNeeded >= ARCHIVE_HEADER_SIZE
+                        && nNeeded <= ARCHIVE_MAX_RECORD_SIZE );
+            if ( bValid && nAvail >= nNeeded )
+            {
+                size_t nLength = 0;
+                if ( hoxRC_OK == hoxGameArchive::decodeRecord( p, nAvail, record, nLength ) )
+                {
+                    if ( pOffset ) *pOffset = _offset + (long) _start;
+                    _start += nLength;
+                    _bSkipping = false;
+                    return hoxRC_OK;
+                }
+                bValid = false;
+            }
+        }
+        if ( bEOF && nAvail > 0 ) bValid = false;  // A record cut short.
+
+        if ( ! bValid )
+        {
+            /* Report it once, then look for a record a byte further. */
+            const long nBadOffset = _offset + (long) _start;
+            ++_start;
+            nNeeded = ARCHIVE_HEADER_SIZE;
+            if ( ! _bSkipping )
+            {
+                _bSkipping = true;
+                if ( pOffset ) *pOffset = nBadOffset;
+                return hoxRC_NOT_VALID;
+            }
+            continue;
+        }
+
+        if ( bEOF )
+        {
+            if ( pOffset ) *pOffset = _offset + (long) _start;
+            return hoxRC_CLOSED;
+        }
+
+        /* Compact the buffer and read some more. */
+        _buffer.erase( 0, _start );
+        _offset += (long) _start;
+        _start = 0;
+
+        const size_t nOld  = _buffer.size();
+        const size_t nRead = std::max( (size_t) ARCHIVE_READ_SIZE, nNeeded - nOld );
+        _buffer.resize( nOld + nRead );
+        const ssize_t n = ::read( _fd, &_buffer[nOld], nRead );
+        _buffer.resize( nOld + ( n > 0 ? n : 0 ) );
+        if ( n <= 0 ) bEOF = true;
+    }
+}
+
+/******************* END OF FILE *********************************************/
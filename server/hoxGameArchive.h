@@ -0,0 +1,219 @@
+//
+// C++ Interface: hoxGameArchive
+//
+// Description: The append-only archive of completed Games.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#ifndef __INCLUDED_HOX_GAME_ARCHIVE_H__
+#define __INCLUDED_HOX_GAME_ARCHIVE_H__
+
+#include <string>
+#include <list>
+#include <vector>
+#include "hoxTypes.h"
+
+/**
+ * A completed Game as stored in the archive.
+ *
+ * On disk, a record is laid out (little-endian) as:
+ *
+ *    magic(2) length(4) timestamp(4) type(1) status(1)
+ *    itimes(3x4) redtime(3x4) blacktime(3x4)
+ *    redId(1+n) redScore(2) blackId(1+n) blackScore(2)
+ *    nMoves(2) moves(nMoves x 2) checksum(4)
+ *
+ * where each Move is encoded in 16 bits as (from << 7 | to),
+ * with a square being (y * 9 + x).
+ */
+class hoxGameRecord
+{
+public:
+    time_t          timestamp;    // When the Game ended.
+    hoxGameType     gameType;
+    hoxGameStatus   status;       // The result.
+    hoxTimeInfo     initialTime;
+    hoxTimeInfo     redTime;      // The remaining clocks (in milliseconds).
+    hoxTimeInfo     blackTime;
+    std::string     redId;
+    int             redScore;
+    std::string     blackId;
+    int             blackScore;
+    hoxStringList   moves;        // Moves in the "xyXY" format.
+
+    hoxGameRecord() : timestamp( 0 )
+                    , gameType( hoxGAME_TYPE_UNKNOWN )
+                    , status( hoxGAME_STATUS_UNKNOWN )
+                    , redScore( 0 ), blackScore( 0 ) {}
+};
+
+/**
+ * The location of a record in the archive.
+ */
+class hoxGameLocation
+{
+public:
+    std::string  segment;   // The path of the segment file.
+    long         offset;    // The offset of the record within the segment.
+
+    hoxGameLocation( const std::string& s = "", long o = 0 )
+        : segment( s ), offset( o ) {}
+};
+typedef std::list<hoxGameLocation> hoxGameLocationList;
+
+/**
+ * The (writer of the) Game archive of this process (VP).
+ * This class is implemented as a singleton.
+ *
+ * Records are appended to a memory buffer, which is written out
+ * sequentially by flush(). Each segment "games.<vp>.<seq>.dat" is
+ * accompanied by a sidecar index "games.<vp>.<seq>.idx" of lines
+ * "<player-id>\t<offset>", one per player of each record.
+ */
+class hoxGameArchive
+{
+private:
+    static hoxGameArchive* s_instance;  // The singleton instance.
+
+public:
+    static hoxGameArchive* getInstance();
+
+public:
+    ~hoxGameArchive() { close(); }
+
+    /**
+     * Open (or re-open) the archive.
+     *
+     * @param sLocation The directory of the segments (ending with '/').
+     * @param nVpIndex The index of this process (VP).
+     * @param nSegmentSize The size after which a new segment is started.
+     */
+    hoxResult open( const std::string& sLocation,
+                    const int          nVpIndex,
+                    const long         nSegmentSize );
+    void close();
+    bool isOpen() const { return _fd >= 0; }
+
+    /**
+     * Append a Game to the (buffered) archive.
+     */
+    hoxResult appendGame( const hoxGameRecord& record );
+
+    /**
+     * Write out all buffered records and index entries.
+     */
+    hoxResult flush();
+
+    /* ---------- */
+    /* Static API */
+    /* ---------- */
+public:
+    /**
+     * Compute the checksum of a given data.
+     */
+    static unsigned int checksum( const char* pData,
+                                  size_t      nSize );
+
+    /**
+     * Encode a Game into its binary record.
+     */
+    static void encodeRecord( const hoxGameRecord& record,
+                              std::string&         sData );
+
+    /**
+     * Decode a binary record.
+     *
+     * @param pData The data starting at the record.
+     * @param nSize The number of bytes available.
+     * @param record [OUT] The decoded Game.
+     * @param nLength [OUT] The length of the record.
+     */
+    static hoxResult decodeRecord( const char*    pData,
+                                   const size_t   nSize,
+                                   hoxGameRecord& record,
+                                   size_t&        nLength );
+
+    /**
+     * Get the (sorted) list of segments in a given directory.
+     */
+    static void getSegments( const std::string&        sLocation,
+                             std::vector<std::string>& segments );
+
+    /**
+     * Look up the Games of a given player using the sidecar indexes.
+     */
+    static hoxResult findGames( const std::string&   sLocation,
+                                const std::string&   playerId,
+                                hoxGameLocationList& locations );
+
+    /**
+     * Read a single Game at a given location.
+     *
+     * @return hoxRC_ERR if the record's length is impossible (larger
+     *         than a record can be, or than the rest of the segment).
+     */
+    static hoxResult readGame( const hoxGameLocation& location,
+                               hoxGameRecord&         record );
+
+private:
+    hoxGameArchive() : _vpIndex( 0 ), _segmentSize( 0 ), _seq( 0 )
+                     , _fd( -1 ), _idxFd( -1 ), _fileSize( 0 ) {}
+
+    hoxResult _openSegment();
+    hoxResult _rotateSegment();
+
+private:
+    std::string   _location;
+    int           _vpIndex;
+    long          _segmentSize;   // The rotation threshold.
+
+    int           _seq;           // The sequence number of the segment.
+    int           _fd;            // The current segment.
+    int           _idxFd;         // The sidecar index of the segment.
+    long          _fileSize;      // The size of the segment on disk.
+
+    std::string   _buffer;        // The pending records.
+    std::string   _idxBuffer;     // The pending index entries.
+};
+
+/**
+ * The streaming reader of an archive segment.
+ */
+class hoxGameArchiveReader
+{
+public:
+    hoxGameArchiveReader() : _fd( -1 ), _offset( 0 ), _start( 0 )
+                           , _bSkipping( false ) {}
+    ~hoxGameArchiveReader() { close(); }
+
+    hoxResult open( const std::string& sSegment );
+    void close();
+
+    /**
+     * Read the next Game.
+     *
+     * Invalid data is reported once, then skipped up to the next valid
+     * record (if any) by the following calls.
+     *
+     * @param record [OUT] The Game read.
+     * @param pOffset [OUT] The offset of the Game, or of the invalid
+     *                data (optional).
+     *
+     * @return hoxRC_OK if a Game is read, hoxRC_CLOSED at the end of the
+     *         segment, or hoxRC_NOT_VALID if invalid data starts here.
+     */
+    hoxResult next( hoxGameRecord& record,
+                    long*          pOffset = NULL );
+
+private:
+    int           _fd;
+    long          _offset;        // The file offset of the buffer.
+    std::string   _buffer;        // The data read but not yet consumed.
+    size_t        _start;         // The first unconsumed byte of the buffer.
+    bool          _bSkipping;     // Looking for a record after invalid data?
+};
+
+#endif /* __INCLUDED_HOX_GAME_ARCHIVE_H__ */
@@ -49,6 +49,7 @@
 #include "hoxLog.h"
 #include "main.h"
 #include "hoxDbClient.h"
+#include "hoxLogWriter.h"
 
 /* Defined in main.cpp */
 extern hoxGlobalConfig g_config;
@@ -188,7 +189,7 @@ static void err_doit( int fd, int errnoflag, const char *fmt, va_list ap )
 }
 
 void
-hoxLog(enum hoxLogLevel level, const char *fmt, ...)
+hoxLogMsg(enum hoxLogLevel level, const char *fmt, ...)
 {
     static const char* levels[] = { "FATAL", "SYS_FATAL",
                                     "ERROR", "SYS_ERROR",
@@ -197,9 +198,6 @@ hoxLog(enum hoxLogLevel level, const char *fmt, ...)
                                     "DEBUG"
                                   };
 
-    if ( level > g_config.minLogLevel )
-        return;
-
     int errno_save;
     char buf[MAXLINE];
     const size_t nMax = sizeof(buf);
@@ -227,11 +225,18 @@ hoxLog(enum hoxLogLevel level, const char *fmt, ...)
     }
     sOut.append("\n");
 
-    // ----
-    s_logMessages.push_back( sOut );
-    //int fd = g_errfd;     // TODO: Defined in main.cpp
-    //write( fd, sOut.data(), sOut.size() );
-    // ----
+    /* To the local file (dropped if its buffer is full), and to the
+     * DB Agent if asked. Those logged before the file is open are kept
+     * to be written there later.
+     */
+    if ( hoxLogWriter::is_running() )
+    {
+        (void) hoxLogWriter::write( sOut );
+    }
+    if ( ! hoxLogWriter::is_running() || g_config.logToDbAgent )
+    {
+        s_logMessages.push_back( sOut );
+    }
     errno = errno_save;
 }
 
@@ -248,7 +253,14 @@ hoxFlushPendingLogMsgs()
     }
     s_logMessages.clear();
 
-    (void) hoxDbClient::log_msg( sOut );
+    if ( g_config.logToDbAgent || ! hoxLogWriter::is_running() )
+    {
+        (void) hoxDbClient::log_msg( sOut );
+    }
+    else  /* Those logged before the local file was open. */
+    {
+        (void) hoxLogWriter::write( sOut );
+    }
 }
 
 /******************* END OF FILE *********************************************/
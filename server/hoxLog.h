@@ -40,11 +40,48 @@ enum hoxLogLevel
     LOG_MAX        = LOG_DEBUG // END ---
 };
 
+/**
+ * The highest level compiled in. The calls above it are removed, with
+ * their arguments (e.g. -DHOX_LOG_COMPILED_LEVEL=LOG_INFO for a release
+ * build without the DEBUG messages).
+ */
+#ifndef HOX_LOG_COMPILED_LEVEL
+#define HOX_LOG_COMPILED_LEVEL  LOG_MAX
+#endif
+
+/**
+ * Log a message if its level is enabled (see g_config.minLogLevel).
+ *
+ * NOTE: The level is checked before the arguments are evaluated, so
+ *       that a disabled message costs no formatting nor string building.
+ *       Thus, the arguments must not have side effects.
+ */
+#define hoxLog(level, ...)                                        \
+    do {                                                          \
+        if (    (level) <= HOX_LOG_COMPILED_LEVEL                 \
+             && (level) <= g_config.minLogLevel )                 \
+        {                                                         \
+            hoxLogMsg( (level), __VA_ARGS__ );                    \
+        }                                                         \
+    } while (0)
+
+/**
+ * Log a message (whatever its level). Use hoxLog() instead.
+ */
 void
-hoxLog(enum hoxLogLevel level, const char *fmt, ...);
+hoxLogMsg(enum hoxLogLevel level, const char *fmt, ...)
+#ifdef __GNUC__
+    __attribute__(( format( printf, 2, 3 ) ))
+#endif
+    ;
 
 void
 hoxFlushPendingLogMsgs();
 
 
+/* The global configuration (with the level enabled), after the levels
+ * since it refers to them.
+ */
+#include "main.h"
+
 #endif /* __INCLUDED_HOX_LOG_H__ */
@@ -0,0 +1,282 @@
+//
+// C++ Implementation: hoxLogWriter
+//
+// Description: The writer of the log messages to a local file.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "hoxLogWriter.h"
+#include "hoxLog.h"
+
+/******************************************************************
+ * Constants
+ */
+
+#define LOG_WRITER_INTERVAL  20000   /* Microseconds between two writes,
+                                      * for the messages to pile up. */
+
+/******************************************************************
+ * The ring
+ */
+
+namespace
+{
+    /* NOTE: The positions only grow; each is taken modulo the size.
+     *       Each is changed by one side only, after a full barrier,
+     *       so that the other side sees the data before the position.
+     *       The writing thread does not use any State Threads' call
+     *       (nor hoxLog).
+     */
+    char*              s_data = NULL;
+    size_t             s_size = 0;
+    volatile uint64_t  s_writePos = 0;   // Moved by the VP's threads.
+    volatile uint64_t  s_readPos  = 0;   // Moved by the writing thread.
+    volatile unsigned  s_nDropped = 0;   // Moved by the VP's threads.
+    volatile int       s_bReopen  = 0;
+    volatile int       s_bStop    = 0;
+
+    std::string        s_path;
+    int                s_fd = -1;        // Used by the writing thread only.
+    pthread_t          s_thread;
+    bool               s_bRunning = false;
+
+    /**
+     * Write the whole data to the file, giving up on an error
+     * (the messages are lost rather than piled up).
+     */
+    void
+    _write_all( const char* data, size_t nBytes )
+    {
+        while ( nBytes > 0 )
+        {
+            const ssize_t n = ::write( s_fd, data, nBytes );
+            if ( n < 0 )
+            {
+                if ( errno == EINTR ) continue;
+                return;
+            }
+            data   += n;
+            nBytes -= n;
+        }
+    }
+
+    /**
+     * Write a note of the writer itself, time-stamped as hoxLog does.
+     */
+    void
+    _write_note( const char* szNote )
+    {
+        static const char* months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+                                      };
+        const time_t now = ::time( NULL );
+        struct tm    tmNow;
+        ::localtime_r( &now, &tmNow );
+
+        char buf[256];
+        const int n = snprintf( buf, sizeof(buf), "[%02d/%s/%d:%02d:%02d:%02d] WARN: %s\n",
+                                tmNow.tm_mday, months[tmNow.tm_mon], 1900 + tmNow.tm_year,
+                                tmNow.tm_hour, tmNow.tm_min, tmNow.tm_sec, szNote );
+        _write_all( buf, std::min( n, (int) sizeof(buf) - 1 ) );
+    }
+
+    int
+    _open_file( const std::string& sPath )
+    {
+        return ::open( sPath.c_str(), O_CREAT | O_WRONLY | O_APPEND, 0644 );
+    }
+
+    /**
+     * Move the messages from the ring to the file.
+     *
+     * @return The number of bytes moved.
+     */
+    size_t
+    _write_ring()
+    {
+        const uint64_t writePos = s_writePos;
+        __sync_synchronize();
+        const uint64_t readPos  = s_readPos;
+
+        if ( writePos == readPos ) return 0;
+
+        /* At most two writes: up to the end of the data, then from its start. */
+        const size_t nBytes  = writePos - readPos;
+        const size_t nOffset = readPos % s_size;
+        const size_t nFirst  = std::min( nBytes, s_size - nOffset );
+        _write_all( s_data + nOffset, nFirst );
+        _write_all( s_data, nBytes - nFirst );
+
+        __sync_synchronize();
+        s_readPos = writePos;
+        return nBytes;
+    }
+
+    /**
+     * The "main" function of the writing thread.
+     */
+    void*
+    _writer_thread( void* /* arg */ )
+    {
+        unsigned nReported = 0;  // The messages dropped and reported.
+
+        for (;;)
+        {
+            if ( s_bReopen )
+            {
+                s_bReopen = 0;
+                const int fd = _open_file( s_path );
+                if ( fd < 0 )
+                {
+                    _write_note( "hoxLogWriter: Failed to reopen the file. Keep the old one." );
+                }
+                else
+                {
+                    ::close( s_fd );
+                    s_fd = fd;
+                }
+            }
+
+            const bool bStop = s_bStop;
+            __sync_synchronize();
+            const size_t nWritten = _write_ring();
+
+            const unsigned nDropped = s_nDropped;
+            if ( nDropped != nReported )
+            {
+                char szNote[128];
+                snprintf( szNote, sizeof(szNote),
+                          "hoxLogWriter: Dropped [%u] messages (the buffer was full).",
+                          nDropped - nReported );
+                _write_note( szNote );
+                nReported = nDropped;
+            }
+
+            if ( bStop ) break;
+
+            /* Wait for more, unless the ring is already half full. */
+            if ( nWritten < s_size / 2 )
+            {
+                ::usleep( LOG_WRITER_INTERVAL );
+            }
+        }
+
+        return NULL;
+    }
+
+} // END of private namespace
+
+/******************************************************************
+ * The API
+ */
+
+hoxResult
+hoxLogWriter::start( const std::string& sPath,
+                     size_t             nSize )
+{
+    const char* FNAME = "hoxLogWriter::start";
+
+    if ( s_bRunning && sPath == s_path )
+    {
+        return hoxRC_OK;  // Already started.
+    }
+
+    stop();
+
+    const int fd = _open_file( sPath );
+    if ( fd < 0 )
+    {
+        hoxLog(LOG_SYS_ERROR, "%s: Failed to open [%s]", FNAME, sPath.c_str());
+        return hoxRC_ERR;
+    }
+
+    delete [] s_data;
+    s_data     = new char[nSize];
+    s_size     = nSize;
+    s_writePos = s_readPos = 0;
+    s_nDropped = 0;
+    s_bReopen  = s_bStop = 0;
+    s_path     = sPath;
+    s_fd       = fd;
+
+    if ( 0 != pthread_create( &s_thread, NULL, _writer_thread, NULL ) )
+    {
+        hoxLog(LOG_SYS_ERROR, "%s: Failed to start the writing thread", FNAME);
+        ::close( s_fd );
+        s_fd = -1;
+        return hoxRC_ERR;
+    }
+    s_bRunning = true;
+
+    hoxLog(LOG_INFO, "%s: Log to [%s] with a buffer of [%lu] bytes.",
+        FNAME, sPath.c_str(), (unsigned long) nSize);
+    return hoxRC_OK;
+}
+
+void
+hoxLogWriter::stop()
+{
+    if ( ! s_bRunning ) return;
+
+    __sync_synchronize();
+    s_bStop = 1;
+    pthread_join( s_thread, NULL );
+    s_bRunning = false;
+
+    ::close( s_fd );
+    s_fd = -1;
+}
+
+bool
+hoxLogWriter::is_running()
+{
+    return s_bRunning;
+}
+
+void
+hoxLogWriter::reopen()
+{
+    s_bReopen = 1;
+}
+
+hoxResult
+hoxLogWriter::write( const std::string& sMsg )
+{
+    if ( ! s_bRunning ) return hoxRC_ERR;
+
+    const uint64_t writePos = s_writePos;
+    const uint64_t readPos  = s_readPos;
+    __sync_synchronize();
+
+    const size_t nBytes = sMsg.size();
+    if ( writePos - readPos + nBytes > s_size )
+    {
+        ++s_nDropped;
+        return hoxRC_ERR;
+    }
+
+    const size_t nOffset = writePos % s_size;
+    const size_t nFirst  = std::min( nBytes, s_size - nOffset );
+    memcpy( s_data + nOffset, sMsg.data(), nFirst );
+    memcpy( s_data, sMsg.data() + nFirst, nBytes - nFirst );
+
+    __sync_synchronize();
+    s_writePos = writePos + nBytes;
+    return hoxRC_OK;
+}
+
+/******************* END OF FILE *********************************************/
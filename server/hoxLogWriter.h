@@ -0,0 +1,64 @@
+//
+// C++ Interface: hoxLogWriter
+//
+// Description: The writer of the log messages to a local file.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#ifndef __INCLUDED_HOX_LOG_WRITER_H__
+#define __INCLUDED_HOX_LOG_WRITER_H__
+
+#include <string>
+#include "hoxEnums.h"
+
+/**
+ * Each process (VP) appends its log messages to its own file.
+ *
+ * The messages are put in a ring in memory, with no lock (the VP's
+ * threads are the only writer, the writing thread the only reader).
+ * A dedicated (system) thread moves them to the file in large writes,
+ * so that neither the State Threads nor the DB calls wait for the disk.
+ *
+ * A message is never waited for: if the ring is full, it is dropped
+ * (and the number of those dropped is logged later).
+ */
+namespace hoxLogWriter
+{
+    /**
+     * Open (or create) the file, and start the writing thread.
+     *
+     * @param sPath The path of the file.
+     * @param nSize The size of the ring, in bytes.
+     */
+    hoxResult start( const std::string& sPath,
+                     size_t             nSize );
+
+    /**
+     * Write out the messages left, then stop the writing thread.
+     */
+    void stop();
+
+    /**
+     * Is the writing thread running?
+     */
+    bool is_running();
+
+    /**
+     * Reopen the file (to be called after it was moved away for rotation).
+     * Done by the writing thread, before it writes again.
+     */
+    void reopen();
+
+    /**
+     * Put a message (one or more lines) in the ring.
+     *
+     * @return hoxRC_ERR if the writer is not running or has no room for it.
+     */
+    hoxResult write( const std::string& sMsg );
+
+} /* namespace hoxLogWriter */
+
+#endif /* __INCLUDED_HOX_LOG_WRITER_H__ */
@@ -0,0 +1,450 @@
+//
+// C++ Implementation: hoxOutbox
+//
+// Description: The local outbox of the writes to the Database.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include "hoxOutbox.h"
+#include "hoxUtil.h"
+#include "hoxLog.h"
+
+/******************************************************************
+ * Constants
+ */
+
+#define OUTBOX_COMPACT_SIZE  ( 1024 * 1024 )
+        /* Start the file anew once all is acknowledged and it is this big. */
+
+/******************************************************************
+ * Helpers
+ */
+
+namespace
+{
+    /**
+     * Write the whole data to a file. Written bytes are removed from
+     * the data, so that a failed write can be resumed later.
+     */
+    hoxResult _writeAll( int fd, std::string& sData )
+    {
+        size_t nWritten = 0;
+        while ( nWritten < sData.size() )
+        {
+            const ssize_t n = ::write( fd, sData.data() + nWritten,
+                                       sData.size() - nWritten );
+            if ( n < 0 )
+            {
+                if ( errno == EINTR ) continue;
+                sData.erase( 0, nWritten );
+                return hoxRC_ERR;
+            }
+            nWritten += n;
+        }
+        sData.clear();
+        return hoxRC_OK;
+    }
+
+    /**
+     * Read a whole file.
+     */
+    hoxResult _readAll( int fd, std::string& sData )
+    {
+        char buf[8192];
+        for (;;)
+        {
+            const ssize_t n = ::read( fd, buf, sizeof(buf) );
+            if ( n == 0 ) return hoxRC_OK;
+            if ( n < 0 )
+            {
+                if ( errno == EINTR ) continue;
+                return hoxRC_ERR;
+            }
+            sData.append( buf, n );
+        }
+    }
+
+    /**
+     * The "main" function of the syncing thread: sync each fd read from
+     * the first pipe, and write the result (0 or errno) to the second,
+     * until the first one is closed. It does not use any State Threads'
+     * call (nor hoxLog).
+     */
+    void* _sync_thread( void* arg )
+    {
+        const int* fds = (const int*) arg;  // { in, out }, owned.
+        int        fd  = -1;
+
+        for (;;)
+        {
+            const ssize_t n = ::read( fds[0], &fd, sizeof(fd) );
+            if ( n < 0 && errno == EINTR ) continue;
+            if ( n != (ssize_t) sizeof(fd) ) break;  // Closed.
+
+            int nError = 0;
+            while ( ::fdatasync( fd ) < 0 )
+            {
+                if ( errno != EINTR ) { nError = errno; break; }
+            }
+            while (    ::write( fds[1], &nError, sizeof(nError) ) < 0
+                    && errno == EINTR ) {}
+        }
+
+        delete [] fds;
+        return NULL;
+    }
+
+    /**
+     * Generate the Id of a new source, unique enough across the hosts
+     * and processes writing to the same Database.
+     */
+    const std::string _newSource()
+    {
+        char szHost[64] = "";
+        ::gethostname( szHost, sizeof(szHost) - 1 );
+        return std::string( szHost ) + "."
+             + hoxUtil::intToString( ::getpid() ) + "."
+             + hoxUtil::intToString( hoxUtil::generateRandomNumber( 1000000000 ) );
+    }
+
+} // END of private namespace
+
+/******************************************************************
+ * hoxOutbox
+ */
+
+hoxOutbox::hoxOutbox()
+        : _fd( -1 ), _fileSize( 0 )
+        , _nextSeq( 1 ), _ackedSeq( 0 )
+        , _bSyncThread( false ), _syncResult( NULL ), _syncMutex( NULL )
+{
+    _syncIn[0]  = _syncIn[1]  = -1;
+    _syncOut[0] = _syncOut[1] = -1;
+    _source = _newSource();  // ... until a file is open.
+}
+
+hoxResult
+hoxOutbox::open( const std::string& sPath )
+{
+    const char* FNAME = "hoxOutbox::open";
+
+    if ( isOpen() && sPath == _path )
+    {
+        return hoxRC_OK;  // Already opened.
+    }
+
+    close();
+
+    const int fd = ::open( sPath.c_str(), O_CREAT | O_RDWR | O_APPEND, 0644 );
+    if ( fd < 0 )
+    {
+        hoxLog(LOG_SYS_ERROR, "%s: Failed to open [%s]", FNAME, sPath.c_str());
+        return hoxRC_ERR;
+    }
+
+    std::string sContent;
+    if ( hoxRC_OK != _readAll( fd, sContent ) )
+    {
+        hoxLog(LOG_SYS_ERROR, "%s: Failed to read [%s]", FNAME, sPath.c_str());
+        ::close( fd );
+        return hoxRC_ERR;
+    }
+
+    /* Load the records not yet acknowledged. A line cut short by a crash
+     * (the last one, with no '\n') is dropped.
+     */
+    hoxOutboxRecordList records;
+    std::string         sSource;
+    long long           ackedSeq = 0;
+    long long           lastSeq  = 0;
+    size_t              nStart   = 0;
+
+    for (;;)
+    {
+        const std::string::size_type nEnd = sContent.find( '\n', nStart );
+        if ( nEnd == std::string::npos ) break;
+
+        const std::string sLine = sContent.substr( nStart, nEnd - nStart );
+        nStart = nEnd + 1;
+
+        if ( sLine.compare( 0, 2, "S " ) == 0 )
+        {
+            sSource = sLine.substr( 2 );
+        }
+        else if ( sLine.compare( 0, 2, "A " ) == 0 )
+        {
+            ackedSeq = ::atoll( sLine.c_str() + 2 );
+            while ( ! records.empty() && records.front().seq <= ackedSeq )
+            {
+                records.pop_front();
+            }
+        }
+        else
+        {
+            /* "<seq> <type> <data>" */
+            const std::string::size_type nSpace = sLine.find( ' ' );
+            if ( nSpace == std::string::npos || nSpace + 2 >= sLine.size() )
+            {
+                hoxLog(LOG_WARN, "%s: Skip the invalid line [%s].", FNAME, sLine.c_str());
+                continue;
+            }
+            const long long seq = ::atoll( sLine.c_str() );
+            records.push_back( hoxOutboxRecord( seq, sLine[nSpace + 1],
+                                                sLine.substr( nSpace + 3 ) ) );
+            lastSeq = std::max( lastSeq, seq );
+        }
+    }
+
+    if ( nStart < sContent.size() )
+    {
+        hoxLog(LOG_WARN, "%s: Drop the incomplete last line of [%s].", FNAME, sPath.c_str());
+        if ( ::ftruncate( fd, nStart ) < 0 )
+        {
+            hoxLog(LOG_SYS_ERROR, "%s: Failed to truncate [%s]", FNAME, sPath.c_str());
+            ::close( fd );
+            return hoxRC_ERR;
+        }
+    }
+
+    _path     = sPath;
+    _fd       = fd;
+    _fileSize = nStart;
+
+    if ( hoxRC_OK != _startSyncThread() )
+    {
+        hoxLog(LOG_WARN, "%s: Sync [%s] without a thread of its own.", FNAME, sPath.c_str());
+    }
+
+    /* Those appended before the file is open (if any) follow the loaded ones. */
+    hoxOutboxRecordList earlier;
+    earlier.swap( _records );
+    _records.swap( records );
+    _nextSeq  = std::max( lastSeq, ackedSeq ) + 1;
+    _ackedSeq = ackedSeq;
+
+    if ( sSource.empty() )  // A new file?
+    {
+        _buffer = "S " + _source + "\n" + _buffer;
+    }
+    else
+    {
+        _source = sSource;
+    }
+
+    for ( hoxOutboxRecordList::const_iterator it = earlier.begin();
+                                              it != earlier.end(); ++it )
+    {
+        (void) append( it->type, it->data );
+    }
+
+    hoxLog(LOG_INFO, "%s: Opened [%s] (source = [%s]) with [%d] records to send.",
+        FNAME, sPath.c_str(), _source.c_str(), (int) _records.size());
+    return flush();
+}
+
+void
+hoxOutbox::close()
+{
+    if ( ! isOpen() ) return;
+
+    flush();
+    _stopSyncThread();
+    ::close( _fd );
+    _fd = -1;
+    _fileSize = 0;
+    _path.clear();
+}
+
+long long
+hoxOutbox::append( char               type,
+                   const std::string& sData )
+{
+    const long long seq = _nextSeq++;
+    _records.push_back( hoxOutboxRecord( seq, type, sData ) );
+
+    if ( isOpen() )
+    {
+        char szPrefix[32];
+        snprintf( szPrefix, sizeof(szPrefix), "%lld %c ", seq, type );
+        _buffer.append( szPrefix ).append( sData ).append( "\n" );
+    }
+
+    return seq;
+}
+
+hoxResult
+hoxOutbox::flush()
+{
+    const char* FNAME = "hoxOutbox::flush";
+
+    if ( ! isOpen() || _buffer.empty() ) return hoxRC_OK;
+
+    const long nSize = _buffer.size();
+    if ( hoxRC_OK != _writeAll( _fd, _buffer ) )
+    {
+        hoxLog(LOG_SYS_ERROR, "%s: Failed to write [%s]", FNAME, _path.c_str());
+        _fileSize += nSize - _buffer.size();
+        return hoxRC_ERR;
+    }
+    _fileSize += nSize;
+
+    /* A single sync for all the records appended since the last one. */
+    if ( hoxRC_OK != _sync( _fd ) )
+    {
+        hoxLog(LOG_SYS_ERROR, "%s: Failed to sync [%s]", FNAME, _path.c_str());
+        return hoxRC_ERR;
+    }
+
+    return hoxRC_OK;
+}
+
+void
+hoxOutbox::ack( long long seq )
+{
+    while ( ! _records.empty() && _records.front().seq <= seq )
+    {
+        _records.pop_front();
+    }
+    _ackedSeq = std::max( _ackedSeq, seq );
+
+    if ( ! isOpen() ) return;
+
+    /* NOTE: Not synced at once. If it is lost, the records are sent
+     *       again and skipped by the DB Agent.
+     */
+    char szLine[32];
+    snprintf( szLine, sizeof(szLine), "A %lld\n", _ackedSeq );
+    _buffer.append( szLine );
+
+    if ( _records.empty() && _fileSize + (long) _buffer.size() >= OUTBOX_COMPACT_SIZE )
+    {
+        (void) _compact();
+    }
+}
+
+/**
+ * Start the file anew, with only the source and the last acknowledged
+ * sequence number, once all the records are acknowledged.
+ */
+hoxResult
+hoxOutbox::_compact()
+{
+    const char* FNAME = "hoxOutbox::_compact";
+
+    const std::string sTemp = _path + ".tmp";
+    std::string sData = "S " + _source + "\n";
+    char szLine[32];
+    snprintf( szLine, sizeof(szLine), "A %lld\n", _ackedSeq );
+    sData.append( szLine );
+    const long nSize = sData.size();
+
+    const int fd = ::open( sTemp.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_APPEND, 0644 );
+    if (   fd < 0
+        || hoxRC_OK != _writeAll( fd, sData )
+        || hoxRC_OK != _sync( fd )
+        || ::rename( sTemp.c_str(), _path.c_str() ) < 0 )
+    {
+        hoxLog(LOG_SYS_ERROR, "%s: Failed to compact [%s]", FNAME, _path.c_str());
+        if ( fd >= 0 ) ::close( fd );
+        return hoxRC_ERR;
+    }
+
+    ::close( _fd );
+    _fd       = fd;
+    _fileSize = nSize;
+    _buffer.clear();
+
+    hoxLog(LOG_DEBUG, "%s: Compacted [%s] at seq [%lld].", FNAME, _path.c_str(), _ackedSeq);
+    return hoxRC_OK;
+}
+
+hoxResult
+hoxOutbox::_startSyncThread()
+{
+    if ( _bSyncThread ) return hoxRC_OK;
+
+    if ( _syncMutex == NULL && ( _syncMutex = st_mutex_new() ) == NULL )
+    {
+        return hoxRC_ERR;
+    }
+    if ( ::pipe( _syncIn ) < 0 )
+    {
+        _syncIn[0] = _syncIn[1] = -1;
+        return hoxRC_ERR;
+    }
+    if (   ::pipe( _syncOut ) < 0
+        || ( _syncResult = st_netfd_open( _syncOut[0] ) ) == NULL )
+    {
+        _stopSyncThread();
+        return hoxRC_ERR;
+    }
+
+    int* fds = new int[2];
+    fds[0] = _syncIn[0];
+    fds[1] = _syncOut[1];
+    if ( 0 != pthread_create( &_syncThread, NULL, _sync_thread, fds ) )
+    {
+        delete [] fds;
+        _stopSyncThread();
+        return hoxRC_ERR;
+    }
+    _bSyncThread = true;
+    return hoxRC_OK;
+}
+
+void
+hoxOutbox::_stopSyncThread()
+{
+    /* Closing its input ends the thread. */
+    if ( _syncIn[1] >= 0 ) ::close( _syncIn[1] );
+    if ( _bSyncThread ) pthread_join( _syncThread, NULL );
+    _bSyncThread = false;
+
+    if ( _syncIn[0] >= 0 ) ::close( _syncIn[0] );
+    if ( _syncResult != NULL ) st_netfd_close( _syncResult );
+    else if ( _syncOut[0] >= 0 ) ::close( _syncOut[0] );
+    if ( _syncOut[1] >= 0 ) ::close( _syncOut[1] );
+
+    _syncResult = NULL;
+    _syncIn[0]  = _syncIn[1]  = -1;
+    _syncOut[0] = _syncOut[1] = -1;
+}
+
+hoxResult
+hoxOutbox::_sync( int fd )
+{
+    if ( ! _bSyncThread )
+    {
+        return ( ::fdatasync( fd ) < 0 ? hoxRC_ERR : hoxRC_OK );
+    }
+
+    st_mutex_lock( _syncMutex );
+
+    int nError = EIO;
+    if (    ::write( _syncIn[1], &fd, sizeof(fd) ) == (ssize_t) sizeof(fd)
+         && st_read_fully( _syncResult, &nError, sizeof(nError),
+                           ST_UTIME_NO_TIMEOUT ) == (ssize_t) sizeof(nError) )
+    {
+        errno = nError;  // For the caller's log.
+    }
+    else
+    {
+        nError = ( errno ? errno : EIO );
+    }
+
+    st_mutex_unlock( _syncMutex );
+    return ( nError == 0 ? hoxRC_OK : hoxRC_ERR );
+}
+
+/******************* END OF FILE *********************************************/
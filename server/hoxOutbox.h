@@ -0,0 +1,133 @@
+//
+// C++ Interface: hoxOutbox
+//
+// Description: The local outbox of the writes to the Database.
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#ifndef __INCLUDED_HOX_OUTBOX_H__
+#define __INCLUDED_HOX_OUTBOX_H__
+
+#include <string>
+#include <list>
+#include <pthread.h>
+#include <st.h>
+#include "hoxEnums.h"
+
+/**
+ * A write waiting to be saved to the Database.
+ */
+class hoxOutboxRecord
+{
+public:
+    enum Type
+    {
+        TYPE_RESULT  = 'R',   // A game's result: "<pid>;<score>;<W|D|L>"
+        TYPE_GAME    = 'G'    // A completed Game: "<ended>;<red>;<black>;<status>;
+                              //   <type>;<redScore>;<blackScore>;<moves>"
+    };
+
+    long long    seq;         // The sequence number (within the source).
+    char         type;
+    std::string  data;        // The fields, separated by ';'.
+
+    hoxOutboxRecord( long long s = 0, char t = TYPE_RESULT,
+                     const std::string& d = "" )
+        : seq( s ), type( t ), data( d ) {}
+};
+typedef std::list<hoxOutboxRecord> hoxOutboxRecordList;
+
+/**
+ * The outbox of the writes of this process (VP) to the Database, kept
+ * until the DB Agent has saved them.
+ *
+ * If a file is open, the records are appended to it (and made durable
+ * by flush(), in batches) so that they survive a restart, and are sent
+ * again if they were not acknowledged. Each record has a sequence number
+ * within the source (the outbox), which lets the DB Agent skip those it
+ * has saved already.
+ *
+ * The syncs are made by a thread of their own, so that the other
+ * threads of this process keep running meanwhile.
+ *
+ * The file is made of lines:
+ *     "S <source>"           The source's Id (the first line).
+ *     "<seq> <type> <data>"  A record.
+ *     "A <seq>"              The records up to <seq> are saved.
+ */
+class hoxOutbox
+{
+public:
+    hoxOutbox();
+    ~hoxOutbox() { close(); }
+
+    /**
+     * Open (or create) the outbox's file, and load the records not yet
+     * acknowledged.
+     */
+    hoxResult open( const std::string& sPath );
+    void close();
+    bool isOpen() const { return _fd >= 0; }
+
+    /**
+     * The Id of the source of the records.
+     */
+    const std::string& getSource() const { return _source; }
+
+    /**
+     * Append a record.
+     *
+     * @return Its sequence number.
+     */
+    long long append( char               type,
+                      const std::string& sData );
+
+    /**
+     * Write out (and sync) the records appended so far.
+     */
+    hoxResult flush();
+
+    /**
+     * The records not yet acknowledged, the oldest first.
+     */
+    const hoxOutboxRecordList& getRecords() const { return _records; }
+    bool empty() const { return _records.empty(); }
+
+    /**
+     * Acknowledge (drop) the records up to a given sequence number.
+     */
+    void ack( long long seq );
+
+private:
+    hoxResult _compact();
+
+    hoxResult _startSyncThread();
+    void      _stopSyncThread();
+
+    /**
+     * Sync a file on the syncing thread (if started) and wait for it.
+     */
+    hoxResult _sync( int fd );
+
+private:
+    std::string          _path;
+    int                  _fd;
+    long                 _fileSize;   // The size of the file on disk.
+    std::string          _source;
+    long long            _nextSeq;
+    long long            _ackedSeq;   // The last sequence number acknowledged.
+    hoxOutboxRecordList  _records;    // Those not yet acknowledged.
+    std::string          _buffer;     // The lines not yet written out.
+
+    pthread_t            _syncThread;
+    bool                 _bSyncThread;   // Whether it is running.
+    int                  _syncIn[2];     // The pipe of the fds to sync...
+    int                  _syncOut[2];    // ... and that of the results.
+    st_netfd_t           _syncResult;    // The read end of _syncOut.
+    st_mutex_t           _syncMutex;     // One sync at a time.
+};
+
+#endif /* __INCLUDED_HOX_OUTBOX_H__ */
@@ -25,6 +25,7 @@ hoxPlayer::hoxPlayer(const std::string&  id,
         , _wins( 0 )
         , _draws( 0 )
         , _losses( 0 )
+        , _millisClock( false )
 {
     const char* FNAME = "hoxPlayer::hoxPlayer";
     hoxLog(LOG_DEBUG, "%s: (%s) ENTER.", FNAME, _id.c_str());
@@ -48,6 +48,9 @@ public:
     void setHPassword(const std::string& hpw) { _hpassword = hpw; }
     const std::string getHPassword() const { return _hpassword; }
 
+    void setMillisClock(bool val) { _millisClock = val; }
+    bool getMillisClock() const { return _millisClock; }
+
     /**
      * On receiving a new event: put the even into outgoing queue.
      *
@@ -128,6 +131,14 @@ public:
      * Attempt to resume playing after having re-connected.
      */
     void resumePlayingIfNeeded();
+
+    /**
+     * Record a Table that this Player is attending without going through
+     * the Table's join process (e.g., a Table restored from the checkpoint).
+     */
+    void addTable( const hoxTable_SPtr& pTable ) { _tables.insert( pTable ); }
+
+    const hoxTableSet& getTables() const { return _tables; }
                            
 private:
     /**
@@ -150,6 +161,9 @@ private:
     std::string         _hpassword;
             /* Hashed password. Required for authentication. */
 
+    bool                _millisClock;
+            /* Whether the Player wants timers in milliseconds. */
+
     hoxSession_SPtr     _session;
 
     hoxTableSet         _tables;
@@ -8,11 +8,11 @@
 // Created: 04/16/2009
 //
 
+#include <vector>
+#include <boost/unordered_map.hpp>
 #include "hoxReferee.h"
 #include "hoxLog.h"
 #include "hoxDebug.h"
-#include <list>
-#include <algorithm>  // std::find
 
 //************************************************************
 //                          BLACK
@@ -21,23 +21,23 @@
 //      +--------------+==============+--------------+
 //  0   |  0 |  1 |  2 #  3 |  4 |  5 #  6 |  7 |  8 |
 //      |--------------#--------------#--------------|
-//  1   |  9 | 10 | 11 # 12 | 13 | 14 # 15 | 16 | 17 | 
+//  1   |  9 | 10 | 11 # 12 | 13 | 14 # 15 | 16 | 17 |
 //      |--------------#--------------#--------------|
-//  2   | 18 | 19 | 20 # 21 | 22 | 23 # 24 | 25 | 26 | 
+//  2   | 18 | 19 | 20 # 21 | 22 | 23 # 24 | 25 | 26 |
 //      |--------------+==============+--------------|
-//  3   | 27 | 28 | 29 | 30 | 31 | 32 | 33 | 34 | 35 | 
+//  3   | 27 | 28 | 29 | 30 | 31 | 32 | 33 | 34 | 35 |
 //      |--------------------------------------------|
 //  4   | 36 | 37 | 38 | 39 | 40 | 41 | 42 | 43 | 44 |
-//      |============================================| <-- The River 
+//      |============================================| <-- The River
 //  5   | 45 | 46 | 47 | 48 | 49 | 50 | 51 | 52 | 53 |
 //      |--------------------------------------------|
-//  6   | 54 | 55 | 56 | 57 | 58 | 59 | 60 | 61 | 62 | 
+//  6   | 54 | 55 | 56 | 57 | 58 | 59 | 60 | 61 | 62 |
 //      |--------------+==============+--------------|
-//  7   | 63 | 64 | 65 # 66 | 67 | 68 # 69 | 70 | 71 | 
+//  7   | 63 | 64 | 65 # 66 | 67 | 68 # 69 | 70 | 71 |
 //      |--------------#--------------#--------------|
-//  8   | 72 | 73 | 74 # 75 | 76 | 77 # 78 | 79 | 80 | 
+//  8   | 72 | 73 | 74 # 75 | 76 | 77 # 78 | 79 | 80 |
 //      |--------------#--------------#--------------|
-//  9   | 81 | 82 | 83 # 84 | 85 | 86 # 87 | 88 | 89 | 
+//  9   | 81 | 82 | 83 # 84 | 85 | 86 # 87 | 88 | 89 |
 //      +--------------+==============+--------------+
 //
 //        0     1    2    3    4    5    6    7    8
@@ -46,218 +46,137 @@
 
 namespace BoardInfoAPI
 {
-    /* Forward declarations */
+    /* Constants */
 
-    class Board;
-    class Piece;
-
-    /* Typedefs */
-
-    typedef std::list<hoxPosition *> PositionList;
-    typedef std::list<Piece* >       PieceList;
-
-    /* ----- */
-
-    /**
-     * The generic Piece from which other specific Pieces (King, Pawn,...)
-     * base on.  
-     */
-    class Piece
+    enum
     {
-    public:
-        Piece() : m_info( hoxPIECE_INVALID, hoxCOLOR_NONE,
-                          hoxPosition(-1, -1) ) { }
-        Piece(hoxPieceType t) : m_info( t, hoxCOLOR_NONE, 
-                                        hoxPosition(-1, -1) ) { }
-        Piece(hoxPieceType t, hoxColor c) 
-                              : m_info( t, c, hoxPosition(-1, -1) ) { }
-        Piece(hoxPieceType t, hoxColor c, const hoxPosition& p)
-                              : m_info( t, c, p ) { }
-        virtual ~Piece() {}
-
-        hoxPieceInfo  GetInfo()     const { return m_info; }
-
-        hoxPieceType  GetType()     const { return m_info.type; }
-        hoxColor GetColor()    const { return m_info.color; }
-        hoxPosition   GetPosition() const { return m_info.position; }
-
-        void SetPosition( const hoxPosition& pos ) { m_info.position = pos; }
-        void SetBoard(Board* board) { m_board = board; }
-
-        virtual bool IsValidMove(const hoxPosition& newPos) const;
-        virtual bool DoesNextMoveExist() const;
-
-        bool HasColor( hoxColor c ) const { return (m_info.color == c); }
-        bool HasType(  hoxPieceType  t ) const { return (m_info.type  == t); }
-        bool HasSameColumnAs( const Piece& other ) const
-            { return (m_info.position.x == other.m_info.position.x); }
-
-    protected:
-        virtual bool CanMoveTo(const hoxPosition& newPos) const = 0;
-        virtual void GetPotentialNextPositions(PositionList& positions) const {} // FIXME
-
-    public: /* Static Public API */ 
-        static bool Is_Inside_Palace( hoxColor color, const hoxPosition& position );
-
-    protected:
-        hoxPieceInfo  m_info;
-        Board*        m_board;
+        NUM_SQUARES  = 90,
+        NUM_SLOTS    = 32,     // 16 pieces per side.
+        RED_SLOT     = 0,      // RED pieces are at slots [0, 16).
+        BLACK_SLOT   = 16,     // BLACK pieces are at slots [16, 32).
+                               // The King is the first piece of each side.
+        NO_SQUARE    = -1,
+
+        RED_BIT      = 0x08,   // A piece is (color-bit | piece-type).
+        BLACK_BIT    = 0x10,
+        TYPE_MASK    = 0x07,
+
+        MAX_TARGETS  = 17      // The most pseudo-legal Moves of one piece.
     };
 
-    /** 
-     * KING Piece 
-     */
-    class KingPiece : public Piece
-    {
-    public:
-        KingPiece(hoxColor c, const hoxPosition& p) 
-            : Piece(hoxPIECE_KING, c, p) {}
-        virtual bool CanMoveTo(const hoxPosition& newPos) const;
-        virtual void GetPotentialNextPositions(PositionList& positions) const;
-    };
+    /* The kinds of Moves in a repetition cycle (by increasing severity). */
+    enum { MOVE_IDLE = 0, MOVE_CHASE, MOVE_CHECK };
 
-    /** 
-     * ADVISOR Piece 
-     */
-    class AdvisorPiece : public Piece
-    {
-    public:
-        AdvisorPiece(hoxColor c, const hoxPosition& p) 
-            : Piece(hoxPIECE_ADVISOR, c, p) {}
-        virtual bool CanMoveTo(const hoxPosition& newPos) const;
-        virtual void GetPotentialNextPositions(PositionList& positions) const;
-    };
+    typedef unsigned long long PositionKey;
 
-    /** 
-     * ELEPHANT Piece 
-     */
-    class ElephantPiece : public Piece
-    {
-    public:
-        ElephantPiece(hoxColor c, const hoxPosition& p) 
-            : Piece(hoxPIECE_ELEPHANT, c, p) {}
-        virtual bool CanMoveTo(const hoxPosition& newPos) const;
-        virtual void GetPotentialNextPositions(PositionList& positions) const;
-    };
+    /* The four directions of the Chariot/Cannon rays. */
+    enum { DIR_UP = 0, DIR_DOWN, DIR_LEFT, DIR_RIGHT, NUM_DIRS };
 
-    /** 
-     * CHARIOT Piece 
-     */
-    class ChariotPiece : public Piece
-    {
-    public:
-        ChariotPiece(hoxColor c, const hoxPosition& p) 
-            : Piece(hoxPIECE_CHARIOT, c, p) {}
-        virtual bool CanMoveTo(const hoxPosition& newPos) const;
-        virtual void GetPotentialNextPositions(PositionList& positions) const;
-    };
-
-    /** 
-     * HORSE Piece 
-     */
-    class HorsePiece : public Piece
-    {
-    public:
-        HorsePiece(hoxColor c, const hoxPosition& p) 
-            : Piece(hoxPIECE_HORSE, c, p) {}
-        virtual bool CanMoveTo(const hoxPosition& newPos) const;
-        virtual void GetPotentialNextPositions(PositionList& positions) const;
-    };
-
-    /** 
-     * CANNON Piece 
-     */
-    class CannonPiece : public Piece
-    {
-    public:
-        CannonPiece(hoxColor c, const hoxPosition& p) 
-            : Piece(hoxPIECE_CANNON, c, p) {}
-        virtual bool CanMoveTo(const hoxPosition& newPos) const;
-        virtual void GetPotentialNextPositions(PositionList& positions) const;
-    };
-
-    /** 
-     * PAWN Piece 
-     */
-    class PawnPiece : public Piece
-    {
-    public:
-        PawnPiece(hoxColor c, const hoxPosition& p) 
-            : Piece(hoxPIECE_PAWN, c, p) {}
-        virtual bool CanMoveTo(const hoxPosition& newPos) const;
-        virtual void GetPotentialNextPositions(PositionList& positions) const;
-    };
-
-    /** 
-     * A single Cell in the 9x10 Xiangqi Board.
+    /**
+     * The precomputed move tables, indexed by square.
+     * Each list ends with NO_SQUARE.
      */
-    class Cell
+    struct MoveTables
     {
-    public:
-        hoxPosition  position;
-        
-        Piece*       pPiece;
-            /* The piece that currrently occupies the cell.
-             * NULL indicates that this cell is empty.
-             */
-
-        Cell() : position(-1, -1), pPiece( NULL ) { }
-        bool IsEmpty() { return ( pPiece == NULL ); }    
+        signed char king[NUM_SQUARES][5];
+        signed char advisor[NUM_SQUARES][5];
+        signed char elephant[NUM_SQUARES][5];
+        signed char elephantEye[NUM_SQUARES][4];
+        signed char horse[NUM_SQUARES][9];
+        signed char horseLeg[NUM_SQUARES][8];
+        signed char pawn[2][NUM_SQUARES][4];  // [0] = RED, [1] = BLACK
+        signed char ray[NUM_SQUARES][NUM_DIRS][10];
+
+        /* The reverse tables: where an enemy must stand to attack a square. */
+        signed char horseCheck[NUM_SQUARES][9];
+        signed char horseCheckLeg[NUM_SQUARES][8];
+        signed char pawnCheck[2][NUM_SQUARES][4];  // By RED / BLACK Pawns.
+
+        /* The Zobrist keys of the 14 kinds of pieces on each square,
+         * and of BLACK to move.
+         */
+        PositionKey zobrist[14][NUM_SQUARES];
+        PositionKey zobristBlack;
+
+        MoveTables();
     };
 
-    /** 
-     * The none-UI Board helping the referee to keep the game's state. 
+    /**
+     * The none-UI Board helping the referee to keep the game's state.
+     *
+     * The Board is a 90-square mailbox plus the list of pieces' squares
+     * and the occupancy bits of each file and rank, so that validating
+     * a Move needs no allocation and checks are found in constant time.
      */
     class Board
     {
     public:
-        Board( hoxColor nextColor = hoxCOLOR_NONE );
-        ~Board();
+        Board();
 
         // ------------ Main Public API -------
         bool ValidateMove( hoxMove&       move,
                            hoxGameStatus& status );
-
+        bool LoadPosition( const std::string& sFen );
+        size_t ApplyMoves( const std::list<std::string>& moves,
+                           hoxGameStatus&                status );
         bool IsLastMoveCheck() const;
-
         void GetGameState( hoxPieceInfoList& pieceInfoList,
-                           hoxColor&    nextColor );
-
+                           hoxColor&         nextColor ) const;
         hoxColor GetNextColor() const { return m_nextColor; }
-
-        bool GetPieceAtPosition( const hoxPosition& position, 
+        bool GetPieceAtPosition( const hoxPosition& position,
                                  hoxPieceInfo&      pieceInfo ) const;
-
-        // ------------ Other Public API -------
-        bool   Simulation_IsValidMove(const hoxMove& move);
-        Piece* GetPieceAt( const hoxPosition& position ) const;
-        bool   HasPieceAt( const hoxPosition& position ) const;
+        hoxGameStatus JudgeRepetition( std::string& sReason ) const;
+        unsigned long Perft( int depth );
 
     private:
-        void         _CreateNewGame();
-        void         _AddNewPiece(Piece* piece);
-
-        void         _SetPiece( Piece* piece );
-        void         _UnsetPiece( Piece* piece );
-        void         _CapturePiece( Piece* piece );
-
-        void         _MovePieceTo( Piece* piece, const hoxPosition& newPos );
-        void         _AddPiece(Piece* piece);
-        void         _PutbackPiece(Piece* piece);
-
-        Piece*       _RecordMove(const hoxMove& move);
-        void         _UndoMove( const hoxMove& move, Piece* pCaptured );
-
-        const Piece* _GetKing(hoxColor color) const;
-        bool         _IsKingBeingChecked(hoxColor color) const;
-        bool         _IsKingFaceKing() const;
-
-        bool         _DoesNextMoveExist() const;
+        /* A Move made in the Game, and the position it leads to. */
+        struct HistoryEntry
+        {
+            PositionKey  key;
+            signed char  from;
+            signed char  to;
+            signed char  captured;
+            signed char  capturedSlot;
+        };
+        typedef std::vector<HistoryEntry> HistoryList;
+        typedef boost::unordered_map<PositionKey, int> KeyCountMap;
+
+        void _CreateNewGame();
+        void _AddPiece( int slot, hoxPieceType type, hoxColor color, int x, int y );
+
+        bool _CanMoveTo( int from, int to ) const;
+        int  _CountBetween( int from, int to ) const;
+        void _GetScreens( int sq, int dir, int& first, int& second ) const;
+        void _SetSquare( int sq, bool bOccupied );
+
+        int  _MakeMove( int from, int to );
+        void _UndoMove( int from, int to, int captured, int capturedSlot );
+
+        int  _GetChecker( hoxColor color, int& screen ) const;
+        bool _IsKingBeingChecked( hoxColor color ) const;
+        bool _IsKingFaceKing() const;
+        bool _IsLegalAfterMove( int from, int to );
+        bool _PlayMove( int from, int to, int& captured );
+        hoxGameStatus _GetEndGameStatus();
+        int  _GetTargets( int from, signed char* targets ) const;
+        bool _HasLegalMoveFrom( int from, bool bUsePins );
+        bool _CanAnyPieceMoveTo( int to );
+        bool _DoesNextMoveExist();
+
+        unsigned int _GetThreats( hoxColor color );
+        bool _IsProtected( int sq );
 
     private:
-        PieceList      m_pieces;       // ACTIVE pieces
-        PieceList      m_deadPieces;   // INACTIVE (dead) pieces
-        Cell           m_cells[9][10];
+        unsigned char  m_squares[NUM_SQUARES];  // 0 = empty.
+        signed char    m_slots[NUM_SQUARES];    // The piece's slot (if any).
+        signed char    m_pieces[NUM_SLOTS];     // The piece's square (or NO_SQUARE).
+        unsigned short m_fileBits[9];   // The occupied ranks of each file.
+        unsigned short m_rankBits[10];  // The occupied files of each rank.
+
+        PositionKey    m_key;           // The Zobrist key of the position.
+        PositionKey    m_initialKey;    // ... of the position before any Move.
+        HistoryList    m_history;       // The Moves made so far.
+        KeyCountMap    m_keyCounts;     // How many times each position occurred.
 
         hoxColor       m_nextColor;
             /* Which side (RED or BLACK) will move next? */
@@ -267,1101 +186,1274 @@ namespace BoardInfoAPI
      * Other utility API *
      *********************/
 
-    /** 
-     * NOTE: This function is an example where we may want to consider using
-     *       the 'smart' shared pointer (specifically, a shared-array pointer)
-     *       such as that from Boost Libraries.
+    const MoveTables s_tables;
+
+    inline int  SQUARE( int x, int y ) { return y * 9 + x; }
+    inline int  FILE_OF( int sq )      { return sq % 9; }
+    inline int  RANK_OF( int sq )      { return sq / 9; }
+
+    inline int  COLOR_BIT( hoxColor c ) { return ( c == hoxCOLOR_RED ? RED_BIT : BLACK_BIT ); }
+    inline int  FIRST_SLOT( hoxColor c ) { return ( c == hoxCOLOR_RED ? RED_SLOT : BLACK_SLOT ); }
+    inline hoxColor OTHER_COLOR( hoxColor c )
+        { return ( c == hoxCOLOR_RED ? hoxCOLOR_BLACK : hoxCOLOR_RED ); }
+
+    inline hoxColor PIECE_COLOR( int piece )
+        { return ( ( piece & RED_BIT ) ? hoxCOLOR_RED : hoxCOLOR_BLACK ); }
+    inline hoxPieceType PIECE_TYPE( int piece )
+        { return (hoxPieceType) ( piece & TYPE_MASK ); }
+    inline PositionKey ZOBRIST( int piece, int sq )
+        { return s_tables.zobrist[( ( piece & BLACK_BIT ) ? 7 : 0 ) + ( piece & TYPE_MASK ) - 1][sq]; }
+
+    /* The piece type of a FEN letter (either case), or hoxPIECE_INVALID. */
+    inline hoxPieceType FEN_TO_TYPE( char c )
+    {
+        switch ( c | 0x20 )  // To lower case.
+        {
+            case 'k':           return hoxPIECE_KING;
+            case 'a':           return hoxPIECE_ADVISOR;
+            case 'b': case 'e': return hoxPIECE_ELEPHANT;
+            case 'r':           return hoxPIECE_CHARIOT;
+            case 'n': case 'h': return hoxPIECE_HORSE;
+            case 'c':           return hoxPIECE_CANNON;
+            case 'p':           return hoxPIECE_PAWN;
+            default:            return hoxPIECE_INVALID;
+        }
+    }
+
+    inline bool IS_IN_PALACE( int x, int y )
+        { return x >= 3 && x <= 5 && ( ( y >= 0 && y <= 2 ) || ( y >= 7 && y <= 9 ) ); }
+    inline bool IS_ON_BOARD( int x, int y )
+        { return x >= 0 && x <= 8 && y >= 0 && y <= 9; }
+
+    /**
+     * Can a piece ever stand on a square (e.g., an Advisor only on the
+     * five points of its palace, a Pawn never behind its starting rank)?
      */
-    void PositionList_Clear( PositionList& positions );
+    inline bool IS_REACHABLE( hoxPieceType type, hoxColor color, int x, int y )
+    {
+        const int r = ( color == hoxCOLOR_RED ? 9 - y : y );  // Rank from its own side.
+        switch ( type )
+        {
+            case hoxPIECE_KING:     return x >= 3 && x <= 5 && r <= 2;
+            case hoxPIECE_ADVISOR:  return x >= 3 && x <= 5 && r <= 2 && ( x + r ) % 2 == 1;
+            case hoxPIECE_ELEPHANT: return r <= 4 && x % 2 == 0 && r % 2 == 0 && ( x + r ) % 4 == 2;
+            case hoxPIECE_PAWN:     return r >= 3 && ( r >= 5 || x % 2 == 0 );
+            default:                return true;
+        }
+    }
 
-} // namespace BoardInfoAPI
+    /* Is a square on the file or rank of another square? */
+    inline bool IS_ON_LINES( int sq, int other )
+        { return FILE_OF( sq ) == FILE_OF( other ) || RANK_OF( sq ) == RANK_OF( other ); }
 
+    /**
+     * The pin-mask of a King: its file and rank (Chariot, Cannon and
+     * King-face-King pins) plus the diagonal neighbors (the Horse's legs).
+     */
+    inline bool IS_PIN_SQUARE( int kingSq, int sq )
+    {
+        const int dx = FILE_OF( sq ) - FILE_OF( kingSq );
+        const int dy = RANK_OF( sq ) - RANK_OF( kingSq );
+        return ( dx == 0 || dy == 0 || ( dx * dx == 1 && dy * dy == 1 ) );
+    }
 
+    /**
+     * Append a square to a NO_SQUARE-terminated list.
+     */
+    void _Append( signed char* list, int sq )
+    {
+        while ( *list != NO_SQUARE ) ++list;
+        *list++ = sq;
+        *list   = NO_SQUARE;
+    }
 
-/* Import namespaces */
+} // namespace BoardInfoAPI
 
+/* Import namespaces */
 using namespace BoardInfoAPI;
 
-
 //-----------------------------------------------------------------------------
-// Board
+// MoveTables
 //-----------------------------------------------------------------------------
 
-
-Board::Board( hoxColor nextColor /* = hoxCOLOR_NONE */ )
-        : m_nextColor( nextColor )
+MoveTables::MoveTables()
 {
-    /* Initialize Piece-Cells. */
-    for ( int x = 0; x <= 8; ++x ) // horizontal
+    static const int ORTHO[4][2] = { {0,-1}, {0,1}, {-1,0}, {1,0} };
+    static const int DIAG[4][2]  = { {-1,-1}, {-1,1}, {1,-1}, {1,1} };
+    static const int HORSE[8][4] = { /* dx, dy, leg-dx, leg-dy */
+        {-1,-2, 0,-1}, {1,-2, 0,-1}, {-1,2, 0,1}, {1,2, 0,1},
+        {-2,-1,-1, 0}, {-2,1,-1, 0}, {2,-1, 1, 0}, {2,1, 1, 0} };
+
+    for ( int sq = 0; sq < NUM_SQUARES; ++sq )
     {
-        for ( int y = 0; y <= 9; ++y ) // vertical
+        const int x = FILE_OF( sq );
+        const int y = RANK_OF( sq );
+        int       i, nx, ny;
+
+        king[sq][0] = advisor[sq][0] = elephant[sq][0] = horse[sq][0] = NO_SQUARE;
+        pawn[0][sq][0] = pawn[1][sq][0] = NO_SQUARE;
+
+        for ( i = 0; i < 4; ++i )
         {
-            m_cells[x][y].pPiece = NULL;
-            m_cells[x][y].position = hoxPosition(-1,-1);
+            /* King: one step orthogonally, within the palace. */
+            nx = x + ORTHO[i][0];
+            ny = y + ORTHO[i][1];
+            if ( IS_IN_PALACE( x, y ) && IS_IN_PALACE( nx, ny ) )
+                _Append( king[sq], SQUARE( nx, ny ) );
+
+            /* Advisor: one step diagonally, within the palace. */
+            nx = x + DIAG[i][0];
+            ny = y + DIAG[i][1];
+            if ( IS_IN_PALACE( x, y ) && IS_IN_PALACE( nx, ny ) )
+                _Append( advisor[sq], SQUARE( nx, ny ) );
+
+            /* Elephant: two steps diagonally, without crossing the river. */
+            nx = x + 2 * DIAG[i][0];
+            ny = y + 2 * DIAG[i][1];
+            if ( IS_ON_BOARD( nx, ny ) && ( y <= 4 ) == ( ny <= 4 ) )
+            {
+                int n = 0;
+                while ( elephant[sq][n] != NO_SQUARE ) ++n;
+                elephantEye[sq][n] = SQUARE( x + DIAG[i][0], y + DIAG[i][1] );
+                _Append( elephant[sq], SQUARE( nx, ny ) );
+            }
         }
-    }
 
-    /* Initialize Board. */
-    _CreateNewGame();
-}
+        /* Horse: unless its leg is blocked. */
+        for ( i = 0; i < 8; ++i )
+        {
+            nx = x + HORSE[i][0];
+            ny = y + HORSE[i][1];
+            if ( IS_ON_BOARD( nx, ny ) )
+            {
+                int n = 0;
+                while ( horse[sq][n] != NO_SQUARE ) ++n;
+                horseLeg[sq][n] = SQUARE( x + HORSE[i][2], y + HORSE[i][3] );
+                _Append( horse[sq], SQUARE( nx, ny ) );
+            }
+        }
 
-Board::~Board()
-{
-    PieceList::const_iterator it;
+        /* Pawn: forward, and sideways after crossing the river. */
+        if ( y > 0 )                 _Append( pawn[0][sq], SQUARE( x, y - 1 ) );
+        if ( y <= 4 && x > 0 )       _Append( pawn[0][sq], SQUARE( x - 1, y ) );
+        if ( y <= 4 && x < 8 )       _Append( pawn[0][sq], SQUARE( x + 1, y ) );
+        if ( y < 9 )                 _Append( pawn[1][sq], SQUARE( x, y + 1 ) );
+        if ( y >= 5 && x > 0 )       _Append( pawn[1][sq], SQUARE( x - 1, y ) );
+        if ( y >= 5 && x < 8 )       _Append( pawn[1][sq], SQUARE( x + 1, y ) );
 
-    for ( it = m_pieces.begin(); it != m_pieces.end(); ++it )
-    {
-        delete (*it);
+        /* Chariot/Cannon: the squares along each direction, nearest first. */
+        for ( i = 0; i < NUM_DIRS; ++i )
+        {
+            ray[sq][i][0] = NO_SQUARE;
+            for ( nx = x + ORTHO[i][0], ny = y + ORTHO[i][1];
+                  IS_ON_BOARD( nx, ny );
+                  nx += ORTHO[i][0], ny += ORTHO[i][1] )
+            {
+                _Append( ray[sq][i], SQUARE( nx, ny ) );
+            }
+        }
     }
 
-    for ( it = m_deadPieces.begin(); it != m_deadPieces.end(); ++it )
+    /* Reverse the Horse and Pawn tables. */
+    for ( int sq = 0; sq < NUM_SQUARES; ++sq )
     {
-        delete (*it);
+        horseCheck[sq][0] = pawnCheck[0][sq][0] = pawnCheck[1][sq][0] = NO_SQUARE;
     }
-}
-
-/**
- * Create a brand new game by specifying the info of ALL pieces initially.
- */
-void
-Board::_CreateNewGame()
-{
-    hoxColor color;        // The current color.
-    int      i;
-
-    // --------- BLACK
-
-    color = hoxCOLOR_BLACK;
-
-    _AddNewPiece( new KingPiece(     color, hoxPosition(4, 0) ) );
-    _AddNewPiece( new AdvisorPiece(  color, hoxPosition(3, 0) ) );
-    _AddNewPiece( new AdvisorPiece(  color, hoxPosition(5, 0) ) );
-    _AddNewPiece( new ElephantPiece( color, hoxPosition(2, 0) ) );
-    _AddNewPiece( new ElephantPiece( color, hoxPosition(6, 0) ) );
-    _AddNewPiece( new HorsePiece(    color, hoxPosition(1, 0) ) );
-    _AddNewPiece( new HorsePiece(    color, hoxPosition(7, 0) ) );
-    _AddNewPiece( new ChariotPiece(  color, hoxPosition(0, 0) ) );
-    _AddNewPiece( new ChariotPiece(  color, hoxPosition(8, 0) ) );
-    _AddNewPiece( new CannonPiece(   color, hoxPosition(1, 2) ) );
-    _AddNewPiece( new CannonPiece(   color, hoxPosition(7, 2) ) );
-    for ( i = 0; i < 10; i += 2 ) // 5 Pawns.
+    for ( int sq = 0; sq < NUM_SQUARES; ++sq )
     {
-        _AddNewPiece( new PawnPiece(   color, hoxPosition(i, 3) ) );
+        for ( int i = 0; horse[sq][i] != NO_SQUARE; ++i )
+        {
+            const int target = horse[sq][i];
+            int n = 0;
+            while ( horseCheck[target][n] != NO_SQUARE ) ++n;
+            horseCheckLeg[target][n] = horseLeg[sq][i];
+            _Append( horseCheck[target], sq );
+        }
+        for ( int c = 0; c < 2; ++c )
+        {
+            for ( const signed char* p = pawn[c][sq]; *p != NO_SQUARE; ++p )
+                _Append( pawnCheck[c][(int) *p], sq );
+        }
     }
 
-    // --------- RED
-
-    color = hoxCOLOR_RED;
-
-    _AddNewPiece( new KingPiece(     color, hoxPosition(4, 9) ) );
-    _AddNewPiece( new AdvisorPiece(  color, hoxPosition(3, 9) ) );
-    _AddNewPiece( new AdvisorPiece(  color, hoxPosition(5, 9) ) );
-    _AddNewPiece( new ElephantPiece( color, hoxPosition(2, 9) ) );
-    _AddNewPiece( new ElephantPiece( color, hoxPosition(6, 9) ) );
-    _AddNewPiece( new HorsePiece(    color, hoxPosition(1, 9) ) );
-    _AddNewPiece( new HorsePiece(    color, hoxPosition(7, 9) ) );
-    _AddNewPiece( new ChariotPiece(  color, hoxPosition(0, 9) ) );
-    _AddNewPiece( new ChariotPiece(  color, hoxPosition(8, 9) ) );
-    _AddNewPiece( new CannonPiece(   color, hoxPosition(1, 7) ) );
-    _AddNewPiece( new CannonPiece(   color, hoxPosition(7, 7) ) );
-    for ( i = 0; i < 10; i += 2 ) // 5 Pawns.
+    /* The Zobrist keys, from a fixed xorshift sequence so that keys are
+     * the same in every process.
+     */
+    PositionKey seed = 0x9E3779B97F4A7C15ULL;
+    for ( int k = 0; k < 14; ++k )
     {
-        _AddNewPiece( new PawnPiece(   color, hoxPosition(i, 6) ) );
+        for ( int sq = 0; sq < NUM_SQUARES; ++sq )
+        {
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            zobrist[k][sq] = seed;
+        }
     }
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+    zobristBlack = seed;
 }
 
-void 
-Board::GetGameState( hoxPieceInfoList& pieceInfoList,
-                     hoxColor&    nextColor )
-{
-    pieceInfoList.clear();    // Clear the old info, if exists.
-
-    /* Return all the ACTIVE Pieces. */
-    for ( PieceList::const_iterator it = m_pieces.begin();
-                                    it != m_pieces.end(); ++it )
-    {
-        pieceInfoList.push_back( hoxPieceInfo( (*it)->GetType(), 
-                                               (*it)->GetColor(), 
-                                               (*it)->GetPosition() ) );
-    }
-
-    /* Return the Next Color */
-    nextColor = m_nextColor;
-}
+//-----------------------------------------------------------------------------
+// Board
+//-----------------------------------------------------------------------------
 
-bool 
-Board::GetPieceAtPosition( const hoxPosition& position, 
-                           hoxPieceInfo&      pieceInfo ) const
+Board::Board()
+        : m_nextColor( hoxCOLOR_RED )
 {
-    Piece* piece = this->GetPieceAt( position );
-    if ( piece == NULL )
-        return false;
-
-    pieceInfo.type     = piece->GetType();
-    pieceInfo.color    = piece->GetColor();
-    pieceInfo.position = piece->GetPosition();
-
-    return true;
+    /* Initialize Board. */
+    _CreateNewGame();
 }
 
 /**
- * Put a given Piece on Board according to its position.
+ * Create a brand new game by specifying the info of ALL pieces initially.
  */
 void
-Board::_SetPiece( Piece* piece )
+Board::_CreateNewGame()
 {
-    hoxCHECK_RET(piece, "Piece is NULL.");
+    static const hoxPieceType BACK_RANK[9] = {
+        hoxPIECE_CHARIOT, hoxPIECE_HORSE, hoxPIECE_ELEPHANT, hoxPIECE_ADVISOR,
+        hoxPIECE_KING,
+        hoxPIECE_ADVISOR, hoxPIECE_ELEPHANT, hoxPIECE_HORSE, hoxPIECE_CHARIOT };
+
+    for ( int sq = 0; sq < NUM_SQUARES; ++sq )
+    {
+        m_squares[sq] = 0;
+        m_slots[sq]   = NO_SQUARE;
+    }
+    for ( int x = 0; x < 9; ++x )  m_fileBits[x] = 0;
+    for ( int y = 0; y < 10; ++y ) m_rankBits[y] = 0;
+    m_key = 0;
 
-    hoxPosition pos = piece->GetPosition();  // The piece's position.
+    for ( int c = 0; c < 2; ++c )
+    {
+        const hoxColor color     = ( c == 0 ? hoxCOLOR_RED : hoxCOLOR_BLACK );
+        const int      backRank  = ( c == 0 ? 9 : 0 );
+        const int      cannonRank = ( c == 0 ? 7 : 2 );
+        const int      pawnRank  = ( c == 0 ? 6 : 3 );
+        int            slot      = FIRST_SLOT( color );
+
+        _AddPiece( slot++, hoxPIECE_KING, color, 4, backRank );
+        for ( int x = 0; x < 9; ++x )
+        {
+            if ( x != 4 ) _AddPiece( slot++, BACK_RANK[x], color, x, backRank );
+        }
+        _AddPiece( slot++, hoxPIECE_CANNON, color, 1, cannonRank );
+        _AddPiece( slot++, hoxPIECE_CANNON, color, 7, cannonRank );
+        for ( int x = 0; x < 9; x += 2 ) // 5 Pawns.
+        {
+            _AddPiece( slot++, hoxPIECE_PAWN, color, x, pawnRank );
+        }
+    }
 
-    hoxCHECK_RET(pos.isValid(), "The piece's position is not valid.");
+    m_nextColor = hoxCOLOR_RED;
 
-    hoxCHECK_RET( m_cells[pos.x][pos.y].pPiece == NULL, 
-                 "The destination cell is not empty." );
-    m_cells[pos.x][pos.y].pPiece = piece;
-    m_cells[pos.x][pos.y].position = pos;
+    /* Start the position history. */
+    m_initialKey = m_key;
+    m_history.clear();
+    m_keyCounts.clear();
+    m_keyCounts[m_key] = 1;
 }
 
-/**
- * Unset an existing piece from Board.
- */
 void
-Board::_UnsetPiece( Piece* piece )
+Board::_AddPiece( int          slot,
+                  hoxPieceType type,
+                  hoxColor     color,
+                  int          x,
+                  int          y )
 {
-    hoxCHECK_RET(piece, "Piece is NULL.");
-
-    hoxPosition curPos = piece->GetPosition();  // The current position.
-
-    hoxCHECK_RET(curPos.isValid(), "The current position is not valid.");
-    hoxCHECK_RET(m_cells[curPos.x][curPos.y].pPiece == piece, 
-                "There is no such as piece on Board.");
-
-    /* 'Undo' old position, if any */
-    m_cells[curPos.x][curPos.y].pPiece = NULL;
-    m_cells[curPos.x][curPos.y].position = hoxPosition(-1,-1);
+    const int sq = SQUARE( x, y );
+    m_squares[sq] = COLOR_BIT( color ) | type;
+    m_slots[sq]   = slot;
+    m_pieces[slot] = sq;
+    m_key ^= ZOBRIST( m_squares[sq], sq );
+    _SetSquare( sq, true );
 }
 
 /**
- * Carry out the 'capture' action toward a given piece:
- *   + Unset the piece from the Board.
- *   + Move the piece from the ACTIVE list to the INACTIVE list.
+ * Mark a square as occupied (or empty) in the file and rank bitmaps.
  */
-void 
-Board::_CapturePiece( Piece* piece )
+void
+Board::_SetSquare( int  sq,
+                   bool bOccupied )
 {
-    _UnsetPiece( piece );
-
-    PieceList::iterator found;
-
-    found = std::find( m_pieces.begin(), m_pieces.end(), piece );
-    hoxCHECK_RET( found != m_pieces.end(), "The piece is not ACTIVE." );
+    const int x = FILE_OF( sq );
+    const int y = RANK_OF( sq );
 
-    found = std::find( m_deadPieces.begin(), m_deadPieces.end(), piece );
-    hoxCHECK_RET( found == m_deadPieces.end(), "The piece is ready INACTIVE." );
-
-    m_pieces.remove( piece );
-    m_deadPieces.push_back( piece );
+    if ( bOccupied )
+    {
+        m_fileBits[x] |= ( 1 << y );
+        m_rankBits[y] |= ( 1 << x );
+    }
+    else
+    {
+        m_fileBits[x] &= ~( 1 << y );
+        m_rankBits[y] &= ~( 1 << x );
+    }
 }
 
-/**
- * Move an existing piece from its current position to a new position.
- *
- * @side-affects: The piece's position is modified as well.
- */
 void
-Board::_MovePieceTo( Piece*             piece, 
-                     const hoxPosition& newPos )
+Board::GetGameState( hoxPieceInfoList& pieceInfoList,
+                     hoxColor&         nextColor ) const
 {
-    hoxCHECK_RET(piece, "Piece is NULL.");
+    pieceInfoList.clear();    // Clear the old info, if exists.
 
-    hoxPosition curPos = piece->GetPosition();  // The current position.
+    /* Return all the ACTIVE Pieces. */
+    for ( int slot = 0; slot < NUM_SLOTS; ++slot )
+    {
+        const int sq = m_pieces[slot];
+        if ( sq == NO_SQUARE ) continue;
 
-    hoxCHECK_RET(curPos.isValid(), "The current position is not valid.");
-    hoxCHECK_RET(newPos.isValid(), "The new position is not valid.");
+        pieceInfoList.push_back( hoxPieceInfo( PIECE_TYPE( m_squares[sq] ),
+                                               PIECE_COLOR( m_squares[sq] ),
+                                               hoxPosition( FILE_OF( sq ), RANK_OF( sq ) ) ) );
+    }
 
-    _UnsetPiece( piece );
-    piece->SetPosition( newPos );  // Adjust piece's position.
-    _SetPiece( piece );
+    /* Return the Next Color */
+    nextColor = m_nextColor;
 }
 
-Piece* 
-Board::GetPieceAt( const hoxPosition& position ) const
+bool
+Board::GetPieceAtPosition( const hoxPosition& position,
+                           hoxPieceInfo&      pieceInfo ) const
 {
     if ( ! position.isValid() )
-        return NULL;
+        return false;
 
-    return m_cells[position.x][position.y].pPiece;
-}
+    const int piece = m_squares[ SQUARE( position.x, position.y ) ];
+    if ( piece == 0 )
+        return false;
 
-bool
-Board::HasPieceAt( const hoxPosition& position ) const
-{
-    return ( NULL != this->GetPieceAt( position ) );
+    pieceInfo.type     = PIECE_TYPE( piece );
+    pieceInfo.color    = PIECE_COLOR( piece );
+    pieceInfo.position = position;
+    return true;
 }
 
 /**
- * Put a brand new piece on Board.
+ * Count the pieces strictly between two squares on the same file or rank.
+ * @return -1 if the squares are not on the same file or rank.
  */
-void
-Board::_AddNewPiece( Piece* piece )
+int
+Board::_CountBetween( int from,
+                      int to ) const
 {
-    hoxCHECK_RET(piece, "Piece is NULL.");
+    unsigned int bits;
+    int          low, high;
+
+    if ( FILE_OF( from ) == FILE_OF( to ) )
+    {
+        bits = m_fileBits[FILE_OF( from )];
+        low  = RANK_OF( from );
+        high = RANK_OF( to );
+    }
+    else if ( RANK_OF( from ) == RANK_OF( to ) )
+    {
+        bits = m_rankBits[RANK_OF( from )];
+        low  = FILE_OF( from );
+        high = FILE_OF( to );
+    }
+    else
+    {
+        return -1;
+    }
+
+    if ( low > high ) { const int tmp = low; low = high; high = tmp; }
 
-    piece->SetBoard( this );
-    this->_AddPiece( piece );
+    /* Keep only the bits strictly between 'low' and 'high'. */
+    bits &= ( 1u << high ) - 1;
+    bits &= ~( ( 2u << low ) - 1 );
+    return __builtin_popcount( bits );
 }
 
 /**
- * Put a piece on Board.
+ * Locate the first two pieces seen from a square along a direction.
+ * The Chariot-check looks at the first, the Cannon-check at the second.
  */
 void
-Board::_AddPiece( Piece* piece )
+Board::_GetScreens( int  sq,
+                    int  dir,
+                    int& first,
+                    int& second ) const
 {
-    hoxCHECK_RET(piece, "Piece is NULL.");
+    const int    x = FILE_OF( sq );
+    const int    y = RANK_OF( sq );
+    unsigned int bits;
 
-    m_pieces.push_back( piece );
-    _SetPiece( piece );
-}
+    first = second = NO_SQUARE;
 
-void 
-Board::_PutbackPiece( Piece* piece )
-{
-    PieceList::iterator found =
-        std::find( m_deadPieces.begin(), m_deadPieces.end(), piece );
-    hoxCHECK_RET( found != m_deadPieces.end(), "Dead piece should be found." );
-    
-    m_deadPieces.remove( piece );
-    this->_AddPiece( piece );
-}
-
-/**
- * Record a valid Move.
- */
-Piece*
-Board::_RecordMove( const hoxMove& move )
-{
-    // Remove captured piece, if any.
-    Piece* pCaptured = this->GetPieceAt(move.newPosition);
-    if (pCaptured != NULL)
+    switch ( dir )
     {
-        _CapturePiece( pCaptured );
-    }
-
-    // Move the piece to the new position.
-    Piece* piece = this->GetPieceAt(move.piece.position);
-    hoxASSERT_MSG(piece != NULL, 
-                 "Piece must not be NULL after being validated");
-    _MovePieceTo( piece, move.newPosition );
+        case DIR_UP:     /* Towards rank 0: the highest bits below 'y'. */
+        case DIR_LEFT:   /* Towards file 0: the highest bits below 'x'. */
+            bits = ( dir == DIR_UP ? m_fileBits[x] & ( ( 1u << y ) - 1 )
+                                   : m_rankBits[y] & ( ( 1u << x ) - 1 ) );
+            if ( bits == 0 ) return;
+            first = 31 - __builtin_clz( bits );
+            bits &= ~( 1u << first );
+            if ( bits != 0 ) second = 31 - __builtin_clz( bits );
+            break;
 
-    return pCaptured;
-}
+        default:         /* DIR_DOWN or DIR_RIGHT: the lowest bits above. */
+            bits = ( dir == DIR_DOWN ? m_fileBits[x] & ~( ( 2u << y ) - 1 )
+                                     : m_rankBits[y] & ~( ( 2u << x ) - 1 ) );
+            if ( bits == 0 ) return;
+            first = __builtin_ctz( bits );
+            bits &= bits - 1;
+            if ( bits != 0 ) second = __builtin_ctz( bits );
+            break;
+    }
 
-void
-Board::_UndoMove( const hoxMove& move,
-                  Piece*         pCaptured )
-{
-    // Return the piece from its NEW position to its ORIGINAL position.
-    Piece* piece = this->GetPieceAt(move.newPosition);
-    hoxCHECK_RET(piece != NULL, "Piece must not be NULL after being validated");
-    hoxCHECK_RET(piece->GetPosition() == move.newPosition,  // TODO: Move inside GetPieceAt()
-                "The positions do not match.");
-    _MovePieceTo( piece, move.piece.position );
-
-    // "Un-capture" the captured piece, if any.
-    if ( pCaptured != NULL )
+    /* Convert the bit-indexes to squares. */
+    if ( dir == DIR_UP || dir == DIR_DOWN )
     {
-        pCaptured->SetPosition( move.newPosition );
-        this->_PutbackPiece( pCaptured );
+        first = SQUARE( x, first );
+        if ( second != NO_SQUARE ) second = SQUARE( x, second );
     }
-}
-
-const Piece*
-Board::_GetKing( hoxColor color ) const
-{
-    for ( PieceList::const_iterator it = m_pieces.begin(); 
-                                    it != m_pieces.end(); 
-                                  ++it )
+    else
     {
-        if (    (*it)->HasType( hoxPIECE_KING ) 
-             && (*it)->HasColor( color ) )
-        {
-            return (*it);
-        }
+        first = SQUARE( first, y );
+        if ( second != NO_SQUARE ) second = SQUARE( second, y );
     }
-
-    hoxFAIL_MSG( "A King of any color should exist." );
-    return NULL;
 }
 
 /**
- * Check if a King (of a given color) is in CHECK position (being "checked").
- * @return true if the King is being checked.
- *         false, otherwise.
+ * Check whether the piece at a given square can move to (or capture at)
+ * another square, ignoring whether its own King is left in check.
  */
-bool 
-Board::_IsKingBeingChecked( hoxColor color ) const
+bool
+Board::_CanMoveTo( int from,
+                   int to ) const
 {
-    /* Check if a King (of a given color) is being checked:.
-     * This is done as follows:
-     *  + For each piece of the 'enemy', check if the king's position
-     *    is one of its valid move.
-     */
+    const int piece  = m_squares[from];
+    const int target = m_squares[to];
+    const signed char* p;
+    int   i;
 
-    const Piece* pKing = _GetKing( color );
-    hoxASSERT_MSG( pKing != NULL, "King must not be NULL" );
+    if ( piece == 0 || from == to )
+        return false;
+    if ( target != 0 && PIECE_COLOR( target ) == PIECE_COLOR( piece ) )
+        return false; // Capture your OWN piece! Not legal.
 
-    for ( PieceList::const_iterator it = m_pieces.begin(); 
-                                    it != m_pieces.end(); ++it )
+    switch ( PIECE_TYPE( piece ) )
     {
-        if (    ( ! (*it)->HasColor( color ) )  // enemy?
-             && (*it)->IsValidMove( pKing->GetPosition() ) )
+        case hoxPIECE_KING:
+            for ( p = s_tables.king[from]; *p != NO_SQUARE; ++p )
+                if ( *p == to ) return true;
+            return false;
+
+        case hoxPIECE_ADVISOR:
+            for ( p = s_tables.advisor[from]; *p != NO_SQUARE; ++p )
+                if ( *p == to ) return true;
+            return false;
+
+        case hoxPIECE_ELEPHANT:
+            for ( i = 0, p = s_tables.elephant[from]; *p != NO_SQUARE; ++p, ++i )
+                if ( *p == to ) return ( m_squares[(int) s_tables.elephantEye[from][i]] == 0 );
+            return false;
+
+        case hoxPIECE_HORSE:
+            for ( i = 0, p = s_tables.horse[from]; *p != NO_SQUARE; ++p, ++i )
+                if ( *p == to ) return ( m_squares[(int) s_tables.horseLeg[from][i]] == 0 );
+            return false;
+
+        case hoxPIECE_PAWN:
+            for ( p = s_tables.pawn[( piece & RED_BIT ) ? 0 : 1][from]; *p != NO_SQUARE; ++p )
+                if ( *p == to ) return true;
+            return false;
+
+        case hoxPIECE_CHARIOT:
+            return ( _CountBetween( from, to ) == 0 );
+
+        case hoxPIECE_CANNON:
         {
-            return true;
+            const int nBetween = _CountBetween( from, to );
+            if ( target == 0 ) return ( nBetween == 0 );
+            return ( nBetween == 1 );  // A capture needs exactly one screen.
         }
-    }
-
-    return false;  // Not in "checked" position.
-}
-
-// Check if one king is facing another.
-bool 
-Board::_IsKingFaceKing() const
-{
-    const Piece* blackKing = _GetKing( hoxCOLOR_BLACK );
-    hoxASSERT_MSG( blackKing != NULL, "Black King must not be NULL" );
 
-    const Piece* redKing = _GetKing( hoxCOLOR_RED );
-    hoxASSERT_MSG( redKing != NULL, "Red King must not be NULL" );
-
-    if ( ! blackKing->HasSameColumnAs( *redKing ) ) // not the same column.
-        return false;  // Not facing
-
-    // If they are in the same column, check if there is any piece in between.
-    for ( PieceList::const_iterator it = m_pieces.begin(); 
-                                    it != m_pieces.end(); 
-                                  ++it )
-    {
-        if ( (*it) == blackKing || (*it) == redKing )
-            continue;
-
-        if ( (*it)->HasSameColumnAs( *redKing ) )  // in between Kings?
-            return false;  // Not facing
+        default:
+            return false;
     }
-
-    return true;  // Facing
 }
 
-bool
-Board::ValidateMove( hoxMove&       move,
-                     hoxGameStatus& status )
+/**
+ * Move a piece (capturing the target, if any).
+ * @return The captured piece (0 if none).
+ */
+int
+Board::_MakeMove( int from,
+                  int to )
 {
-    const char* FNAME = "Board::ValidateMove";
-
-    /* Check for 'turn' */
-
-    if ( move.piece.color != m_nextColor )
-        return false; // Error! Wrong turn.
-
-    /* Perform a basic validation */
-
-    Piece* piece = this->GetPieceAt( move.piece.position );
-    if ( piece == NULL )
-        return false;
-
-    if ( ! piece->IsValidMove( move.newPosition ) )
-        return false;
-
-    /* At this point, the Move is valid.
-     * Record this move (to validate future Moves).
-     */
-
-    Piece* pCaptured = _RecordMove( move );
-
-    /* If the Move results in its own check-mate OR
-     * there is a KING-face-KING problem...
-     * then it is invalid and must be undone.
-     */
-    if (   _IsKingBeingChecked( move.piece.color )
-        || _IsKingFaceKing() )
+    const int captured = m_squares[to];
+    if ( captured != 0 )
     {
-        _UndoMove(move, pCaptured);
-        return false;
+        m_pieces[(int) m_slots[to]] = NO_SQUARE;
+        m_key ^= ZOBRIST( captured, to );
     }
+    m_key ^= ZOBRIST( m_squares[from], from ) ^ ZOBRIST( m_squares[from], to );
 
-    /* Return the captured-piece, if any */
-    move.setCapturedPiece( pCaptured != NULL ? pCaptured->GetInfo() 
-                                             : hoxPieceInfo() /* 'Empty' piece */ );
+    m_squares[to]   = m_squares[from];
+    m_slots[to]     = m_slots[from];
+    m_pieces[(int) m_slots[to]] = to;
+    m_squares[from] = 0;
+    m_slots[from]   = NO_SQUARE;
 
-    /* Set the next-turn. */
-    m_nextColor = ( m_nextColor == hoxCOLOR_RED ? hoxCOLOR_BLACK
-                                                : hoxCOLOR_RED );
-
-    /* Check for end game:
-     * ------------------
-     *   Checking if this Move makes the Move's Player
-     *   the winner of the game. The step is done by checking to see if the
-     *   opponent can make ANY valid Move at all.
-     *   If not, then the opponent has just lost the game.
-     */
+    _SetSquare( from, false );
+    _SetSquare( to, true );
 
-    if ( ! _DoesNextMoveExist() )
+    return captured;
+}
+
+void
+Board::_UndoMove( int from,
+                  int to,
+                  int captured,
+                  int capturedSlot )
+{
+    m_squares[from] = m_squares[to];
+    m_slots[from]   = m_slots[to];
+    m_pieces[(int) m_slots[from]] = from;
+    m_key ^= ZOBRIST( m_squares[from], from ) ^ ZOBRIST( m_squares[from], to );
+
+    m_squares[to] = captured;
+    m_slots[to]   = capturedSlot;
+    if ( captured != 0 )
     {
-        hoxLog(LOG_DEBUG, "%s: The game is over.", FNAME);
-        status = (  m_nextColor == hoxCOLOR_BLACK ? hoxGAME_STATUS_RED_WIN
-                                                  : hoxGAME_STATUS_BLACK_WIN );
+        m_pieces[capturedSlot] = to;
+        m_key ^= ZOBRIST( captured, to );
     }
     else
     {
-        status = hoxGAME_STATUS_IN_PROGRESS;
+        _SetSquare( to, false );
     }
-
-    return true;
+    _SetSquare( from, true );
 }
 
-bool
-Board::IsLastMoveCheck() const
-{
-    return _IsKingBeingChecked( m_nextColor );
-}
-
-bool
-Board::Simulation_IsValidMove( const hoxMove& move )
+/**
+ * Find a piece checking the King of a given color.
+ *
+ * The search is done outward from the King: the nearest pieces along
+ * the four lines (Chariots and Cannons), the Horse squares whose legs
+ * are free, and the Pawn squares. Advisors and Elephants can never
+ * reach the enemy's King.
+ *
+ * @param screen [OUT] The Cannon's screen or the Horse's leg, if any.
+ * @return The square of the checker, or NO_SQUARE if not in check.
+ */
+int
+Board::_GetChecker( hoxColor color,
+                    int&     screen ) const
 {
-    Piece* piece = this->GetPieceAt( move.piece.position );
-    if ( piece == NULL )
-        return false;
+    const int kingSq = m_pieces[FIRST_SLOT( color )];
+    hoxASSERT_MSG( kingSq != NO_SQUARE, "A King of any color should exist." );
 
-    if ( ! piece->IsValidMove( move.newPosition ) )
-        return false;
-
-    /* Simulate the Move. */
+    const int enemyBit = COLOR_BIT( OTHER_COLOR( color ) );
+    const signed char* p;
+    int   i, first, second;
 
-    Piece* pCaptured = _RecordMove( move );
+    screen = NO_SQUARE;
 
-    /* If the Move ends up results in its own check-mate,
-     * then it is invalid and must be undone.
-     */
-    bool beingChecked = _IsKingBeingChecked( piece->GetColor() );
-    bool areKingsFacing = _IsKingFaceKing();
-
-    _UndoMove( move, pCaptured );
-
-    if ( beingChecked || areKingsFacing )
+    for ( int dir = 0; dir < NUM_DIRS; ++dir )
     {
-        return false;  // Not a good move. Process the next move.
+        _GetScreens( kingSq, dir, first, second );
+        if ( first == NO_SQUARE ) continue;
+        if ( m_squares[first] == ( enemyBit | hoxPIECE_CHARIOT ) )
+            return first;
+        if ( second != NO_SQUARE && m_squares[second] == ( enemyBit | hoxPIECE_CANNON ) )
+        {
+            screen = first;
+            return second;
+        }
     }
 
-    return true;  // It is a valid Move.
-}
-
-bool 
-Board::_DoesNextMoveExist() const
-{
-    /* Go through all Pieces of the 'next' color.
-     * If any piece can move 'next', then Board can as well.
-     */
-
-    for ( PieceList::const_iterator it = m_pieces.begin(); 
-                                    it != m_pieces.end(); ++it )
+    for ( i = 0, p = s_tables.horseCheck[kingSq]; *p != NO_SQUARE; ++p, ++i )
     {
-        if (    (*it)->HasColor( m_nextColor )
-             && (*it)->DoesNextMoveExist() )
+        const int leg = s_tables.horseCheckLeg[kingSq][i];
+        if (    m_squares[(int) *p] == ( enemyBit | hoxPIECE_HORSE )
+             && m_squares[leg] == 0 )
         {
-                return true;
+            screen = leg;
+            return *p;
         }
     }
 
-    return false;
-}
-
-//-----------------------------------------------------------------------------
-// Piece
-//-----------------------------------------------------------------------------
-
-bool 
-Piece::IsValidMove( const hoxPosition& newPos ) const
-{
-    if ( ! this->CanMoveTo( newPos ) )
-        return false;
-
-    /* If this is an Capture-Move, make sure the captured piece 
-     * is an 'enemy'. 
-     */
-    const Piece* capturedPiece = m_board->GetPieceAt( newPos );
-    if (   capturedPiece != NULL 
-        && capturedPiece->HasColor( m_info.color ) )
+    for ( p = s_tables.pawnCheck[color == hoxCOLOR_RED ? 1 : 0][kingSq]; *p != NO_SQUARE; ++p )
     {
-        return false; // Capture your OWN piece! Not legal.
+        if ( m_squares[(int) *p] == ( enemyBit | hoxPIECE_PAWN ) )
+            return *p;
     }
 
-    return true;
+    return NO_SQUARE;  // Not in "checked" position.
 }
 
-bool 
-Piece::DoesNextMoveExist() const
+/**
+ * Check if a King (of a given color) is in CHECK position (being "checked").
+ * @return true if the King is being checked.
+ *         false, otherwise.
+ */
+bool
+Board::_IsKingBeingChecked( hoxColor color ) const
 {
-    bool  nextMoveExits = false;
-
-    /* Generate all potential 'next' positions. */
-
-    PositionList positions;  // all potential 'next' positions.
-
-    this->GetPotentialNextPositions( positions );
-
-    /* For each potential 'next' position, check if this piece can 
-     * actually move there. 
-     */
-
-    hoxMove move;
-    move.piece = this->m_info;
-
-    for ( PositionList::const_iterator it = positions.begin();
-                                       it != positions.end(); ++it )
-    {
-        if ( ! (*it)->isValid() ) continue;
-
-        move.newPosition = *(*it);
-        
-        /* Ask the Board to validate this Move in Simulation mode. */
-        if ( m_board->Simulation_IsValidMove( move ) )
-        {
-            nextMoveExits = true;
-            break;
-        }
-    }
-
-    PositionList_Clear( positions ); // Release memory.
-
-    return nextMoveExits;
+    int screen;
+    return ( _GetChecker( color, screen ) != NO_SQUARE );
 }
 
-//-----------------------------------------------------------------------------
-// KingPiece
-//-----------------------------------------------------------------------------
-
-bool 
-KingPiece::CanMoveTo( const hoxPosition& newPos ) const
-{
-    const hoxColor myColor = m_info.color;
-    const hoxPosition   curPos = m_info.position;
-
-    // Within the palace...?
-    if ( !newPos.isInsidePalace(myColor) ) 
-        return false;
-
-    // Is a 1-cell horizontal or vertical move?
-    if ( ! (   (abs(newPos.x - curPos.x) == 1 && newPos.y == curPos.y)
-            || (newPos.x == curPos.x && abs(newPos.y - curPos.y) == 1)) )
-    {
-        return false;
-    }
+// Check if one king is facing another.
+bool
+Board::_IsKingFaceKing() const
+{
+    const int redKing   = m_pieces[RED_SLOT];
+    const int blackKing = m_pieces[BLACK_SLOT];
 
-    // NOTE: The caller will check if the captured piece (if any) is allowed.
+    if ( FILE_OF( redKing ) != FILE_OF( blackKing ) ) // not the same column.
+        return false;  // Not facing
 
-    return true;
+    return ( _CountBetween( blackKing, redKing ) == 0 );
 }
 
-void 
-KingPiece::GetPotentialNextPositions(PositionList& positions) const
+/**
+ * Check whether a pseudo-legal Move leaves its own King safe.
+ * The Board is left unchanged.
+ */
+bool
+Board::_IsLegalAfterMove( int from,
+                          int to )
 {
-    const hoxPosition p = this->GetPosition();
-    
-    positions.clear();
-
-    // ... Simply use the 4 possible positions.
-    positions.push_back( new hoxPosition(p.x, p.y-1) );
-    positions.push_back( new hoxPosition(p.x, p.y+1) );
-    positions.push_back( new hoxPosition(p.x-1, p.y) );
-    positions.push_back( new hoxPosition(p.x+1, p.y) );
-}
+    const hoxColor color        = PIECE_COLOR( m_squares[from] );
+    const int      capturedSlot = m_slots[to];
+    const int      captured     = _MakeMove( from, to );
 
-//-----------------------------------------------------------------------------
-// AdvisorPiece
-//-----------------------------------------------------------------------------
+    const bool bLegal = ( ! _IsKingBeingChecked( color ) && ! _IsKingFaceKing() );
 
-bool 
-AdvisorPiece::CanMoveTo( const hoxPosition& newPos ) const
-{
-    const hoxColor myColor = m_info.color;
-    const hoxPosition   curPos = m_info.position;
+    _UndoMove( from, to, captured, capturedSlot );
+    return bLegal;
+}
 
-    // Within the palace...?
-    if ( !newPos.isInsidePalace(myColor) ) 
+/**
+ * Make a Move of the next side if it is legal, and record it.
+ *
+ * @param captured [OUT] The captured piece (0 if none).
+ * @return false if the Move is not legal (the Board is unchanged).
+ */
+bool
+Board::_PlayMove( int  from,
+                  int  to,
+                  int& captured )
+{
+    /* Perform a basic validation */
+    if (    m_squares[from] == 0
+         || PIECE_COLOR( m_squares[from] ) != m_nextColor
+         || ! _CanMoveTo( from, to ) )
+    {
         return false;
+    }
+
+    /* At this point, the Move is valid.
+     * Record this move (to validate future Moves).
+     */
+    const int capturedSlot = m_slots[to];
+    captured = _MakeMove( from, to );
 
-    // Is a 1-cell diagonal move?
-    if (! (abs(newPos.x - curPos.x) == 1 && abs(newPos.y - curPos.y) == 1) )
+    /* If the Move results in its own check-mate OR
+     * there is a KING-face-KING problem...
+     * then it is invalid and must be undone.
+     */
+    if (   _IsKingBeingChecked( m_nextColor )
+        || _IsKingFaceKing() )
+    {
+        _UndoMove( from, to, captured, capturedSlot );
         return false;
+    }
 
-    // NOTE: The caller will check if the captured piece (if any) is allowed.
+    /* Set the next-turn. */
+    m_nextColor = OTHER_COLOR( m_nextColor );
+    m_key ^= s_tables.zobristBlack;
+
+    /* Record the new position. */
+    HistoryEntry entry;
+    entry.key          = m_key;
+    entry.from         = from;
+    entry.to           = to;
+    entry.captured     = captured;
+    entry.capturedSlot = capturedSlot;
+    m_history.push_back( entry );
+    ++m_keyCounts[m_key];
 
     return true;
-
 }
 
-void 
-AdvisorPiece::GetPotentialNextPositions(PositionList& positions) const
+/**
+ * Check for end game:
+ * ------------------
+ *   The side to move loses the game if it cannot make ANY valid Move.
+ */
+hoxGameStatus
+Board::_GetEndGameStatus()
 {
-    const hoxPosition p = this->GetPosition();
-    
-    positions.clear();
-
-    // ... Simply use the 4 possible positions.
-    positions.push_back(new hoxPosition(p.x-1, p.y-1));
-    positions.push_back(new hoxPosition(p.x-1, p.y+1));
-    positions.push_back(new hoxPosition(p.x+1, p.y-1));
-    positions.push_back(new hoxPosition(p.x+1, p.y+1));
-}
+    if ( _DoesNextMoveExist() )
+    {
+        return hoxGAME_STATUS_IN_PROGRESS;
+    }
 
-//-----------------------------------------------------------------------------
-// ElephantPiece
-//-----------------------------------------------------------------------------
+    return (  m_nextColor == hoxCOLOR_BLACK ? hoxGAME_STATUS_RED_WIN
+                                            : hoxGAME_STATUS_BLACK_WIN );
+}
 
-bool 
-ElephantPiece::CanMoveTo( const hoxPosition& newPos ) const
+bool
+Board::ValidateMove( hoxMove&       move,
+                     hoxGameStatus& status )
 {
-    const hoxColor myColor = m_info.color;
-    const hoxPosition curPos = m_info.position;
+    const char* FNAME = "Board::ValidateMove";
 
-    // Within the country...?
-    if ( !newPos.isInsideCountry(myColor) ) // crossed the river/border?
-        return false;
+    /* Check for 'turn' */
+    if ( move.piece.color != m_nextColor )
+        return false; // Error! Wrong turn.
 
-    // Is a 2-cell diagonal move?
-    if (! (abs(newPos.x - curPos.x) == 2 && abs(newPos.y - curPos.y) == 2) )
+    if ( ! move.piece.position.isValid() || ! move.newPosition.isValid() )
         return false;
 
-    // ... and there is no piece on the diagonal (to hinder the move)
-    hoxPosition centerPos((curPos.x+newPos.x)/2, (curPos.y+newPos.y)/2);
-    if ( m_board->HasPieceAt(centerPos) )
+    int captured = 0;
+    if ( ! _PlayMove( SQUARE( move.piece.position.x, move.piece.position.y ),
+                      SQUARE( move.newPosition.x, move.newPosition.y ),
+                      captured ) )
+    {
         return false;
+    }
 
-    // NOTE: The caller will check if the captured piece (if any) is allowed.
+    /* Return the captured-piece, if any */
+    move.setCapturedPiece( captured != 0
+                          ? hoxPieceInfo( PIECE_TYPE( captured ), PIECE_COLOR( captured ),
+                                          move.newPosition )
+                          : hoxPieceInfo() /* 'Empty' piece */ );
+
+    /* Check if this Move makes the Move's Player the winner of the game. */
+    status = _GetEndGameStatus();
+    if ( status != hoxGAME_STATUS_IN_PROGRESS )
+    {
+        hoxLog(LOG_DEBUG, "%s: The game is over.", FNAME);
+    }
 
     return true;
 }
 
-void 
-ElephantPiece::GetPotentialNextPositions(PositionList& positions) const
-{
-    const hoxPosition p = this->GetPosition();
-    
-    positions.clear();
-
-    // ... Simply use the 4 possible positions.
-    positions.push_back(new hoxPosition(p.x-2, p.y-2));
-    positions.push_back(new hoxPosition(p.x-2, p.y+2));
-    positions.push_back(new hoxPosition(p.x+2, p.y-2));
-    positions.push_back(new hoxPosition(p.x+2, p.y+2));
-}
-
-//-----------------------------------------------------------------------------
-// ChariotPiece
-//-----------------------------------------------------------------------------
-
-bool 
-ChariotPiece::CanMoveTo( const hoxPosition& newPos ) const
+/**
+ * Set up a position from a FEN string: the ranks from BLACK's side
+ * (y = 0) to RED's side (y = 9), upper-case letters for RED pieces,
+ * then the side to move ('w' or 'r' for RED, 'b' for BLACK).
+ * Anything after the side to move is ignored.
+ *
+ * @return false if the string is not a valid position.
+ */
+bool
+Board::LoadPosition( const std::string& sFen )
 {
-    const hoxPosition   curPos = m_info.position;
+    /* The maximum number of pieces of each type (per side). */
+    static const int MAX_COUNT[8] = { 0, 1, 2, 2, 2, 2, 2, 5 };
 
-    bool bIsValidMove = false;
+    int    counts[2][8] = { { 0 } };
+    int    nextSlot[2]  = { RED_SLOT + 1, BLACK_SLOT + 1 };  // After the King.
+    int    x = 0;
+    int    y = 0;
+    size_t i = 0;
 
-    // Is a horizontal or vertical move?
-    if (! (  (newPos.x != curPos.x && newPos.y == curPos.y)
-          || (newPos.x == curPos.x && newPos.y != curPos.y) ) )
+    for ( int sq = 0; sq < NUM_SQUARES; ++sq )
     {
-        return false;
+        m_squares[sq] = 0;
+        m_slots[sq]   = NO_SQUARE;
     }
+    for ( int slot = 0; slot < NUM_SLOTS; ++slot ) m_pieces[slot] = NO_SQUARE;
+    for ( x = 0; x < 9; ++x )  m_fileBits[x] = 0;
+    for ( y = 0; y < 10; ++y ) m_rankBits[y] = 0;
+    m_key = 0;
 
-    // Make sure there is no piece that hinders the move from the current
-    // position to the new.
-    //
-    //          top
-    //           ^
-    //           |
-    //  left <-- +  ---> right
-    //           |
-    //           v
-    //         bottom
-    // 
-
-    PositionList middlePieces;
-    hoxPosition* pPos = 0;
-    int i;
-
-    // If the new position is on TOP.
-    if (newPos.y < curPos.y)
+    /* The piece placement. */
+    for ( x = 0, y = 0; i < sFen.size() && sFen[i] != ' '; ++i )
     {
-        for (i = newPos.y+1; i < curPos.y; ++i)
+        const char c = sFen[i];
+
+        if ( c == '/' )
         {
-            pPos = new hoxPosition(curPos.x, i);
-            middlePieces.push_back( pPos );
+            if ( x != 9 || ++y > 9 ) return false;
+            x = 0;
         }
-    }
-    // If the new position is on the RIGHT.
-    else if (newPos.x > curPos.x)
-    {
-        for (i = curPos.x+1; i < newPos.x; ++i)
+        else if ( c >= '1' && c <= '9' )
         {
-            pPos = new hoxPosition(i, curPos.y);
-            middlePieces.push_back(pPos);
+            x += c - '0';
+            if ( x > 9 ) return false;
         }
-    }
-    // If the new position is at the BOTTOM.
-    else if (newPos.y > curPos.y)
-    {
-        for (i = curPos.y+1; i < newPos.y; ++i)
+        else
         {
-            pPos = new hoxPosition(curPos.x, i);
-            middlePieces.push_back(pPos);
+            const hoxPieceType type = FEN_TO_TYPE( c );
+            if ( type == hoxPIECE_INVALID || x > 8 ) return false;
+
+            const hoxColor color = ( c >= 'A' && c <= 'Z' ? hoxCOLOR_RED : hoxCOLOR_BLACK );
+            const int      side  = ( color == hoxCOLOR_RED ? 0 : 1 );
+            if (    ++counts[side][type] > MAX_COUNT[type]
+                 || ! IS_REACHABLE( type, color, x, y ) )
+            {
+                return false;
+            }
+
+            _AddPiece( ( type == hoxPIECE_KING ? FIRST_SLOT( color ) : nextSlot[side]++ ),
+                       type, color, x, y );
+            ++x;
         }
     }
-    // If the new position is on the LEFT.
-    else if (newPos.x < curPos.x)
+    if ( y != 9 || x != 9 ) return false;
+
+    /* The side to move. */
+    while ( i < sFen.size() && sFen[i] == ' ' ) ++i;
+    if ( i == sFen.size() || sFen[i] == 'w' || sFen[i] == 'r' )
+        m_nextColor = hoxCOLOR_RED;
+    else if ( sFen[i] == 'b' )
+        m_nextColor = hoxCOLOR_BLACK;
+    else
+        return false;
+
+    if ( m_nextColor == hoxCOLOR_BLACK ) m_key ^= s_tables.zobristBlack;
+
+    /* Both Kings must be there, and the side that has just moved must
+     * not be left in check.
+     */
+    if (    m_pieces[RED_SLOT] == NO_SQUARE || m_pieces[BLACK_SLOT] == NO_SQUARE
+         || _IsKingFaceKing()
+         || _IsKingBeingChecked( OTHER_COLOR( m_nextColor ) ) )
     {
-        for (i = newPos.x+1; i < curPos.x; ++i)
-        {
-            pPos = new hoxPosition(i, curPos.y);
-            middlePieces.push_back(pPos);
-        }
+        return false;
     }
 
-    // Check that no middle pieces exist from the new to the current position.
-    for ( PositionList::const_iterator it = middlePieces.begin();
-                                       it != middlePieces.end();
-                                     ++it )
+    /* Start the position history. */
+    m_initialKey = m_key;
+    m_history.clear();
+    m_keyCounts.clear();
+    m_keyCounts[m_key] = 1;
+
+    return true;
+}
+
+/**
+ * Apply a list of Moves ("xyXY" strings) from the current position,
+ * checking for the end of the game only in the final position.
+ *
+ * @return The number of Moves applied. If it is less than the number
+ *         of Moves given, the next Move is not valid and the Board is
+ *         left at the position before it.
+ */
+size_t
+Board::ApplyMoves( const std::list<std::string>& moves,
+                   hoxGameStatus&                status )
+{
+    size_t nApplied = 0;
+    int    captured = 0;
+
+    m_history.reserve( m_history.size() + moves.size() );
+
+    for ( std::list<std::string>::const_iterator it = moves.begin();
+                                                 it != moves.end(); ++it )
     {
-        if ( m_board->HasPieceAt( *(*it) ) )
+        const std::string& sMove = *it;
+        if ( sMove.size() != 4 ) break;
+
+        const int x1 = sMove[0] - '0';
+        const int y1 = sMove[1] - '0';
+        const int x2 = sMove[2] - '0';
+        const int y2 = sMove[3] - '0';
+        if (    ! IS_ON_BOARD( x1, y1 ) || ! IS_ON_BOARD( x2, y2 )
+             || ! _PlayMove( SQUARE( x1, y1 ), SQUARE( x2, y2 ), captured ) )
         {
-            goto cleanup;  // return with 'invalid' move
+            break;
         }
+        ++nApplied;
     }
 
-    // NOTE: The caller will check if the captured piece (if any) is allowed.
-
-    // Finally, return 'valid' move.
-    bIsValidMove = true;
-
-cleanup:
-    PositionList_Clear( middlePieces ); // Release memory.
+    status = _GetEndGameStatus();
+    return nApplied;
+}
 
-    return bIsValidMove;
+bool
+Board::IsLastMoveCheck() const
+{
+    return _IsKingBeingChecked( m_nextColor );
 }
 
-void 
-ChariotPiece::GetPotentialNextPositions(PositionList& positions) const
+/**
+ * Collect the pseudo-legal targets of the piece at a given square
+ * (ignoring whether its own King is left in check).
+ *
+ * @param targets [OUT] The buffer of at least MAX_TARGETS squares.
+ * @return The number of targets.
+ */
+int
+Board::_GetTargets( int          from,
+                    signed char* targets ) const
 {
-    const hoxPosition p = this->GetPosition();
-    
-    positions.clear();
+    const int piece = m_squares[from];
+    const signed char* p = NULL;
+    int   nTargets = 0;
 
-    // ... Horizontally.
-    for ( int x = 0; x <= 8; ++x )
+    switch ( PIECE_TYPE( piece ) )
     {
-        if ( x == p.x ) continue;
-        positions.push_back(new hoxPosition(x, p.y));
+        case hoxPIECE_KING:     p = s_tables.king[from];     break;
+        case hoxPIECE_ADVISOR:  p = s_tables.advisor[from];  break;
+        case hoxPIECE_ELEPHANT: p = s_tables.elephant[from]; break;
+        case hoxPIECE_HORSE:    p = s_tables.horse[from];    break;
+        case hoxPIECE_PAWN:
+            p = s_tables.pawn[( piece & RED_BIT ) ? 0 : 1][from];
+            break;
 
+        case hoxPIECE_CHARIOT:
+        case hoxPIECE_CANNON:
+            /* Walk each ray up to (and including) the first blocker,
+             * plus the second blocker for a Cannon.
+             */
+            for ( int dir = 0; dir < NUM_DIRS; ++dir )
+            {
+                int nBlockers = 0;
+                for ( p = s_tables.ray[from][dir];
+                      *p != NO_SQUARE && nBlockers < 2; ++p )
+                {
+                    if ( _CanMoveTo( from, *p ) ) targets[nTargets++] = *p;
+                    if ( m_squares[(int) *p] != 0 ) ++nBlockers;
+                }
+            }
+            return nTargets;
+
+        default:
+            return 0;
     }
 
-    // ... Vertically
-    for ( int y = 0; y <= 9; ++y )
+    for ( ; *p != NO_SQUARE; ++p )
     {
-        if ( y == p.y ) continue;
-        positions.push_back(new hoxPosition(p.x, y));
-
+        if ( _CanMoveTo( from, *p ) ) targets[nTargets++] = *p;
     }
+    return nTargets;
 }
 
-//-----------------------------------------------------------------------------
-// HorsePiece
-//-----------------------------------------------------------------------------
-
-bool 
-HorsePiece::CanMoveTo( const hoxPosition& newPos ) const
+/**
+ * Check whether the piece at a given square has at least one legal Move.
+ *
+ * @param bUsePins If true, a piece standing outside the pin-mask of its
+ *                 own King and moving outside the King's lines is
+ *                 accepted without simulating the Move.
+ */
+bool
+Board::_HasLegalMoveFrom( int  from,
+                          bool bUsePins )
 {
-    const hoxPosition   curPos = m_info.position;
-
-    /* Is a 2-1-rectangle move? */
-
-    // Make sure there is no piece that hinders the move if the move
-    // start from one of the four 'neighbors' below.
-    //
-    //          top
-    //           ^
-    //           |
-    //  left <-- +  ---> right
-    //           |
-    //           v
-    //         bottom
-    // 
-
-    hoxPosition neighbor;
-
-    // If the new position is on TOP.
-    if ( (curPos.y - 2) == newPos.y && abs(newPos.x - curPos.x) == 1 )
-    {
-        neighbor = hoxPosition(curPos.x, curPos.y-1); 
-    }
-    // If the new position is at the BOTTOM.
-    else if ( (curPos.y + 2) == newPos.y && abs(newPos.x - curPos.x) == 1 )
-    {
-        neighbor = hoxPosition(curPos.x, curPos.y+1); 
-    }
-    // If the new position is on the RIGHT.
-    else if ( (curPos.x + 2) == newPos.x && abs(newPos.y - curPos.y) == 1 )
-    {
-        neighbor = hoxPosition(curPos.x+1, curPos.y); 
-    }
-    // If the new position is on the LEFT.
-    else if ( (curPos.x - 2) == newPos.x && abs(newPos.y - curPos.y) == 1 )
-    {
-        neighbor = hoxPosition(curPos.x-1, curPos.y); 
-    }
-    else
+    const int  kingSq = m_pieces[FIRST_SLOT( PIECE_COLOR( m_squares[from] ) )];
+    const bool bFree  = ( bUsePins && ! IS_PIN_SQUARE( kingSq, from ) );
+    signed char targets[MAX_TARGETS];
+
+    const int nTargets = _GetTargets( from, targets );
+    for ( int i = 0; i < nTargets; ++i )
     {
-        return false;
+        if (    ( bFree && ! IS_ON_LINES( kingSq, targets[i] ) )
+             || _IsLegalAfterMove( from, targets[i] ) )
+        {
+            return true;
+        }
     }
 
-    // If the neighbor exists, then the move is invalid.
-    if ( m_board->HasPieceAt( neighbor ) ) 
-        return false;
-
-    // NOTE: The caller will check if the captured piece (if any) is allowed.
-
-    return true;
+    return false;
 }
 
-void 
-HorsePiece::GetPotentialNextPositions(PositionList& positions) const
+/**
+ * Check whether any piece other than the King (of the 'next' color)
+ * can legally move to a given square.
+ */
+bool
+Board::_CanAnyPieceMoveTo( int to )
 {
-    const hoxPosition p = this->GetPosition();
-    
-    positions.clear();
-
-    // ... Check for the 8 possible positions.
-    positions.push_back(new hoxPosition(p.x-1, p.y-2));
-    positions.push_back(new hoxPosition(p.x-1, p.y+2));
-    positions.push_back(new hoxPosition(p.x-2, p.y-1));
-    positions.push_back(new hoxPosition(p.x-2, p.y+1));
-    positions.push_back(new hoxPosition(p.x+1, p.y-2));
-    positions.push_back(new hoxPosition(p.x+1, p.y+2));
-    positions.push_back(new hoxPosition(p.x+2, p.y-1));
-    positions.push_back(new hoxPosition(p.x+2, p.y+1));
-}
+    const int firstSlot = FIRST_SLOT( m_nextColor );
 
-//-----------------------------------------------------------------------------
-// CannonPiece
-//-----------------------------------------------------------------------------
+    for ( int slot = firstSlot + 1; slot < firstSlot + 16; ++slot )
+    {
+        const int from = m_pieces[slot];
+        if (    from != NO_SQUARE
+             && _CanMoveTo( from, to )
+             && _IsLegalAfterMove( from, to ) )
+        {
+            return true;
+        }
+    }
 
-bool 
-CannonPiece::CanMoveTo( const hoxPosition& newPos ) const
+    return false;
+}
+
+/**
+ * Check whether the 'next' color has any legal Move, without generating
+ * the list of Moves.
+ *
+ * The King's moves are tried first. If the King is in check, the only
+ * other candidates are capturing the checker, blocking it (the squares
+ * between a Chariot/Cannon and the King, or a Horse's leg), and moving
+ * the Cannon's screen away. Otherwise, a piece outside the King's
+ * pin-mask has a legal Move as soon as it has a pseudo-legal one.
+ */
+bool
+Board::_DoesNextMoveExist()
 {
-    const hoxColor myColor = m_info.color;
-    const hoxPosition   curPos = m_info.position;
+    const int firstSlot = FIRST_SLOT( m_nextColor );
+    const int kingSq    = m_pieces[firstSlot];
 
-    bool bIsValidMove = false;
+    /* 1. The King's own moves. */
+    if ( _HasLegalMoveFrom( kingSq, false /* bUsePins */ ) )
+        return true;
 
-    // Is a horizontal or vertical move?
-    if (! (  (newPos.x != curPos.x && newPos.y == curPos.y)
-          || (newPos.x == curPos.x && newPos.y != curPos.y) ) )
-    {
-        return false;
-    }
+    int screen = NO_SQUARE;
+    const int checker = _GetChecker( m_nextColor, screen );
 
-    // Make sure there is no piece that hinders the move from the current
-    // position to the new.
-    //
-    //          top
-    //           ^
-    //           |
-    //  left <-- +  ---> right
-    //           |
-    //           v
-    //         bottom
-    // 
-
-    PositionList middlePieces;
-    hoxPosition* pPos = 0;
-    int i;
-
-    // If the new position is on TOP.
-    if (newPos.y < curPos.y)
-    {
-        for (i = newPos.y+1; i < curPos.y; ++i)
-        {
-            pPos = new hoxPosition(curPos.x, i);
-            middlePieces.push_back(pPos);
-        }
-    }
-    // If the new position is on the RIGHT.
-    else if (newPos.x > curPos.x)
-    {
-        for (i = curPos.x+1; i < newPos.x; ++i)
-        {
-            pPos = new hoxPosition(i, curPos.y);
-            middlePieces.push_back(pPos);
-        }
-    }
-    // If the new position is at the BOTTOM.
-    else if (newPos.y > curPos.y)
-    {
-        for (i = curPos.y+1; i < newPos.y; ++i)
-        {
-            pPos = new hoxPosition(curPos.x, i);
-            middlePieces.push_back(pPos);
-        }
-    }
-    // If the new position is on the LEFT.
-    else if (newPos.x < curPos.x)
+    if ( checker == NO_SQUARE )  // Not in check?
     {
-        for (i = newPos.x+1; i < curPos.x; ++i)
+        for ( int slot = firstSlot + 1; slot < firstSlot + 16; ++slot )
         {
-            pPos = new hoxPosition(i, curPos.y);
-            middlePieces.push_back(pPos);
+            const int from = m_pieces[slot];
+            if ( from != NO_SQUARE && _HasLegalMoveFrom( from, true /* bUsePins */ ) )
+                return true;
         }
+        return false;
     }
 
-    // Check to see how many middle pieces exist from the 
-    // new to the current position.
-    int numMiddle = 0;
-    for ( PositionList::const_iterator it = middlePieces.begin();
-                                       it != middlePieces.end(); ++it )
-    {
-        if ( m_board->HasPieceAt( *(*it)) )
-            ++numMiddle;
-    }
+    /* 2. Capture the checker. */
+    if ( _CanAnyPieceMoveTo( checker ) )
+        return true;
 
-    // If there are more than 1 middle piece, return 'invalid'.
-    if (numMiddle > 1)
-    {
-        goto cleanup;  // return with 'invalid'
-    }
-    // If there is exactly 1 middle pieces, this must be a Capture Move.
-    else if (numMiddle == 1)
+    /* 3. Block the checker. */
+    switch ( PIECE_TYPE( m_squares[checker] ) )
     {
-        const Piece* capturedPiece = m_board->GetPieceAt(newPos);
-        if ( !capturedPiece || capturedPiece->GetColor() == myColor) 
+        case hoxPIECE_HORSE:
+            return _CanAnyPieceMoveTo( screen );  // The Horse's leg.
+
+        case hoxPIECE_CHARIOT:
+        case hoxPIECE_CANNON:
         {
-            goto cleanup;  // return with 'invalid'
+            const int dir = ( FILE_OF( checker ) == FILE_OF( kingSq )
+                              ? ( checker < kingSq ? DIR_UP : DIR_DOWN )
+                              : ( checker < kingSq ? DIR_LEFT : DIR_RIGHT ) );
+            for ( const signed char* p = s_tables.ray[kingSq][dir]; *p != checker; ++p )
+            {
+                if ( m_squares[(int) *p] == 0 && _CanAnyPieceMoveTo( *p ) )
+                    return true;
+            }
+
+            /* Move away the Cannon's screen, if it is ours. */
+            if (    screen != NO_SQUARE
+                 && PIECE_COLOR( m_squares[screen] ) == m_nextColor
+                 && _HasLegalMoveFrom( screen, false /* bUsePins */ ) )
+            {
+                return true;
+            }
+            return false;
         }
+
+        default:
+            return false;  // A Pawn's check cannot be blocked.
     }
-    // If there is no middle piece, make sure that no piece is captured.
-    else   // numMiddle = 0
+}
+
+/**
+ * Check whether the opponent of the piece at a given square could
+ * legally capture it.
+ */
+bool
+Board::_IsProtected( int sq )
+{
+    const int firstSlot = FIRST_SLOT( OTHER_COLOR( PIECE_COLOR( m_squares[sq] ) ) );
+
+    for ( int slot = firstSlot; slot < firstSlot + 16; ++slot )
     {
-        if ( m_board->HasPieceAt(newPos) ) 
+        const int from = m_pieces[slot];
+        if (    from != NO_SQUARE
+             && _CanMoveTo( from, sq )
+             && _IsLegalAfterMove( from, sq ) )
         {
-            goto cleanup;  // return with 'invalid'
+            return true;
         }
     }
 
-    // Finally, return 'valid' move.
-    bIsValidMove = true;
-
-cleanup:
-    PositionList_Clear( middlePieces ); // Release memory.
-
-    return bIsValidMove;
+    return false;
 }
 
-void 
-CannonPiece::GetPotentialNextPositions(PositionList& positions) const
+/**
+ * Find the enemy pieces that a given color is threatening to capture.
+ *
+ * Following the Asian rules, a piece is threatened if it can be legally
+ * captured, and it is either unprotected or worth more than its attacker.
+ * The Kings and Pawns may chase freely, and a Pawn that has not crossed
+ * the river may be chased freely.
+ *
+ * @return The bitmask of the threatened pieces' slots.
+ */
+unsigned int
+Board::_GetThreats( hoxColor color )
 {
-    const hoxPosition p = this->GetPosition();
-    
-    positions.clear();
-
-    // ... Horizontally.
-    for ( int x = 0; x <= 8; ++x )
-    {
-        if ( x == p.x ) continue;
-        positions.push_back(new hoxPosition(x, p.y));
+    /* The value of each piece-type, indexed by hoxPieceType. */
+    static const int VALUE[8] = { 0, 0, 2, 2, 9, 4, 4, 2 };
 
-    }
+    const int firstSlot = FIRST_SLOT( color );
+    const int enemySlot = FIRST_SLOT( OTHER_COLOR( color ) );
+    unsigned int threats = 0;
 
-    // ... Vertically
-    for ( int y = 0; y <= 9; ++y )
+    for ( int slot = firstSlot + 1; slot < firstSlot + 16; ++slot )
     {
-        if ( y == p.y ) continue;
-        positions.push_back(new hoxPosition(p.x, y));
+        const int from = m_pieces[slot];
+        if ( from == NO_SQUARE ) continue;
+
+        const hoxPieceType attacker = PIECE_TYPE( m_squares[from] );
+        if ( attacker == hoxPIECE_PAWN ) continue;
 
+        for ( int target = enemySlot + 1; target < enemySlot + 16; ++target )
+        {
+            const int to = m_pieces[target];
+            if ( to == NO_SQUARE ) continue;
+
+            const hoxPieceType victim = PIECE_TYPE( m_squares[to] );
+            if (    victim == hoxPIECE_PAWN
+                 && ( color == hoxCOLOR_RED ? RANK_OF( to ) <= 4 : RANK_OF( to ) >= 5 ) )
+            {
+                continue;  // Not yet crossed the river.
+            }
+
+            if ( ! _CanMoveTo( from, to ) || ! _IsLegalAfterMove( from, to ) )
+                continue;
+
+            bool bThreat = ( VALUE[victim] > VALUE[attacker] );
+            if ( ! bThreat )
+            {
+                const int capturedSlot = m_slots[to];
+                const int captured     = _MakeMove( from, to );
+                bThreat = ! _IsProtected( to );
+                _UndoMove( from, to, captured, capturedSlot );
+            }
+
+            if ( bThreat ) threats |= ( 1u << target );
+        }
     }
-}
 
-//-----------------------------------------------------------------------------
-// PawnPiece
-//-----------------------------------------------------------------------------
+    return threats;
+}
 
-bool 
-PawnPiece::CanMoveTo( const hoxPosition& newPos ) const
+/**
+ * Judge the Game if the current position has occurred too many times.
+ *
+ * Each Move since the first occurrence of the position is classified as
+ * a check, a chase (making a new threat), or idle. A side whose Moves are
+ * all checks or chases loses against an idle side; perpetual check loses
+ * against perpetual chase; otherwise the Game is drawn.
+ *
+ * @return IN_PROGRESS if the position has not repeated enough.
+ */
+hoxGameStatus
+Board::JudgeRepetition( std::string& sReason ) const
 {
-    const hoxColor myColor = m_info.color;
-    const hoxPosition   curPos = m_info.position;
+    const char* FNAME = "Board::JudgeRepetition";
 
-    bool bMoveValid = false;
+    KeyCountMap::const_iterator found = m_keyCounts.find( m_key );
+    if ( found == m_keyCounts.end() || found->second < hoxREPETITION_MAX )
+        return hoxGAME_STATUS_IN_PROGRESS;
 
-    // Within the country...?
-    if ( newPos.isInsideCountry(myColor) ) 
+    /* Locate the first occurrence. The Moves after it form the cycles. */
+    size_t nFirst = 0;
+    if ( m_initialKey != m_key )
     {
-        // Can only move up.
-        if ( newPos.x == curPos.x && 
-           (   (myColor == hoxCOLOR_BLACK && newPos.y == curPos.y+1)
-             || (myColor == hoxCOLOR_RED && newPos.y == curPos.y-1)) )
-        {
-            bMoveValid = true;
-        }
+        while ( m_history[nFirst].key != m_key ) ++nFirst;
+        ++nFirst;
     }
-    // Outside the country (alread crossed the 'river')
-    else
+
+    /* Walk back through the cycles on a scratch Board. */
+    Board scratch( *this );
+    bool  bForbidden[2] = { true, true };  // [0] = RED, [1] = BLACK
+    bool  bAllChecks[2] = { true, true };
+
+    for ( size_t i = m_history.size(); i-- > nFirst; )
     {
-        // Only horizontally (LEFT or RIGHT)
-        // ... or 1-way-UP vertically.
-        if ( ( newPos.y == curPos.y 
-                    && abs(newPos.x - curPos.x) == 1 )
-            || (newPos.x == curPos.x
-                  && ( (myColor == hoxCOLOR_BLACK && newPos.y == curPos.y+1)
-                    || (myColor == hoxCOLOR_RED && newPos.y == curPos.y-1))) )
+        const HistoryEntry& entry = m_history[i];
+        const hoxColor mover = PIECE_COLOR( scratch.m_squares[(int) entry.to] );
+        const int      c     = ( mover == hoxCOLOR_RED ? 0 : 1 );
+        int            kind  = MOVE_IDLE;
+
+        if ( scratch._IsKingBeingChecked( OTHER_COLOR( mover ) ) )
+        {
+            kind = MOVE_CHECK;
+            scratch._UndoMove( entry.from, entry.to, entry.captured, entry.capturedSlot );
+        }
+        else
         {
-            bMoveValid = true;
+            const unsigned int after = scratch._GetThreats( mover );
+            scratch._UndoMove( entry.from, entry.to, entry.captured, entry.capturedSlot );
+            const unsigned int before = scratch._GetThreats( mover );
+            if ( ( after & ~before ) != 0 ) kind = MOVE_CHASE;
         }
+
+        if ( kind == MOVE_IDLE )  bForbidden[c] = false;
+        if ( kind != MOVE_CHECK ) bAllChecks[c] = false;
     }
 
-    // *** If move is still invalid, return 'invalid'.
-    if ( ! bMoveValid )
-        return false;
+    hoxGameStatus status = hoxGAME_STATUS_DRAWN;
+    sReason = "Repetition detected";
 
-    // NOTE: The caller will check if the captured piece (if any) is allowed.
+    if ( bForbidden[0] != bForbidden[1] )
+    {
+        const int c = ( bForbidden[0] ? 0 : 1 );  // The offender.
+        status  = ( c == 0 ? hoxGAME_STATUS_BLACK_WIN : hoxGAME_STATUS_RED_WIN );
+        sReason = ( bAllChecks[c] ? "Perpetual Check detected" : "Perpetual Chase detected" );
+    }
+    else if ( bForbidden[0] && bAllChecks[0] != bAllChecks[1] )
+    {
+        const int c = ( bAllChecks[0] ? 0 : 1 );  // Check against chase.
+        status  = ( c == 0 ? hoxGAME_STATUS_BLACK_WIN : hoxGAME_STATUS_RED_WIN );
+        sReason = "Perpetual Check detected";
+    }
 
-    return true;
+    hoxLog(LOG_DEBUG, "%s: Position repeated %d times (%d moves). %s.", FNAME,
+        found->second, (int) ( m_history.size() - nFirst ), sReason.c_str());
+    return status;
 }
 
-void 
-PawnPiece::GetPotentialNextPositions(PositionList& positions) const
+/**
+ * Count the leaf nodes of the legal-move tree to a given depth.
+ * The Board is left unchanged.
+ */
+unsigned long
+Board::Perft( int depth )
 {
-    const hoxPosition p = this->GetPosition();
-    
-    positions.clear();
-
-    // ... Simply use the 4 possible positions.
-    positions.push_back(new hoxPosition(p.x, p.y-1));
-    positions.push_back(new hoxPosition(p.x, p.y+1));
-    positions.push_back(new hoxPosition(p.x-1, p.y));
-    positions.push_back(new hoxPosition(p.x+1, p.y));
-}
+    if ( depth <= 0 ) return 1;
 
-//-----------------------------------------------------------------------------
-// Other utility API
-//-----------------------------------------------------------------------------
+    const int     firstSlot = FIRST_SLOT( m_nextColor );
+    unsigned long nNodes    = 0;
+    signed char   targets[MAX_TARGETS];
 
-void
-BoardInfoAPI::PositionList_Clear( PositionList& positions )
-{
-    for ( PositionList::const_iterator it = positions.begin();
-                                       it != positions.end(); ++it )
+    for ( int slot = firstSlot; slot < firstSlot + 16; ++slot )
     {
-        delete (*it);
+        const int from = m_pieces[slot];
+        if ( from == NO_SQUARE ) continue;
+
+        const int nTargets = _GetTargets( from, targets );
+        for ( int i = 0; i < nTargets; ++i )
+        {
+            const int to = targets[i];
+            if ( ! _IsLegalAfterMove( from, to ) ) continue;
+
+            if ( depth == 1 )
+            {
+                ++nNodes;
+                continue;
+            }
+
+            const int capturedSlot = m_slots[to];
+            const int captured     = _MakeMove( from, to );
+            m_nextColor = OTHER_COLOR( m_nextColor );
+            m_key ^= s_tables.zobristBlack;
+
+            nNodes += Perft( depth - 1 );
+
+            m_key ^= s_tables.zobristBlack;
+            m_nextColor = OTHER_COLOR( m_nextColor );
+            _UndoMove( from, to, captured, capturedSlot );
+        }
     }
-}
 
+    return nNodes;
+}
 
 /**************************************************************************
  *
@@ -1384,11 +1476,10 @@ void
 hoxReferee::resetGame()
 {
     delete _board;   // Delete the old Board, if exists.
-
-    _board = new Board( hoxCOLOR_RED /* next-color */ );
+    _board = new Board();
 }
 
-bool 
+bool
 hoxReferee::validateMove( hoxMove&       move,
                           hoxGameStatus& status )
 {
@@ -1402,7 +1493,7 @@ hoxReferee::isLastMoveCheck() const
     return _board->IsLastMoveCheck();
 }
 
-void 
+void
 hoxReferee::getGameState( hoxPieceInfoList& pieceInfoList,
                           hoxColor&         nextColor ) const
 {
@@ -1410,13 +1501,54 @@ hoxReferee::getGameState( hoxPieceInfoList& pieceInfoList,
     return _board->GetGameState( pieceInfoList, nextColor );
 }
 
-hoxColor 
+hoxColor
 hoxReferee::getNextColor() const
 {
     hoxCHECK_MSG(_board, hoxCOLOR_UNKNOWN, "The Board is NULL.");
     return _board->GetNextColor();
 }
 
+hoxGameStatus
+hoxReferee::judgeRepetition( std::string& sReason ) const
+{
+    hoxCHECK_MSG(_board, hoxGAME_STATUS_UNKNOWN, "The Board is NULL.");
+    return _board->JudgeRepetition( sReason );
+}
+
+bool
+hoxReferee::loadPosition( const std::string& sFen )
+{
+    const char* FNAME = "hoxReferee::loadPosition";
+
+    /* Set up a new Board so that the current one is kept on error. */
+    Board* board = new Board();
+    if ( ! board->LoadPosition( sFen ) )
+    {
+        hoxLog(LOG_INFO, "%s: Invalid position [%s].", FNAME, sFen.c_str());
+        delete board;
+        return false;
+    }
+
+    delete _board;
+    _board = board;
+    return true;
+}
+
+size_t
+hoxReferee::applyMoves( const std::list<std::string>& moves,
+                        hoxGameStatus&                status )
+{
+    hoxCHECK_MSG(_board, 0, "The Board is NULL.");
+    return _board->ApplyMoves( moves, status );
+}
+
+unsigned long
+hoxReferee::perft( int depth )
+{
+    hoxCHECK_MSG(_board, 0, "The Board is NULL.");
+    return _board->Perft( depth );
+}
+
 hoxMove
 hoxReferee::stringToMove( const std::string& sMove ) const
 {
@@ -1436,8 +1568,7 @@ hoxReferee::stringToMove( const std::string& sMove ) const
     move.newPosition.y    = sMove[3] - '0';
 
     /* Lookup a Piece based on "fromPosition". */
-
-    if ( ! _getPieceAtPosition( move.piece.position, 
+    if ( ! _getPieceAtPosition( move.piece.position,
                                 move.piece ) )
     {
         hoxLog(LOG_INFO, "%s: Failed to locate piece at the position.", FNAME);
@@ -1447,8 +1578,8 @@ hoxReferee::stringToMove( const std::string& sMove ) const
     return move;
 }
 
-bool 
-hoxReferee::_getPieceAtPosition( const hoxPosition& position, 
+bool
+hoxReferee::_getPieceAtPosition( const hoxPosition& position,
                                  hoxPieceInfo&      pieceInfo ) const
 {
     hoxCHECK_MSG(_board, false, "The Board is NULL.");
@@ -32,6 +32,25 @@ public:
     bool validateMove( hoxMove&       move,
                        hoxGameStatus& status );
 
+    /**
+     * Set up the Board from a FEN string (BLACK's back rank first,
+     * upper-case letters for RED, then 'w' or 'b' for the side to move).
+     *
+     * @return false if the position is not valid (the Board is unchanged).
+     */
+    bool loadPosition( const std::string& sFen );
+
+    /**
+     * Apply a list of Moves ("xyXY") from the current position, checking
+     * for the end of the game only once, in the final position.
+     *
+     * @param status [OUT] The Game status after the last Move applied.
+     * @return The number of Moves applied (less than given if a Move
+     *         is not valid).
+     */
+    size_t applyMoves( const std::list<std::string>& moves,
+                       hoxGameStatus&                status );
+
     bool isLastMoveCheck() const;
 
     void getGameState( hoxPieceInfoList& pieceInfoList,
@@ -39,8 +58,22 @@ public:
     
     hoxColor getNextColor() const;
 
+    /**
+     * Judge the Game by the repetition rules (perpetual check / chase)
+     * if the current position has occurred hoxREPETITION_MAX times.
+     *
+     * @return hoxGAME_STATUS_IN_PROGRESS if the Game goes on.
+     */
+    hoxGameStatus judgeRepetition( std::string& sReason ) const;
+
     hoxMove stringToMove( const std::string& sMove ) const;
 
+    /**
+     * Count the leaf nodes of the legal-move tree from the current
+     * position to a given depth (to test and benchmark the Referee).
+     */
+    unsigned long perft( int depth );
+
 private:
     bool _getPieceAtPosition( const hoxPosition& position, 
                               hoxPieceInfo&      pieceInfo ) const;
@@ -0,0 +1,459 @@
+//
+// C++ Implementation: hoxRefereeBench
+//
+// Description: The benchmark of the Referee (perft and games replay).
+//
+// Author: Huy Phan  <hphan@hphan-hp>, (C) 2008-2009
+//
+// Created: 10/19/2009
+//
+
+#include <sys/time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <new>
+#include <string>
+#include <list>
+#include <vector>
+#include <iterator>
+#include <fstream>
+#include "hoxReferee.h"
+#include "hoxLog.h"
+
+#ifdef HOX_BENCH_FOLIUM
+#include "../plugins/AI_Folium/xq.h"
+#include "../plugins/AI_Folium/generator.h"
+#include "../plugins/AI_Folium/history.h"
+#endif
+
+typedef std::list<std::string>   GameMoves;
+typedef std::vector<GameMoves>   GameList;
+
+/* Tactical positions: checks by each piece type, pins, and crowded
+ * middle-games (RED's pieces in upper case, BLACK's rank 0 first).
+ */
+static const char* TACTICAL_FENS[] = {
+    "rnbakabnr/9/1c5c1/p1p1p1p1p/9/9/P1P1P1P1P/1C5C1/9/RNBAKABNR w",
+    "r2akab1r/9/1cn1b1n2/p1p1p3p/6p2/2P6/P3P1P1P/1CN1C1N2/9/R1BAKAB1R b",
+    "r1bakab1r/9/1cn4cn/p1p1p1p1p/9/2P6/P3P1P1P/1C2C1N2/9/RNBAKAB1R w",
+    "4k4/9/9/4n4/9/9/9/4C4/9/3K5 b",
+    "3k5/9/4N4/9/9/9/9/9/9/4K4 b",
+    "3akab2/9/4b4/9/9/9/9/9/4R4/4K4 w",
+    "4k4/4a4/9/9/9/9/9/9/4R4/3K5 b",
+    "2bak4/4a4/4b1N2/p3C4/2p6/9/P5c2/4B4/4A4/2BAK4 b",
+    "3k5/4P4/9/9/9/9/9/9/9/4K4 b",
+    NULL
+};
+
+/******************************************************************
+ * Allocation counting
+ */
+
+static unsigned long s_nAllocs = 0;
+
+void* operator new( size_t size )
+{
+    ++s_nAllocs;
+    void* p = malloc( size ? size : 1 );
+    if ( p == NULL ) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete( void* p )
+{
+    free( p );
+}
+
+void operator delete( void* p, size_t /*size*/ )
+{
+    free( p );
+}
+
+/******************************************************************
+ * The Referee logs through hoxLog. The server's log is not
+ * available in this tool, so only warnings and errors are printed.
+ */
+
+hoxGlobalConfig g_config;  /* Its level is set to LOG_WARN in main(). */
+
+void
+hoxLogMsg( enum hoxLogLevel /*level*/, const char *fmt, ... )
+{
+    va_list ap;
+    va_start( ap, fmt );
+    vfprintf( stderr, fmt, ap );
+    va_end( ap );
+    fputc( '\n', stderr );
+}
+
+/******************************************************************
+ * Helper API
+ */
+
+static void usage( const char *progname )
+{
+    fprintf( stderr, "Usage: %s [<options>]\n\n"
+             "Possible options:\n\n"
+             "\t-d <depth>              The perft depth from the start position (default = 4).\n"
+             "\t-r <rounds>             The rounds of the games replay (default = 100).\n"
+             "\t-g <games_file>         The games to replay (default = ../hoxTest/games.txt).\n"
+             "\t-h                      Print this message.\n\n"
+             "The games file has one game per line, as Moves \"xyXY\" separated by '/'.\n"
+             "The exit status is non-zero if a check fails.\n",
+             progname );
+    exit( 1 );
+}
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static double per_second( double nCount, double nSeconds )
+{
+    return ( nSeconds > 0 ? nCount / nSeconds : 0 );
+}
+
+static bool load_games( const std::string& sPath,
+                        GameList&          games )
+{
+    std::ifstream in( sPath.c_str() );
+    if ( ! in ) return false;
+
+    std::string sLine;
+    while ( std::getline( in, sLine ) )
+    {
+        if ( sLine.empty() || sLine[0] == '#' ) continue;
+
+        GameMoves moves;
+        std::string::size_type start = 0;
+        while ( start < sLine.size() )
+        {
+            std::string::size_type end = sLine.find( '/', start );
+            if ( end == std::string::npos ) end = sLine.size();
+            if ( end - start >= 4 ) moves.push_back( sLine.substr( start, 4 ) );
+            start = end + 1;
+        }
+        if ( ! moves.empty() ) games.push_back( moves );
+    }
+    return true;
+}
+
+/**
+ * Play the first Moves of a game.
+ * @return The number of Moves played (less than requested on error).
+ */
+static size_t play_moves( hoxReferee&      referee,
+                          const GameMoves& moves,
+                          size_t           nMoves )
+{
+    hoxGameStatus             status;
+    size_t                    nPlayed = 0;
+    GameMoves::const_iterator it      = moves.begin();
+
+    for ( ; nPlayed < nMoves && it != moves.end(); ++nPlayed, ++it )
+    {
+        hoxMove move = referee.stringToMove( *it );
+        if ( ! move.isValid() || ! referee.validateMove( move, status ) )
+        {
+            break;
+        }
+    }
+    return nPlayed;
+}
+
+#ifdef HOX_BENCH_FOLIUM
+
+/**
+ * Convert the Referee's position to the FEN read by Folium.
+ */
+static std::string to_fen( const hoxReferee& referee )
+{
+    static const char* LETTERS = " KABRNCP";  // Indexed by hoxPieceType.
+
+    hoxPieceInfoList pieces;
+    hoxColor         nextColor;
+    char             board[10][9];
+
+    referee.getGameState( pieces, nextColor );
+    for ( int y = 0; y < 10; ++y )
+        for ( int x = 0; x < 9; ++x ) board[y][x] = 0;
+
+    for ( hoxPieceInfoList::const_iterator it = pieces.begin();
+                                           it != pieces.end(); ++it )
+    {
+        const char c = LETTERS[it->type];
+        board[(unsigned char) it->position.y][(unsigned char) it->position.x] = ( it->color == hoxCOLOR_RED ? c : c - 'A' + 'a' );
+    }
+
+    std::string sFen;
+    for ( int y = 0; y < 10; ++y )
+    {
+        int nEmpty = 0;
+        for ( int x = 0; x < 9; ++x )
+        {
+            if ( board[y][x] == 0 ) { ++nEmpty; continue; }
+            if ( nEmpty > 0 ) sFen += (char) ( '0' + nEmpty );
+            nEmpty = 0;
+            sFen += board[y][x];
+        }
+        if ( nEmpty > 0 ) sFen += (char) ( '0' + nEmpty );
+        sFen += ( y < 9 ? '/' : ' ' );
+    }
+    sFen += ( nextColor == hoxCOLOR_BLACK ? 'b' : 'w' );
+    return sFen;
+}
+
+static History s_history;  // Move-ordering scores required by Folium.
+
+static unsigned long folium_perft( XQ& xq, int depth )
+{
+    if ( depth <= 0 ) return 1;
+
+    MoveList      ml;
+    unsigned long nNodes = 0;
+
+    generate_moves( xq, ml, s_history );
+    for ( uint i = 0; i < ml.size(); ++i )
+    {
+        const uint src      = move_src( ml[i] );
+        const uint dst      = move_dst( ml[i] );
+        const uint dstPiece = xq.square( dst );
+        if ( ! xq.do_move( src, dst ) ) continue;  // Leaves the King in check.
+        nNodes += folium_perft( xq, depth - 1 );
+        xq.undo_move( src, dst, dstPiece );
+    }
+    return nNodes;
+}
+
+#endif /* HOX_BENCH_FOLIUM */
+
+/**
+ * Cross-check the perft count of a position with Folium's generator.
+ * @return false if the counts differ.
+ */
+#ifdef HOX_BENCH_FOLIUM
+static bool cross_check( const hoxReferee& referee,
+                         int               depth,
+                         unsigned long     nNodes )
+{
+    const std::string sFen = to_fen( referee );
+    XQ xq( sFen );
+    const unsigned long nExpected = folium_perft( xq, depth );
+    if ( nExpected != nNodes )
+    {
+        printf( "  MISMATCH [%s] depth %d: referee %lu, folium %lu\n",
+                sFen.c_str(), depth, nNodes, nExpected );
+        return false;
+    }
+    return true;
+}
+#else
+static bool cross_check( const hoxReferee& /*referee*/,
+                         int               /*depth*/,
+                         unsigned long     /*nNodes*/ )
+{
+    return true;  // Nothing to check against.
+}
+#endif
+
+/******************************************************************/
+
+/**
+ * Main function.
+ */
+int
+main( int argc, char *argv[] )
+{
+    extern char *optarg;
+    int          depth     = 4;
+    int          nRounds   = 100;
+    std::string  sGames    = "../hoxTest/games.txt";
+    int          nFailures = 0;
+    int          opt;
+
+    g_config.minLogLevel = LOG_WARN;
+
+    while (( opt = getopt( argc, argv, "d:r:g:h" ) ) != EOF )
+    {
+        switch ( opt )
+        {
+            case 'd':
+                depth = atoi( optarg );
+                break;
+            case 'r':
+                nRounds = atoi( optarg );
+                break;
+            case 'g':
+                sGames = optarg;
+                break;
+            case 'h':
+            case '?':
+                usage( argv[0] );
+        }
+    }
+
+    GameList games;
+    if ( ! load_games( sGames, games ) )
+    {
+        fprintf( stderr, "ERROR: can't read the games file [%s]\n", sGames.c_str() );
+        return 1;
+    }
+
+#ifdef HOX_BENCH_FOLIUM
+    s_history.clear();
+    printf( "Perft counts are cross-checked with Folium's generator.\n" );
+#endif
+
+    /* 1. Perft from the start position. */
+
+    printf( "\nperft (start position)\n" );
+    for ( int d = 1; d <= depth; ++d )
+    {
+        hoxReferee referee;
+        const unsigned long nAllocs = s_nAllocs;
+        const double        start   = now();
+        const unsigned long nNodes  = referee.perft( d );
+        const double        elapsed = now() - start;
+
+        printf( "  depth %d: %12lu nodes %8.3fs %12.0f nodes/s %6lu allocs\n",
+                d, nNodes, elapsed, per_second( nNodes, elapsed ), s_nAllocs - nAllocs );
+        if ( ! cross_check( referee, d, nNodes ) ) ++nFailures;
+    }
+
+    /* 2. Perft from the tactical positions. */
+
+    const int     gameDepth   = ( depth < 3 ? depth : 3 );
+    unsigned long nTotalNodes = 0;
+    double        elapsed     = 0;
+
+    printf( "\nperft (tactical positions)\n" );
+    for ( int i = 0; TACTICAL_FENS[i] != NULL; ++i )
+    {
+        hoxReferee referee;
+        if ( ! referee.loadPosition( TACTICAL_FENS[i] ) )
+        {
+            printf( "  Position [%s] is rejected\n", TACTICAL_FENS[i] );
+            ++nFailures;
+            continue;
+        }
+
+        const double        start  = now();
+        const unsigned long nNodes = referee.perft( gameDepth );
+        elapsed += now() - start;
+
+        nTotalNodes += nNodes;
+        if ( ! cross_check( referee, gameDepth, nNodes ) ) ++nFailures;
+    }
+    printf( "  depth %d: %d positions %12lu nodes %8.3fs %12.0f nodes/s\n",
+            gameDepth, (int) ( sizeof(TACTICAL_FENS) / sizeof(TACTICAL_FENS[0]) ) - 1,
+            nTotalNodes, elapsed, per_second( nTotalNodes, elapsed ) );
+
+    /* 3. Perft from the middle-game positions of the games. */
+
+    const size_t PLIES[]    = { 20, 40, 60, 80 };
+    int          nPositions = 0;
+
+    nTotalNodes = 0;
+    elapsed     = 0;
+
+    for ( GameList::const_iterator it = games.begin(); it != games.end(); ++it )
+    {
+        for ( size_t i = 0; i < sizeof(PLIES) / sizeof(PLIES[0]); ++i )
+        {
+            if ( PLIES[i] >= it->size() ) break;
+
+            hoxReferee referee;
+            if ( play_moves( referee, *it, PLIES[i] ) != PLIES[i] ) break;
+
+            const double        start  = now();
+            const unsigned long nNodes = referee.perft( gameDepth );
+            elapsed += now() - start;
+
+            nTotalNodes += nNodes;
+            ++nPositions;
+            if ( ! cross_check( referee, gameDepth, nNodes ) ) ++nFailures;
+        }
+    }
+
+    printf( "\nperft (games positions)\n"
+            "  depth %d: %d positions %12lu nodes %8.3fs %12.0f nodes/s\n",
+            gameDepth, nPositions, nTotalNodes, elapsed,
+            per_second( nTotalNodes, elapsed ) );
+
+    /* 4. Replay the games through the Referee, one Move at a time. */
+
+    unsigned long nMoves  = 0;
+    unsigned long nAllocs = s_nAllocs;
+    const double  start   = now();
+
+    for ( int r = 0; r < nRounds; ++r )
+    {
+        for ( GameList::const_iterator it = games.begin(); it != games.end(); ++it )
+        {
+            hoxReferee referee;
+            const size_t nPlayed = play_moves( referee, *it, it->size() );
+            if ( r == 0 && nPlayed != it->size() )
+            {
+                GameMoves::const_iterator bad = it->begin();
+                std::advance( bad, nPlayed );
+                printf( "  Game #%d: Move #%d [%s] is rejected\n",
+                        (int) ( it - games.begin() ) + 1, (int) nPlayed + 1,
+                        bad->c_str() );
+                ++nFailures;
+            }
+            nMoves += nPlayed;
+        }
+    }
+
+    elapsed = now() - start;
+    nAllocs = s_nAllocs - nAllocs;
+    printf( "\nreplay (%d games x %d rounds)\n"
+            "  %lu moves %8.3fs %12.0f moves/s %6.2f allocs/move\n",
+            (int) games.size(), nRounds, nMoves, elapsed,
+            per_second( nMoves, elapsed ),
+            ( nMoves > 0 ? (double) nAllocs / nMoves : 0 ) );
+
+    /* 5. Rebuild each game's final position from its list of Moves. */
+
+    unsigned long nRebuilt = 0;
+    nMoves = 0;
+    const double rebuildStart = now();
+
+    for ( int r = 0; r < nRounds; ++r )
+    {
+        for ( GameList::const_iterator it = games.begin(); it != games.end(); ++it )
+        {
+            hoxReferee    referee;
+            hoxGameStatus status;
+            const size_t  nApplied = referee.applyMoves( *it, status );
+            if ( r == 0 && nApplied != it->size() )
+            {
+                printf( "  Game #%d: applyMoves stopped at Move #%d\n",
+                        (int) ( it - games.begin() ) + 1, (int) nApplied + 1 );
+                ++nFailures;
+            }
+            nMoves += nApplied;
+            ++nRebuilt;
+        }
+    }
+
+    elapsed = now() - rebuildStart;
+    printf( "\nrebuild (applyMoves)\n"
+            "  %lu games %8.3fs %8.2f us/game %12.0f moves/s\n",
+            nRebuilt, elapsed, ( nRebuilt > 0 ? elapsed * 1000000 / nRebuilt : 0 ),
+            per_second( nMoves, elapsed ) );
+
+    if ( nFailures > 0 )
+    {
+        printf( "\n%d check(s) FAILED\n", nFailures );
+        return 1;
+    }
+    return 0;
+}
+
+/******************* END OF FILE *********************************************/
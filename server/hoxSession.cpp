@@ -17,8 +17,18 @@
 #include "hoxExcept.h"
 #include "hoxUtil.h"
 #include "hoxFileMgr.h"
+#include "hoxDbClient.h"
+#include "hoxEventLog.h"
 #include <sstream>
 
+/* The default size of a LEADERBOARD's answer. */
+#define LEADERBOARD_COUNT_DEFAULT   20  /* The top Players */
+#define LEADERBOARD_AROUND_DEFAULT   5  /* The neighbors on each side */
+
+/* The size of a HISTORY's page. */
+#define HISTORY_LIMIT_DEFAULT       20
+#define HISTORY_LIMIT_MAX          100
+
 // =========================================================================
 //
 //                        hoxSession
@@ -176,6 +186,10 @@ hoxSession::handleRequest( const hoxRequest_SPtr& pRequest,
 
     this->updateTimeStamp();  // Keep the session alive.
 
+    hoxEventLog*         pEventLog   = hoxEventLog::getInstance();
+    const long long      startTime   = ( pEventLog->isOpen() ? hoxEventLog::now() : 0 );
+    hoxResult            result      = hoxRC_OK;
+
     const hoxRequestType requestType = pRequest->getType();
     try
     {
@@ -196,6 +210,8 @@ hoxSession::handleRequest( const hoxRequest_SPtr& pRequest,
             case hoxREQUEST_RESET:  handle_RESET( pRequest, pResponse ); break;
             case hoxREQUEST_INVITE: handle_INVITE( pRequest, pResponse ); break;
             case hoxREQUEST_PLAYER_INFO: handle_PLAYER_INFO( pRequest, pResponse ); break;
+            case hoxREQUEST_LEADERBOARD: handle_LEADERBOARD( pRequest, pResponse ); break;
+            case hoxREQUEST_HISTORY: handle_HISTORY( pRequest, pResponse ); break;
             case hoxREQUEST_POLL:  /* Handle this request below... */ break;
 
             default: throw hoxError(hoxRC_NOT_SUPPORTED, "Unsupported Request");
@@ -203,6 +219,7 @@ hoxSession::handleRequest( const hoxRequest_SPtr& pRequest,
     }
     catch( hoxTableError error )
     {
+        result = error.code();
         pResponse.reset( new hoxResponse( requestType, error.code() ) );
         pResponse->setTid( error.tid() );
         pResponse->setContent( error.what() + std::string("\n") );
@@ -210,11 +227,19 @@ hoxSession::handleRequest( const hoxRequest_SPtr& pRequest,
     }
     catch( hoxError error )
     {
+        result = error.code();
         pResponse.reset( new hoxResponse( requestType, error.code() ) );
         pResponse->setContent( error.what() + std::string("\n") );
         hoxLog(LOG_WARN, "%s: Error caught [%s].", FNAME, error.toString().c_str());
     }
 
+    if ( pEventLog->isOpen() )
+    {
+        pEventLog->log( hoxEVENT_REQUEST, _player->getId(), _id, pRequest->getParam("tid"),
+                        hoxUtil::requestTypeToString( requestType ),
+                        hoxEventLog::now() - startTime, result );
+    }
+
     /* Write a response if any (some requests do not have any response). */
     if ( pResponse )
     {
@@ -229,6 +254,9 @@ hoxSession::handle_LOGIN( const hoxRequest_SPtr& pRequest,
 {
     hoxPlayer_SPtr player = this->getPlayer();
 
+    /* Clients opt in to millisecond timers with "clock=ms". */
+    player->setMillisClock( pRequest->getParam("clock") == "ms" );
+
     /* !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
      * Since session-ID is secret to the Player, only the Player
      * should know about the ID.
@@ -252,6 +280,8 @@ hoxSession::handle_LOGIN( const hoxRequest_SPtr& pRequest,
     player->onNewEvent( pResponse );
 
     // If the Player was disconnected, attempt to resume playing.
+    // This includes the Tables restored after a restart of this process.
+    hoxTableMgr::getInstance()->reattachPlayer( player );
     player->resumePlayingIfNeeded();
 
     pResponse.reset();  // Return "nothing".
@@ -269,9 +299,63 @@ hoxSession::handle_LIST( const hoxRequest_SPtr&  pRequest,
                          hoxResponse_SPtr&       pResponse )
 {
     hoxTableList tables;
-    hoxTableMgr::getInstance()->getTables( tables );
 
-    pResponse = hoxResponse::create_event_LIST( tables );
+    /* The paged form is used if any filter or paging parameter is present:
+     *   status   : The game-status ("open", "ready", "in_progress",...)
+     *   type     : The game-type (0 = rated, 1 = non-rated, 2 = solo)
+     *   tbucket  : The time-control bucket (0 = blitz,..., 3 = long)
+     *   minscore, maxscore : The range of the max player-score.
+     *   cursor   : The cursor returned by the previous page.
+     *   limit    : The page size.
+     */
+    const hoxParameters& params = pRequest->getParameters();
+    const bool bPaged = (    params.find("status")   != params.end()
+                          || params.find("type")     != params.end()
+                          || params.find("tbucket")  != params.end()
+                          || params.find("minscore") != params.end()
+                          || params.find("maxscore") != params.end()
+                          || params.find("cursor")   != params.end()
+                          || params.find("limit")    != params.end() );
+    if ( ! bPaged )
+    {
+        hoxTableMgr::getInstance()->getTables( tables );
+        pResponse = hoxResponse::create_event_LIST( tables,
+                                                    this->getPlayer()->getMillisClock() );
+        return;
+    }
+
+    hoxTableFilter filter;
+    std::string    sValue;
+
+    if ( ! (sValue = pRequest->getParam("status")).empty() )
+    {
+        filter.status = hoxUtil::stringToGameStatus( sValue );
+        if ( filter.status == hoxGAME_STATUS_UNKNOWN )
+            throw hoxError(hoxRC_NOT_VALID, "Invalid status filter");
+    }
+    if ( ! (sValue = pRequest->getParam("type")).empty() )
+        filter.gameType = (hoxGameType) hoxUtil::stringToInt( sValue );
+    if ( ! (sValue = pRequest->getParam("tbucket")).empty() )
+        filter.timeBucket = (hoxTimeBucket) hoxUtil::stringToInt( sValue );
+    if ( ! (sValue = pRequest->getParam("minscore")).empty() )
+        filter.minScore = hoxUtil::stringToInt( sValue );
+    if ( ! (sValue = pRequest->getParam("maxscore")).empty() )
+        filter.maxScore = hoxUtil::stringToInt( sValue );
+    if (    filter.minScore >= 0 && filter.maxScore >= 0
+         && filter.minScore > filter.maxScore )
+    {
+        throw hoxError(hoxRC_NOT_VALID, "Invalid score range");
+    }
+    if ( ! (sValue = pRequest->getParam("cursor")).empty() )
+        filter.cursor = hoxUtil::stringToInt( sValue );
+    if ( ! (sValue = pRequest->getParam("limit")).empty() )
+        filter.limit = hoxUtil::stringToInt( sValue );
+
+    int nextCursor = 0;
+    hoxTableMgr::getInstance()->getTables( filter, tables, nextCursor );
+
+    pResponse = hoxResponse::create_event_LIST( tables, nextCursor,
+                                                this->getPlayer()->getMillisClock() );
 }
 
 void
@@ -536,6 +620,115 @@ hoxSession::handle_PLAYER_INFO( const hoxRequest_SPtr&  pRequest,
                                                        tableId );
 }
 
+void
+hoxSession::handle_LEADERBOARD( const hoxRequest_SPtr&  pRequest,
+                                hoxResponse_SPtr&       pResponse )
+{
+    /* The Players ranked by score:
+     *   oid    : [OPTIONAL] The Player to look up. If absent, the top.
+     *   around : The neighbors on each side of the Player (default: 5).
+     *   from   : The number of top Players to skip (default: 0).
+     *   count  : The number of top Players (default: 20).
+     * The number of Players is capped by the DB-Agent.
+     */
+    const std::string sPlayerId = pRequest->getParam("oid");
+    std::string       sValue;
+    std::string       sEntries;
+    hoxResult         result;
+
+    if ( ! sPlayerId.empty() )
+    {
+        const int nAround = ( (sValue = pRequest->getParam("around")).empty()
+                              ? LEADERBOARD_AROUND_DEFAULT : hoxUtil::stringToInt( sValue ) );
+        result = hoxDbClient::get_rank( sPlayerId, nAround, sEntries );
+    }
+    else
+    {
+        const int nFrom  = hoxUtil::stringToInt( pRequest->getParam("from") );
+        const int nCount = ( (sValue = pRequest->getParam("count")).empty()
+                             ? LEADERBOARD_COUNT_DEFAULT : hoxUtil::stringToInt( sValue ) );
+        result = hoxDbClient::get_leaders( nFrom, nCount, sEntries );
+    }
+
+    if ( result == hoxRC_NOT_FOUND )
+    {
+        throw hoxError(hoxRC_NOT_FOUND, "Player not ranked");
+    }
+    else if ( result != hoxRC_OK )
+    {
+        throw hoxError(result, "Leaderboard not available");
+    }
+
+    /* Return:
+     *       One line per Player: "rank;pid;score".
+     */
+
+    pResponse.reset( new hoxResponse( hoxREQUEST_LEADERBOARD ) );
+    pResponse->setContent( sEntries.empty() ? "\n" : sEntries );
+}
+
+void
+hoxSession::handle_HISTORY( const hoxRequest_SPtr&  pRequest,
+                            hoxResponse_SPtr&       pResponse )
+{
+    /* The completed Games of a Player, a page at a time:
+     *   oid    : [OPTIONAL] The Player (default: this Player).
+     *   vs     : [OPTIONAL] Only the Games against this opponent.
+     *   cursor : The cursor returned by the previous page (default: 0).
+     *   limit  : The page size.
+     */
+    std::string sPlayerId = pRequest->getParam("oid");
+    if ( sPlayerId.empty() ) sPlayerId = this->getPlayer()->getId();
+
+    const std::string sValue = pRequest->getParam("limit");
+    int nLimit = ( sValue.empty() ? HISTORY_LIMIT_DEFAULT : hoxUtil::stringToInt( sValue ) );
+    nLimit = std::max( 1, std::min( nLimit, HISTORY_LIMIT_MAX ) );
+
+    const long long cursor = ::atoll( pRequest->getParam("cursor").c_str() );
+
+    /* Ask for one more Game, to tell whether there is a next page. */
+    std::string sEntries;
+    const hoxResult result = hoxDbClient::get_games( sPlayerId, pRequest->getParam("vs"),
+                                                     cursor, nLimit + 1, sEntries );
+    if ( result != hoxRC_OK )
+    {
+        throw hoxError(result, "History not available");
+    }
+
+    std::istringstream inStream( sEntries );
+    std::ostringstream gamesStream;
+    std::string        sLine;
+    int                nCount = 0;
+    long long          nextCursor = 0;  // The last Game-Id, if there is more.
+    bool               bMore = false;
+
+    while ( std::getline( inStream, sLine ) )
+    {
+        if ( sLine.empty() ) continue;
+        if ( nCount == nLimit )
+        {
+            bMore = true;
+            break;
+        }
+        gamesStream << sLine << "\n";
+        nextCursor = ::atoll( sLine.c_str() );
+        ++nCount;
+    }
+    if ( ! bMore ) nextCursor = 0;
+
+    /* Return:
+     *       "<next-cursor>;<count>;" (0 if no more), then one line per Game:
+     *       "gid;ended;red;black;status;type;redScore;blackScore;moves".
+     */
+
+    std::ostringstream outStream;
+    outStream << nextCursor << ";" << nCount << ";" << "\n"
+              << gamesStream.str();
+
+    pResponse.reset( new hoxResponse( hoxREQUEST_HISTORY ) );
+    pResponse->setContent( outStream.str() );
+}
+
 // =========================================================================
 //
 //                        hoxPersistentSession
@@ -69,6 +69,8 @@ protected:
     void handle_RESET( const hoxRequest_SPtr&  pRequest, hoxResponse_SPtr& pResponse );
     void handle_INVITE( const hoxRequest_SPtr&  pRequest, hoxResponse_SPtr& pResponse );
     void handle_PLAYER_INFO( const hoxRequest_SPtr&  pRequest, hoxResponse_SPtr& pResponse );
+    void handle_LEADERBOARD( const hoxRequest_SPtr&  pRequest, hoxResponse_SPtr& pResponse );
+    void handle_HISTORY( const hoxRequest_SPtr&  pRequest, hoxResponse_SPtr& pResponse );
 
     virtual void closeIO() {}
     virtual hoxResult readRequest( hoxRequest_SPtr& pRequest );
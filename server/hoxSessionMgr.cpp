@@ -14,6 +14,7 @@
 #include "hoxTable.h"
 #include "hoxLog.h"
 #include "hoxUtil.h"
+#include "hoxEventLog.h"
 
 /* Define the static singleton instance. */
 hoxSessionMgr* hoxSessionMgr::s_instance = NULL;
@@ -65,12 +66,17 @@ hoxSessionMgr::createSession( hoxClientType  type,
     /* Store the session */
     _sessions[pSession->getId()] = pSession;
 
+    hoxEventLog::getInstance()->log( hoxEVENT_SESSION_START, pPlayer->getId(),
+                                     pSession->getId(), "", "", 0, (int) type );
+
     return pSession;
 }
 
 void
 hoxSessionMgr::_deleteSession( hoxSession_SPtr pSession )
 {
+    hoxEventLog::getInstance()->log( hoxEVENT_SESSION_END, pSession->getPlayer()->getId(),
+                                     pSession->getId(), "", "closed" );
     pSession->onDeleted();
     _sessions.erase( pSession->getId() );
 }
@@ -164,6 +170,8 @@ hoxSessionMgr::manageSessions()
         if ( pSession->getState() == hoxSESSION_STATE_SHUTDOWN )
         {
             hoxLog(LOG_INFO, "%s: Purged expired session [%s].", FNAME, pSession->getId().c_str());
+            hoxEventLog::getInstance()->log( hoxEVENT_SESSION_END, pSession->getPlayer()->getId(),
+                                             pSession->getId(), "", "purged" );
             pSession->onDeleted();
             _sessions.erase( it++ );
         }
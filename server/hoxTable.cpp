@@ -8,6 +8,7 @@
 // Created: 04/16/2009
 //
 
+#include <iterator>
 #include <st.h>
 #include "hoxTable.h"
 #include "hoxDebug.h"
@@ -15,131 +16,10 @@
 #include "hoxLog.h"
 #include "hoxReferee.h"
 #include "hoxDbClient.h"
-
-// =========================================================================
-//                  >>>> Elo Rating System <<<
-//
-//  References:
-//  ----------
-//     http://en.wikipedia.org/wiki/Elo_rating_system
-//     http://www.chesselo.com
-//     http://gobase.org/studying/articles/elo
-//
-//  Table of Winning Probability:
-//  ---------------------------------------------------------
-//   Rating Difference | Stronger Player | Weaker Player
-//    0                    0.50              0.50
-//    25                   0.53	             0.47
-//    50                   0.57	             0.43
-//    100                  0.64	             0.36
-//    150                  0.70              0.30
-//    200                  0.76              0.24
-//    250                  0.81              0.19
-//    300                  0.85              0.15
-//    350 (FIDE)           0.89              0.11
-//  ----------------------------------------------------------
-//
-// Calculating K-factor:
-// ---------------------
-// Use FIDE rules to determine the K-factor:
-//
-//  (1) K-factor = 25 for players new to the rating list, until they have
-//                    completed events with a total of at least 30 games;
-//  (2) K-factor = 15 for players with a rating under 2400;
-//  (3) K-factor = 10 once the player has reached 2400 and been registered
-//                    for at least 30 games. Thereafter it remains permanently
-//                    at 10, even if the player' s rating is under 2400 at
-//                    a later stage.
-//
-//
-//  Calculating New Rating:
-//  -----------------------
-//     New Rating = Old Rating + K-factor * (Result - Expected Result)
-//
-// =========================================================================
-
-struct WinningProbability_t
-{
-    int    ratingDiff;
-    float  strongerPlayer;
-    float  weakerPlayer;
-};
-
-WinningProbability_t s_winningProbabilities[] =
-{
-   // Diff | Stronger | Weaker
-    { 0,      0.50,   0.50 },
-    { 25,     0.53,   0.47 },
-    { 50,     0.57,   0.43 },
-    { 100,    0.64,	  0.36 },
-    { 150,    0.70,   0.30 },
-    { 200,    0.76,   0.24 },
-    { 250,    0.81,   0.19 },
-    { 300,    0.85,   0.15 },
-    { 350,    0.89,   0.11 }
-};
-
-/**
- * Calculate the K-Factor.
- *
- * @param nOldRating The Old Rating.
- * @param nPlayedGames The number of games that has been played.
- *
- * @return The K-Factor.
- */
-int
-_Elo_calculate_KFactor( const int nPlayedGames,
-                        const int nOldRating )
-{
-    if      ( nPlayedGames < 30 ) return 25;
-    else if ( nOldRating < 2400 ) return 15;
-    // FIXME: We ignore the phase:
-    //    "... Thereafter it remains permanently at 10,"
-    //    "even if the player's rating is under 2400 at a later stage"
-    return 10;
-}
-
-/**
- * Calculate the new (Elo) Rating Change.
- *
- * @param nRatingDiff The Rating Difference:
- *                    (positive for Stronger, negative for Weaker)
- *
- * @param nOldRating The Old Rating.
- *
- * @param nPlayedGames The number of games that has been played.
- *
- * @param nGameResult The game's score:
- *                    (win=1, draw=0.5, loss=0)
- *
- * @return The New Rating Change.
- */
-int
-_Elo_calculate_NewRatingChange( const int   nRatingDiff,
-                                const int   nOldRating,
-                                const int   nPlayedGames,
-                                const float fGameResult )
-{
-    const int nAbsoluteRatingDiff = ( nRatingDiff > 0 ? nRatingDiff
-                                                      :(-1 * nRatingDiff) );
-
-    const int nMaxSize = sizeof(s_winningProbabilities) / sizeof (WinningProbability_t);
-    float fExpectedResult = 0.50;
-    for ( int i = nMaxSize-1; i >= 0; --i )
-    {
-        if ( nAbsoluteRatingDiff >= s_winningProbabilities[i].ratingDiff )
-        {
-            fExpectedResult = (   nRatingDiff > 0
-                                ? s_winningProbabilities[i].strongerPlayer
-                                : s_winningProbabilities[i].weakerPlayer );
-            break;
-        }
-    }
-
-    const int nKFactor = _Elo_calculate_KFactor( nPlayedGames, nOldRating );
-
-    return (int) (nKFactor * (fGameResult - fExpectedResult));
-}
+#include "hoxGameArchive.h"
+#include "hoxCheckpoint.h"
+#include "hoxElo.h"
+#include "hoxEventLog.h"
 
 // =========================================================================
 //
@@ -161,8 +41,7 @@ hoxTable::hoxTable( const std::string& id,
         , _nextMoveExpiry( 0 )
         , _isPrevMoveCheck( false )
         , _effectiveMoves( 0 )
-        , _redChecks( 0 )
-        , _blackChecks( 0 )
+        , _isCheckpointLost( false )
 {
     hoxLog(LOG_DEBUG, "%s: (%s) ENTER.", __FUNCTION__, _id.c_str());
 }
@@ -262,13 +141,15 @@ hoxTable::assignPlayerAs( hoxPlayer_SPtr player,
     }
 
     _updateStatus(); // Update the game's status.
+    _updateIndex();
     return hoxRC_OK;
 }
 
 void
 hoxTable::sendInfoToPlayer( hoxPlayer_SPtr player )
 {
-    hoxResponse_SPtr event = hoxResponse::create_event_I_TABLE( this );
+    hoxResponse_SPtr event =
+        hoxResponse::create_event_I_TABLE( this, player->getMillisClock() );
     player->onNewEvent( event );
 
     if ( ! _moves.empty() ) // Inform about the existing Moves.
@@ -297,6 +178,8 @@ hoxTable::_unassignPlayer( hoxPlayer_SPtr player )
 
     _removePlayer( player );  // Update our player-list.
     _updateStatus();  // Update the game's status.
+    _updateIndex();
+    _updateCheckpoint();
 }
 
 hoxResult
@@ -340,7 +223,7 @@ hoxTable::acceptMove( hoxPlayer_SPtr     player,
         return hoxRC_NOT_VALID;
     }
 
-    /* Perpetual-Check detection. */
+    /* Repetition (Perpetual check / chase) and Long-Game detection. */
 
     std::string sReason;  // The reason that (if) game ended.
 
@@ -351,16 +234,23 @@ hoxTable::acceptMove( hoxPlayer_SPtr     player,
     }
     else
     {
-        _detectLongGameAndPerpetualCheck( nextColor, gameStatus, sReason );
+        _detectLongGameAndRepetition( gameStatus, sReason );
     }
-    hoxLog(LOG_DEBUG, "%s: PERPETUAL: %s (R:%d B:%d E:%d)", __FUNCTION__,
-        hoxUtil::colorToString(nextColor).c_str(), _redChecks, _blackChecks, _effectiveMoves);
+    hoxLog(LOG_DEBUG, "%s: %s moved (E:%d)", __FUNCTION__,
+        hoxUtil::colorToString(nextColor).c_str(), _effectiveMoves);
 
     /* Move is fine. Record the Move and prepare for the next one. */
 
+    const int nThinkTime = ( _moves.size() >= 2 ? (int) ( hoxUtil::getMonotonicTime() - _lastMoveTime )
+                                                : 0 );
+    hoxEventLog::getInstance()->log( hoxEVENT_MOVE, player->getId(), "", _id, sMove,
+                                     (long long) nThinkTime * 1000, gameStatus );
+
     _status = gameStatus;
     _moves.push_back( sMove );
     _resetMoveTimers( nextColor );
+    _updateIndex();
+    _updateCheckpoint();
 
     /* Inform other players about the new Move */
     _postAll_MoveEvent( player, sMove, gameStatus );
@@ -436,6 +326,7 @@ hoxTable::handleDrawRequest( hoxPlayer_SPtr player )
         hoxLog(LOG_DEBUG, "%s: Sending Draw-Request from player = [%s]...",
             FNAME, _drawPlayerId.c_str());
         _postAll_DrawEvent( player );
+        _updateCheckpoint();
     }
     /* If the player is requesting AGAIN, do nothing. */
     else if ( player->getId() == _drawPlayerId )
@@ -493,6 +384,7 @@ hoxTable::handleResetRequest( hoxPlayer_SPtr player )
         _onGameReset();
     }
 
+    _updateIndex();
     return hoxRC_OK;
 }
 
@@ -540,6 +432,7 @@ hoxTable::handleUpdateRequest( hoxPlayer_SPtr     player,
     _initialTime = newInitialTime;
     _redTime     = _initialTime;
     _blackTime   = _initialTime;
+    _updateIndex();
 
     /* Inform other players about the new Options */
     _postAll_UpdateEvent( player, _gameType, newInitialTime );
@@ -560,11 +453,11 @@ hoxTable::checkTimeoutOnMove()
         return;
     }
 
-    const time_t now = st_time();
+    const hoxTimeMs now = hoxUtil::getMonotonicTime();
     if ( now <= _nextMoveExpiry ) return;
 
-    hoxLog(LOG_DEBUG, "%s: Timeout detected. Seconds passed = [%d].",
-        FNAME, (now > _nextMoveExpiry));
+    hoxLog(LOG_DEBUG, "%s: Timeout detected. Milliseconds passed = [%d].",
+        FNAME, (int) (now - _nextMoveExpiry));
 
     const hoxColor nextColor = _referee->getNextColor();
     const hoxGameStatus newStatus = ( nextColor == hoxCOLOR_RED
@@ -576,13 +469,91 @@ hoxTable::checkTimeoutOnMove()
     _onGameEnded( newStatus, "Move timeout" );
 }
 
+hoxResult
+hoxTable::restoreState( const hoxTableState& state,
+                        hoxPlayer_SPtr       redPlayer,
+                        hoxPlayer_SPtr       blackPlayer )
+{
+    const char* FNAME = "hoxTable::restoreState";
+    hoxCHECK( redPlayer && blackPlayer, hoxRC_ERR );
+
+    _gameGroup   = state.gameGroup;
+    _gameType    = state.game.gameType;
+    _initialTime = state.game.initialTime;
+    _redTime     = state.game.redTime;
+    _blackTime   = state.game.blackTime;
+
+    _addPlayer( redPlayer, hoxCOLOR_RED );
+    _addPlayer( blackPlayer, hoxCOLOR_BLACK );
+
+    /* Replay the Moves to rebuild the Referee's board. */
+    hoxGameStatus gameStatus = hoxGAME_STATUS_UNKNOWN;
+    const size_t nApplied = _referee->applyMoves( state.game.moves, gameStatus );
+    if ( nApplied != state.game.moves.size() )
+    {
+        hoxStringList::const_iterator it = state.game.moves.begin();
+        std::advance( it, nApplied );
+        hoxLog(LOG_WARN, "%s: (%s) Move [%s] is not valid.", FNAME,
+            _id.c_str(), it->c_str());
+        return hoxRC_NOT_VALID;
+    }
+    _moves = state.game.moves;
+
+    _status          = state.game.status;
+    _drawPlayerId    = state.drawPlayerId;
+    _isPrevMoveCheck = state.isPrevMoveCheck;
+    _effectiveMoves  = state.effectiveMoves;
+
+    /* Restart the clock of the "next" Player. */
+    const hoxTimeMs now = hoxUtil::getMonotonicTime();
+    const hoxTimeInfo& nextTime = ( _referee->getNextColor() == hoxCOLOR_RED
+                                   ? _redTime : _blackTime );
+    int nRemain = nextTime.nGame + nextTime.nFree;
+    if ( nRemain > nextTime.nMove ) nRemain = nextTime.nMove;
+    _lastMoveTime   = now;
+    _nextMoveExpiry = now + nRemain;
+    hoxTableMgr::getInstance()->onNewMoveExpiry( _nextMoveExpiry );
+
+    hoxLog(LOG_INFO, "%s: Table [%s] restored: [%s] vs. [%s], %d moves.", FNAME,
+        _id.c_str(), redPlayer->getId().c_str(), blackPlayer->getId().c_str(),
+        (int) _moves.size());
+    return hoxRC_OK;
+}
+
+void
+hoxTable::replacePlayer( hoxPlayer_SPtr oldPlayer,
+                         hoxPlayer_SPtr newPlayer )
+{
+    for ( hoxPlayerList::iterator it = _allPlayers.begin();
+                                  it != _allPlayers.end(); ++it )
+    {
+        if ( *it == oldPlayer ) *it = newPlayer;
+    }
+
+    if ( _redPlayer   == oldPlayer ) _redPlayer   = newPlayer;
+    if ( _blackPlayer == oldPlayer ) _blackPlayer = newPlayer;
+    _updateIndex();
+}
+
+hoxTimeMs
+hoxTable::getNextMoveExpiry() const
+{
+    const bool bGameStarted = (_moves.size() >= 2);
+    if (   _status != hoxGAME_STATUS_IN_PROGRESS
+        || !bGameStarted )
+    {
+        return 0;
+    }
+    return _nextMoveExpiry;
+}
+
 void
 hoxTable::getCurrentTimers( hoxTimeInfo& redTime,
                             hoxTimeInfo& blackTime ) const
 {
-    const time_t now        = st_time();
-    const time_t elapseTime = (_moves.size() > 2 ? (now - _lastMoveTime)
-                                                 : 0 );
+    const hoxTimeMs now        = hoxUtil::getMonotonicTime();
+    const int       elapseTime = (_moves.size() > 2 ? (int) (now - _lastMoveTime)
+                                                    : 0 );
     const hoxColor nextColor = _referee->getNextColor();
     redTime   = _redTime;
     blackTime = _blackTime;
@@ -667,15 +638,73 @@ hoxTable::_updateStatus()
     }
 }
 
+void
+hoxTable::_updateIndex() const
+{
+    hoxTableMgr::getInstance()->updateTableIndex( this );
+}
+
+void
+hoxTable::_updateCheckpoint() const
+{
+    const char* FNAME = "hoxTable::_updateCheckpoint";
+
+    if ( ! hoxCheckpoint::getInstance()->isOpen() ) return;
+
+    /* Only the in-progress Games are worth restoring. */
+    if (   _status != hoxGAME_STATUS_IN_PROGRESS
+        || !_redPlayer || !_blackPlayer )
+    {
+        hoxCheckpoint::getInstance()->clear( _id );
+        _isCheckpointLost = false;
+        return;
+    }
+
+    hoxTableState state;
+    state.tableId          = _id;
+    state.gameGroup        = _gameGroup;
+    state.game.timestamp   = st_time();
+    state.game.gameType    = _gameType;
+    state.game.status      = _status;
+    state.game.initialTime = _initialTime;
+    state.game.redTime     = _redTime;
+    state.game.blackTime   = _blackTime;
+    state.game.redId       = _redPlayer->getId();
+    state.game.redScore    = _redPlayer->getScore();
+    state.game.blackId     = _blackPlayer->getId();
+    state.game.blackScore  = _blackPlayer->getScore();
+    state.game.moves       = _moves;
+    state.redGames[0]      = _redPlayer->getWins();
+    state.redGames[1]      = _redPlayer->getDraws();
+    state.redGames[2]      = _redPlayer->getLosses();
+    state.blackGames[0]    = _blackPlayer->getWins();
+    state.blackGames[1]    = _blackPlayer->getDraws();
+    state.blackGames[2]    = _blackPlayer->getLosses();
+    state.drawPlayerId     = _drawPlayerId;
+    state.isPrevMoveCheck  = _isPrevMoveCheck;
+    state.effectiveMoves   = _effectiveMoves;
+
+    if ( hoxRC_OK == hoxCheckpoint::getInstance()->save( state ) )
+    {
+        _isCheckpointLost = false;
+    }
+    else if ( ! _isCheckpointLost )  /* Only once, not after every Move. */
+    {
+        hoxLog(LOG_WARN, "%s: Table [%s] is no longer checkpointed (%d moves).",
+            FNAME, _id.c_str(), (int) _moves.size());
+        _isCheckpointLost = true;
+    }
+}
+
 void
 hoxTable::_resetMoveTimers( const hoxColor currColor )
 {
     if ( _status != hoxGAME_STATUS_IN_PROGRESS ) return;
 
     /* Update the timestamp of the last Move. */
-    const time_t now        = st_time();
-    const time_t elapseTime = (_moves.size() > 2 ? (now - _lastMoveTime)
-                                                 : 0 );
+    const hoxTimeMs now        = hoxUtil::getMonotonicTime();
+    const int       elapseTime = (_moves.size() > 2 ? (int) (now - _lastMoveTime)
+                                                    : 0 );
     _lastMoveTime = now;
 
     /* Start timers only after each Player made a Move. */
@@ -705,6 +734,7 @@ hoxTable::_resetMoveTimers( const hoxColor currColor )
     int nRemain = pNextTime->nGame + pNextTime->nFree;
     if ( nRemain > pNextTime->nMove ) nRemain = pNextTime->nMove;
     _nextMoveExpiry = now + nRemain;
+    hoxTableMgr::getInstance()->onNewMoveExpiry( _nextMoveExpiry );
 
     hoxLog(LOG_DEBUG, "%s: Turn : [%s], (%d / %d / %d) vs (%d / %d / %d)",
         __FUNCTION__, hoxUtil::colorToString(currColor).c_str(),
@@ -714,47 +744,32 @@ hoxTable::_resetMoveTimers( const hoxColor currColor )
 }
 
 void
-hoxTable::_detectLongGameAndPerpetualCheck( const hoxColor color,
-                                            hoxGameStatus& gameStatus,
-                                            std::string&   sReason )
+hoxTable::_detectLongGameAndRepetition( hoxGameStatus& gameStatus,
+                                        std::string&   sReason )
 {
     /* Side-effects:
      *    The following member variables are effected:
      *     + The number of 'effective' moves.
-     *     + The number of RED/BLACK perpetual moves.
      */
 
     const bool bCurrentCheck = _referee->isLastMoveCheck();
 
-    if ( bCurrentCheck )
-    {
-        int perpetualChecks = 0;
-        if ( color == hoxCOLOR_RED ) perpetualChecks = ++_redChecks;
-        else                         perpetualChecks = ++_blackChecks;
+    /* The Referee keeps the position history and judges repetitions. */
+    gameStatus = _referee->judgeRepetition( sReason );
 
-        if ( perpetualChecks > hoxPERPETUAL_CHECKS_MAX )
-        {
-            gameStatus = ( color == hoxCOLOR_RED ? hoxGAME_STATUS_BLACK_WIN
-                                                 : hoxGAME_STATUS_RED_WIN );
-            sReason = "Perpetual Check detected";
-            hoxLog(LOG_INFO, "%s: Game ended [%s]. %s.", __FUNCTION__,
-                hoxUtil::gameStatusToString(gameStatus).c_str(), sReason.c_str());
-        }
+    if ( gameStatus != hoxGAME_STATUS_IN_PROGRESS )
+    {
+        hoxLog(LOG_INFO, "%s: Game ended [%s]. %s.", __FUNCTION__,
+            hoxUtil::gameStatusToString(gameStatus).c_str(), sReason.c_str());
     }
-    else /* non-check Move ? */
+    else if ( !bCurrentCheck && !_isPrevMoveCheck ) /* non-check Move ? */
     {
-        if ( color == hoxCOLOR_RED ) _redChecks   = 0;
-        else                         _blackChecks = 0;
-
-        if ( !_isPrevMoveCheck )
+        if ( ++_effectiveMoves > hoxEFFECTIVE_MOVES_MAX )
         {
-            if ( ++_effectiveMoves > hoxEFFECTIVE_MOVES_MAX )
-            {
-                gameStatus = hoxGAME_STATUS_DRAWN;
-                sReason = "Long Game detected";
-                hoxLog(LOG_INFO, "%s: Game ended [%s]. %s.", __FUNCTION__,
-                    hoxUtil::gameStatusToString(gameStatus).c_str(), sReason.c_str());
-            }
+            gameStatus = hoxGAME_STATUS_DRAWN;
+            sReason = "Long Game detected";
+            hoxLog(LOG_INFO, "%s: Game ended [%s]. %s.", __FUNCTION__,
+                hoxUtil::gameStatusToString(gameStatus).c_str(), sReason.c_str());
         }
     }
 
@@ -772,6 +787,9 @@ hoxTable::_onGameEnded( const hoxGameStatus status,
     _status       = status;
     _drawPlayerId = "";
 
+    hoxEventLog::getInstance()->log( hoxEVENT_GAME_END, _redPlayer->getId(),
+                                     _blackPlayer->getId(), _id, sReason, 0, status );
+
     _postAll_EndEvent( _status, sReason );
 
     bool bGuestTable = false;
@@ -792,6 +810,18 @@ hoxTable::_onGameEnded( const hoxGameStatus status,
         _postAll_ScoreEvent( _redPlayer );
         _postAll_ScoreEvent( _blackPlayer );
     }
+
+    hoxGameRecord record;
+    _getGameRecord( record );
+
+    if ( !bGuestTable )
+    {
+        hoxDbClient::put_game_info( record );  // ... to the Players' history.
+    }
+
+    _archiveGame( record );
+    _updateIndex();
+    _updateCheckpoint();
 }
 
 void
@@ -806,6 +836,7 @@ hoxTable::_onGameReset()
 
     /* Update the game's status. */
     _updateStatus();
+    _updateIndex();
 
     /* Reset timers. */
     _redTime   = _initialTime;
@@ -818,8 +849,7 @@ hoxTable::_onGameReset()
     /* Reset move counts. */
     _isPrevMoveCheck = false;
     _effectiveMoves  = 0;
-    _redChecks       = 0;
-    _blackChecks     = 0;
+    _updateCheckpoint();
 
     /* Notify all players. */
     _postAll_ResetEvent();
@@ -876,6 +906,35 @@ hoxTable::_recordGameResult()
     return bScoreChanged;
 }
 
+void
+hoxTable::_getGameRecord( hoxGameRecord& record ) const
+{
+    record.timestamp   = st_time();
+    record.gameType    = _gameType;
+    record.status      = _status;
+    record.initialTime = _initialTime;
+    getCurrentTimers( record.redTime, record.blackTime );
+    record.redId       = _redPlayer->getId();
+    record.redScore    = _redPlayer->getScore();
+    record.blackId     = _blackPlayer->getId();
+    record.blackScore  = _blackPlayer->getScore();
+    record.moves       = _moves;
+}
+
+void
+hoxTable::_archiveGame( const hoxGameRecord& record )
+{
+    const char* FNAME = "hoxTable::_archiveGame";
+
+    if ( ! hoxGameArchive::getInstance()->isOpen() ) return;
+
+    if ( hoxRC_OK != hoxGameArchive::getInstance()->appendGame( record ) )
+    {
+        hoxLog(LOG_WARN, "%s: Failed to archive the game at Table [%s].",
+            FNAME, _id.c_str());
+    }
+}
+
 void hoxTable::_calculateNewScores()
 {
     /* References: Using "Elo Rating System":
@@ -883,42 +942,23 @@ void hoxTable::_calculateNewScores()
      *   http://gobase.org/studying/articles/elo/
      */
 
-    // NOTE: Focus more on the "experienced" player.
-    const bool bUseRED =
-        _redPlayer->getPlayedGames() > _blackPlayer->getPlayedGames();
-
-    const int nRatingDiff =
-        ( bUseRED ? _redPlayer->getScore() - _blackPlayer->getScore()
-                  : _blackPlayer->getScore() - _redPlayer->getScore() );
-
-    const int nOldRating =
-        ( bUseRED ? _redPlayer->getScore() : _blackPlayer->getScore() );
-
-    const int nPlayedGames =
-        ( bUseRED ? _redPlayer->getPlayedGames() : _blackPlayer->getPlayedGames() );
+    const hoxElo::Rating_t red( _redPlayer->getScore(),
+                                _redPlayer->getPlayedGames() );
+    const hoxElo::Rating_t black( _blackPlayer->getScore(),
+                                  _blackPlayer->getPlayedGames() );
 
-    float fGameResult = 0.0;
+    float fRedResult = 0.0;
     switch ( _status )
     {
-        case hoxGAME_STATUS_RED_WIN:   fGameResult = bUseRED ? 1.0 : 0.0; break;
-        case hoxGAME_STATUS_BLACK_WIN: fGameResult = bUseRED ? 0.0 : 1.0; break;
-        default: /* DRAWN */           fGameResult = 0.5;
+        case hoxGAME_STATUS_RED_WIN:   fRedResult = 1.0; break;
+        case hoxGAME_STATUS_BLACK_WIN: fRedResult = 0.0; break;
+        default: /* DRAWN */           fRedResult = 0.5;
     }
 
-    const int nRatingChange =
-        _Elo_calculate_NewRatingChange( nRatingDiff, nOldRating,
-                                        nPlayedGames, fGameResult );
+    const int nRedChange = hoxElo::calculate_RedChange( red, black, fRedResult );
 
-    if ( bUseRED )
-    {
-        _redPlayer->setScore( _redPlayer->getScore() + nRatingChange );
-        _blackPlayer->setScore( _blackPlayer->getScore() - nRatingChange );
-    }
-    else
-    {
-        _redPlayer->setScore( _redPlayer->getScore() - nRatingChange );
-        _blackPlayer->setScore( _blackPlayer->getScore() + nRatingChange );
-    }
+    _redPlayer->setScore( _redPlayer->getScore() + nRedChange );
+    _blackPlayer->setScore( _blackPlayer->getScore() - nRedChange );
 }
 
 void
@@ -1021,14 +1061,28 @@ hoxTable::_postAll_UpdateEvent( const hoxPlayer_SPtr player,
                                 const hoxGameType  newGameType,
                                 const hoxTimeInfo& newInitialTime )
 {
+    /* Each client gets the timers in its own unit (see I_TABLE). */
     const hoxResponse_SPtr event = 
         hoxResponse::create_event_UPDATE( this, player, 
                                           newGameType, newInitialTime );
+    hoxResponse_SPtr millisEvent;  // Created only if needed.
 
     for ( hoxPlayerList::const_iterator it = _allPlayers.begin();
                                         it != _allPlayers.end(); ++it )
     {
-        (*it)->onNewEvent( event );
+        if ( (*it)->getMillisClock() )
+        {
+            if ( ! millisEvent )
+            {
+                millisEvent = hoxResponse::create_event_UPDATE( this, player, newGameType,
+                                                                newInitialTime, true );
+            }
+            (*it)->onNewEvent( millisEvent );
+        }
+        else
+        {
+            (*it)->onNewEvent( event );
+        }
     }
 }
 
@@ -1060,6 +1114,7 @@ hoxTableMgr::createTable( const hoxTimeInfo& initialTime )
     hoxTable_SPtr pTable( new hoxTable( newTableId, initialTime ) );
 
     _tableMap[newTableId] = pTable;
+    updateTableIndex( pTable.get() );
     return pTable;
 }
 
@@ -1073,10 +1128,77 @@ hoxTableMgr::deleteTable( const std::string& tableId )
     }
 
     _tableMap.erase( foundIt );
+    _removeFromIndex( hoxUtil::stringToInt(tableId) );
+    hoxCheckpoint::getInstance()->clear( tableId );
     _freeIdList.push_back( hoxUtil::stringToInt(tableId) );
     return true;
 }
 
+int
+hoxTableMgr::restoreTables()
+{
+    const char* FNAME = "hoxTableMgr::restoreTables";
+    hoxTableStateList states;
+    int               nRestored = 0;
+
+    hoxCheckpoint::getInstance()->load( states );
+
+    for ( hoxTableStateList::const_iterator it = states.begin();
+                                            it != states.end(); ++it )
+    {
+        if ( _tableMap.find( it->tableId ) != _tableMap.end() )
+        {
+            continue;  // Already restored.
+        }
+
+        hoxTable_SPtr pTable( new hoxTable( it->tableId, it->game.initialTime ) );
+        hoxPlayer_SPtr redPlayer   =
+            _getRestoredPlayer( it->game, hoxCOLOR_RED, it->redGames );
+        hoxPlayer_SPtr blackPlayer =
+            _getRestoredPlayer( it->game, hoxCOLOR_BLACK, it->blackGames );
+
+        if ( hoxRC_OK != pTable->restoreState( *it, redPlayer, blackPlayer ) )
+        {
+            hoxLog(LOG_WARN, "%s: Failed to restore Table [%s].", FNAME,
+                it->tableId.c_str());
+            hoxCheckpoint::getInstance()->clear( it->tableId );
+            continue;
+        }
+
+        _tableMap[it->tableId] = pTable;
+        updateTableIndex( pTable.get() );
+        redPlayer->addTable( pTable );
+        blackPlayer->addTable( pTable );
+        ++nRestored;
+    }
+
+    _restoreTime = st_time();
+    hoxLog(LOG_INFO, "%s: %d Table(s) restored.", FNAME, nRestored);
+    return nRestored;
+}
+
+void
+hoxTableMgr::reattachPlayer( hoxPlayer_SPtr player )
+{
+    const char* FNAME = "hoxTableMgr::reattachPlayer";
+
+    PlayerContainer::iterator foundIt = _restoredPlayers.find( player->getId() );
+    if ( foundIt == _restoredPlayers.end() ) return;
+
+    hoxPlayer_SPtr placeholder = foundIt->second;
+    _restoredPlayers.erase( foundIt );
+
+    const hoxTableSet tables = placeholder->getTables(); // Make a copy.
+    for ( hoxTableSet::const_iterator it = tables.begin();
+                                      it != tables.end(); ++it )
+    {
+        hoxLog(LOG_INFO, "%s: Player [%s] is back at Table [%s].", FNAME,
+            player->getId().c_str(), (*it)->getId().c_str());
+        (*it)->replacePlayer( placeholder, player );
+        player->addTable( *it );
+    }
+}
+
 hoxTable_SPtr
 hoxTableMgr::findTable( const std::string& tableId ) const
 {
@@ -1102,6 +1224,162 @@ hoxTableMgr::getTables( hoxTableList& tables ) const
     }
 }
 
+void
+hoxTableMgr::getTables( const hoxTableFilter& filter,
+                        hoxTableList&         tables,
+                        int&                  nextCursor ) const
+{
+    static const TableIdSet s_emptySet;
+
+    tables.clear();
+    nextCursor = 0;
+
+    const int nLimit = ( filter.limit > 0 && filter.limit < hoxLIST_LIMIT_MAX
+                        ? filter.limit : hoxLIST_LIMIT_MAX );
+
+    if (    filter.minScore >= 0 && filter.maxScore >= 0
+         && filter.minScore > filter.maxScore )
+    {
+        return;  // An empty range (and the score-index cannot walk it).
+    }
+
+    /* Select the smallest applicable index to drive the scan.
+     * The score-index may contribute several (rating) bands,
+     * which are merged below by Table-Id.
+     */
+    std::list<const TableIdSet*> driver( 1, &_allIds );
+    size_t nDriverSize = _allIds.size();
+    TableIndex::const_iterator found;
+
+    if ( filter.status != hoxGAME_STATUS_UNKNOWN )
+    {
+        found = _statusIndex.find( filter.status );
+        const TableIdSet* pSet = ( found != _statusIndex.end() ? &found->second : &s_emptySet );
+        if ( pSet->size() < nDriverSize )
+        {
+            driver.assign( 1, pSet );
+            nDriverSize = pSet->size();
+        }
+    }
+    if ( filter.gameType != hoxGAME_TYPE_UNKNOWN )
+    {
+        found = _typeIndex.find( filter.gameType );
+        const TableIdSet* pSet = ( found != _typeIndex.end() ? &found->second : &s_emptySet );
+        if ( pSet->size() < nDriverSize )
+        {
+            driver.assign( 1, pSet );
+            nDriverSize = pSet->size();
+        }
+    }
+    if ( filter.timeBucket != hoxTIME_BUCKET_UNKNOWN )
+    {
+        found = _timeIndex.find( filter.timeBucket );
+        const TableIdSet* pSet = ( found != _timeIndex.end() ? &found->second : &s_emptySet );
+        if ( pSet->size() < nDriverSize )
+        {
+            driver.assign( 1, pSet );
+            nDriverSize = pSet->size();
+        }
+    }
+    if ( filter.minScore >= 0 || filter.maxScore >= 0 )
+    {
+        TableIndex::const_iterator first = ( filter.minScore >= 0
+            ? _scoreIndex.lower_bound( filter.minScore / hoxSCORE_BAND_SIZE )
+            : _scoreIndex.begin() );
+        TableIndex::const_iterator last = ( filter.maxScore >= 0
+            ? _scoreIndex.upper_bound( filter.maxScore / hoxSCORE_BAND_SIZE )
+            : _scoreIndex.end() );
+
+        std::list<const TableIdSet*> bands;
+        size_t nBandsSize = 0;
+        for ( ; first != last; ++first )
+        {
+            bands.push_back( &first->second );
+            nBandsSize += first->second.size();
+        }
+        if ( nBandsSize < nDriverSize )
+        {
+            driver.swap( bands );
+            nDriverSize = nBandsSize;
+        }
+    }
+
+    /* Walk the driving set(s) in the order of Table-Id, starting
+     * right after the cursor, and stop as soon as the page is full.
+     */
+    typedef std::pair<TableIdSet::const_iterator, TableIdSet::const_iterator> Range;
+    std::list<Range> ranges;
+    for ( std::list<const TableIdSet*>::const_iterator it = driver.begin();
+                                                       it != driver.end(); ++it )
+    {
+        ranges.push_back( Range( (*it)->upper_bound( filter.cursor ), (*it)->end() ) );
+    }
+
+    for (;;)
+    {
+        std::list<Range>::iterator minIt = ranges.end();
+        for ( std::list<Range>::iterator it = ranges.begin(); it != ranges.end(); ++it )
+        {
+            if (    it->first != it->second
+                 && ( minIt == ranges.end() || *(it->first) < *(minIt->first) ) )
+            {
+                minIt = it;
+            }
+        }
+        if ( minIt == ranges.end() ) break;  // No more candidates.
+
+        const int nId = *(minIt->first);
+        ++(minIt->first);
+
+        IndexKeyMap::const_iterator keyIt = _indexKeys.find( nId );
+        if ( keyIt == _indexKeys.end() || !_matchFilter( keyIt->second, filter ) )
+        {
+            continue;
+        }
+
+        if ( (int) tables.size() == nLimit )  // One more match exists?
+        {
+            nextCursor = hoxUtil::stringToInt( tables.back()->getId() );
+            break;
+        }
+        tables.push_back( findTable( hoxUtil::intToString( nId ) ) );
+    }
+}
+
+void
+hoxTableMgr::updateTableIndex( const hoxTable* pTable )
+{
+    if ( _tableMap.find( pTable->getId() ) == _tableMap.end() )
+    {
+        return;  // Not (or no longer) managed.
+    }
+
+    const hoxPlayer_SPtr redPlayer   = pTable->getRedPlayer();
+    const hoxPlayer_SPtr blackPlayer = pTable->getBlackPlayer();
+    const int nRedScore   = ( redPlayer   ? redPlayer->getScore()   : 0 );
+    const int nBlackScore = ( blackPlayer ? blackPlayer->getScore() : 0 );
+
+    IndexKey key;
+    key.status     = pTable->getStatus();
+    key.gameType   = pTable->getGameType();
+    key.timeBucket = getTimeBucket( pTable->getInitialTime() );
+    key.maxScore   = ( nRedScore > nBlackScore ? nRedScore : nBlackScore );
+
+    const int nId = hoxUtil::stringToInt( pTable->getId() );
+    _removeFromIndex( nId );
+    _addToIndex( nId, key );
+}
+
+/*static*/
+hoxTimeBucket
+hoxTableMgr::getTimeBucket( const hoxTimeInfo& initialTime )
+{
+    if ( initialTime.nGame <= 5 * 60 * 1000 )  return hoxTIME_BUCKET_BLITZ;
+    if ( initialTime.nGame <= 15 * 60 * 1000 ) return hoxTIME_BUCKET_RAPID;
+    if ( initialTime.nGame <= 30 * 60 * 1000 ) return hoxTIME_BUCKET_STANDARD;
+    return hoxTIME_BUCKET_LONG;
+}
+
 void
 hoxTableMgr::runCleanup()
 {
@@ -1120,6 +1398,8 @@ hoxTableMgr::runCleanup()
         {
             hoxLog(LOG_DEBUG, "%s: Purge the empty table [%s].", FNAME, pTable->getId().c_str());
             _tableMap.erase( it++ );
+            _removeFromIndex( hoxUtil::stringToInt(pTable->getId()) );
+            hoxCheckpoint::getInstance()->clear( pTable->getId() );
             _freeIdList.push_back( hoxUtil::stringToInt(pTable->getId()) );
         }
         else
@@ -1129,14 +1409,106 @@ hoxTableMgr::runCleanup()
     }
 }
 
-void
+hoxTimeMs
 hoxTableMgr::manageTables()
 {
+    if (   ! _restoredPlayers.empty()
+        && st_time() - _restoreTime > SESSION_EXPIRY )
+    {
+        _expireRestoredPlayers();
+    }
+
+    hoxTimeMs nextExpiry = 0;
+    hoxTimeMs expiry;
     for ( TableContainer::const_iterator it = _tableMap.begin();
                                          it != _tableMap.end(); ++it )
     {
         it->second->checkTimeoutOnMove();
+        expiry = it->second->getNextMoveExpiry();
+        if ( expiry != 0 && ( nextExpiry == 0 || expiry < nextExpiry ) )
+        {
+            nextExpiry = expiry;
+        }
+    }
+    return nextExpiry;
+}
+
+void
+hoxTableMgr::waitForExpiry( const hoxTimeMs nextExpiry,
+                            const int       nMaxWait )
+{
+    if ( _expiryCond == NULL )
+    {
+        _expiryCond = st_cond_new();
     }
+
+    /* NOTE: A Move-timer expires only after its deadline has passed. */
+    const hoxTimeMs now = hoxUtil::getMonotonicTime();
+    _nextWakeup = now + nMaxWait * 1000;
+    if ( nextExpiry != 0 && nextExpiry + 1 < _nextWakeup )
+    {
+        _nextWakeup = nextExpiry + 1;
+    }
+
+    if ( _nextWakeup > now )
+    {
+        st_cond_timedwait( _expiryCond, ( _nextWakeup - now ) * 1000 /* usecs */ );
+    }
+    _nextWakeup = 0;
+}
+
+void
+hoxTableMgr::onNewMoveExpiry( const hoxTimeMs expiry )
+{
+    /* Wake up the waiting thread if it would wake up too late. */
+    if ( _nextWakeup != 0 && expiry + 1 < _nextWakeup )
+    {
+        st_cond_signal( _expiryCond );
+    }
+}
+
+void
+hoxTableMgr::_addToIndex( const int       nId,
+                          const IndexKey& key )
+{
+    _indexKeys[nId] = key;
+    _allIds.insert( nId );
+    _statusIndex[key.status].insert( nId );
+    _typeIndex[key.gameType].insert( nId );
+    _timeIndex[key.timeBucket].insert( nId );
+    _scoreIndex[key.maxScore / hoxSCORE_BAND_SIZE].insert( nId );
+}
+
+void
+hoxTableMgr::_removeFromIndex( const int nId )
+{
+    IndexKeyMap::iterator foundIt = _indexKeys.find( nId );
+    if ( foundIt == _indexKeys.end() ) return;
+
+    const IndexKey& key = foundIt->second;
+    _statusIndex[key.status].erase( nId );
+    _typeIndex[key.gameType].erase( nId );
+    _timeIndex[key.timeBucket].erase( nId );
+    _scoreIndex[key.maxScore / hoxSCORE_BAND_SIZE].erase( nId );
+    _allIds.erase( nId );
+    _indexKeys.erase( foundIt );
+}
+
+bool
+hoxTableMgr::_matchFilter( const IndexKey&       key,
+                           const hoxTableFilter& filter ) const
+{
+    if ( filter.status != hoxGAME_STATUS_UNKNOWN && key.status != filter.status )
+        return false;
+    if ( filter.gameType != hoxGAME_TYPE_UNKNOWN && key.gameType != filter.gameType )
+        return false;
+    if ( filter.timeBucket != hoxTIME_BUCKET_UNKNOWN && key.timeBucket != filter.timeBucket )
+        return false;
+    if ( filter.minScore >= 0 && key.maxScore < filter.minScore )
+        return false;
+    if ( filter.maxScore >= 0 && key.maxScore > filter.maxScore )
+        return false;
+    return true;
 }
 
 const std::string
@@ -1146,7 +1518,14 @@ hoxTableMgr::_generateNewTableId()
 
     if ( _freeIdList.empty() )
     {
+        /* NOTE: Restored Tables keep their Ids, so the Ids in use
+         *       are not necessarily contiguous.
+         */
         nId = _tableMap.size() + 1;
+        while ( _tableMap.find( hoxUtil::intToString(nId) ) != _tableMap.end() )
+        {
+            ++nId;
+        }
     }
     else
     {
@@ -1157,4 +1536,50 @@ hoxTableMgr::_generateNewTableId()
     return hoxUtil::intToString( nId );
 }
 
+hoxPlayer_SPtr
+hoxTableMgr::_getRestoredPlayer( const hoxGameRecord& game,
+                                 const hoxColor       color,
+                                 const int            games[3] )
+{
+    const std::string playerId = ( color == hoxCOLOR_RED ? game.redId : game.blackId );
+
+    PlayerContainer::const_iterator foundIt = _restoredPlayers.find( playerId );
+    if ( foundIt != _restoredPlayers.end() )
+    {
+        return foundIt->second;  // Seated at more than one Table.
+    }
+
+    const hoxPlayerType type = ( playerId.find("Guest#") == 0 ? hoxPLAYER_TYPE_GUEST
+                                                              : hoxPLAYER_TYPE_NORMAL );
+    hoxPlayer_SPtr player( new hoxPlayer( playerId, type ) );
+    player->setScore( color == hoxCOLOR_RED ? game.redScore : game.blackScore );
+    player->setWins( games[0] );
+    player->setDraws( games[1] );
+    player->setLosses( games[2] );
+
+    _restoredPlayers[playerId] = player;
+    return player;
+}
+
+void
+hoxTableMgr::_expireRestoredPlayers()
+{
+    const char* FNAME = "hoxTableMgr::_expireRestoredPlayers";
+
+    /* The Players who did not come back lose their Games,
+     * as if their sessions had expired.
+     */
+    const PlayerContainer players = _restoredPlayers; // Make a copy.
+    _restoredPlayers.clear();
+
+    for ( PlayerContainer::const_iterator it = players.begin();
+                                          it != players.end(); ++it )
+    {
+        hoxLog(LOG_INFO, "%s: Player [%s] did not come back.", FNAME, it->first.c_str());
+        it->second->leaveAllTables();
+    }
+
+    runCleanup();
+}
+
 /******************* END OF FILE *********************************************/
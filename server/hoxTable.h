@@ -13,11 +13,15 @@
 
 #include <string>
 #include <map>
+#include <set>
+#include <st.h>
 #include "hoxPlayer.h"
 #include "hoxTypes.h"
 
 /* Forward declarations. */
 class hoxReferee;
+class hoxTableState;
+class hoxGameRecord;
 
 /**
  * A Table.
@@ -124,11 +128,38 @@ public:
      */
     void checkTimeoutOnMove();
 
+    /**
+     * Get the time before which the "next" Player must make a Move
+     * (0 if no clock is running).
+     */
+    hoxTimeMs getNextMoveExpiry() const;
+
     /**
      * Check if this Table has no Player attending.
      */
     bool isEmpty() const { return _allPlayers.empty(); }
 
+    /**
+     * Restore an in-progress Game from its checkpointed state.
+     * The Moves are replayed through the Referee. The clock of the "next"
+     * Player restarts now, i.e., the time lost during the restart is
+     * not charged to any Player.
+     *
+     * @param state The saved state.
+     * @param redPlayer The (placeholder of the) RED Player.
+     * @param blackPlayer The (placeholder of the) BLACK Player.
+     */
+    hoxResult restoreState( const hoxTableState& state,
+                            hoxPlayer_SPtr       redPlayer,
+                            hoxPlayer_SPtr       blackPlayer );
+
+    /**
+     * Replace a Player (e.g., a restored placeholder) by another Player
+     * with the same Id, keeping the seat.
+     */
+    void replacePlayer( hoxPlayer_SPtr oldPlayer,
+                        hoxPlayer_SPtr newPlayer );
+
 private:
     /**
      * Unseat a given player from this table.
@@ -145,17 +176,20 @@ private:
     void _removePlayer( hoxPlayer_SPtr player );
 
     void _updateStatus();
+    void _updateIndex() const;
+    void _updateCheckpoint() const;
     void _resetMoveTimers( const hoxColor currColor );
 
-    void _detectLongGameAndPerpetualCheck( const hoxColor color,
-                                           hoxGameStatus& gameStatus,
-                                           std::string&   sReason );
+    void _detectLongGameAndRepetition( hoxGameStatus& gameStatus,
+                                       std::string&   sReason );
 
     void _onGameEnded( const hoxGameStatus status,
                        const std::string&  sReason );
     void _onGameReset();
 
     bool _recordGameResult();
+    void _getGameRecord( hoxGameRecord& record ) const;
+    void _archiveGame( const hoxGameRecord& record );
     void _calculateNewScores();
 
     void _postAll_JoinEvent( hoxPlayer_SPtr player,
@@ -198,9 +232,9 @@ private:
          * If it is empty, then there is no player requesting.
          */
 
-    time_t          _lastMoveTime; // Timestamp of the last move.
+    hoxTimeMs       _lastMoveTime; // Timestamp of the last move.
 
-    time_t          _nextMoveExpiry;
+    hoxTimeMs       _nextMoveExpiry;
         /* The time before which the "next" Player must make a move
          * or will lose by timeout.
          */
@@ -211,9 +245,31 @@ private:
     int             _effectiveMoves;
         /* The number of 'effective' (i.e., non-check) Moves. */
 
-    int             _redChecks;
-    int             _blackChecks;
-        /* The number of consecutive 'Check' Moves. */
+    mutable bool    _isCheckpointLost;
+        /* Whether the last save of the checkpoint failed (and was logged). */
+};
+
+/**
+ * The filter (and the page) of a LIST request.
+ * Fields left at their default values do not filter anything.
+ */
+class hoxTableFilter
+{
+public:
+    hoxGameStatus  status;
+    hoxGameType    gameType;
+    hoxTimeBucket  timeBucket;
+    int            minScore;   // Min of the max player-score (-1 = any).
+    int            maxScore;   // Max of the max player-score (-1 = any).
+
+    int            cursor;     // Only return Tables whose Id is greater.
+    int            limit;      // The maximum number of Tables returned.
+
+    hoxTableFilter() : status( hoxGAME_STATUS_UNKNOWN )
+                     , gameType( hoxGAME_TYPE_UNKNOWN )
+                     , timeBucket( hoxTIME_BUCKET_UNKNOWN )
+                     , minScore( -1 ), maxScore( -1 )
+                     , cursor( 0 ), limit( hoxLIST_LIMIT_MAX ) {}
 };
 
 /**
@@ -228,6 +284,18 @@ private:
     typedef std::map<const std::string, hoxTable_SPtr> TableContainer;
     typedef std::list<int> FreeTableIdList;
 
+    /* The indexed attributes of a Table. */
+    struct IndexKey
+    {
+        hoxGameStatus  status;
+        hoxGameType    gameType;
+        hoxTimeBucket  timeBucket;
+        int            maxScore;
+    };
+    typedef std::map<int, IndexKey>   IndexKeyMap;   // Table-Id => Key
+    typedef std::set<int>             TableIdSet;    // Sorted Table-Ids
+    typedef std::map<int, TableIdSet> TableIndex;    // Attribute => Ids
+
 public:
     static hoxTableMgr* getInstance();
 
@@ -237,6 +305,20 @@ public:
     hoxTable_SPtr createTable( const hoxTimeInfo& initialTime );
     bool deleteTable(const std::string& tableId);
 
+    /**
+     * Re-create the in-progress Tables from the checkpoint.
+     * The seated Players are represented by placeholders until they
+     * log in again (see reattachPlayer) or until SESSION_EXPIRY.
+     *
+     * @return The number of Tables restored.
+     */
+    int restoreTables();
+
+    /**
+     * Give back the restored seats (if any) to a Player who just logged in.
+     */
+    void reattachPlayer( hoxPlayer_SPtr player );
+
     /**
      * Find a Table by table-Id.
      *
@@ -247,21 +329,91 @@ public:
 
     void getTables(hoxTableList& tables) const;
 
+    /**
+     * Get a page of Tables matching a given filter, ordered by Table-Id.
+     * Only the Tables in the page are visited, in addition to the
+     * non-matching ones within the smallest applicable index.
+     * The page is empty if the score range is inverted (min > max).
+     *
+     * @param filter The filter, cursor and page limit.
+     * @param tables [OUT] The Tables found.
+     * @param nextCursor [OUT] The cursor of the next page (0 = last page).
+     */
+    void getTables( const hoxTableFilter& filter,
+                    hoxTableList&         tables,
+                    int&                  nextCursor ) const;
+
+    /**
+     * Refresh the index entries of a given Table.
+     * Tables call this API whenever their status, game-type,
+     * initial-time or seated players change.
+     */
+    void updateTableIndex( const hoxTable* pTable );
+
+    /**
+     * Determine the time-control bucket of a given initial-time.
+     */
+    static hoxTimeBucket getTimeBucket( const hoxTimeInfo& initialTime );
+
     /**
      * Run a cleanup procedure.
      */
     void runCleanup();
 
-    void manageTables();
+    /**
+     * Check the Tables for timeout.
+     *
+     * @return The earliest Move-expiry of all Tables (0 if none).
+     */
+    hoxTimeMs manageTables();
+
+    /**
+     * Wait until a given Move-expiry has passed, or a Table has a new
+     * earlier expiry, or a maximum wait time elapses.
+     *
+     * @param nextExpiry The Move-expiry to wait for (0 if none).
+     * @param nMaxWait The maximum wait time (in seconds).
+     */
+    void waitForExpiry( const hoxTimeMs nextExpiry,
+                        const int       nMaxWait );
+
+    /**
+     * Callback from a Table which has just started a Move-timer.
+     */
+    void onNewMoveExpiry( const hoxTimeMs expiry );
 
 private:
-    hoxTableMgr() {}
+    hoxTableMgr() : _restoreTime( 0 ), _expiryCond( NULL ), _nextWakeup( 0 ) {}
 
     const std::string _generateNewTableId();
 
+    hoxPlayer_SPtr _getRestoredPlayer( const hoxGameRecord& game,
+                                       const hoxColor       color,
+                                       const int            games[3] );
+    void _expireRestoredPlayers();
+
+    void _addToIndex( const int nId, const IndexKey& key );
+    void _removeFromIndex( const int nId );
+    bool _matchFilter( const IndexKey& key,
+                       const hoxTableFilter& filter ) const;
+
 private:
     mutable TableContainer  _tableMap;
     FreeTableIdList         _freeIdList;
+
+    IndexKeyMap             _indexKeys;
+    TableIdSet              _allIds;
+    TableIndex              _statusIndex;
+    TableIndex              _typeIndex;
+    TableIndex              _timeIndex;
+    TableIndex              _scoreIndex;  // By rating band of the max score.
+
+    typedef std::map<const std::string, hoxPlayer_SPtr> PlayerContainer;
+    PlayerContainer         _restoredPlayers;  // Placeholders, by Player-Id.
+    time_t                  _restoreTime;
+
+    st_cond_t               _expiryCond;  // To wake up the waiting thread.
+    hoxTimeMs               _nextWakeup;  // When the thread wakes up (0 = not waiting).
 };
 
 #endif /* __INCLUDED_HOX_TABLE_H__ */
@@ -57,6 +57,37 @@ hoxRequest::toString() const
 //
 // =========================================================================
 
+/**
+ * Write one line per Table, as used by the LIST response.
+ */
+static void
+_writeTableList( std::ostringstream& outStream,
+                 const hoxTableList& tables,
+                 const bool          bMillis )
+{
+    hoxPlayer_SPtr      redPlayer;
+    hoxPlayer_SPtr      blackPlayer;
+
+    for ( hoxTableList::const_iterator it = tables.begin();
+                                       it != tables.end(); ++it )
+    {
+        redPlayer   = (*it)->getRedPlayer();
+        blackPlayer = (*it)->getBlackPlayer();
+
+        outStream << (*it)->getId() << ";"
+                  << (*it)->getGameGroup() << ";"
+                  << (*it)->getGameType() << ";"
+                  << hoxUtil::timeInfoToString((*it)->getInitialTime(), bMillis) << ";"
+                  << hoxUtil::timeInfoToString((*it)->getRedTime(), bMillis) << ";"
+                  << hoxUtil::timeInfoToString((*it)->getBlackTime(), bMillis) << ";"
+                  << (redPlayer ? redPlayer->getId() : "") << ";"
+                  << (redPlayer ? redPlayer->getScore() : 0) << ";"
+                  << (blackPlayer ? blackPlayer->getId() : "") << ";"
+                  << (blackPlayer ? blackPlayer->getScore() : 0) << ";"
+                  << "\n";
+    }
+}
+
 hoxResponse::hoxResponse( hoxRequestType type,
                           hoxResult      code /* = hoxRC_OK */ )
         : _type( type )
@@ -204,7 +235,8 @@ hoxResponse::create_event_I_PLAYERS( const std::string& sEventContent )
 
 /*static*/ 
 hoxResponse_SPtr
-hoxResponse::create_event_I_TABLE( const hoxTable*  pTable )
+hoxResponse::create_event_I_TABLE( const hoxTable*  pTable,
+                                   const bool       bMillis /* = false */ )
 {
     std::ostringstream  outStream;
 
@@ -218,9 +250,9 @@ hoxResponse::create_event_I_TABLE( const hoxTable*  pTable )
     outStream << pTable->getId() << ";"
               << pTable->getGameGroup() << ";"
               << pTable->getGameType() << ";"
-              << hoxUtil::timeInfoToString(pTable->getInitialTime()) << ";"
-              << hoxUtil::timeInfoToString(redTime) << ";"
-              << hoxUtil::timeInfoToString(blackTime) << ";"
+              << hoxUtil::timeInfoToString(pTable->getInitialTime(), bMillis) << ";"
+              << hoxUtil::timeInfoToString(redTime, bMillis) << ";"
+              << hoxUtil::timeInfoToString(blackTime, bMillis) << ";"
               << (redPlayer ? redPlayer->getId() : "") << ";"
               << (redPlayer ? redPlayer->getScore() : 0) << ";"
               << (blackPlayer ? blackPlayer->getId() : "") << ";"
@@ -244,30 +276,12 @@ hoxResponse::create_event_I_TABLE( const hoxTable*  pTable )
 
 /*static*/ 
 hoxResponse_SPtr
-hoxResponse::create_event_LIST( const hoxTableList& tables )
+hoxResponse::create_event_LIST( const hoxTableList& tables,
+                                const bool          bMillis /* = false */ )
 {
     std::ostringstream  outStream;
-    hoxPlayer_SPtr      redPlayer;
-    hoxPlayer_SPtr      blackPlayer;
-
-    for ( hoxTableList::const_iterator it = tables.begin();
-                                       it != tables.end(); ++it )
-    {
-        redPlayer   = (*it)->getRedPlayer();
-        blackPlayer = (*it)->getBlackPlayer();
 
-        outStream << (*it)->getId() << ";"
-                  << (*it)->getGameGroup() << ";"
-                  << (*it)->getGameType() << ";"
-                  << hoxUtil::timeInfoToString((*it)->getInitialTime()) << ";"
-                  << hoxUtil::timeInfoToString((*it)->getRedTime()) << ";"
-                  << hoxUtil::timeInfoToString((*it)->getBlackTime()) << ";"
-                  << (redPlayer ? redPlayer->getId() : "") << ";"
-                  << (redPlayer ? redPlayer->getScore() : 0) << ";"
-                  << (blackPlayer ? blackPlayer->getId() : "") << ";"
-                  << (blackPlayer ? blackPlayer->getScore() : 0) << ";"
-                  << "\n";
-    }
+    _writeTableList( outStream, tables, bMillis );
 
     if ( tables.empty() )
     {
@@ -280,6 +294,23 @@ hoxResponse::create_event_LIST( const hoxTableList& tables )
     return pResponse;
 }
 
+/*static*/ 
+hoxResponse_SPtr
+hoxResponse::create_event_LIST( const hoxTableList& tables,
+                                const int           nextCursor,
+                                const bool          bMillis /* = false */ )
+{
+    std::ostringstream  outStream;
+
+    outStream << nextCursor << ";" << tables.size() << ";" << "\n";
+    _writeTableList( outStream, tables, bMillis );
+
+    hoxResponse_SPtr pResponse( new hoxResponse( hoxREQUEST_LIST ) );
+    pResponse->setContent( outStream.str() );
+
+    return pResponse;
+}
+
 /*static*/
 hoxResponse_SPtr
 hoxResponse::create_event_E_JOIN( const hoxTable*   pTable,
@@ -477,14 +508,15 @@ hoxResponse_SPtr
 hoxResponse::create_event_UPDATE( const hoxTable*    pTable,
                                   const hoxPlayer_SPtr player,
                                   const hoxGameType  newGameType,
-                                  const hoxTimeInfo& newInitialTime )
+                                  const hoxTimeInfo& newInitialTime,
+                                  const bool         bMillis /* = false */ )
 {
     std::ostringstream  outStream;
 
     outStream << pTable->getId() << ";"
               << player->getId() << ";"
               << (newGameType == hoxGAME_TYPE_RATED ? "1" : "0") << ";"
-              << hoxUtil::timeInfoToString( newInitialTime )
+              << hoxUtil::timeInfoToString( newInitialTime, bMillis )
               << "\n";
 
     hoxResponse_SPtr pResponse( new hoxResponse( hoxREQUEST_UPDATE ) );
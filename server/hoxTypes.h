@@ -43,6 +43,8 @@ typedef std::list<hoxResponse_SPtr> hoxResponseSList;
 
 typedef std::list<std::string> hoxStringList;
 
+typedef long long hoxTimeMs;  // A time (in milliseconds) of the monotonic clock.
+
 /**
  * Container for parameters.
  */
@@ -120,11 +122,27 @@ public:
     static hoxResponse_SPtr
     create_event_I_PLAYERS( const std::string& sEventContent );
 
+    /**
+     * @param bMillis Whether the timers are sent in milliseconds
+     *                (instead of seconds).
+     */
+    static hoxResponse_SPtr
+    create_event_I_TABLE( const hoxTable*  pTable,
+                          const bool       bMillis = false );
+
     static hoxResponse_SPtr
-    create_event_I_TABLE( const hoxTable*  pTable );
+    create_event_LIST( const hoxTableList& tables,
+                       const bool          bMillis = false );
 
+    /**
+     * Create the response of a paged (filtered) LIST request.
+     * The first line is "<next-cursor>;<count>;", followed by the Tables
+     * in the same format as the regular LIST.
+     */
     static hoxResponse_SPtr
-    create_event_LIST( const hoxTableList& tables );
+    create_event_LIST( const hoxTableList& tables,
+                       const int           nextCursor,
+                       const bool          bMillis = false );
 
     static hoxResponse_SPtr
     create_event_E_JOIN( const hoxTable*  pTable,
@@ -170,11 +188,16 @@ public:
     create_event_I_MOVES( const hoxTable*      pTable,
                           const hoxStringList& moves );
 
+    /**
+     * @param bMillis Whether the timers are sent in milliseconds
+     *                (instead of seconds).
+     */
     static hoxResponse_SPtr
     create_event_UPDATE( const hoxTable*    pTable,
                          const hoxPlayer_SPtr player,
                          const hoxGameType  newGameType,
-                         const hoxTimeInfo& newInitialTime );
+                         const hoxTimeInfo& newInitialTime,
+                         const bool         bMillis = false );
 
     static hoxResponse_SPtr
     create_event_POLL( const hoxResponseSList& responseList );
@@ -188,6 +211,8 @@ private:
 
 /**
  * Game's Time-info.
+ * All values are in milliseconds. On the network, they are in seconds
+ * unless the client asks for milliseconds (see hoxUtil::timeInfoToString).
  */
 class hoxTimeInfo
 {
@@ -13,6 +13,8 @@
 #include <sstream>
 #include <boost/tokenizer.hpp>
 #include <cstdlib>     // rand()
+#include <cmath>       // floor()
+#include <ctime>       // clock_gettime()
 #include "hoxUtil.h"
 #include "hoxLog.h"
 #include "hoxSocketAPI.h"
@@ -56,6 +58,8 @@ hoxUtil::requestTypeToString( const hoxRequestType requestType )
         case hoxREQUEST_I_MOVES:     return "I_MOVES";
         case hoxREQUEST_INVITE:      return "INVITE";
         case hoxREQUEST_PLAYER_INFO:   return "PLAYER_INFO";
+        case hoxREQUEST_LEADERBOARD:   return "LEADERBOARD";
+        case hoxREQUEST_HISTORY:       return "HISTORY";
         case hoxREQUEST_PLAYER_STATUS: return "PLAYER_STATUS";
         case hoxREQUEST_MSG:         return "MSG";
         case hoxREQUEST_PING:        return "PING";
@@ -63,7 +67,13 @@ hoxUtil::requestTypeToString( const hoxRequestType requestType )
         case hoxREQUEST_DB_PLAYER_PUT:    return "DB_PLAYER_PUT";
         case hoxREQUEST_DB_PLAYER_GET:    return "DB_PLAYER_GET";
         case hoxREQUEST_DB_PLAYER_SET:    return "DB_PLAYER_SET";
+        case hoxREQUEST_DB_PLAYER_SET_BATCH: return "DB_PLAYER_SET_BATCH";
+        case hoxREQUEST_DB_GAME_PUT_BATCH: return "DB_GAME_PUT_BATCH";
+        case hoxREQUEST_DB_GAMES_GET:     return "DB_GAMES_GET";
         case hoxREQUEST_DB_PASSWORD_SET:  return "DB_PASSWORD_SET";
+        case hoxREQUEST_DB_PLAYER_INVALIDATE: return "DB_PLAYER_INVALIDATE";
+        case hoxREQUEST_DB_LEADERS_GET:   return "DB_LEADERS_GET";
+        case hoxREQUEST_DB_RANK_GET:      return "DB_RANK_GET";
 
         case hoxREQUEST_HTTP_GET:    return "HTTP_GET";
         case hoxREQUEST_HTTP_POST:   return "HTTP_POST";
@@ -104,6 +114,8 @@ hoxUtil::stringToRequestType( const std::string& input )
     if ( input == "I_MOVES" )     return hoxREQUEST_I_MOVES;
     if ( input == "INVITE" )      return hoxREQUEST_INVITE;
     if ( input == "PLAYER_INFO" )   return hoxREQUEST_PLAYER_INFO;
+    if ( input == "LEADERBOARD" )   return hoxREQUEST_LEADERBOARD;
+    if ( input == "HISTORY" )       return hoxREQUEST_HISTORY;
     if ( input == "PLAYER_STATUS" ) return hoxREQUEST_PLAYER_STATUS;
     if ( input == "MSG" )         return hoxREQUEST_MSG;
     if ( input == "PING" )        return hoxREQUEST_PING;
@@ -111,7 +123,13 @@ hoxUtil::stringToRequestType( const std::string& input )
     if ( input == "DB_PLAYER_PUT" )   return hoxREQUEST_DB_PLAYER_PUT;
     if ( input == "DB_PLAYER_GET" )   return hoxREQUEST_DB_PLAYER_GET;
     if ( input == "DB_PLAYER_SET" )   return hoxREQUEST_DB_PLAYER_SET;
+    if ( input == "DB_PLAYER_SET_BATCH" ) return hoxREQUEST_DB_PLAYER_SET_BATCH;
+    if ( input == "DB_GAME_PUT_BATCH" ) return hoxREQUEST_DB_GAME_PUT_BATCH;
+    if ( input == "DB_GAMES_GET" )    return hoxREQUEST_DB_GAMES_GET;
     if ( input == "DB_PASSWORD_SET" ) return hoxREQUEST_DB_PASSWORD_SET;
+    if ( input == "DB_PLAYER_INVALIDATE" ) return hoxREQUEST_DB_PLAYER_INVALIDATE;
+    if ( input == "DB_LEADERS_GET" )  return hoxREQUEST_DB_LEADERS_GET;
+    if ( input == "DB_RANK_GET" )     return hoxREQUEST_DB_RANK_GET;
 
     if ( input == "HTTP_GET" )  return hoxREQUEST_HTTP_GET;
     if ( input == "HTTP_POST" ) return hoxREQUEST_HTTP_POST;
@@ -163,9 +181,9 @@ hoxUtil::stringToTimeInfo( const std::string& input )
     {
         switch (i++)
         {
-            case 0: timeInfo.nGame = ::atoi(it->c_str()); break;
-            case 1: timeInfo.nMove = ::atoi(it->c_str()); break;
-            case 2: timeInfo.nFree = ::atoi(it->c_str()); break;
+            case 0: timeInfo.nGame = (int) ::floor( ::atof(it->c_str()) * 1000 + 0.5 ); break;
+            case 1: timeInfo.nMove = (int) ::floor( ::atof(it->c_str()) * 1000 + 0.5 ); break;
+            case 2: timeInfo.nFree = (int) ::floor( ::atof(it->c_str()) * 1000 + 0.5 ); break;
             default: break; // Ignore the rest.
         }
     }
@@ -174,16 +192,26 @@ hoxUtil::stringToTimeInfo( const std::string& input )
 }
 
 const std::string
-hoxUtil::timeInfoToString( const hoxTimeInfo timeInfo )
+hoxUtil::timeInfoToString( const hoxTimeInfo timeInfo,
+                           const bool        bMillis /* = false */ )
 {
     std::ostringstream outStream;
 
-    outStream << timeInfo.nGame << "/"
-              << timeInfo.nMove << "/"
-              << timeInfo.nFree;
+    const int nUnit = ( bMillis ? 1 : 1000 );
+    outStream << timeInfo.nGame / nUnit << "/"
+              << timeInfo.nMove / nUnit << "/"
+              << timeInfo.nFree / nUnit;
     return outStream.str();
 }
 
+hoxTimeMs
+hoxUtil::getMonotonicTime()
+{
+    struct timespec ts;
+    ::clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (hoxTimeMs) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 const std::string
 hoxUtil::intToString( const int number )
 {
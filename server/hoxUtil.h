@@ -47,16 +47,27 @@ namespace hoxUtil
 
     /**
      * Convert a given (human-readable) string to a Time-Info\ of
-     * of the format "nGame/nMove/nFree".
+     * of the format "nGame/nMove/nFree" (in seconds, possibly fractional).
      */
     hoxTimeInfo
     stringToTimeInfo( const std::string& input );
 
     /**
      * Convert a given Time-Info to a (human-readable) string.
+     *
+     * @param bMillis If true, the values are in milliseconds.
+     *                Otherwise, they are in (whole) seconds.
      */
     const std::string
-    timeInfoToString( const hoxTimeInfo timeInfo );
+    timeInfoToString( const hoxTimeInfo timeInfo,
+                      const bool        bMillis = false );
+
+    /**
+     * Get the current time (in milliseconds) of the monotonic clock.
+     * @note Only the difference between two values is meaningful.
+     */
+    hoxTimeMs
+    getMonotonicTime();
 
     /**
      * Convert a given Integer to a string.
@@ -48,8 +48,14 @@
 #include "hoxEnums.h"
 #include "hoxTypes.h"
 #include "hoxDbClient.h"
+#include "hoxLogRing.h"
+#include "hoxLogWriter.h"
 #include "hoxFileMgr.h"
 #include "hoxSessionMgr.h"
+#include "hoxGameArchive.h"
+#include "hoxEventLog.h"
+#include "hoxCheckpoint.h"
+#include "hoxTable.h"
 
 /******************************************************************
  * Server configuration parameters
@@ -58,6 +64,10 @@
 /* Log files */
 #define PID_FILE    "pid"
 #define ERRORS_FILE "errors.log"
+#define CHECKPOINT_FILE_FORMAT "tables.%d.state"  /* One per VP */
+#define OUTBOX_FILE_FORMAT     "outbox.%d.log"    /* One per VP */
+#define LOG_FILE_FORMAT        "server.%d.log"    /* One per VP */
+#define EVENT_FILE_FORMAT      "events.%d.bin"    /* One per VP */
 
 /* Default server port */
 #define SERV_PORT_DEFAULT 8000
@@ -77,9 +87,16 @@
 /* Access log buffer flushing interval (in seconds) */
 #define ACCLOG_FLUSH_INTERVAL 2 /* 30 */
 
+/* The default size of the buffer of a VP's log file (in bytes) */
+#define LOG_BUFFER_SIZE_DEFAULT  ( 4 * 1024 * 1024 )
+
+/* The default size of a Game archive's segment (in bytes) */
+#define ARCHIVE_SEGMENT_SIZE_DEFAULT  ( 64 * 1024 * 1024 )
+
 /* DBAgent host and port */
 #define DBAGENT_DEFAULT_IP    "0.0.0.0"
 #define DBAGENT_DEFAULT_PORT  7000
+#define DBAGENT_DEFAULT_POOL_SIZE  1
 
 /******************************************************************
  * Global data
@@ -116,6 +133,8 @@ static char *username   = NULL;
 static int listenq_size = LISTENQ_SIZE_DEFAULT;
 static const char* s_dbagent_ip   = DBAGENT_DEFAULT_IP;
 static int         s_dbagent_port = DBAGENT_DEFAULT_PORT;
+static int         s_dbagent_pool_size = DBAGENT_DEFAULT_POOL_SIZE;
+static int         s_dbagent_timeout   = 0;  /* The DB-Client's default */
 /*static*/ int g_errfd    = STDERR_FILENO;
 
 hoxGlobalConfig g_config;    /* The global configuration */
@@ -158,6 +177,7 @@ static void start_processes( void );
 static void wdog_sighandler( int signo );
 static void child_sighandler( int signo );
 static void install_sighandlers( void );
+static void restore_tables( void );
 static void start_threads( void );
 static void *process_signals( void *arg );
 static void *flush_acclog_buffer( void *arg );
@@ -261,6 +281,9 @@ main( int argc, char *argv[] )
     /* Load configuration from config files */
     load_configs();
 
+    /* Restore the in-progress Tables (if this VP was restarted) */
+    restore_tables();
+
     /* Start all threads */
     start_threads();
 
@@ -804,6 +827,8 @@ static void *process_signals( void *arg )
             case SIGHUP:
                 err_report( g_errfd, "INFO: process %d (pid %d): caught SIGHUP,"
                             " reloading configuration", my_index, my_pid );
+                hoxLogWriter::reopen();
+                hoxEventLog::getInstance()->reopen();
                 if ( interactive_mode )
                 {
                     load_configs();
@@ -828,7 +853,9 @@ static void *process_signals( void *arg )
                 err_report( g_errfd, "INFO: process %d (pid %d): caught SIGTERM,"
                             " terminating", my_index, my_pid );
                 logbuf_flush();
+                hoxLogWriter::stop();
                 hoxDbClient::deinitialize();
+                hoxLogRing::close();
                 exit( 0 );
             case SIGUSR1:
                 err_report( g_errfd, "INFO: process %d (pid %d): caught SIGUSR1",
@@ -865,6 +892,30 @@ static void *flush_acclog_buffer( void *arg )
 }
 
 
+/******************************************************************/
+
+static void restore_tables( void )
+{
+    if ( interactive_mode )
+        return;
+
+    char szName[32];
+    snprintf( szName, sizeof(szName), CHECKPOINT_FILE_FORMAT, my_index );
+    const std::string sPath = get_actual_path( szName );
+
+    if ( hoxRC_OK != hoxCheckpoint::getInstance()->open( sPath ) )
+    {
+        err_sys_report( g_errfd, "ERROR: process %d (pid %d): can't open"
+                        " the checkpoint [%s]", my_index, my_pid, sPath.c_str() );
+        return;
+    }
+
+    const int nTables = hoxTableMgr::getInstance()->restoreTables();
+    err_report( g_errfd, "INFO: process %d (pid %d): %d table(s) restored from [%s].",
+                my_index, my_pid, nTables, sPath.c_str() );
+}
+
+
 /******************************************************************/
 
 static void start_threads( void )
@@ -1027,6 +1078,45 @@ void load_configs( void )
             }
         }
 
+        /* --- Log's settings. Each VP writes its own file (if there is
+         *     a log directory), and sends to the DB Agent if asked.
+         */
+
+        if ( s_logdir != NULL )
+        {
+            int nBufferSize = LOG_BUFFER_SIZE_DEFAULT;
+            cfg.lookupValue( "server.log.bufferSize", nBufferSize );
+            char szName[32];
+            snprintf( szName, sizeof(szName), LOG_FILE_FORMAT, my_index );
+            const std::string sPath = get_actual_path( szName );
+            err_report( g_errfd, "INFO: ... server.log: file = [%s], bufferSize = [%d].",
+                        sPath.c_str(), nBufferSize );
+            if ( hoxRC_OK != hoxLogWriter::start( sPath, nBufferSize ) )
+                err_sys_report( g_errfd, "ERROR: process %d (pid %d): can't open"
+                                " the log file [%s]", my_index, my_pid, sPath.c_str() );
+        }
+
+        g_config.logToDbAgent = false;
+        cfg.lookupValue( "server.log.toDbAgent", g_config.logToDbAgent );
+        err_report( g_errfd, "INFO: ... server.log.toDbAgent = [%d].", g_config.logToDbAgent );
+
+        bool bLogEvents = false;
+        cfg.lookupValue( "server.log.events", bLogEvents );
+        if ( s_logdir != NULL && bLogEvents )
+        {
+            char szName[32];
+            snprintf( szName, sizeof(szName), EVENT_FILE_FORMAT, my_index );
+            const std::string sPath = get_actual_path( szName );
+            err_report( g_errfd, "INFO: ... server.log.events: file = [%s].", sPath.c_str() );
+            if ( hoxRC_OK != hoxEventLog::getInstance()->open( sPath ) )
+                err_sys_report( g_errfd, "ERROR: process %d (pid %d): can't open"
+                                " the event log [%s]", my_index, my_pid, sPath.c_str() );
+        }
+        else
+        {
+            hoxEventLog::getInstance()->close();
+        }
+
         /* --- DB Agent's settings. */
 
         const std::string sDbAgentIp = cfg.lookup( "server.dbAgent.ip" );
@@ -1036,13 +1126,60 @@ void load_configs( void )
         s_dbagent_port = cfg.lookup( "server.dbAgent.port" );
         err_report( g_errfd, "INFO: ... server.dbAgent.port = [%d].", s_dbagent_port );
 
+        cfg.lookupValue( "server.dbAgent.poolSize", s_dbagent_pool_size );
+        err_report( g_errfd, "INFO: ... server.dbAgent.poolSize = [%d].", s_dbagent_pool_size );
+
+        cfg.lookupValue( "server.dbAgent.callTimeout", s_dbagent_timeout );
+        err_report( g_errfd, "INFO: ... server.dbAgent.callTimeout = [%d].", s_dbagent_timeout );
+
+        /* Keep the writes to the Database in a durable outbox, so that they
+         * survive the DB Agent being down (and this VP being restarted).
+         */
+        if ( ! interactive_mode )
+        {
+            char szName[32];
+            snprintf( szName, sizeof(szName), OUTBOX_FILE_FORMAT, my_index );
+            const std::string sPath = get_actual_path( szName );
+            if ( hoxRC_OK != hoxDbClient::open_outbox( sPath ) )
+                err_sys_report( g_errfd, "ERROR: process %d (pid %d): can't open"
+                                " the outbox [%s]", my_index, my_pid, sPath.c_str() );
+        }
+
         /* Initialize the DB-Client.
          * NOTE: This is done before "load_configs" since we will need to preload
          *       files from disk (for caching purpose.)
          */
-        if ( hoxRC_OK != hoxDbClient::initialize( s_dbagent_ip, s_dbagent_port ) )
+        if ( hoxRC_OK != hoxDbClient::initialize( s_dbagent_ip, s_dbagent_port,
+                                                 s_dbagent_pool_size, s_dbagent_timeout ) )
             err_quit( g_errfd, "ERROR: failed to connect to DB-Client at [%s:%d]", s_dbagent_ip, s_dbagent_port );
+
+        /* Send the logs through the DB Agent's shared-memory ring (optional),
+         * if it runs on this host. Otherwise, they go with the DB calls.
+         */
+        std::string sLogRing;
+        if ( cfg.lookupValue( "server.dbAgent.logRing", sLogRing ) )
+        {
+            err_report( g_errfd, "INFO: ... server.dbAgent.logRing = [%s].", sLogRing.c_str() );
+            if ( hoxRC_OK != hoxLogRing::open( sLogRing.c_str() ) )
+                err_report( g_errfd, "WARN: failed to open the log ring [%s]. Logs are sent to DB Agent instead.",
+                            sLogRing.c_str() );
+        }
         
+        /* --- Game Archive's settings (optional). */
+
+        std::string sArchiveLocation;
+        if ( cfg.lookupValue( "server.archive.location", sArchiveLocation ) )
+        {
+            int nSegmentSize = ARCHIVE_SEGMENT_SIZE_DEFAULT;
+            cfg.lookupValue( "server.archive.segmentSize", nSegmentSize );
+            err_report( g_errfd, "INFO: ... server.archive.location = [%s], segmentSize = [%d].",
+                        sArchiveLocation.c_str(), nSegmentSize );
+            if ( hoxRC_OK != hoxGameArchive::getInstance()->open( sArchiveLocation,
+                                                                  my_index, nSegmentSize ) )
+                err_sys_report( g_errfd, "ERROR: failed to open the Game archive at [%s]",
+                                sArchiveLocation.c_str() );
+        }
+
         /* --- File Manager's settings. */
 
         hoxFileMgr::m_bCacheEnabled = cfg.lookup( "server.fileMgr.cacheEnabled" );
@@ -1093,6 +1230,8 @@ void logbuf_open( void )
 void logbuf_flush( void )
 {
     hoxFlushPendingLogMsgs();
+    hoxGameArchive::getInstance()->flush();
+    hoxEventLog::getInstance()->flush();
 }
 
 
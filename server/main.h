@@ -17,10 +17,11 @@
 class hoxGlobalConfig
 {
 public:
-    hoxGlobalConfig() : minLogLevel( LOG_DEBUG )
+    hoxGlobalConfig() : minLogLevel( LOG_DEBUG ), logToDbAgent( false )
         { /* empty */ }
 
     hoxLogLevel  minLogLevel;        /* Minimal log level      */
+    bool         logToDbAgent;       /* Also send the logs to DB Agent? */
 };
 
 /* Defined in main.cpp */
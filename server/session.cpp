@@ -34,7 +34,8 @@
 #define NEW_PLAYER_SCORE   1500  /* The initial score of new Players. */
 
 #define SESSION_MANAGER_INTERVAL 5 /* Session manager interval (in seconds) */
-#define TABLE_MANAGER_INTERVAL   1 /* Table manager interval (in seconds) */
+#define TABLE_MANAGER_INTERVAL   1 /* Table manager interval (in seconds),
+                                    * unless a Move-timer expires earlier. */
 
 /******************************************************************
  * Extern declaration
@@ -98,16 +99,26 @@ _handle_request_REGISTER( st_netfd_t             nfd,
         hoxPlayer_SPtr pPlayer( new hoxPlayer( sPlayerId ) );
 
         /* Check if the Player's ID has been taken. */
-        if ( hoxRC_OK == hoxDbClient::get_player_info( pPlayer ) )
+        const hoxResult getResult = hoxDbClient::get_player_info( pPlayer );
+        if ( getResult == hoxRC_OK )
         {
             throw hoxError(hoxRC_NOT_FOUND, "Player-ID not available");
         }
+        else if ( getResult == hoxRC_TIMEOUT )
+        {
+            throw hoxError(hoxRC_TIMEOUT, "Database not available. Please try again later");
+        }
 
         pPlayer->setScore( NEW_PLAYER_SCORE );
         pPlayer->setHPassword( hpassword );
 
         /* Put (save/create) this new Player into the Database. */
-        if ( hoxRC_OK != hoxDbClient::put_player_info( pPlayer, sEmail ) )
+        const hoxResult putResult = hoxDbClient::put_player_info( pPlayer, sEmail );
+        if ( putResult == hoxRC_TIMEOUT )
+        {
+            throw hoxError(hoxRC_TIMEOUT, "Database not available. Please try again later");
+        }
+        else if ( putResult != hoxRC_OK )
         {
             throw hoxError(hoxRC_ERR, "Failed to register new player into DB");
         }
@@ -218,7 +229,13 @@ _authenticate_player( const std::string& sPlayerId,
 {
     hoxPlayer_SPtr pPlayer( new hoxPlayer( sPlayerId ) );
 
-    if ( hoxRC_OK != hoxDbClient::get_player_info( pPlayer ) )
+    const hoxResult result = hoxDbClient::get_player_info( pPlayer );
+    if ( result == hoxRC_TIMEOUT )
+    {
+        hoxLog(LOG_WARN, "%s: Player [%s] not authenticated: DB timed out.", __FUNCTION__, sPlayerId.c_str());
+        throw hoxError(hoxRC_TIMEOUT, "Database not available. Please try again later");
+    }
+    else if ( result != hoxRC_OK )
     {
         throw hoxError(hoxRC_NOT_FOUND, "Failed to get player's info");
     }
@@ -415,10 +432,11 @@ session_manager_thread( void* arg )
 void*
 table_manager_thread( void* arg )
 {
+    hoxTimeMs nextExpiry = 0;
     for (;;)
     {
-        st_sleep( TABLE_MANAGER_INTERVAL );
-        hoxTableMgr::getInstance()->manageTables();
+        hoxTableMgr::getInstance()->waitForExpiry( nextExpiry, TABLE_MANAGER_INTERVAL );
+        nextExpiry = hoxTableMgr::getInstance()->manageTables();
     }
 
     /* NOTREACHED */